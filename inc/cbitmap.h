@@ -0,0 +1,167 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef CBITMAP_H
+#define CBITMAP_H
+
+#include <stddef.h> /* size_t */
+
+/*
+ * Concurrent bitmap: bits are claimed and released by any number of
+ * threads with CAS on the word that holds them, no locks. A summary bit
+ * per word says the word was seen full, so searches skip it. Summary bits
+ * are set and cleared lazily by whoever notices, and may be stale; a
+ * search that finds nothing through them checks every word before giving
+ * up, so a clear bit is never missed for good.
+ *
+ * Claim, ClaimBit, Release, SetRange and ClearRange may run at the same
+ * time from any threads. The counting and finding functions read a
+ * moving target and are exact only while nothing writes.
+ */
+typedef struct cbitmap cbitmap_t;
+
+
+/**
+ * Creates a bitmap with every bit clear.
+ *
+ * @param: num_bits The number of bits, at least 1.
+ * @return:A pointer to the newly created bitmap.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(n / 64)
+ */
+cbitmap_t *CBitmapCreate(size_t num_bits);
+
+
+
+/**
+ * Destroys a bitmap. No thread may use it during or after this call.
+ *
+ * Time Complexity: O(1)
+ */
+void CBitmapDestroy(cbitmap_t *cbitmap);
+
+
+
+/**
+ * Claims a clear bit, trying from hint on and wrapping around. Threads
+ * that start from hints far apart work on different words and do not
+ * contend.
+ *
+ * @param: cbitmap The bitmap.
+ * @param: hint Where to start looking, any value.
+ * @return: The index of the claimed bit, num_bits if every bit is set.
+ *
+ * Time Complexity: O(1) near a clear bit, O(n / 64) worst case
+ */
+size_t CBitmapClaim(cbitmap_t *cbitmap, size_t hint);
+
+
+
+/**
+ * Claims a given bit.
+ *
+ * @param: cbitmap The bitmap.
+ * @param: idx The bit to claim, below num_bits.
+ * @return: 1 if the bit was clear and is now claimed, 0 if it was set.
+ *
+ * Time Complexity: O(1)
+ */
+int CBitmapClaimBit(cbitmap_t *cbitmap, size_t idx);
+
+
+
+/**
+ * Clears a bit.
+ *
+ * @param: cbitmap The bitmap.
+ * @param: idx The bit to clear, below num_bits.
+ * @return: The previous value of the bit.
+ *
+ * Time Complexity: O(1)
+ */
+int CBitmapRelease(cbitmap_t *cbitmap, size_t idx);
+
+
+
+/**
+ * Sets every bit in [from, to), one atomic operation per word.
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+void CBitmapSetRange(cbitmap_t *cbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Sets the bits of one word that are set in bits, bit i of bits being
+ * bit word * 64 + i of the bitmap, in one atomic operation.
+ *
+ * @param: cbitmap The bitmap.
+ * @param: word The word, below (num_bits + 63) / 64.
+ * @param: bits The bits to set.
+ *
+ * Time Complexity: O(1)
+ */
+void CBitmapOrWord(cbitmap_t *cbitmap, size_t word, unsigned long bits);
+
+
+
+/**
+ * Clears every bit in [from, to), one atomic operation per word.
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+void CBitmapClearRange(cbitmap_t *cbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Counts the set bits in [from, to).
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+size_t CBitmapCountSetRange(const cbitmap_t *cbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Finds the n-th clear bit, counting from 0.
+ *
+ * @return: The index of the bit, num_bits if there are no more than n
+ *          clear bits.
+ *
+ * Time Complexity: O(n / 64)
+ */
+size_t CBitmapFindNthClear(const cbitmap_t *cbitmap, size_t n);
+
+
+
+/**
+ * Finds the first bit from "from" on that is set, or that is clear.
+ *
+ * @param: cbitmap The bitmap.
+ * @param: from The first bit to consider.
+ * @param: set 1 to find a set bit, 0 to find a clear one.
+ * @return: The index of the bit, num_bits if there is none.
+ *
+ * Time Complexity: O(n / 64)
+ */
+size_t CBitmapFindNext(const cbitmap_t *cbitmap, size_t from, int set);
+
+
+
+/**
+ * Returns the number of bits.
+ *
+ * Time Complexity: O(1)
+ */
+size_t CBitmapSize(const cbitmap_t *cbitmap);
+
+
+
+#endif /* CBITMAP_H */
@@ -0,0 +1,92 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef CVECTOR_H
+#define CVECTOR_H
+
+#include <stddef.h> /* size_t */
+
+/*
+ * Concurrent append-only vector. Elements live in segments of doubling
+ * size that are never moved or freed before CVectorDestroy, so any number
+ * of threads can push while others read.
+ *
+ * A push reserves its slot with one atomic fetch-add and publishes it once
+ * written. The committed prefix - every slot below CVectorSize() - only
+ * grows, and readers walk it without waiting on the writers.
+ */
+typedef struct cvector cvector_t;
+
+
+/**
+ * Creates a new concurrent vector.
+ *
+ * @param: element_size The size of each element.
+ * @return:A pointer to the newly created vector.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(1)
+ */
+cvector_t *CVectorCreate(size_t element_size);
+
+
+
+/**
+ * Destroys the vector, freeing all allocated memory. No thread may use
+ * the vector during or after this call.
+ *
+ * @param: cvector The vector to be destroyed.
+ *
+ * Time Complexity: O(log n)
+ */
+void CVectorDestroy(cvector_t *cvector);
+
+
+
+/**
+ * Appends an element. Safe to call from any number of threads.
+ *
+ * @param: cvector The vector.
+ * @param: data A pointer to the data to be appended.
+ * @return: 0 if successful, -1 if a new segment could not be allocated.
+ *
+ * Time Complexity: O(1), lock-free
+ * @note: A failed segment allocation leaves a hole the committed prefix
+ *        cannot pass, so every later push fails as well.
+ */
+int CVectorPushBack(cvector_t *cvector, const void *data);
+
+
+
+/**
+ * Returns the length of the committed prefix: every element below it is
+ * fully written and readable.
+ *
+ * @param: cvector The vector.
+ * @return: The number of committed elements.
+ *
+ * Time Complexity: O(1), wait-free
+ */
+size_t CVectorSize(const cvector_t *cvector);
+
+
+
+/**
+ * Gets access to a committed element. The address stays valid until the
+ * vector is destroyed.
+ *
+ * @param: cvector The vector.
+ * @param: idx An index below a value returned by CVectorSize.
+ * @return: A pointer to the element.
+ *
+ * Time Complexity: O(1), wait-free
+ */
+void *CVectorGetAccessToElement(const cvector_t *cvector, size_t idx);
+
+
+
+#endif /* CVECTOR_H */
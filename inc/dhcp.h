@@ -1,8 +1,8 @@
 /*//////////////////////////////////////
-Name: Alon Weinberg                    
-Reviewer:                              
-last date updated: 02/4/24             
-File type: header file                   
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
 //////////////////////////////////////*/ 
 
 
@@ -23,6 +23,25 @@ typedef enum status
 
 typedef struct dhcp dhcp_t;
 
+/* how a pool tracks its addresses:
+   TRIE       - a binary trie, memory follows the number of allocations
+   BITMAP     - one bit per address plus summary words, allocation and free
+                are a handful of word operations (2MB for a /8)
+   CONCURRENT - a bitmap that many threads use at once without a lock.
+                DHCPAllocateIP, DHCPAllocateMany, DHCPFreeIP, DHCPFreeMany,
+                DHCPReserveRange and DHCPReleaseRange may be called from
+                any threads, each claiming with CAS on a bitmap word. With
+                no requested address each thread allocates near its own
+                spot in the pool rather than the first free address.
+                Counts and DHCPGetNthFree are exact only while no thread
+                writes */
+typedef enum dhcp_backend
+{
+    DHCP_BACKEND_TRIE = 0,
+    DHCP_BACKEND_BITMAP,
+    DHCP_BACKEND_CONCURRENT
+} dhcp_backend_t;
+
 /* broadcast - host ip is all 1's
    DHCP ip   - host ip is all 1's but the last (...11110)
     - host ip is all 0's                                */
@@ -30,6 +49,11 @@ typedef struct dhcp dhcp_t;
 dhcp_t *DHCPCreate(const unsigned char subnet_addr[BYTES_IN_IP], 
                    size_t bits_in_subnet); 
 
+/* same as DHCPCreate, on the chosen backend. DHCPCreate uses the trie */
+/*O(logn) trie, O(n / 64) bitmaps*/
+dhcp_t *DHCPCreateWithBackend(const unsigned char subnet_addr[BYTES_IN_IP],
+                              size_t bits_in_subnet, dhcp_backend_t backend);
+
 
 /* if gets NULL - does nothing */
 /*O(n)*/
@@ -44,13 +68,78 @@ status_t DHCPAllocateIP(dhcp_t *dhcp,
 
 /* indicate double free error */
 /*O(Log n)*/
-status_t DHCPFreeIP(dhcp_t *dhcp, 
+status_t DHCPFreeIP(dhcp_t *dhcp,
                     const unsigned char ip_addr[BYTES_IN_IP]);
 
+/* the n smallest free addresses, BYTES_IN_IP bytes each in result_ips.
+   all or nothing - DHCP_STATUS_FULL_ERR when less than n are free */
+/*O(Log n) per run of free addresses, plus O(n) to write them*/
+status_t DHCPAllocateMany(dhcp_t *dhcp, size_t n, unsigned char *result_ips);
+
+/* n addresses of BYTES_IN_IP bytes each. every allocated one is freed,
+   DHCP_STATUS_DOUBLE_FREE_ERR if some were not allocated */
+/*O(Log n) per run of consecutive addresses*/
+status_t DHCPFreeMany(dhcp_t *dhcp, size_t n, const unsigned char *ip_addrs);
+
+/* takes every free address in [first_ip, last_ip], both inside the
+   subnet. taken addresses stay taken. all or nothing */
+/*O(Log^2 n) trie, O(n / 64) bitmap*/
+status_t DHCPReserveRange(dhcp_t *dhcp,
+                          const unsigned char first_ip[BYTES_IN_IP],
+                          const unsigned char last_ip[BYTES_IN_IP]);
+
+/* frees every address in [first_ip, last_ip], the reserved ones too */
+/*O(Log^2 n) trie, O(n / 64) bitmap*/
+status_t DHCPReleaseRange(dhcp_t *dhcp,
+                          const unsigned char first_ip[BYTES_IN_IP],
+                          const unsigned char last_ip[BYTES_IN_IP]);
+
 /* without preserved addresses */
-/*O(n)*/
+/*O(1), O(n / 64) concurrent*/
 size_t DHCPCountFree(const dhcp_t *dhcp); 
 
+/* the n-th free address counting from 0 in increasing order, DHCP_STATUS_FAIL
+   if there are no more than n free addresses */
+/*O(Log n) trie, O(n / 64) bitmap*/
+status_t DHCPGetNthFree(const dhcp_t *dhcp, size_t n,
+                        unsigned char result_ip[BYTES_IN_IP]);
+
+/* free addresses in [first_ip, last_ip], both inside the subnet */
+/*O(Log n) trie, O(n / 64) bitmap*/
+size_t DHCPCountFreeInRange(const dhcp_t *dhcp,
+                            const unsigned char first_ip[BYTES_IN_IP],
+                            const unsigned char last_ip[BYTES_IN_IP]);
+
+/* a snapshot of the pool written to fd: a 32 byte header, then the taken
+   addresses as runs of 8 bytes or as a raw bitmap, whichever is smaller.
+   every field is a big endian 32 bit word, so the file can be mapped and
+   read in place. a concurrent pool must not change while it is saved */
+/*O(runs of taken addresses) trie, O(n / 64) bitmaps*/
+status_t DHCPSave(const dhcp_t *dhcp, int fd);
+
+/* a pool on the chosen backend from a snapshot of DHCPSave. NULL on a
+   read error, a snapshot that is cut short or not one, or memory failure */
+/*O(runs of taken addresses) plus the reading*/
+dhcp_t *DHCPLoad(int fd, dhcp_backend_t backend);
+
+/* from now on every change to the pool is appended to fd as a 12 byte
+   record. records are buffered and reach fd when the buffer fills, on
+   DHCPJournalFlush, or on DHCPDestroy. an fd of -1 flushes and stops.
+   start a new journal right after each DHCPSave.
+   DHCP_STATUS_FAIL for a concurrent pool, or on memory failure */
+/*O(1)*/
+status_t DHCPJournalStart(dhcp_t *dhcp, int fd);
+
+/* writes the buffered records. DHCP_STATUS_FAIL if a write to the
+   journal failed since it was started */
+/*O(buffered records)*/
+status_t DHCPJournalFlush(dhcp_t *dhcp);
+
+/* applies a journal to the pool loaded from the snapshot taken before it
+   started. a record cut short by a crash ends the journal */
+/*O(records) times a range change*/
+status_t DHCPJournalReplay(dhcp_t *dhcp, int fd);
+
 
 #endif /* __DHCP_ILRD_1556__ */
 
@@ -0,0 +1,59 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef DHCP6_H
+#define DHCP6_H
+
+#include <stddef.h> /* size_t */
+
+#include "dhcp.h" /* status_t */
+
+#define BYTES_IN_IP6 (16)
+#define BITS_IN_IP6 (128)
+
+/* addresses and delegated prefixes of one IPv6 prefix. Every allocation
+   is an aligned block - a prefix of block_len bits, a single address when
+   block_len is 128. Only allocated blocks are stored, in a path compressed
+   binary trie whose nodes remember the largest free block below them, so
+   memory follows the number of allocations and not the size of the pool.
+   No address is reserved, the caller allocates the ones it keeps */
+typedef struct dhcp6 dhcp6_t;
+
+/* NULL if prefix_len is above 128 or on memory failure */
+/*O(1)*/
+dhcp6_t *DHCP6Create(const unsigned char prefix[BYTES_IN_IP6],
+                     size_t prefix_len);
+
+/* if gets NULL - does nothing */
+/*O(allocations)*/
+void DHCP6Destroy(dhcp6_t *dhcp6);
+
+/* a free block of block_len bits, prefix_len <= block_len <= 128. the
+   requested one when it is a free block of the pool, otherwise the lowest
+   free block. DHCP_STATUS_FULL_ERR when no block that large is free */
+/*O(128)*/
+status_t DHCP6Allocate(dhcp6_t *dhcp6, size_t block_len,
+                       unsigned char result[BYTES_IN_IP6],
+                       const unsigned char requested[BYTES_IN_IP6]);
+
+/* DHCP_STATUS_DOUBLE_FREE_ERR if block/block_len is not allocated as is */
+/*O(128)*/
+status_t DHCP6Free(dhcp6_t *dhcp6, const unsigned char block[BYTES_IN_IP6],
+                   size_t block_len);
+
+/* 1 if no address of block/block_len is allocated, 0 otherwise or when it
+   is not inside the pool */
+/*O(128)*/
+int DHCP6IsFree(const dhcp6_t *dhcp6, const unsigned char block[BYTES_IN_IP6],
+                size_t block_len);
+
+/* the number of allocated blocks */
+/*O(1)*/
+size_t DHCP6CountAllocated(const dhcp6_t *dhcp6);
+
+
+#endif /* DHCP6_H */
@@ -0,0 +1,106 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef DHCP_LEASE_H
+#define DHCP_LEASE_H
+
+#include <stddef.h> /* size_t */
+#include <time.h> /* time_t */
+
+#include "dhcp.h" /* dhcp_t, status_t */
+
+#define HWADDR_LEN (6)
+
+/* a lease ties an address of a dhcp_t to the client that owns it and the
+   time it runs out. The table keeps leases in a timing wheel of one
+   second slots, so a renew moves a lease between two slots in O(1) and
+   expiry only looks at the slots that came due, never at every lease.
+   Live leases are indexed by owner and by address in open addressing
+   hash tables, one lease per owner.
+
+   Times are whatever clock the caller passes in as now, in seconds */
+typedef struct dhcp_lease_table dhcp_lease_table_t;
+
+/* 0 is never a lease. An id stays valid until the lease is released or
+   reported by DHCPLeaseExpire */
+typedef unsigned int lease_id_t;
+
+#define LEASE_INVALID ((lease_id_t)0)
+
+/* called for every lease DHCPLeaseExpire reclaims, after its address is
+   back in the pool */
+typedef void (*lease_expire_func_t)(lease_id_t lease,
+                                    const unsigned char ip[BYTES_IN_IP],
+                                    const unsigned char owner[HWADDR_LEN],
+                                    void *param);
+
+/* leases of dhcp, which must outlive the table. expire_func may be NULL.
+   now is where the wheel starts */
+/*O(1)*/
+dhcp_lease_table_t *DHCPLeaseCreate(dhcp_t *dhcp, time_t now,
+                                    lease_expire_func_t expire_func,
+                                    void *param);
+
+/* the addresses of live leases stay allocated in the dhcp_t */
+/*O(n)*/
+void DHCPLeaseDestroy(dhcp_lease_table_t *table);
+
+/* allocates an address like DHCPAllocateIP and leases it to owner until
+   now + duration. An owner that already has a lease gets it back renewed,
+   with no new address - requested_ip is ignored then. LEASE_INVALID when
+   the pool is full or on memory failure */
+/*O(1) for a known owner, else O(Log n) trie, O(1) amortized for the lease*/
+lease_id_t DHCPLeaseGrant(dhcp_lease_table_t *table,
+                          const unsigned char owner[HWADDR_LEN],
+                          const unsigned char requested_ip[BYTES_IN_IP],
+                          time_t duration, time_t now,
+                          unsigned char result_ip[BYTES_IN_IP]);
+
+/* the lease now runs out at now + duration */
+/*O(1)*/
+status_t DHCPLeaseRenew(dhcp_lease_table_t *table, lease_id_t lease,
+                        time_t duration, time_t now);
+
+/* ends the lease and frees its address */
+/*O(1) plus DHCPFreeIP*/
+status_t DHCPLeaseRelease(dhcp_lease_table_t *table, lease_id_t lease);
+
+/* reclaims up to max leases that ran out by now, freeing their addresses
+   and calling the expire function. A call that stops at max goes on from
+   the same place next time. Returns the number reclaimed */
+/*O(due slots + expired leases)*/
+size_t DHCPLeaseExpire(dhcp_lease_table_t *table, time_t now, size_t max);
+
+/* the live lease of a client, LEASE_INVALID if it has none */
+/*O(1)*/
+lease_id_t DHCPLeaseFindByClient(const dhcp_lease_table_t *table,
+                                 const unsigned char owner[HWADDR_LEN]);
+
+/* the live lease on an address, LEASE_INVALID if there is none */
+/*O(1)*/
+lease_id_t DHCPLeaseFindByIP(const dhcp_lease_table_t *table,
+                             const unsigned char ip[BYTES_IN_IP]);
+
+/* DHCP_STATUS_FAIL if lease is not live */
+/*O(1)*/
+status_t DHCPLeaseGetIP(const dhcp_lease_table_t *table, lease_id_t lease,
+                        unsigned char ip[BYTES_IN_IP]);
+
+/*O(1)*/
+status_t DHCPLeaseGetOwner(const dhcp_lease_table_t *table, lease_id_t lease,
+                           unsigned char owner[HWADDR_LEN]);
+
+/* (time_t)-1 if lease is not live */
+/*O(1)*/
+time_t DHCPLeaseGetExpiry(const dhcp_lease_table_t *table, lease_id_t lease);
+
+/* the number of live leases */
+/*O(1)*/
+size_t DHCPLeaseCount(const dhcp_lease_table_t *table);
+
+
+#endif /* DHCP_LEASE_H */
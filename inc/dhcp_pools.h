@@ -0,0 +1,85 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef DHCP_POOLS_H
+#define DHCP_POOLS_H
+
+#include <stddef.h> /* size_t */
+
+#include "dhcp.h" /* dhcp_t, status_t */
+
+/* many dhcp_t scopes behind one longest-prefix-match index. A request is
+   routed by the relay or interface address it came through to the most
+   specific pool that contains it, so scopes may nest. A nested pool's
+   addresses are taken out of the pool around it while it exists, so no
+   address belongs to two pools.
+   The index is a path compressed binary trie, lookups are O(prefix
+   length) at worst and touch only nodes where stored prefixes branch */
+typedef struct dhcp_pools dhcp_pools_t;
+
+typedef struct dhcp_pool_stats
+{
+    size_t num_addresses;
+    size_t num_free;
+    size_t allocations;
+    size_t frees;
+    size_t failures;
+} dhcp_pool_stats_t;
+
+/*O(1)*/
+dhcp_pools_t *DHCPPoolsCreate(void);
+
+/* destroys every pool too. if gets NULL - does nothing */
+/*O(pools)*/
+void DHCPPoolsDestroy(dhcp_pools_t *pools);
+
+/* creates a pool for subnet_addr/bits_in_subnet on the chosen backend.
+   DHCP_STATUS_FAIL if the same prefix is already a pool, if it leaves no
+   room for the reserved addresses (more than 30 bits), if the pool around
+   it already handed out some of its addresses, or on memory failure */
+/*O(prefix length) plus DHCPCreateWithBackend*/
+status_t DHCPPoolsAdd(dhcp_pools_t *pools,
+                      const unsigned char subnet_addr[BYTES_IN_IP],
+                      size_t bits_in_subnet, dhcp_backend_t backend);
+
+/* destroys the pool of exactly this prefix and gives its addresses back
+   to the pool around it. DHCP_STATUS_FAIL if none */
+/*O(prefix length)*/
+status_t DHCPPoolsRemove(dhcp_pools_t *pools,
+                         const unsigned char subnet_addr[BYTES_IN_IP],
+                         size_t bits_in_subnet);
+
+/* the most specific pool containing addr, NULL if none does */
+/*O(prefix length)*/
+dhcp_t *DHCPPoolsLookup(const dhcp_pools_t *pools,
+                        const unsigned char addr[BYTES_IN_IP]);
+
+/* DHCPAllocateIP in the pool of relay_addr. DHCP_STATUS_FAIL if no pool
+   contains relay_addr */
+/*O(prefix length) plus DHCPAllocateIP*/
+status_t DHCPPoolsAllocateIP(dhcp_pools_t *pools,
+                             const unsigned char relay_addr[BYTES_IN_IP],
+                             unsigned char result_ip[BYTES_IN_IP],
+                             const unsigned char requested_ip[BYTES_IN_IP]);
+
+/* DHCPFreeIP in the most specific pool containing ip_addr */
+/*O(prefix length) plus DHCPFreeIP*/
+status_t DHCPPoolsFreeIP(dhcp_pools_t *pools,
+                         const unsigned char ip_addr[BYTES_IN_IP]);
+
+/* the counters of the pool of exactly this prefix, DHCP_STATUS_FAIL if
+   none. failures counts allocations that did not succeed */
+/*O(prefix length) plus DHCPCountFree*/
+status_t DHCPPoolsGetStats(const dhcp_pools_t *pools,
+                           const unsigned char subnet_addr[BYTES_IN_IP],
+                           size_t bits_in_subnet, dhcp_pool_stats_t *stats);
+
+/*O(1)*/
+size_t DHCPPoolsCount(const dhcp_pools_t *pools);
+
+
+#endif /* DHCP_POOLS_H */
@@ -0,0 +1,83 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef DHCP_SERVER_H
+#define DHCP_SERVER_H
+
+#include <stddef.h> /* size_t */
+#include <time.h> /* time_t */
+
+#include "dhcp.h" /* dhcp_backend_t, status_t */
+
+/* a DHCPv4 server over one UDP socket. DISCOVER is answered with an
+   OFFER held for offer_time, REQUEST with an ACK for lease_time or a NAK,
+   RELEASE frees the lease. A rebooting client the server has no lease
+   for is not answered, so another server can. Leases live in a dhcp_lease_table_t on a pool
+   of subnet_addr/bits_in_subnet.
+   Packets are received and sent in batches with recvmmsg/sendmmsg, into
+   buffers allocated once with the server, and requests are read where
+   they lie in the receive buffer.
+   A reply goes to the relay in giaddr, else a NAK is broadcast, else the
+   reply goes to ciaddr, else broadcast if the client asked for it or has
+   no address yet, else back to the sender */
+typedef struct dhcp_server dhcp_server_t;
+
+typedef struct dhcp_server_config
+{
+    unsigned char server_ip[BYTES_IN_IP];
+    unsigned char subnet_addr[BYTES_IN_IP];
+    size_t bits_in_subnet;
+    dhcp_backend_t backend;
+    unsigned short port;
+    time_t lease_time;
+    time_t offer_time;
+} dhcp_server_config_t;
+
+typedef struct dhcp_server_stats
+{
+    size_t received;
+    size_t dropped;
+    size_t offers;
+    size_t acks;
+    size_t naks;
+    size_t releases;
+} dhcp_server_stats_t;
+
+/* binds port on every interface, 0 picks a free port. NULL if the socket
+   cannot be bound, or on memory failure */
+/*O(1) plus DHCPCreateWithBackend*/
+dhcp_server_t *DHCPServerCreate(const dhcp_server_config_t *config);
+
+/* if gets NULL - does nothing */
+/*O(n)*/
+void DHCPServerDestroy(dhcp_server_t *server);
+
+/* serves until DHCPServerStop. DHCP_STATUS_FAIL on a socket error */
+status_t DHCPServerRun(dhcp_server_t *server);
+
+/* makes DHCPServerRun return within a receive timeout. May be called
+   from any thread or from a signal handler */
+/*O(1)*/
+void DHCPServerStop(dhcp_server_t *server);
+
+/* one request in, its reply out. Returns the reply length, 0 when there
+   is nothing to answer. reply_size should be at least 576 */
+/*O(1) plus the lease operation*/
+size_t DHCPServerHandle(dhcp_server_t *server, const unsigned char *request,
+                        size_t request_len, unsigned char *reply,
+                        size_t reply_size, time_t now);
+
+/* the bound port, in host order */
+/*O(1)*/
+unsigned short DHCPServerPort(const dhcp_server_t *server);
+
+/*O(1)*/
+void DHCPServerGetStats(const dhcp_server_t *server,
+                        dhcp_server_stats_t *stats);
+
+
+#endif /* DHCP_SERVER_H */
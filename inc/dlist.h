@@ -1,14 +1,14 @@
 /*//////////////////////////////////////
 Name: Alon Weinberg                    /
 Reviewer:                              /
-last date updated: 18/2/24             /
+last date updated: 19/10/26            /
 File type: header file                 /
 //////////////////////////////////////*/ 
 
 #ifndef DLIST_H
 #define DLIST_H
 
-#include <stddef.h> /* size_t */
+#include <stddef.h> /* size_t, offsetof */
 
 /**
  * @brief Structure representing a doubly linked list.
@@ -16,9 +16,43 @@ File type: header file                 /
 typedef struct dlist dlist_t;
 
 /**
- * @brief Iterator for traversing a doubly linked list.
+ * @brief Iterator for traversing a doubly linked list. It remembers the
+ * list it was taken from, so inserting and removing through it keep the
+ * list's count. After a node moves to another list (DListSplice,
+ * DListConcat, DListSplit), iterators to it must be taken again from the
+ * new list.
  */
-typedef struct node *dlist_iter_t;
+typedef struct dlist_iter
+{
+    struct node *node;
+    dlist_t *list;
+} dlist_iter_t;
+
+/**
+ * @brief Node pool that lists can draw their nodes from instead of malloc.
+ */
+typedef struct dlist_pool dlist_pool_t;
+
+/**
+ * @brief Link for intrusive lists, embedded by the caller in its own struct.
+ */
+typedef struct dlist_link dlist_link_t;
+
+struct dlist_link
+{
+    dlist_link_t *next;
+    dlist_link_t *prev;
+};
+
+/**
+ * @brief Gets the struct that embeds a link.
+ *
+ * @param link Pointer to the embedded dlist_link_t.
+ * @param type Type of the embedding struct.
+ * @param member Name of the link member inside type.
+ */
+#define DLIST_LINK_ENTRY(link, type, member) \
+    ((type *)((char *)(link) - offsetof(type, member)))
 
 /**
  * @brief Function pointer type for matching elements in the list.
@@ -38,6 +72,16 @@ typedef int (*match_func_t)(const void *data, void *param);
  */
 typedef int (*action_func_t)(void *data, void *param);
 
+/**
+ * @brief Function pointer type for ordering elements in the list.
+ *
+ * @param data1 The first element.
+ * @param data2 The second element.
+ * @return Negative if data1 goes before data2, 0 if they are equal,
+ *         positive otherwise.
+ */
+typedef int (*dlist_cmp_func_t)(const void *data1, const void *data2);
+
 /**
  * @brief Creates a new doubly linked list.
  *
@@ -45,6 +89,17 @@ typedef int (*action_func_t)(void *data, void *param);
  */
 dlist_t *DListCreate();
 
+/**
+ * @brief Creates a new doubly linked list whose nodes come from a pool.
+ *
+ * @param pool The pool to take nodes from, shared freely between lists.
+ * @return A pointer to the newly created list.
+ * @note The pool must outlive every list and node taken from it. Nodes go
+ *       back to the pool they came from, also after a DListSplice into a
+ *       list that uses another pool or none.
+ */
+dlist_t *DListCreateFromPool(dlist_pool_t *pool);
+
 /**
  * @brief Destroys the doubly linked list and frees allocated memory.
  *
@@ -127,7 +182,7 @@ void *DListGetData(dlist_iter_t iter);
 void DListSetData(dlist_iter_t iter, void *data);
 
 /**
- * @brief Gets the number of nodes in a list.
+ * @brief Gets the number of nodes in a list. The count is cached, O(1).
  *
  * @param list The relevant list.
  * @return The number of nodes in the list.
@@ -167,15 +222,60 @@ int DListForEach(dlist_iter_t from, dlist_iter_t to, action_func_t action,
     void *param);
 
 /**
- * @brief Runs a function through nodes in a list.
+ * @brief Moves a range of nodes before another node.
  *
  * @param from First node to slice.
  * @param to Last node to slice ("to"'s node is excluded).
  * @param where Insert the sliced list before "where"'s node.
  * @note "where" iterator must not point to a node within the sliced list.
+ * @note O(1) within one list. Between lists the range is counted, O(k) in
+ *       the range length; use DListConcat or DListSplit to move the whole
+ *       list or a whole tail in O(1).
  */
 void DListSplice(dlist_iter_t from, dlist_iter_t to, dlist_iter_t where);
 
+/**
+ * @brief Moves every node of src to the end of dest, leaving src empty.
+ *
+ * @param dest The list to append to.
+ * @param src The list to take the nodes from, must differ from dest.
+ * @note O(1).
+ */
+void DListConcat(dlist_t *dest, dlist_t *src);
+
+/**
+ * @brief Moves the nodes from "where" to the end of its list to the end of
+ * dest.
+ *
+ * @param where First node to move, DListEnd moves nothing.
+ * @param dest The list to append to, must differ from where's list.
+ * @note Relinking is O(1). Keeping both counts exact costs
+ *       O(min(k, n - k)), since only the shorter part is walked.
+ */
+void DListSplit(dlist_iter_t where, dlist_t *dest);
+
+/**
+ * @brief Sorts a list in place. Nodes are relinked, never copied or
+ * reallocated, so iterators stay valid and keep pointing to their data.
+ *
+ * @param list The list to sort.
+ * @param cmp The comparator.
+ * @note Bottom-up merge sort: O(n log n) compares, stable, and O(1) extra
+ *       memory.
+ */
+void DListSort(dlist_t *list, dlist_cmp_func_t cmp);
+
+/**
+ * @brief Merges src into dest. Both must already be sorted by cmp; dest
+ * stays sorted and src is left empty.
+ *
+ * @param dest The list to merge into.
+ * @param src The list to take the nodes from, must differ from dest.
+ * @param cmp The comparator both lists are sorted by.
+ * @note O(n + m) compares. Equal elements of dest come before those of src.
+ */
+void DListMerge(dlist_t *dest, dlist_t *src, dlist_cmp_func_t cmp);
+
 /**
  * @brief Runs a match function through nodes in a list and inserts all matches into a different list.
  *
@@ -223,4 +323,56 @@ dlist_iter_t DListPushFront(dlist_t *list, void *data);
  */
 void* DListPopFront(dlist_t *list);
 
+/**
+ * @brief Creates a node pool. Nodes are allocated nodes_per_chunk at a time
+ * and recycled on removal, so inserting into and removing from pooled lists
+ * does not call malloc or free once the pool is warm.
+ *
+ * @param nodes_per_chunk Number of nodes allocated each time the pool runs dry.
+ * @return A pointer to the new pool, NULL if memory allocation fails.
+ * @note A pool is not thread safe, lists sharing it must be used from one
+ *       thread at a time.
+ */
+dlist_pool_t *DListPoolCreate(size_t nodes_per_chunk);
+
+/**
+ * @brief Destroys a pool and every chunk it allocated.
+ *
+ * @param pool The pool to destroy. No list may still use it.
+ */
+void DListPoolDestroy(dlist_pool_t *pool);
+
+/**
+ * @brief Initializes the sentinel of an empty intrusive list.
+ *
+ * The intrusive list is circular: iterate from head->next until reaching
+ * head again, and use DLIST_LINK_ENTRY to get from a link to its struct.
+ *
+ * @param head The sentinel link.
+ */
+void DListLinkInit(dlist_link_t *head);
+
+/**
+ * @brief Inserts a link before "where". Does not allocate.
+ *
+ * @param where A link in the list, or the sentinel to insert at the end.
+ * @param link The link to insert, must not be in any list.
+ */
+void DListLinkInsert(dlist_link_t *where, dlist_link_t *link);
+
+/**
+ * @brief Unlinks a link from its list. Does not free anything.
+ *
+ * @param link The link to remove. It is left pointing to itself.
+ */
+void DListLinkRemove(dlist_link_t *link);
+
+/**
+ * @brief Checks if an intrusive list is empty.
+ *
+ * @param head The sentinel link.
+ * @return 1 if the list is empty, 0 otherwise.
+ */
+int DListLinkIsEmpty(const dlist_link_t *head);
+
 #endif /*DLIST_H*/
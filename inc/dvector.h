@@ -1,7 +1,7 @@
 /*//////////////////////////////////////
 Name: Alon Weinberg                    /
 Reviewer:                              /
-last date updated: 06/2/24             /
+last date updated: 19/10/26            /
 File type: header file                 /
 //////////////////////////////////////*/ 
 
@@ -13,6 +13,16 @@ File type: header file                 /
 
 typedef struct dvector_t dvector_t;
 
+/* returns <0, 0 or >0 when lhs orders before, with or after rhs */
+typedef int (*dvector_cmp_func_t)(const void *lhs, const void *rhs);
+
+/* backing flags for DvectorCreateMapped */
+typedef enum dvector_map_flags
+{
+    DVECTOR_MAP_DEFAULT = 0,
+    DVECTOR_MAP_HUGEPAGE = 1
+} dvector_map_flags_t;
+
 
 /**
  * Creates a new dynamic vector with the specified capacity and element size.
@@ -28,6 +38,88 @@ dvector_t *DvectorCreate(size_t capacity, size_t element_size);
 
 
 
+/**
+ * Creates a new dynamic vector whose elements live in an anonymous mmap
+ * region instead of the heap. Growing and shrinking use
+ * mremap(MREMAP_MAYMOVE), so a resize only remaps pages and never copies
+ * the elements - use it for vectors that reach hundreds of MB or more.
+ * 
+ * @param: capacity The initial capacity of the dynamic vector.
+ * @param: element_size The size of each element in the dynamic vector.
+ * @param: flags DVECTOR_MAP_HUGEPAGE rounds the mapping to 2MB once it is
+ *         large enough and advises the kernel to back it with transparent
+ *         hugepages, DVECTOR_MAP_DEFAULT otherwise.
+ * @return:A pointer to the newly created dynamic vector.
+ *         NULL if the mapping fails.
+ * 
+ * Time Complexity: O(1)
+ * @note: The mapping is rounded up to whole pages, so small vectors waste
+ *        memory in this mode.
+ */
+dvector_t *DvectorCreateMapped(size_t capacity, size_t element_size, int flags);
+
+
+
+/**
+ * Creates a new dynamic vector that keeps its first inline_capacity
+ * elements inside the vector's own allocation. Creating it costs a single
+ * malloc, and the elements spill to a separate heap block only when the
+ * vector outgrows inline_capacity.
+ * 
+ * @param: inline_capacity The number of elements stored inline.
+ * @param: element_size The size of each element in the dynamic vector.
+ * @return:A pointer to the newly created dynamic vector.
+ *         NULL if memory allocation fails.
+ * 
+ * Time Complexity: O(1)
+ * @note: Element addresses change when the vector spills to the heap or
+ *        moves back inline, as they do on any other resize.
+ */
+dvector_t *DvectorCreateSmall(size_t inline_capacity, size_t element_size);
+
+
+
+/**
+ * Opens a dynamic vector stored in a memory-mapped file, creating the file
+ * if it does not exist. The file starts with a header (element_size, size,
+ * capacity, checksum) followed by the elements, so reopening it after a
+ * restart exposes the stored elements in place, without copying them.
+ * 
+ * @param: path The file that backs the vector.
+ * @param: capacity The initial capacity, an existing file is grown to it
+ *         if it is smaller.
+ * @param: element_size The size of each element, must match the size the
+ *         file was created with.
+ * @return:A pointer to the opened dynamic vector.
+ *         NULL if the file cannot be mapped, belongs to a different
+ *         element_size, or fails its checksum.
+ * 
+ * Time Complexity: O(1) for a new file, O(n) to verify an existing one
+ * @note: The checksum is only verified for files that were synced last.
+ *        A file left by a crashed process is trusted as is - the kernel
+ *        still holds the pages it wrote.
+ */
+dvector_t *DvectorOpenFile(const char *path, size_t capacity,
+                           size_t element_size);
+
+
+
+/**
+ * Flushes a file backed dynamic vector to its file with msync and records
+ * the checksum of the elements in the header. Does nothing for vectors
+ * that are not file backed. Any change after it, including a write
+ * through DvectorGetAccessToElement or a DvectorSort, marks the file as
+ * unsynced again, so reopening it trusts the elements as they are.
+ * 
+ * @param: dvector The dynamic vector.
+ * @return: 0 if successful, -1 if msync fails.
+ * 
+ * Time Complexity: O(n)
+ */
+int DvectorSync(dvector_t *dvector);
+
+
+
 /**
  * Destroys a dynamic vector, freeing all allocated memory.
  * 
@@ -108,6 +200,7 @@ size_t DvectorCapacity(const dvector_t *dvector);
  * @return: 0 if successful, -1 if memory allocation fails.
  * 
  * Time Complexity: O(n), where n is the new capacity
+ *                  O(1) copies for vectors made by DvectorCreateMapped
  */
 int DvectorReserve(dvector_t *dvector, size_t capacity);
 
@@ -125,6 +218,52 @@ int DvectorShrink(dvector_t *dvector);
 
 
 
+/**
+ * Finds the first element whose bytes equal key. Vectors of 4 and 8 byte
+ * elements (int, long, pointers) are scanned with SSE2, or AVX2 when the
+ * CPU has it.
+ * 
+ * @param: dvector The dynamic vector.
+ * @param: key A pointer to element_size bytes to look for.
+ * @return: The index of the first match, DvectorSize() if there is none.
+ * 
+ * Time Complexity: O(n)
+ */
+size_t DvectorFind(const dvector_t *dvector, const void *key);
+
+
+
+/**
+ * Counts the elements whose bytes equal key, with the same fast paths as
+ * DvectorFind.
+ * 
+ * @param: dvector The dynamic vector.
+ * @param: key A pointer to element_size bytes to count.
+ * @return: The number of matching elements.
+ * 
+ * Time Complexity: O(n)
+ */
+size_t DvectorCount(const dvector_t *dvector, const void *key);
+
+
+
+/**
+ * Sorts the elements in place. Without a comparator the elements must be
+ * 4 or 8 byte unsigned integers (or pointers) and are radix sorted; with
+ * one, or when the radix buffer cannot be allocated, the vector is
+ * introsorted.
+ * 
+ * @param: dvector The dynamic vector.
+ * @param: cmp The comparator, NULL to radix sort unsigned integer keys.
+ * @return: 0.
+ * 
+ * Time Complexity: O(n) for radix sort, O(nlogn) for introsort
+ * @note: The sort is not stable when a comparator is used.
+ */
+int DvectorSort(dvector_t *dvector, dvector_cmp_func_t cmp);
+
+
+
 #endif /* DVECTOR_H */
 
 
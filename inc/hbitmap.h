@@ -0,0 +1,197 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef HBITMAP_H
+#define HBITMAP_H
+
+#include <stddef.h> /* size_t */
+
+/*
+ * Hierarchical bitmap: a flat array of bits plus summary levels on top of
+ * it, where a summary bit is set when the word below it is all ones. The
+ * first clear bit at or after any position is found by climbing until a
+ * word has a clear bit and descending with ctz - a handful of word
+ * operations even when millions of bits are set.
+ */
+typedef struct hbitmap hbitmap_t;
+
+
+/**
+ * Creates a bitmap with every bit clear.
+ *
+ * @param: num_bits The number of bits, at least 1.
+ * @return:A pointer to the newly created bitmap.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(n / 64)
+ */
+hbitmap_t *HBitmapCreate(size_t num_bits);
+
+
+
+/**
+ * Destroys a bitmap, freeing all allocated memory.
+ *
+ * @param: hbitmap The bitmap to be destroyed.
+ *
+ * Time Complexity: O(1)
+ */
+void HBitmapDestroy(hbitmap_t *hbitmap);
+
+
+
+/**
+ * Sets a bit.
+ *
+ * @param: hbitmap The bitmap.
+ * @param: idx The bit to set, below num_bits.
+ * @return: The previous value of the bit.
+ *
+ * Time Complexity: O(log64 n)
+ */
+int HBitmapSet(hbitmap_t *hbitmap, size_t idx);
+
+
+
+/**
+ * Clears a bit.
+ *
+ * @param: hbitmap The bitmap.
+ * @param: idx The bit to clear, below num_bits.
+ * @return: The previous value of the bit.
+ *
+ * Time Complexity: O(log64 n)
+ */
+int HBitmapClear(hbitmap_t *hbitmap, size_t idx);
+
+
+
+/**
+ * Sets every bit in [from, to).
+ *
+ * @param: hbitmap The bitmap.
+ * @param: from The first bit to set.
+ * @param: to One past the last bit to set, at most num_bits.
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+void HBitmapSetRange(hbitmap_t *hbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Sets the bits of one word that are set in bits, bit i of bits being
+ * bit word * 64 + i of the bitmap. A saved bitmap is loaded back a
+ * word at a time with it.
+ *
+ * @param: hbitmap The bitmap.
+ * @param: word The word, below (num_bits + 63) / 64.
+ * @param: bits The bits to set.
+ *
+ * Time Complexity: O(log64 n)
+ */
+void HBitmapOrWord(hbitmap_t *hbitmap, size_t word, unsigned long bits);
+
+
+
+/**
+ * Clears every bit in [from, to).
+ *
+ * @param: hbitmap The bitmap.
+ * @param: from The first bit to clear.
+ * @param: to One past the last bit to clear, at most num_bits.
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+void HBitmapClearRange(hbitmap_t *hbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Gets the value of a bit.
+ *
+ * Time Complexity: O(1)
+ */
+int HBitmapTest(const hbitmap_t *hbitmap, size_t idx);
+
+
+
+/**
+ * Finds the first clear bit at or after from.
+ *
+ * @param: hbitmap The bitmap.
+ * @param: from The first bit to consider.
+ * @return: The index of the bit, num_bits if every bit from "from" on is
+ *          set.
+ *
+ * Time Complexity: O(log64 n)
+ */
+size_t HBitmapFindClear(const hbitmap_t *hbitmap, size_t from);
+
+
+
+/**
+ * Finds the first set bit in [from, to).
+ *
+ * @param: hbitmap The bitmap.
+ * @param: from The first bit to consider.
+ * @param: to One past the last bit to consider, at most num_bits.
+ * @return: The index of the bit, to if every bit in the range is clear.
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+size_t HBitmapFindSet(const hbitmap_t *hbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Finds the n-th clear bit, counting from 0.
+ *
+ * @param: hbitmap The bitmap.
+ * @param: n The number of clear bits to skip.
+ * @return: The index of the bit, num_bits if there are no more than n
+ *          clear bits.
+ *
+ * Time Complexity: O(n / 64)
+ */
+size_t HBitmapFindNthClear(const hbitmap_t *hbitmap, size_t n);
+
+
+
+/**
+ * Counts the set bits in [from, to).
+ *
+ * @param: hbitmap The bitmap.
+ * @param: from The first bit to count.
+ * @param: to One past the last bit to count, at most num_bits.
+ * @return: The number of set bits in the range.
+ *
+ * Time Complexity: O((to - from) / 64)
+ */
+size_t HBitmapCountSetRange(const hbitmap_t *hbitmap, size_t from, size_t to);
+
+
+
+/**
+ * Returns the number of set bits.
+ *
+ * Time Complexity: O(1)
+ */
+size_t HBitmapCountSet(const hbitmap_t *hbitmap);
+
+
+
+/**
+ * Returns the number of bits.
+ *
+ * Time Complexity: O(1)
+ */
+size_t HBitmapSize(const hbitmap_t *hbitmap);
+
+
+
+#endif /* HBITMAP_H */
@@ -0,0 +1,123 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stddef.h> /* size_t, offsetof */
+#include <stdint.h> /* uintptr_t */
+#include <stdatomic.h> /* atomic_uintptr_t */
+
+/*
+ * Unbounded intrusive multi-producer single-consumer queue (Vyukov's
+ * algorithm). Callers embed an mpsc_link_t in their own struct, so a push
+ * is one atomic exchange and one store, with no allocation and no lock.
+ *
+ * Any number of threads may push; exactly one thread may pop. A pop can
+ * briefly see the queue as empty while a producer is between its exchange
+ * and its store - the element shows up on a later pop.
+ */
+typedef struct mpsc_queue mpsc_queue_t;
+
+/**
+ * Link embedded by the caller in the struct it queues. A link may be in
+ * one queue at a time and must stay alive until it is popped.
+ */
+typedef struct mpsc_link mpsc_link_t;
+
+struct mpsc_link
+{
+    atomic_uintptr_t next;
+};
+
+/**
+ * Gets the struct that embeds a link.
+ *
+ * @param: link Pointer to the embedded mpsc_link_t.
+ * @param: type Type of the embedding struct.
+ * @param: member Name of the link member inside type.
+ */
+#define MPSC_LINK_ENTRY(link, type, member) \
+    ((type *)((char *)(link) - offsetof(type, member)))
+
+
+/**
+ * Creates a new empty queue.
+ *
+ * @return:A pointer to the newly created queue.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(1)
+ */
+mpsc_queue_t *MPSCQueueCreate(void);
+
+
+
+/**
+ * Destroys the queue. Links still queued are not touched - they belong
+ * to the caller.
+ *
+ * @param: queue The queue to be destroyed.
+ *
+ * Time Complexity: O(1)
+ */
+void MPSCQueueDestroy(mpsc_queue_t *queue);
+
+
+
+/**
+ * Pushes a link to the back of the queue. Safe to call from any thread.
+ *
+ * @param: queue The queue.
+ * @param: link The link to push, not currently in any queue.
+ *
+ * Time Complexity: O(1), wait-free
+ */
+void MPSCQueuePush(mpsc_queue_t *queue, mpsc_link_t *link);
+
+
+
+/**
+ * Pops the front link. Consumer thread only.
+ *
+ * @param: queue The queue.
+ * @return: The popped link, NULL if the queue is empty or the next link is
+ *          still being pushed.
+ *
+ * Time Complexity: O(1)
+ */
+mpsc_link_t *MPSCQueuePop(mpsc_queue_t *queue);
+
+
+
+/**
+ * Pops up to max links in queue order. Consumer thread only.
+ *
+ * @param: queue The queue.
+ * @param: links Output array with room for max links.
+ * @param: max The maximum number of links to pop.
+ * @return: The number of links popped.
+ *
+ * Time Complexity: O(max)
+ */
+size_t MPSCQueuePopBatch(mpsc_queue_t *queue, mpsc_link_t *links[],
+                         size_t max);
+
+
+
+/**
+ * Checks whether the queue has nothing to pop. Consumer thread only.
+ *
+ * @return: 1 if empty, 0 otherwise.
+ *
+ * Time Complexity: O(1)
+ */
+int MPSCQueueIsEmpty(const mpsc_queue_t *queue);
+
+
+
+#endif /* MPSC_QUEUE_H */
@@ -0,0 +1,269 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <stddef.h> /* size_t */
+
+/*
+ * Ordered container with O(log n) expected insert, find and remove. The
+ * bottom level is a doubly linked list, so iteration works like dlist_t's:
+ * Begin to End in cmp order, Next and Prev, and [from, to) ranges taken
+ * from SkipListLowerBound/SkipListUpperBound.
+ *
+ * Equal elements are allowed and kept in insertion order.
+ */
+typedef struct skiplist skiplist_t;
+
+/**
+ * Iterator into a skip list. End is a NULL node, so Prev(End) needs the
+ * list to reach the last element.
+ */
+typedef struct skiplist_iter
+{
+    struct skip_node *node;
+    skiplist_t *list;
+} skiplist_iter_t;
+
+/**
+ * A read section, from SkipListReadBegin to be passed to SkipListReadEnd.
+ */
+typedef unsigned int skiplist_read_t;
+
+/* returns <0, 0 or >0 when data1 orders before, with or after data2 */
+typedef int (*skiplist_cmp_func_t)(const void *data1, const void *data2);
+
+/* returns 0 to go on, anything else stops SkipListForEach */
+typedef int (*skiplist_action_func_t)(void *data, void *param);
+
+/* flags for SkipListCreate */
+typedef enum skiplist_flags
+{
+    SKIPLIST_DEFAULT = 0,
+    SKIPLIST_CONCURRENT_READS = 1
+} skiplist_flags_t;
+
+
+/**
+ * Creates a new empty skip list.
+ *
+ * @param: cmp The order of the list.
+ * @param: flags SKIPLIST_CONCURRENT_READS lets any number of threads read
+ *         the list without a lock while writers change it (see
+ *         SkipListReadBegin), SKIPLIST_DEFAULT for single threaded use.
+ * @return:A pointer to the newly created list.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(1)
+ */
+skiplist_t *SkipListCreate(skiplist_cmp_func_t cmp, int flags);
+
+
+
+/**
+ * Destroys the list and frees its nodes. The data is not freed. No thread
+ * may use the list during or after this call.
+ *
+ * @param: list The list to be destroyed.
+ *
+ * Time Complexity: O(n)
+ */
+void SkipListDestroy(skiplist_t *list);
+
+
+
+/**
+ * Inserts data after every element equal to it.
+ *
+ * @param: list The list.
+ * @param: data The data to insert.
+ * @return: An iterator to the new element, SkipListEnd on allocation
+ *          failure.
+ *
+ * Time Complexity: O(log n) expected
+ */
+skiplist_iter_t SkipListInsert(skiplist_t *list, void *data);
+
+
+
+/**
+ * Removes the element pointed by the iterator.
+ *
+ * @param: to_remove An iterator to an element in the list.
+ * @return: An iterator to the next element.
+ *
+ * Time Complexity: O(log n) expected, plus the number of elements equal
+ *                  to the removed one that come before it
+ */
+skiplist_iter_t SkipListRemove(skiplist_iter_t to_remove);
+
+
+
+/**
+ * Finds the first element equal to key.
+ *
+ * @return: An iterator to the element, SkipListEnd if there is none.
+ *
+ * Time Complexity: O(log n) expected
+ */
+skiplist_iter_t SkipListFind(const skiplist_t *list, const void *key);
+
+
+
+/**
+ * Finds the first element that is not before key.
+ *
+ * @return: An iterator to the element, SkipListEnd if there is none.
+ *
+ * Time Complexity: O(log n) expected
+ */
+skiplist_iter_t SkipListLowerBound(const skiplist_t *list, const void *key);
+
+
+
+/**
+ * Finds the first element that is after key. [LowerBound(a), UpperBound(b))
+ * is every element between a and b inclusive.
+ *
+ * @return: An iterator to the element, SkipListEnd if there is none.
+ *
+ * Time Complexity: O(log n) expected
+ */
+skiplist_iter_t SkipListUpperBound(const skiplist_t *list, const void *key);
+
+
+
+/**
+ * Gets an iterator to the first element, SkipListEnd if the list is empty.
+ *
+ * Time Complexity: O(1)
+ */
+skiplist_iter_t SkipListBegin(const skiplist_t *list);
+
+
+
+/**
+ * Gets the iterator past the last element.
+ *
+ * Time Complexity: O(1)
+ */
+skiplist_iter_t SkipListEnd(const skiplist_t *list);
+
+
+
+/**
+ * Gets the next element in order.
+ *
+ * Time Complexity: O(1)
+ */
+skiplist_iter_t SkipListNext(skiplist_iter_t iter);
+
+
+
+/**
+ * Gets the previous element in order, iter must not be SkipListBegin.
+ *
+ * Time Complexity: O(1)
+ * @note: Writer side only - concurrent readers may only walk forward.
+ */
+skiplist_iter_t SkipListPrev(skiplist_iter_t iter);
+
+
+
+/**
+ * @return: 1 if both iterators point to the same element, 0 otherwise.
+ */
+int SkipListIsIterSame(skiplist_iter_t iter1, skiplist_iter_t iter2);
+
+
+
+/**
+ * Gets the data pointed by the iterator.
+ */
+void *SkipListGetData(skiplist_iter_t iter);
+
+
+
+/**
+ * Runs an action through the elements in [from, to), stopping at the first
+ * non zero result.
+ *
+ * @return: 0 if the action succeeded on every element, its result
+ *          otherwise.
+ *
+ * Time Complexity: O(k)
+ */
+int SkipListForEach(skiplist_iter_t from, skiplist_iter_t to,
+                    skiplist_action_func_t action, void *param);
+
+
+
+/**
+ * Removes the first element. Empty list results in undefined.
+ *
+ * @return: The removed data.
+ *
+ * Time Complexity: O(1) expected
+ */
+void *SkipListPopFront(skiplist_t *list);
+
+
+
+/**
+ * Returns the number of elements.
+ *
+ * Time Complexity: O(1)
+ */
+size_t SkipListSize(const skiplist_t *list);
+
+
+
+/**
+ * @return: 1 if the list is empty, 0 otherwise.
+ *
+ * Time Complexity: O(1)
+ */
+int SkipListIsEmpty(const skiplist_t *list);
+
+
+
+/**
+ * Starts a lock-free read section on a SKIPLIST_CONCURRENT_READS list.
+ * Inside it a thread may call Find, LowerBound, UpperBound, Begin, End,
+ * Next, GetData, ForEach, Size and IsEmpty while other threads insert and
+ * remove. Iterators taken inside a section are only valid until its end.
+ *
+ * Writes are serialized by a lock inside the list. A removed node is
+ * unlinked at once and freed after every section open at its removal has
+ * ended, and so have the sections open at the next grace period start -
+ * by the first write after that or by the end of the last such section.
+ * So a reader never touches freed memory, and the removed nodes waiting
+ * to be freed are at most those removed during two section lengths, even
+ * when sections overlap so that one is always open.
+ *
+ * @return:The section, for SkipListReadEnd.
+ *
+ * Time Complexity: O(1)
+ */
+skiplist_read_t SkipListReadBegin(skiplist_t *list);
+
+
+
+/**
+ * Ends a read section started by SkipListReadBegin.
+ *
+ * @param: section What SkipListReadBegin returned.
+ *
+ * Time Complexity: O(1), plus freeing the removed nodes it was the last
+ *         section to hold back
+ */
+void SkipListReadEnd(skiplist_t *list, skiplist_read_t section);
+
+
+
+#endif /* SKIPLIST_H */
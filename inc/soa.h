@@ -0,0 +1,178 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef SOA_H
+#define SOA_H
+
+#include <stddef.h> /* size_t */
+
+/*
+ * Struct-of-arrays container: every field of a row lives in its own
+ * contiguous column, and all columns share one size and capacity. Scanning
+ * a single field (deadlines, lease end times) touches only that column.
+ */
+typedef struct soa soa_t;
+
+
+/**
+ * Creates a new columnar container.
+ *
+ * @param: num_columns The number of fields in each row.
+ * @param: column_sizes The element size of every column.
+ * @param: capacity The initial number of rows.
+ * @return:A pointer to the newly created container.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(num_columns)
+ */
+soa_t *SoaCreate(size_t num_columns, const size_t column_sizes[],
+                 size_t capacity);
+
+
+
+/**
+ * Destroys a columnar container, freeing all allocated memory.
+ *
+ * @param: soa The container to be destroyed.
+ *
+ * Time Complexity: O(num_columns)
+ */
+void SoaDestroy(soa_t *soa);
+
+
+
+/**
+ * Appends a row to the end of the container.
+ *
+ * @param: soa The container.
+ * @param: fields One pointer per column to the value of that field.
+ * @return: 0 if successful, -1 if memory allocation fails.
+ *
+ * Time Complexity: O(num_columns) amortized
+ */
+int SoaPushBack(soa_t *soa, const void *const fields[]);
+
+
+
+/**
+ * Removes the last row from the container.
+ *
+ * @param: soa The container.
+ *
+ * Time Complexity: O(1)
+ */
+void SoaPopBack(soa_t *soa);
+
+
+
+/**
+ * Removes a row by moving the last row into its place. Row order is not
+ * kept.
+ *
+ * @param: soa The container.
+ * @param: idx The row to remove.
+ *
+ * Time Complexity: O(num_columns)
+ */
+void SoaSwapRemove(soa_t *soa, size_t idx);
+
+
+
+/**
+ * Returns the base of a column. The column holds SoaSize() contiguous
+ * elements and stays valid until the next push or reserve.
+ *
+ * @param: soa The container.
+ * @param: column The column index.
+ * @return: A pointer to the first element of the column.
+ *
+ * Time Complexity: O(1)
+ */
+void *SoaGetColumn(const soa_t *soa, size_t column);
+
+
+
+/**
+ * Gets access to one field of one row.
+ *
+ * @param: soa The container.
+ * @param: column The column index.
+ * @param: idx The row index.
+ * @return: A pointer to the field. Undefined if idx is out of bounds.
+ *
+ * Time Complexity: O(1)
+ */
+void *SoaGetField(const soa_t *soa, size_t column, size_t idx);
+
+
+
+/**
+ * Returns the number of rows in the container.
+ *
+ * Time Complexity: O(1)
+ */
+size_t SoaSize(const soa_t *soa);
+
+
+
+/**
+ * Returns the number of rows the container can hold without growing.
+ *
+ * Time Complexity: O(1)
+ */
+size_t SoaCapacity(const soa_t *soa);
+
+
+
+/**
+ * Reserves space for at least capacity rows in every column.
+ *
+ * @param: soa The container.
+ * @param: capacity The new capacity to reserve.
+ * @return: 0 if successful, -1 if memory allocation fails.
+ *
+ * Time Complexity: O(n * num_columns)
+ */
+int SoaReserve(soa_t *soa, size_t capacity);
+
+
+
+/**
+ * Collects the indices of the rows whose value in a long column (time_t
+ * on Linux) is smaller than threshold, in increasing order. The column is
+ * compared in blocks with a branch-free loop the compiler vectorizes (64 bit
+ * compares need -msse4.2 or -mavx2), and blocks with no match are skipped
+ * as a whole.
+ *
+ * @param: soa The container.
+ * @param: column A column whose element size is sizeof(long).
+ * @param: threshold The value to compare against.
+ * @param: indices Output array, room for SoaSize() indices.
+ * @return: The number of indices written.
+ *
+ * Time Complexity: O(n)
+ */
+size_t SoaFilterLess(const soa_t *soa, size_t column, long threshold,
+                     size_t indices[]);
+
+
+
+/**
+ * Counts the rows whose value in a long column is smaller than threshold.
+ *
+ * @param: soa The container.
+ * @param: column A column whose element size is sizeof(long).
+ * @param: threshold The value to compare against.
+ * @return: The number of matching rows.
+ *
+ * Time Complexity: O(n)
+ */
+size_t SoaCountLess(const soa_t *soa, size_t column, long threshold);
+
+
+
+#endif /* SOA_H */
@@ -0,0 +1,96 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h> /* size_t */
+
+/*
+ * Bounded single-producer single-consumer ring buffer. Elements are copied
+ * in and out by value, so nothing is allocated after creation.
+ *
+ * Exactly one thread may enqueue and exactly one (other) thread may
+ * dequeue. Each side owns its own index on its own cache line and keeps a
+ * cached copy of the other's, so the shared line is only read when the
+ * cached copy says the queue looks full (or empty).
+ */
+typedef struct spsc_queue spsc_queue_t;
+
+
+/**
+ * Creates a new ring buffer.
+ *
+ * @param: capacity The maximum number of elements, rounded up to a power
+ *         of two.
+ * @param: element_size The size of each element.
+ * @return:A pointer to the newly created queue.
+ *         NULL if memory allocation fails.
+ *
+ * Time Complexity: O(1)
+ */
+spsc_queue_t *SPSCQueueCreate(size_t capacity, size_t element_size);
+
+
+
+/**
+ * Destroys the queue, freeing all allocated memory.
+ *
+ * @param: queue The queue to be destroyed.
+ *
+ * Time Complexity: O(1)
+ */
+void SPSCQueueDestroy(spsc_queue_t *queue);
+
+
+
+/**
+ * Copies an element to the back of the queue. Producer thread only.
+ *
+ * @param: queue The queue.
+ * @param: data A pointer to the data to be copied.
+ * @return: 0 if successful, -1 if the queue is full.
+ *
+ * Time Complexity: O(1), wait-free
+ */
+int SPSCQueueEnqueue(spsc_queue_t *queue, const void *data);
+
+
+
+/**
+ * Copies the front element out and removes it. Consumer thread only.
+ *
+ * @param: queue The queue.
+ * @param: data Where to copy the element to.
+ * @return: 0 if successful, -1 if the queue is empty.
+ *
+ * Time Complexity: O(1), wait-free
+ */
+int SPSCQueueDequeue(spsc_queue_t *queue, void *data);
+
+
+
+/**
+ * Returns the number of queued elements. Exact only when called from one
+ * of the two sides while the other is idle.
+ *
+ * Time Complexity: O(1)
+ */
+size_t SPSCQueueSize(const spsc_queue_t *queue);
+
+
+
+/**
+ * Returns the capacity after rounding.
+ *
+ * Time Complexity: O(1)
+ */
+size_t SPSCQueueCapacity(const spsc_queue_t *queue);
+
+
+
+#endif /* SPSC_QUEUE_H */
@@ -0,0 +1,189 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: header file                 /
+//////////////////////////////////////*/
+
+#ifndef ULIST_H
+#define ULIST_H
+
+#include <stddef.h> /* size_t */
+
+/**
+ * @brief Unrolled doubly linked list: every node holds a small array of
+ * items, so walking the list touches one cache line per several items
+ * instead of one per item. The API follows dlist.h.
+ */
+typedef struct ulist ulist_t;
+
+/**
+ * @brief Iterator for traversing an unrolled list: a node and a slot in it.
+ * @note Inserting or removing may move the other items of the same node,
+ *       so only the iterator returned by UListInsert/UListRemove stays
+ *       valid after the call.
+ */
+typedef struct ulist_iter
+{
+    struct unode *node;
+    size_t idx;
+    ulist_t *list;
+} ulist_iter_t;
+
+/**
+ * @brief Function pointer type for matching items in the list.
+ *
+ * @param data The data to match.
+ * @param param Additional parameter for matching.
+ * @return Non zero on a match, 0 otherwise.
+ */
+typedef int (*ulist_match_func_t)(const void *data, void *param);
+
+/**
+ * @brief Function pointer type for performing an action on items in the list.
+ *
+ * @param data The data to perform the action on.
+ * @param param Additional parameter for the action.
+ * @return 0 to continue, anything else stops the walk.
+ */
+typedef int (*ulist_action_func_t)(void *data, void *param);
+
+/**
+ * @brief Creates a new unrolled list.
+ *
+ * @return A pointer to the newly created list, NULL on failure.
+ */
+ulist_t *UListCreate(void);
+
+/**
+ * @brief Destroys the list and frees allocated memory.
+ *
+ * @param list The list to be destroyed.
+ */
+void UListDestroy(ulist_t *list);
+
+/**
+ * @brief Gets an iterator to the first item in the list.
+ *
+ * @param list The relevant list.
+ * @return An iterator to the first item, UListEnd if the list is empty.
+ */
+ulist_iter_t UListBegin(const ulist_t *list);
+
+/**
+ * @brief Gets the iterator past the last item in the list.
+ *
+ * @param list The relevant list.
+ * @return The end iterator.
+ */
+ulist_iter_t UListEnd(const ulist_t *list);
+
+/**
+ * @brief Gets the next item relative to the iterator.
+ *
+ * @param iter An iterator.
+ * @return An iterator to the next item.
+ */
+ulist_iter_t UListNext(ulist_iter_t iter);
+
+/**
+ * @brief Gets the previous item relative to the iterator.
+ *
+ * @param iter An iterator, must not be UListBegin.
+ * @return An iterator to the previous item.
+ */
+ulist_iter_t UListPrev(ulist_iter_t iter);
+
+/**
+ * @brief Compares two iterators.
+ *
+ * @return 1 if both point to the same slot, 0 otherwise.
+ */
+int UListIsIterSame(ulist_iter_t iter1, ulist_iter_t iter2);
+
+/**
+ * @brief Inserts an item before the iterator. A full node is split in two.
+ *
+ * @param where An iterator.
+ * @param data The data to insert.
+ * @return An iterator to the new item, UListEnd on allocation failure.
+ */
+ulist_iter_t UListInsert(ulist_iter_t where, void *data);
+
+/**
+ * @brief Removes the item pointed by the iterator. A node that runs low is
+ * merged with its successor.
+ *
+ * @param to_remove An iterator to the item to remove.
+ * @return An iterator to the item after the removed one.
+ */
+ulist_iter_t UListRemove(ulist_iter_t to_remove);
+
+/**
+ * @brief Gets the data pointed by the iterator.
+ */
+void *UListGetData(ulist_iter_t iter);
+
+/**
+ * @brief Sets the data pointed by the iterator.
+ */
+void UListSetData(ulist_iter_t iter, void *data);
+
+/**
+ * @brief Gets the number of items in a list, O(1).
+ */
+size_t UListCount(const ulist_t *list);
+
+/**
+ * @brief Checks if the list is empty.
+ *
+ * @return 1 if the list is empty, 0 otherwise.
+ */
+int UListIsEmpty(const ulist_t *list);
+
+/**
+ * @brief Runs a match function through the items in [from, to).
+ *
+ * @return The first matching item, "to" if there is none.
+ */
+ulist_iter_t UListFind(ulist_iter_t from, ulist_iter_t to,
+                       ulist_match_func_t is_match, void *param);
+
+/**
+ * @brief Runs an action through the items in [from, to), stopping at the
+ * first non zero result.
+ *
+ * @return 0 if the action succeeded on every item, its result otherwise.
+ */
+int UListForEach(ulist_iter_t from, ulist_iter_t to,
+                 ulist_action_func_t action, void *param);
+
+/**
+ * @brief Pushes an item to the end of a list.
+ *
+ * @return An iterator to the new item, UListEnd on allocation failure.
+ */
+ulist_iter_t UListPushBack(ulist_t *list, void *data);
+
+/**
+ * @brief Pops the last item. Empty list results in undefined.
+ *
+ * @return The popped data.
+ */
+void *UListPopBack(ulist_t *list);
+
+/**
+ * @brief Pushes an item to the beginning of a list.
+ *
+ * @return An iterator to the new item, UListEnd on allocation failure.
+ */
+ulist_iter_t UListPushFront(ulist_t *list, void *data);
+
+/**
+ * @brief Pops the first item. Empty list results in undefined.
+ *
+ * @return The popped data.
+ */
+void *UListPopFront(ulist_t *list);
+
+#endif /* ULIST_H */
@@ -0,0 +1,479 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+#include <stdatomic.h> /* atomic_ulong */
+
+#include "cbitmap.h" /* cbitmap_t */
+
+#define WORD_BITS (sizeof(unsigned long) * 8)
+#define WORD_SHIFT (6)
+#define WORD_MASK (WORD_BITS - 1)
+#define ALL_ONES (~0UL)
+#define WORDS_FOR(bits) (((bits) + WORD_MASK) >> WORD_SHIFT)
+#define NOT_FOUND ((size_t)-1)
+
+/* bit i of full is a hint that word i is all ones. Padding bits past
+   the end of both arrays are set, so they are never claimed or visited */
+struct cbitmap
+{
+    size_t num_bits;
+    size_t num_words;
+    atomic_ulong *words;
+    atomic_ulong *full;
+};
+
+static size_t Search(cbitmap_t *cbitmap, size_t from, int use_hints);
+static size_t ClaimInWord(cbitmap_t *cbitmap, size_t word, unsigned long mask);
+static int IsMarkedFull(const cbitmap_t *cbitmap, size_t word);
+static void MarkFull(cbitmap_t *cbitmap, size_t word);
+static void MarkNotFull(cbitmap_t *cbitmap, size_t word);
+static unsigned long LoadWord(const cbitmap_t *cbitmap, size_t word);
+static void InitWords(atomic_ulong *words, size_t bits);
+
+cbitmap_t *CBitmapCreate(size_t num_bits)
+{
+    cbitmap_t *cbitmap = NULL;
+
+    assert(0 != num_bits);
+    assert(WORD_BITS == ((size_t)1 << WORD_SHIFT));
+
+    cbitmap = (cbitmap_t *)malloc(sizeof(cbitmap_t));
+    if (NULL == cbitmap)
+    {
+        return NULL;
+    }
+
+    cbitmap->num_bits = num_bits;
+    cbitmap->num_words = WORDS_FOR(num_bits);
+    cbitmap->words = (atomic_ulong *)malloc(cbitmap->num_words *
+                                            sizeof(atomic_ulong));
+    cbitmap->full = (atomic_ulong *)malloc(WORDS_FOR(cbitmap->num_words) *
+                                           sizeof(atomic_ulong));
+    if (NULL == cbitmap->words || NULL == cbitmap->full)
+    {
+        free(cbitmap->words);
+        free(cbitmap->full);
+        free(cbitmap);
+        return NULL;
+    }
+
+    InitWords(cbitmap->words, num_bits);
+    InitWords(cbitmap->full, cbitmap->num_words);
+
+    return cbitmap;
+}
+
+void CBitmapDestroy(cbitmap_t *cbitmap)
+{
+    assert(NULL != cbitmap);
+
+    free(cbitmap->words);
+    free(cbitmap->full);
+    free(cbitmap);
+}
+
+/* through the hints first. Finding nothing that way may only mean stale
+   hints, so the second try looks at every word */
+size_t CBitmapClaim(cbitmap_t *cbitmap, size_t hint)
+{
+    size_t idx = 0;
+
+    assert(NULL != cbitmap);
+
+    if (hint >= cbitmap->num_bits)
+    {
+        hint = 0;
+    }
+
+    idx = Search(cbitmap, hint, 1);
+    if (NOT_FOUND == idx)
+    {
+        idx = Search(cbitmap, hint, 0);
+    }
+
+    return ((NOT_FOUND == idx) ? cbitmap->num_bits : idx);
+}
+
+int CBitmapClaimBit(cbitmap_t *cbitmap, size_t idx)
+{
+    unsigned long bit = 0;
+    unsigned long old = 0;
+
+    assert(NULL != cbitmap);
+    assert(idx < cbitmap->num_bits);
+
+    bit = 1UL << (idx & WORD_MASK);
+    old = atomic_fetch_or_explicit(&cbitmap->words[idx >> WORD_SHIFT], bit,
+                                   memory_order_acq_rel);
+    if (ALL_ONES == (old | bit))
+    {
+        MarkFull(cbitmap, idx >> WORD_SHIFT);
+    }
+
+    return (0 == (old & bit));
+}
+
+int CBitmapRelease(cbitmap_t *cbitmap, size_t idx)
+{
+    unsigned long bit = 0;
+    unsigned long old = 0;
+
+    assert(NULL != cbitmap);
+    assert(idx < cbitmap->num_bits);
+
+    bit = 1UL << (idx & WORD_MASK);
+    old = atomic_fetch_and_explicit(&cbitmap->words[idx >> WORD_SHIFT], ~bit,
+                                    memory_order_acq_rel);
+    if (ALL_ONES == old)
+    {
+        MarkNotFull(cbitmap, idx >> WORD_SHIFT);
+    }
+
+    return (0 != (old & bit));
+}
+
+void CBitmapSetRange(cbitmap_t *cbitmap, size_t from, size_t to)
+{
+    unsigned long mask = 0;
+    unsigned long old = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t word = 0;
+
+    assert(NULL != cbitmap);
+    assert(to <= cbitmap->num_bits);
+
+    if (from >= to)
+    {
+        return;
+    }
+
+    first = from >> WORD_SHIFT;
+    last = (to - 1) >> WORD_SHIFT;
+    for (word = first; word <= last; ++word)
+    {
+        mask = ALL_ONES;
+        if (word == first)
+        {
+            mask &= ALL_ONES << (from & WORD_MASK);
+        }
+        if (word == last)
+        {
+            mask &= ALL_ONES >> (WORD_MASK - ((to - 1) & WORD_MASK));
+        }
+
+        old = atomic_fetch_or_explicit(&cbitmap->words[word], mask,
+                                       memory_order_acq_rel);
+        if (ALL_ONES == (old | mask))
+        {
+            MarkFull(cbitmap, word);
+        }
+    }
+}
+
+void CBitmapOrWord(cbitmap_t *cbitmap, size_t word, unsigned long bits)
+{
+    unsigned long old = 0;
+
+    assert(NULL != cbitmap);
+    assert(word < cbitmap->num_words);
+
+    old = atomic_fetch_or_explicit(&cbitmap->words[word], bits,
+                                   memory_order_acq_rel);
+    if (ALL_ONES == (old | bits) && ALL_ONES != old)
+    {
+        MarkFull(cbitmap, word);
+    }
+}
+
+void CBitmapClearRange(cbitmap_t *cbitmap, size_t from, size_t to)
+{
+    unsigned long mask = 0;
+    unsigned long old = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t word = 0;
+
+    assert(NULL != cbitmap);
+    assert(to <= cbitmap->num_bits);
+
+    if (from >= to)
+    {
+        return;
+    }
+
+    first = from >> WORD_SHIFT;
+    last = (to - 1) >> WORD_SHIFT;
+    for (word = first; word <= last; ++word)
+    {
+        mask = ALL_ONES;
+        if (word == first)
+        {
+            mask &= ALL_ONES << (from & WORD_MASK);
+        }
+        if (word == last)
+        {
+            mask &= ALL_ONES >> (WORD_MASK - ((to - 1) & WORD_MASK));
+        }
+
+        old = atomic_fetch_and_explicit(&cbitmap->words[word], ~mask,
+                                        memory_order_acq_rel);
+        if (ALL_ONES == old)
+        {
+            MarkNotFull(cbitmap, word);
+        }
+    }
+}
+
+size_t CBitmapCountSetRange(const cbitmap_t *cbitmap, size_t from, size_t to)
+{
+    unsigned long first_mask = 0;
+    unsigned long last_mask = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t count = 0;
+
+    assert(NULL != cbitmap);
+    assert(to <= cbitmap->num_bits);
+
+    if (from >= to)
+    {
+        return 0;
+    }
+
+    first = from >> WORD_SHIFT;
+    last = (to - 1) >> WORD_SHIFT;
+    first_mask = ALL_ONES << (from & WORD_MASK);
+    last_mask = ALL_ONES >> (WORD_MASK - ((to - 1) & WORD_MASK));
+
+    if (first == last)
+    {
+        return __builtin_popcountl(LoadWord(cbitmap, first) &
+                                   first_mask & last_mask);
+    }
+
+    count = __builtin_popcountl(LoadWord(cbitmap, first) & first_mask);
+    for (++first; first < last; ++first)
+    {
+        count += __builtin_popcountl(LoadWord(cbitmap, first));
+    }
+
+    return (count + __builtin_popcountl(LoadWord(cbitmap, last) & last_mask));
+}
+
+size_t CBitmapFindNthClear(const cbitmap_t *cbitmap, size_t n)
+{
+    unsigned long free_bits = 0;
+    size_t free_in_word = 0;
+    size_t word = 0;
+
+    assert(NULL != cbitmap);
+
+    /* padding bits count as set */
+    for (word = 0; word < cbitmap->num_words; ++word)
+    {
+        free_bits = ~LoadWord(cbitmap, word);
+        free_in_word = __builtin_popcountl(free_bits);
+        if (n < free_in_word)
+        {
+            for (; 0 < n; --n)
+            {
+                free_bits &= free_bits - 1;
+            }
+
+            return ((word << WORD_SHIFT) + __builtin_ctzl(free_bits));
+        }
+        n -= free_in_word;
+    }
+
+    return cbitmap->num_bits;
+}
+
+/* set bits are searched in the words as they are, clear bits in their
+   complement */
+size_t CBitmapFindNext(const cbitmap_t *cbitmap, size_t from, int set)
+{
+    unsigned long flip = set ? 0 : ALL_ONES;
+    unsigned long bits = 0;
+    size_t word = 0;
+
+    assert(NULL != cbitmap);
+
+    if (from >= cbitmap->num_bits)
+    {
+        return cbitmap->num_bits;
+    }
+
+    word = from >> WORD_SHIFT;
+    bits = (LoadWord(cbitmap, word) ^ flip) & (ALL_ONES << (from & WORD_MASK));
+    while (0 == bits && ++word < cbitmap->num_words)
+    {
+        bits = LoadWord(cbitmap, word) ^ flip;
+    }
+    if (0 == bits)
+    {
+        return cbitmap->num_bits;
+    }
+    from = (word << WORD_SHIFT) + __builtin_ctzl(bits);
+
+    /* padding bits are set */
+    return ((from < cbitmap->num_bits) ? from : cbitmap->num_bits);
+}
+
+size_t CBitmapSize(const cbitmap_t *cbitmap)
+{
+    assert(NULL != cbitmap);
+
+    return cbitmap->num_bits;
+}
+
+/******************************************************************************/
+
+/* visits every word once from the word of from, wrapping around, then
+   the bits of the first word that come before from. With use_hints,
+   words marked full are skipped, 64 at a time when a whole hint word
+   is set */
+static size_t Search(cbitmap_t *cbitmap, size_t from, int use_hints)
+{
+    size_t start = from >> WORD_SHIFT;
+    size_t word = start;
+    size_t left = cbitmap->num_words;
+    size_t step = 0;
+    size_t idx = 0;
+    unsigned long mask = ALL_ONES << (from & WORD_MASK);
+    unsigned long hints = 0;
+
+    while (0 < left)
+    {
+        if (use_hints)
+        {
+            hints = atomic_load_explicit(&cbitmap->full[word >> WORD_SHIFT],
+                                         memory_order_relaxed);
+            step = cbitmap->num_words - word;
+            if (0 == (word & WORD_MASK) && ALL_ONES == hints &&
+                WORD_BITS <= left && WORD_BITS <= step)
+            {
+                step = WORD_BITS;
+            }
+            else
+            {
+                step = 1;
+            }
+
+            if (0 != (hints & (1UL << (word & WORD_MASK))))
+            {
+                left -= step;
+                word += step;
+                word = (word == cbitmap->num_words) ? 0 : word;
+                mask = ALL_ONES;
+                continue;
+            }
+        }
+
+        idx = ClaimInWord(cbitmap, word, mask);
+        if (NOT_FOUND != idx)
+        {
+            return idx;
+        }
+
+        --left;
+        ++word;
+        word = (word == cbitmap->num_words) ? 0 : word;
+        mask = ALL_ONES;
+    }
+
+    return ClaimInWord(cbitmap, start, ~(ALL_ONES << (from & WORD_MASK)));
+}
+
+/* a clear bit of the word inside mask, lowest first. A word seen full
+   is marked, a word seen with room loses a stale mark */
+static size_t ClaimInWord(cbitmap_t *cbitmap, size_t word, unsigned long mask)
+{
+    unsigned long old = LoadWord(cbitmap, word);
+    unsigned long free_bits = 0;
+
+    while (0 != (free_bits = ~old & mask))
+    {
+        free_bits &= -free_bits;
+        if (atomic_compare_exchange_weak_explicit(&cbitmap->words[word], &old,
+                                                  old | free_bits,
+                                                  memory_order_acq_rel,
+                                                  memory_order_relaxed))
+        {
+            if (ALL_ONES == (old | free_bits))
+            {
+                MarkFull(cbitmap, word);
+            }
+            else if (IsMarkedFull(cbitmap, word))
+            {
+                MarkNotFull(cbitmap, word);
+            }
+
+            return ((word << WORD_SHIFT) + __builtin_ctzl(free_bits));
+        }
+    }
+
+    if (ALL_ONES == old)
+    {
+        MarkFull(cbitmap, word);
+    }
+
+    return NOT_FOUND;
+}
+
+static int IsMarkedFull(const cbitmap_t *cbitmap, size_t word)
+{
+    return (0 != (atomic_load_explicit(&cbitmap->full[word >> WORD_SHIFT],
+                                       memory_order_relaxed) &
+                  (1UL << (word & WORD_MASK))));
+}
+
+/* reads before writing, so a mark that is already right costs no
+   exclusive cache line */
+static void MarkFull(cbitmap_t *cbitmap, size_t word)
+{
+    if (!IsMarkedFull(cbitmap, word))
+    {
+        atomic_fetch_or_explicit(&cbitmap->full[word >> WORD_SHIFT],
+                                 1UL << (word & WORD_MASK),
+                                 memory_order_relaxed);
+    }
+}
+
+static void MarkNotFull(cbitmap_t *cbitmap, size_t word)
+{
+    if (IsMarkedFull(cbitmap, word))
+    {
+        atomic_fetch_and_explicit(&cbitmap->full[word >> WORD_SHIFT],
+                                  ~(1UL << (word & WORD_MASK)),
+                                  memory_order_relaxed);
+    }
+}
+
+static unsigned long LoadWord(const cbitmap_t *cbitmap, size_t word)
+{
+    return atomic_load_explicit(&cbitmap->words[word], memory_order_acquire);
+}
+
+/* clear bits, and set padding bits past the last one */
+static void InitWords(atomic_ulong *words, size_t bits)
+{
+    size_t num_words = WORDS_FOR(bits);
+    size_t word = 0;
+
+    for (word = 0; word < num_words; ++word)
+    {
+        atomic_init(&words[word], 0);
+    }
+
+    if (0 != (bits & WORD_MASK))
+    {
+        atomic_init(&words[num_words - 1], ALL_ONES << (bits & WORD_MASK));
+    }
+}
@@ -0,0 +1,254 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memcpy */
+#include <assert.h> /* assert */
+#include <stdint.h> /* uintptr_t */
+#include <stdatomic.h> /* atomic_size_t */
+
+#include "cvector.h" /* cvector_t */
+
+#define SUCCESS (0)
+#define FAILURE (-1)
+#define FIRST_SEGMENT_BITS (6)
+#define FIRST_SEGMENT_SIZE ((size_t)1 << FIRST_SEGMENT_BITS)
+#define MAX_SEGMENTS (sizeof(size_t) * 8 - FIRST_SEGMENT_BITS)
+#define SEGMENT_SIZE(seg) (FIRST_SEGMENT_SIZE << (seg))
+
+typedef enum slot_state
+{
+    SLOT_EMPTY = 0,
+    SLOT_READY
+} slot_state_t;
+
+/* segment seg holds SEGMENT_SIZE(seg) elements followed by one ready flag
+   per element */
+struct cvector
+{
+    size_t element_size;
+    atomic_size_t reserved;
+    atomic_size_t committed;
+    atomic_int is_broken;
+    atomic_uintptr_t segments[MAX_SEGMENTS];
+};
+
+static size_t Locate(size_t idx, size_t *offset);
+static char *GetSegment(cvector_t *cvector, size_t seg);
+static atomic_uchar *ReadyFlags(const cvector_t *cvector, char *segment,
+                                size_t seg);
+static void AdvanceCommitted(cvector_t *cvector);
+static int IsReady(cvector_t *cvector, size_t idx);
+
+cvector_t *CVectorCreate(size_t element_size)
+{
+    cvector_t *cvector = NULL;
+    size_t seg = 0;
+
+    assert(0 != element_size);
+
+    cvector = (cvector_t *)malloc(sizeof(cvector_t));
+    if (NULL == cvector)
+    {
+        return NULL;
+    }
+
+    cvector->element_size = element_size;
+    atomic_init(&cvector->reserved, 0);
+    atomic_init(&cvector->committed, 0);
+    atomic_init(&cvector->is_broken, 0);
+    for (seg = 0; seg < MAX_SEGMENTS; ++seg)
+    {
+        atomic_init(&cvector->segments[seg], 0);
+    }
+
+    if (NULL == GetSegment(cvector, 0))
+    {
+        free(cvector);
+        return NULL;
+    }
+
+    return cvector;
+}
+
+void CVectorDestroy(cvector_t *cvector)
+{
+    size_t seg = 0;
+
+    assert(NULL != cvector);
+
+    for (seg = 0; seg < MAX_SEGMENTS; ++seg)
+    {
+        free((void *)atomic_load_explicit(&cvector->segments[seg],
+                                          memory_order_relaxed));
+    }
+    free(cvector);
+}
+
+int CVectorPushBack(cvector_t *cvector, const void *data)
+{
+    char *segment = NULL;
+    size_t offset = 0;
+    size_t seg = 0;
+    size_t idx = 0;
+
+    assert(NULL != cvector);
+    assert(NULL != data);
+
+    if (atomic_load_explicit(&cvector->is_broken, memory_order_relaxed))
+    {
+        return FAILURE;
+    }
+
+    idx = atomic_fetch_add_explicit(&cvector->reserved, 1,
+                                    memory_order_relaxed);
+    seg = Locate(idx, &offset);
+    segment = GetSegment(cvector, seg);
+    if (NULL == segment)
+    {
+        atomic_store_explicit(&cvector->is_broken, 1, memory_order_relaxed);
+        return FAILURE;
+    }
+
+    memcpy(segment + offset * cvector->element_size, data,
+           cvector->element_size);
+    atomic_store(&ReadyFlags(cvector, segment, seg)[offset], SLOT_READY);
+
+    AdvanceCommitted(cvector);
+
+    return SUCCESS;
+}
+
+size_t CVectorSize(const cvector_t *cvector)
+{
+    assert(NULL != cvector);
+
+    return atomic_load_explicit((atomic_size_t *)&cvector->committed,
+                                memory_order_acquire);
+}
+
+void *CVectorGetAccessToElement(const cvector_t *cvector, size_t idx)
+{
+    char *segment = NULL;
+    size_t offset = 0;
+    size_t seg = 0;
+
+    assert(NULL != cvector);
+    assert(idx < CVectorSize(cvector));
+
+    seg = Locate(idx, &offset);
+    segment = (char *)atomic_load_explicit(
+                  (atomic_uintptr_t *)&cvector->segments[seg],
+                  memory_order_acquire);
+
+    return (segment + offset * cvector->element_size);
+}
+
+/******************************************************************************/
+
+/* idx + FIRST_SEGMENT_SIZE has its top bit at FIRST_SEGMENT_BITS + seg */
+static size_t Locate(size_t idx, size_t *offset)
+{
+    size_t biased = idx + FIRST_SEGMENT_SIZE;
+    size_t top_bit = sizeof(unsigned long) * 8 - 1 -
+                     __builtin_clzl((unsigned long)biased);
+
+    *offset = biased - ((size_t)1 << top_bit);
+
+    return (top_bit - FIRST_SEGMENT_BITS);
+}
+
+/* allocates a missing segment; racing threads all allocate and the losers
+   of the CAS free theirs */
+static char *GetSegment(cvector_t *cvector, size_t seg)
+{
+    uintptr_t segment = 0;
+    uintptr_t expected = 0;
+    size_t slots = SEGMENT_SIZE(seg);
+    char *fresh = NULL;
+
+    segment = atomic_load_explicit(&cvector->segments[seg],
+                                   memory_order_acquire);
+    if (0 != segment)
+    {
+        return (char *)segment;
+    }
+
+    fresh = (char *)malloc(slots * cvector->element_size + slots);
+    if (NULL == fresh)
+    {
+        return NULL;
+    }
+    memset(fresh + slots * cvector->element_size, SLOT_EMPTY, slots);
+
+    if (atomic_compare_exchange_strong_explicit(&cvector->segments[seg],
+                    &expected, (uintptr_t)fresh, memory_order_acq_rel,
+                    memory_order_acquire))
+    {
+        return fresh;
+    }
+    free(fresh);
+
+    return (char *)expected;
+}
+
+static atomic_uchar *ReadyFlags(const cvector_t *cvector, char *segment,
+                                size_t seg)
+{
+    return (atomic_uchar *)(segment + SEGMENT_SIZE(seg) * cvector->element_size);
+}
+
+/* moves the committed prefix over every ready slot. Any pusher may do the
+   work of a slower one, so no thread waits on another.
+   The ready flags and committed are accessed seq_cst: a pusher that sets
+   its flag and a helper that stops at that flag cannot both miss the
+   other's store, so the last slot to become ready is always committed */
+static void AdvanceCommitted(cvector_t *cvector)
+{
+    size_t committed = atomic_load(&cvector->committed);
+    size_t next = 0;
+
+    while (1)
+    {
+        next = committed;
+        while (IsReady(cvector, next))
+        {
+            ++next;
+        }
+        if (next == committed)
+        {
+            return;
+        }
+
+        /* one CAS covers the whole ready run; on failure committed is
+           reloaded and the walk starts over from there */
+        if (atomic_compare_exchange_weak(&cvector->committed, &committed,
+                                         next))
+        {
+            committed = next;
+        }
+    }
+}
+
+static int IsReady(cvector_t *cvector, size_t idx)
+{
+    uintptr_t segment = 0;
+    size_t offset = 0;
+    size_t seg = 0;
+
+    if (idx >= atomic_load_explicit(&cvector->reserved, memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    seg = Locate(idx, &offset);
+    segment = atomic_load_explicit(&cvector->segments[seg],
+                                   memory_order_acquire);
+
+    return (0 != segment && SLOT_READY == atomic_load(
+                &ReadyFlags(cvector, (char *)segment, seg)[offset]));
+}
@@ -1,21 +1,70 @@
 /*//////////////////////////////////////
-Name: Alon Weinberg                    
-Reviewer:                              
-Last Date Updated: 04/4/24             
-File Type: Test File                   
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
 //////////////////////////////////////*/
 
 #include <stdlib.h> /* malloc */
 #include <assert.h> /* assert */
 #include <string.h> /* memcpy */
-#include <math.h> /* pow */
-#include <stdio.h> /* sprintf */
+#include <errno.h> /* errno */
+#include <unistd.h> /* read, write */
+#include <stdatomic.h> /* atomic_size_t */
 
 #include "dhcp.h" /* dhcp_t, status_t */
+#include "hbitmap.h" /* hbitmap_t */
+#include "cbitmap.h" /* cbitmap_t */
 
 #define SIZE_IP (32)
 #define SIZE_BYTE (8)
 #define SIZE_HOST(dhcp) (SIZE_IP - dhcp->bits_in_subnet)
+#define HOST_MASK(dhcp) (0xFFFFFFFFU >> dhcp->bits_in_subnet)
+#define SUBTREE_SIZE(height) ((size_t)1 << (height))
+#define INITIAL_POOL_SIZE (64)
+
+/* node 0 is an empty dummy standing for every missing child, so its
+   taken of 0 can be read like any other node's. The root is node 1 */
+#define NIL (0)
+#define ROOT (1)
+
+/* snapshot and journal fields are big endian 32 bit words */
+#define WORD_SIZE (4)
+#define SNAPSHOT_MAGIC (0x44484350) /* "DHCP" */
+#define SNAPSHOT_VERSION (1)
+#define HEADER_SIZE (8 * WORD_SIZE)
+#define RUN_SIZE (2 * WORD_SIZE)
+#define RECORD_SIZE (3 * WORD_SIZE)
+#define IO_CHUNK (1 << 16)
+#define JOURNAL_RECORDS (4096)
+#define HINT_SLOTS (16)
+#define CACHE_LINE (64)
+
+typedef enum snapshot_field
+{
+    FIELD_MAGIC = 0,
+    FIELD_VERSION,
+    FIELD_SUBNET,
+    FIELD_BITS,
+    FIELD_ENCODING,
+    FIELD_ENTRIES,
+    FIELD_TAKEN
+} snapshot_field_t;
+
+/* runs are a first host and a count, raw is one bit per host with host 0
+   the low bit of byte 0, so every 8 bytes read as a little endian word
+   are a word of a bitmap backend */
+typedef enum snapshot_encoding
+{
+    ENCODING_RUNS = 0,
+    ENCODING_RAW
+} snapshot_encoding_t;
+
+typedef enum journal_op
+{
+    JOURNAL_TAKE = 1,
+    JOURNAL_RELEASE
+} journal_op_t;
 
 typedef enum children
 {
@@ -24,40 +73,110 @@ typedef enum children
     NUM_OF_CHILDREN
 } children_t;
 
-typedef enum is_full
-{
-    NOT_FULL = 0,
-    FULL
-} is_full_t;
+typedef unsigned int node_idx_t;
 
 typedef struct trie_node trie_node_t;
 
+/* where the threads in one slot look for a free host in a concurrent pool,
+   plus one, so 0 is a slot no thread has used yet. A hint per cache line,
+   so threads moving their hints do not share lines */
+typedef struct hint
+{
+    atomic_size_t spot;
+    char pad[CACHE_LINE - sizeof(atomic_size_t)];
+} hint_t;
+
+/* taken counts the allocated hosts under the node: the subtree is full
+   when taken reaches its size, and a missing child is all free.
+   A released node is linked into the free list through children[LEFT] */
 struct trie_node
 {
-    trie_node_t *children[NUM_OF_CHILDREN];
-    int is_full;
+    node_idx_t children[NUM_OF_CHILDREN];
+    unsigned int taken;
 };
 
+/* the trie lives in one array of nodes linked by index, so growing it
+   with realloc keeps every link valid. Only one of nodes, bitmap and
+   shared is used, as backend says. A set bit in a bitmap is a taken host */
 struct dhcp
 {
     unsigned char subnet_addr[BYTES_IN_IP];
     size_t bits_in_subnet;
-    trie_node_t *tree;
+    dhcp_backend_t backend;
+    trie_node_t *nodes;
+    size_t pool_size;
+    size_t pool_used;
+    node_idx_t free_nodes;
+    hbitmap_t *bitmap;
+    cbitmap_t *shared;
+    hint_t *hints;
+    atomic_size_t next_spot;
+    int journal_fd;
+    unsigned char *journal;
+    size_t journal_used;
+    int journal_failed;
 };
 
-static trie_node_t *TrieCreate();
-static void TrieDestroy(trie_node_t *root);
-static status_t TrieInsertMostLeft(trie_node_t *root, unsigned int *result_ip, unsigned int mask);
-static status_t TrieInsertRequest(trie_node_t *root, unsigned int *result_ip,
-                                  const unsigned int requested_ip, int mask);
-static size_t TrieSize(trie_node_t *trie, int size);
+/* which hint of a concurrent pool the calling thread uses. Threads more
+   than HINT_SLOTS apart share a hint, which only costs them a longer
+   search */
+static __thread size_t thread_slot;
+static __thread int thread_has_slot;
+static atomic_size_t next_thread_slot;
+
+static int PoolCreate(dhcp_t *dhcp);
+static int PoolReserve(dhcp_t *dhcp, size_t count);
+static node_idx_t NodeAlloc(dhcp_t *dhcp);
+static void NodeRelease(dhcp_t *dhcp, node_idx_t node);
+static int TrieFindFree(const dhcp_t *dhcp, unsigned int from,
+                        unsigned int *host, size_t *run_end);
+static unsigned int TrieLeftmostFree(const dhcp_t *dhcp, node_idx_t node,
+                                     unsigned int prefix, unsigned int height,
+                                     size_t *run_end);
+static void TrieFillBlock(dhcp_t *dhcp, unsigned int first,
+                          unsigned int block_height);
+static status_t TrieClearBlock(dhcp_t *dhcp, unsigned int first,
+                               unsigned int block_height);
+static status_t TrieExpand(dhcp_t *dhcp, node_idx_t node, unsigned int height);
+static void TrieFreeSubtree(dhcp_t *dhcp, node_idx_t node);
+static void TrieFillRange(dhcp_t *dhcp, size_t first, size_t end);
+static status_t TrieClearRange(dhcp_t *dhcp, size_t first, size_t end);
+static unsigned int BlockHeight(size_t first, size_t end, unsigned int max_height);
+static unsigned int TrieNthFree(const dhcp_t *dhcp, size_t n);
+static size_t TrieFreeBelow(const dhcp_t *dhcp, unsigned int host);
+static int TrieIsTaken(const dhcp_t *dhcp, unsigned int host);
+static int FindFree(const dhcp_t *dhcp, unsigned int from, unsigned int *host,
+                    size_t *run_end);
+static status_t TakeHosts(dhcp_t *dhcp, size_t first, size_t end);
+static status_t ReleaseHosts(dhcp_t *dhcp, size_t first, size_t end);
+static size_t CountFreeHosts(const dhcp_t *dhcp, unsigned int first,
+                             unsigned int last);
+static void UndoMany(dhcp_t *dhcp, const unsigned char *ips, size_t n);
+static status_t SharedAllocate(dhcp_t *dhcp, unsigned char result_ip[BYTES_IN_IP],
+                               const unsigned char requested_ip[BYTES_IN_IP]);
 
 static unsigned int CharToInt(const unsigned char *requested_ip, size_t bits_in_subnet);
 static void ExtractNum(unsigned char *ip, unsigned int result_ip, size_t bits_in_subnet);
-static int IsFull(trie_node_t *root);
-static status_t ChangeToMostLeft(trie_node_t *root, status_t status,
-                                  unsigned int *result_ip, int mask, unsigned int curr_host_msb);
 static unsigned int ExtractBitsFromArray(const unsigned char requested[BYTES_IN_IP]);
+static status_t BitmapFree(dhcp_t *dhcp, unsigned int host);
+static int NextTakenRun(const dhcp_t *dhcp, size_t from, size_t *first,
+                        size_t *end);
+static size_t HostsInPool(const dhcp_t *dhcp);
+static void JournalAppend(dhcp_t *dhcp, journal_op_t op, size_t first,
+                          size_t end);
+static status_t WriteRaw(const dhcp_t *dhcp, int fd, unsigned char *buffer);
+static status_t WriteRuns(const dhcp_t *dhcp, int fd, unsigned char *buffer);
+static status_t LoadRaw(dhcp_t *dhcp, int fd, size_t num_bytes,
+                        unsigned char *buffer);
+static status_t LoadRuns(dhcp_t *dhcp, int fd, size_t num_runs,
+                         unsigned char *buffer);
+static void OrRawWords(dhcp_t *dhcp, size_t first_word,
+                       const unsigned char *bytes, size_t num_bytes);
+static void SetBits(unsigned char *bytes, size_t from, size_t to);
+static void Put32(unsigned char *bytes, size_t value);
+static size_t Get32(const unsigned char *bytes);
+static status_t WriteAll(int fd, const unsigned char *bytes, size_t size);
+static size_t ReadAll(int fd, unsigned char *bytes, size_t size);
 
 /******************************************************************************/
 
@@ -67,6 +186,13 @@ static unsigned int ExtractBitsFromArray(const unsigned char requested[BYTES_IN_
 
 dhcp_t *DHCPCreate(const unsigned char subnet_addr[BYTES_IN_IP], 
                    size_t bits_in_subnet)
+{
+    return (DHCPCreateWithBackend(subnet_addr, bits_in_subnet,
+                                  DHCP_BACKEND_TRIE));
+}
+
+dhcp_t *DHCPCreateWithBackend(const unsigned char subnet_addr[BYTES_IN_IP],
+                              size_t bits_in_subnet, dhcp_backend_t backend)
 {
     status_t status = DHCP_STATUS_SUCCESS;
     unsigned char network_address[BYTES_IN_IP] = {0, 0, 0, 0};
@@ -79,7 +205,45 @@ dhcp_t *DHCPCreate(const unsigned char subnet_addr[BYTES_IN_IP],
         return (NULL);
     }
 
-    dhcp->tree = TrieCreate();
+    dhcp->backend = backend;
+    dhcp->nodes = NULL;
+    dhcp->bitmap = NULL;
+    dhcp->shared = NULL;
+    dhcp->hints = NULL;
+    atomic_init(&dhcp->next_spot, 0);
+    dhcp->journal_fd = -1;
+    dhcp->journal = NULL;
+    dhcp->journal_used = 0;
+    dhcp->journal_failed = 0;
+    if (DHCP_BACKEND_BITMAP == backend)
+    {
+        dhcp->bitmap = HBitmapCreate((size_t)1 << (SIZE_IP - bits_in_subnet));
+        if (NULL == dhcp->bitmap)
+        {
+            free(dhcp);
+            return (NULL);
+        }
+    }
+    else if (DHCP_BACKEND_CONCURRENT == backend)
+    {
+        dhcp->shared = CBitmapCreate((size_t)1 << (SIZE_IP - bits_in_subnet));
+        dhcp->hints = calloc(HINT_SLOTS, sizeof(hint_t));
+        if (NULL == dhcp->shared || NULL == dhcp->hints)
+        {
+            if (NULL != dhcp->shared)
+            {
+                CBitmapDestroy(dhcp->shared);
+            }
+            free(dhcp->hints);
+            free(dhcp);
+            return (NULL);
+        }
+    }
+    else if (DHCP_STATUS_SUCCESS != PoolCreate(dhcp))
+    {
+        free(dhcp);
+        return (NULL);
+    }
     dhcp->bits_in_subnet = bits_in_subnet;
     memcpy(dhcp->subnet_addr, subnet_addr, BYTES_IN_IP);
     
@@ -109,291 +273,1580 @@ dhcp_t *DHCPCreate(const unsigned char subnet_addr[BYTES_IN_IP],
 
 void DHCPDestroy(dhcp_t *dhcp)
 {
-    TrieDestroy(dhcp->tree);
-    dhcp->tree = NULL;
+    if (NULL == dhcp)
+    {
+        return;
+    }
+
+    DHCPJournalFlush(dhcp);
+    free(dhcp->journal);
+    /* the whole trie is one block */
+    free(dhcp->nodes);
+    if (NULL != dhcp->bitmap)
+    {
+        HBitmapDestroy(dhcp->bitmap);
+    }
+    if (NULL != dhcp->shared)
+    {
+        CBitmapDestroy(dhcp->shared);
+    }
+    free(dhcp->hints);
     free(dhcp);
 }
 
+/* the requested host, else the first free one after it, else the first
+   free one */
 status_t DHCPAllocateIP(dhcp_t *dhcp, unsigned char result_ip[BYTES_IN_IP],
                         const unsigned char requested_ip[BYTES_IN_IP])
 {
     status_t status = DHCP_STATUS_SUCCESS;
-    unsigned int host_requested = 0;
-    unsigned int mask = (1 << (SIZE_HOST(dhcp) - 1));
-    unsigned int result_ip_in_bits = 0;
+    unsigned int from = 0;
+    unsigned int host = 0;
+    size_t run_end = 0;
 
-    if (NULL == requested_ip)
+    assert(dhcp);
+
+    if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        return (SharedAllocate(dhcp, result_ip, requested_ip));
+    }
+
+    if (NULL != requested_ip)
+    {
+        from = CharToInt(requested_ip, dhcp->bits_in_subnet) & HOST_MASK(dhcp);
+    }
+
+    if (!FindFree(dhcp, from, &host, &run_end) &&
+        !FindFree(dhcp, 0, &host, &run_end))
     {
-        status = TrieInsertMostLeft(dhcp->tree, &result_ip_in_bits, mask);
+        status = DHCP_STATUS_FULL_ERR;
+    }
+    else if (DHCP_BACKEND_BITMAP == dhcp->backend)
+    {
+        HBitmapSet(dhcp->bitmap, host);
+        JournalAppend(dhcp, JOURNAL_TAKE, host, (size_t)host + 1);
+    }
+    /* a new path needs at most one node per level, reserve them all so
+       taking the host cannot fail half way */
+    else if (DHCP_STATUS_SUCCESS != PoolReserve(dhcp, SIZE_HOST(dhcp)))
+    {
+        status = DHCP_STATUS_FAIL;
     }
     else
     {
-        host_requested = CharToInt(requested_ip, dhcp->bits_in_subnet);
-        status = TrieInsertRequest(dhcp->tree, &result_ip_in_bits, host_requested, mask);
-        if (DHCP_STATUS_FULL_ERR == status)
-        {
-            status = TrieInsertMostLeft(dhcp->tree, &result_ip_in_bits, mask);
-        }
+        TrieFillBlock(dhcp, host, 0);
+        JournalAppend(dhcp, JOURNAL_TAKE, host, (size_t)host + 1);
     }
 
-    memcpy(result_ip, dhcp->subnet_addr, sizeof(int));
+    memcpy(result_ip, dhcp->subnet_addr, BYTES_IN_IP);
 
-    ExtractNum(result_ip, result_ip_in_bits, dhcp->bits_in_subnet);
+    ExtractNum(result_ip, host, dhcp->bits_in_subnet);
 
     return (status);
 }
 
 status_t DHCPFreeIP(dhcp_t *dhcp, const unsigned char ip_addr[BYTES_IN_IP])
 {
-    unsigned int height = 32 - (dhcp->bits_in_subnet);
-    unsigned int host_to_remove = ExtractBitsFromArray(ip_addr);
-    unsigned int curr_host_msb = 0;
-    trie_node_t *current_node = dhcp->tree;
-    trie_node_t *parent = NULL;
-    while (height > 0)
+    unsigned int host_to_remove = ExtractBitsFromArray(ip_addr) & HOST_MASK(dhcp);
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
     {
-        curr_host_msb = ((1 << (height -1)) & host_to_remove) == 0 ? LEFT : RIGHT; 
-        if (current_node->children[curr_host_msb] == NULL)
-        {
-            return DHCP_STATUS_DOUBLE_FREE_ERR;
-        }
-        parent = current_node;
-        current_node = current_node->children[curr_host_msb];
+        status = BitmapFree(dhcp, host_to_remove);
+    }
+    else if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        return (CBitmapRelease(dhcp->shared, host_to_remove) ?
+                DHCP_STATUS_SUCCESS : DHCP_STATUS_DOUBLE_FREE_ERR);
+    }
+    else
+    {
+        status = TrieClearBlock(dhcp, host_to_remove, 0);
+    }
 
-        parent->is_full = NOT_FULL;
-        height--;
+    if (DHCP_STATUS_SUCCESS == status)
+    {
+        JournalAppend(dhcp, JOURNAL_RELEASE, host_to_remove,
+                      (size_t)host_to_remove + 1);
     }
 
-    parent->children[curr_host_msb] = NULL;
-    free(current_node);
-    return DHCP_STATUS_SUCCESS;
+    return (status);
 }
 
-size_t DHCPCountFree(const dhcp_t *dhcp)
+/* takes the free runs in increasing order, each run as a range */
+status_t DHCPAllocateMany(dhcp_t *dhcp, size_t n, unsigned char *result_ips)
 {
-    size_t occupied = 0;
+    unsigned int from = 0;
+    unsigned int host = 0;
+    size_t run_end = 0;
+    size_t count = 0;
+    size_t done = 0;
+    size_t i = 0;
+
     assert(dhcp);
-    occupied = TrieSize(dhcp->tree, SIZE_HOST(dhcp));
-    return (pow(2, SIZE_HOST(dhcp)) - occupied);
-}
 
-/******************************************************************************/
+    /* other threads allocate too, so the count proves nothing here. The
+       addresses are not the smallest ones, but near the thread's own */
+    if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        for (done = 0; done < n; ++done)
+        {
+            if (DHCP_STATUS_SUCCESS !=
+                SharedAllocate(dhcp, result_ips + done * BYTES_IN_IP, NULL))
+            {
+                DHCPFreeMany(dhcp, done, result_ips);
+                return (DHCP_STATUS_FULL_ERR);
+            }
+        }
 
-/****************************Utilities Functions*******************************/
+        return (DHCP_STATUS_SUCCESS);
+    }
 
-/******************************************************************************/
+    if (n > DHCPCountFree(dhcp))
+    {
+        return (DHCP_STATUS_FULL_ERR);
+    }
 
-static trie_node_t *TrieCreate()
-{
-    trie_node_t *trie = (trie_node_t *)malloc(sizeof(trie_node_t));
-    if (NULL == trie)
+    while (done < n)
     {
-        return (NULL);
+        FindFree(dhcp, from, &host, &run_end);
+        if (DHCP_BACKEND_BITMAP == dhcp->backend)
+        {
+            run_end = host + (n - done);
+            if (run_end > HBitmapSize(dhcp->bitmap))
+            {
+                run_end = HBitmapSize(dhcp->bitmap);
+            }
+            run_end = HBitmapFindSet(dhcp->bitmap, host, run_end);
+        }
+        count = run_end - host;
+        if (count > n - done)
+        {
+            count = n - done;
+        }
+
+        if (DHCP_STATUS_SUCCESS != TakeHosts(dhcp, host, (size_t)host + count))
+        {
+            UndoMany(dhcp, result_ips, done);
+            return (DHCP_STATUS_FAIL);
+        }
+
+        for (i = 0; i < count; ++i, ++done)
+        {
+            memcpy(result_ips + done * BYTES_IN_IP, dhcp->subnet_addr,
+                   BYTES_IN_IP);
+            ExtractNum(result_ips + done * BYTES_IN_IP, host + (unsigned int)i,
+                       dhcp->bits_in_subnet);
+        }
+        from = host + (unsigned int)count;
     }
 
-    trie->children[LEFT] = NULL;
-    trie->children[RIGHT] = NULL;
-    trie->is_full = NOT_FULL;
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* consecutive addresses that are all taken are released as one range */
+status_t DHCPFreeMany(dhcp_t *dhcp, size_t n, const unsigned char *ip_addrs)
+{
+    status_t status = DHCP_STATUS_SUCCESS;
+    status_t one_status = DHCP_STATUS_SUCCESS;
+    unsigned int first = 0;
+    unsigned int last = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    assert(dhcp);
+
+    while (i < n)
+    {
+        first = ExtractBitsFromArray(ip_addrs + i * BYTES_IN_IP) & HOST_MASK(dhcp);
+        last = first;
+        for (j = i + 1; j < n; ++j)
+        {
+            if ((ExtractBitsFromArray(ip_addrs + j * BYTES_IN_IP) &
+                 HOST_MASK(dhcp)) != last + 1)
+            {
+                break;
+            }
+            ++last;
+        }
+
+        /* the check and the release are not one step for other threads */
+        if (DHCP_BACKEND_CONCURRENT != dhcp->backend && 1 < j - i &&
+            0 == CountFreeHosts(dhcp, first, last) &&
+            DHCP_STATUS_SUCCESS == ReleaseHosts(dhcp, first, (size_t)last + 1))
+        {
+            i = j;
+            continue;
+        }
+
+        /* one by one, so every address gets its own status */
+        for (; i < j; ++i)
+        {
+            one_status = DHCPFreeIP(dhcp, ip_addrs + i * BYTES_IN_IP);
+            if (DHCP_STATUS_SUCCESS == status)
+            {
+                status = one_status;
+            }
+        }
+    }
 
-    return (trie);
+    return (status);
 }
 
-static void TrieDestroy(trie_node_t *root)
+status_t DHCPReserveRange(dhcp_t *dhcp,
+                          const unsigned char first_ip[BYTES_IN_IP],
+                          const unsigned char last_ip[BYTES_IN_IP])
 {
-    if (!root)
+    unsigned int first = 0;
+    unsigned int last = 0;
+
+    assert(dhcp);
+
+    first = ExtractBitsFromArray(first_ip) & HOST_MASK(dhcp);
+    last = ExtractBitsFromArray(last_ip) & HOST_MASK(dhcp);
+    if (first > last)
     {
-        return;
+        return (DHCP_STATUS_FAIL);
     }
 
-    TrieDestroy(root->children[LEFT]);
-    TrieDestroy(root->children[RIGHT]);
-    free(root);
+    return (TakeHosts(dhcp, first, (size_t)last + 1));
 }
 
-static status_t TrieInsertMostLeft(trie_node_t *root,
-                                    unsigned int *result_ip, unsigned int mask)
+status_t DHCPReleaseRange(dhcp_t *dhcp,
+                          const unsigned char first_ip[BYTES_IN_IP],
+                          const unsigned char last_ip[BYTES_IN_IP])
 {
-    int side = LEFT;
-    status_t status = DHCP_STATUS_SUCCESS;
+    unsigned int first = 0;
+    unsigned int last = 0;
 
-    if (FULL == root->is_full)
+    assert(dhcp);
+
+    first = ExtractBitsFromArray(first_ip) & HOST_MASK(dhcp);
+    last = ExtractBitsFromArray(last_ip) & HOST_MASK(dhcp);
+    if (first > last)
     {
-        return (DHCP_STATUS_FULL_ERR);
+        return (DHCP_STATUS_FAIL);
     }
 
-    if (mask == 0) 
+    return (ReleaseHosts(dhcp, first, (size_t)last + 1));
+}
+
+size_t DHCPCountFree(const dhcp_t *dhcp)
+{
+    assert(dhcp);
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
     {
-        root->is_full = FULL;
-        return (DHCP_STATUS_SUCCESS);
+        return (HBitmapSize(dhcp->bitmap) - HBitmapCountSet(dhcp->bitmap));
+    }
+    if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        return (CBitmapSize(dhcp->shared) -
+                CBitmapCountSetRange(dhcp->shared, 0, CBitmapSize(dhcp->shared)));
     }
 
-    if (root->children[side] && FULL == root->children[side]->is_full)
+    return (SUBTREE_SIZE(SIZE_HOST(dhcp)) - dhcp->nodes[ROOT].taken);
+}
+
+status_t DHCPGetNthFree(const dhcp_t *dhcp, size_t n,
+                        unsigned char result_ip[BYTES_IN_IP])
+{
+    unsigned int host = 0;
+
+    assert(dhcp);
+
+    if (n >= DHCPCountFree(dhcp))
     {
-        side = RIGHT;
+        return (DHCP_STATUS_FAIL);
     }
 
-    if (!root->children[side])
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
+    {
+        host = (unsigned int)HBitmapFindNthClear(dhcp->bitmap, n);
+    }
+    else if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
     {
-        root->children[side] = TrieCreate();
-        if (!root->children[side])
+        /* the count may be stale by now */
+        if (CBitmapSize(dhcp->shared) ==
+            (host = (unsigned int)CBitmapFindNthClear(dhcp->shared, n)))
         {
             return (DHCP_STATUS_FAIL);
         }
     }
-
-    *result_ip = ((*result_ip << 1) | side);
-    status = TrieInsertMostLeft(root->children[side], result_ip, mask >> 1);
-
-    if (IsFull(root))
+    else
     {
-        root->is_full = FULL;
+        host = TrieNthFree(dhcp, n);
     }
 
-    return (status);
+    memcpy(result_ip, dhcp->subnet_addr, BYTES_IN_IP);
+    ExtractNum(result_ip, host, dhcp->bits_in_subnet);
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+size_t DHCPCountFreeInRange(const dhcp_t *dhcp,
+                            const unsigned char first_ip[BYTES_IN_IP],
+                            const unsigned char last_ip[BYTES_IN_IP])
+{
+    assert(dhcp);
+
+    return (CountFreeHosts(dhcp, ExtractBitsFromArray(first_ip) & HOST_MASK(dhcp),
+                           ExtractBitsFromArray(last_ip) & HOST_MASK(dhcp)));
 }
 
-static status_t TrieInsertRequest(trie_node_t *root, unsigned int *result_ip,
-                                  const unsigned int requested_ip, int mask)
+/* the runs are counted first, so the smaller encoding is known before
+   the header is written */
+status_t DHCPSave(const dhcp_t *dhcp, int fd)
 {
+    unsigned char *buffer = NULL;
+    size_t raw_bytes = (HostsInPool(dhcp) + SIZE_BYTE - 1) / SIZE_BYTE;
+    size_t num_runs = 0;
+    size_t taken = 0;
+    size_t first = 0;
+    size_t end = 0;
     status_t status = DHCP_STATUS_SUCCESS;
-    unsigned int curr_host_msb = (mask & requested_ip) == 0 ? 0 : 1;
 
-    if (FULL == root->is_full)
+    assert(dhcp);
+
+    buffer = (unsigned char *)malloc(IO_CHUNK);
+    if (NULL == buffer)
     {
-        return (DHCP_STATUS_FULL_ERR);
+        return (DHCP_STATUS_FAIL);
     }
 
-    if (mask == 0)
+    while (NextTakenRun(dhcp, end, &first, &end))
     {
-        root->is_full = FULL;
-        return (DHCP_STATUS_SUCCESS);
+        ++num_runs;
+        taken += end - first;
     }
 
-    if (NULL == root->children[curr_host_msb])
+    memset(buffer, 0, HEADER_SIZE);
+    Put32(buffer + FIELD_MAGIC * WORD_SIZE, SNAPSHOT_MAGIC);
+    Put32(buffer + FIELD_VERSION * WORD_SIZE, SNAPSHOT_VERSION);
+    memcpy(buffer + FIELD_SUBNET * WORD_SIZE, dhcp->subnet_addr, BYTES_IN_IP);
+    Put32(buffer + FIELD_BITS * WORD_SIZE, dhcp->bits_in_subnet);
+    Put32(buffer + FIELD_TAKEN * WORD_SIZE, taken);
+    if (num_runs * RUN_SIZE > raw_bytes)
     {
-        root->children[curr_host_msb] = TrieCreate();
-        if (!root->children[curr_host_msb])
-        {
-            return (DHCP_STATUS_FAIL);
-        }
+        Put32(buffer + FIELD_ENCODING * WORD_SIZE, ENCODING_RAW);
+        Put32(buffer + FIELD_ENTRIES * WORD_SIZE, raw_bytes);
+    }
+    else
+    {
+        Put32(buffer + FIELD_ENCODING * WORD_SIZE, ENCODING_RUNS);
+        Put32(buffer + FIELD_ENTRIES * WORD_SIZE, num_runs);
     }
-    *result_ip = ((*result_ip << 1) | curr_host_msb);
-    status = TrieInsertRequest(root->children[curr_host_msb], result_ip, requested_ip, mask >> 1);
 
-    if (DHCP_STATUS_FULL_ERR == status)
+    status = WriteAll(fd, buffer, HEADER_SIZE);
+    if (DHCP_STATUS_SUCCESS == status)
     {
-        *result_ip = *result_ip >> 1;
-        status = ChangeToMostLeft(root, status, result_ip, mask, curr_host_msb);
+        status = (num_runs * RUN_SIZE > raw_bytes) ?
+                 WriteRaw(dhcp, fd, buffer) : WriteRuns(dhcp, fd, buffer);
     }
+    free(buffer);
+
     return (status);
 }
 
-static status_t ChangeToMostLeft(trie_node_t *root, status_t status,
-                                  unsigned int *result_ip, int mask, unsigned int curr_host_msb)
+/* the pool is made empty, then every taken run of the snapshot is taken
+   as one range */
+dhcp_t *DHCPLoad(int fd, dhcp_backend_t backend)
 {
-    if (LEFT == curr_host_msb)
+    unsigned char *buffer = NULL;
+    dhcp_t *dhcp = NULL;
+    status_t status = DHCP_STATUS_FAIL;
+
+    buffer = (unsigned char *)malloc(IO_CHUNK);
+    if (NULL == buffer)
+    {
+        return (NULL);
+    }
+
+    if (HEADER_SIZE == ReadAll(fd, buffer, HEADER_SIZE) &&
+        SNAPSHOT_MAGIC == Get32(buffer + FIELD_MAGIC * WORD_SIZE) &&
+        SNAPSHOT_VERSION == Get32(buffer + FIELD_VERSION * WORD_SIZE) &&
+        SIZE_IP > Get32(buffer + FIELD_BITS * WORD_SIZE))
+    {
+        dhcp = DHCPCreateWithBackend(buffer + FIELD_SUBNET * WORD_SIZE,
+                                     Get32(buffer + FIELD_BITS * WORD_SIZE),
+                                     backend);
+    }
+    if (NULL != dhcp &&
+        DHCP_STATUS_SUCCESS == ReleaseHosts(dhcp, 0, HostsInPool(dhcp)))
     {
-        curr_host_msb = RIGHT;
-        *result_ip = ((*result_ip << 1) | 1);
-        if (!root->children[RIGHT])
+        if (ENCODING_RAW == Get32(buffer + FIELD_ENCODING * WORD_SIZE))
         {
-            root->children[RIGHT] = TrieCreate();
-            if (!root->children[RIGHT])
-            {
-                return (DHCP_STATUS_FAIL);
-            }
+            status = LoadRaw(dhcp, fd, Get32(buffer + FIELD_ENTRIES * WORD_SIZE),
+                             buffer + HEADER_SIZE);
         }
-
-        status = TrieInsertMostLeft(root->children[RIGHT], result_ip, mask >> 1);
-        if (DHCP_STATUS_FULL_ERR == status)
+        else if (ENCODING_RUNS == Get32(buffer + FIELD_ENCODING * WORD_SIZE))
         {
-            *result_ip = *result_ip >> 1;
+            status = LoadRuns(dhcp, fd, Get32(buffer + FIELD_ENTRIES * WORD_SIZE),
+                              buffer + HEADER_SIZE);
         }
     }
+    if (DHCP_STATUS_SUCCESS == status &&
+        HostsInPool(dhcp) - DHCPCountFree(dhcp) !=
+        Get32(buffer + FIELD_TAKEN * WORD_SIZE))
+    {
+        status = DHCP_STATUS_FAIL;
+    }
+    free(buffer);
 
-    return (status);
+    if (DHCP_STATUS_SUCCESS != status)
+    {
+        DHCPDestroy(dhcp);
+        return (NULL);
+    }
+
+    return (dhcp);
 }
 
-static size_t TrieSize(trie_node_t *root, int height)
+status_t DHCPJournalStart(dhcp_t *dhcp, int fd)
 {
-    if (NULL == root)
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(dhcp);
+
+    if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
     {
-        return (0);
+        return (DHCP_STATUS_FAIL);
     }
 
-    if (FULL == root->is_full)
+    status = DHCPJournalFlush(dhcp);
+    if (NULL == dhcp->journal && -1 != fd)
     {
-        return (pow(2, height));
+        dhcp->journal = (unsigned char *)malloc(JOURNAL_RECORDS * RECORD_SIZE);
+        if (NULL == dhcp->journal)
+        {
+            return (DHCP_STATUS_FAIL);
+        }
     }
+    dhcp->journal_fd = fd;
+    dhcp->journal_failed = 0;
 
-    return (TrieSize(root->children[LEFT], height - 1) +
-            TrieSize(root->children[RIGHT], height - 1));
+    return (status);
 }
 
-static void ExtractNum(unsigned char *ip, unsigned int result_ip, size_t bits_in_subnet)
+status_t DHCPJournalFlush(dhcp_t *dhcp)
 {
-    unsigned mask = 0xFF000000;
-    size_t bits = 0;
-    int i = 0;
-
-    i = bits_in_subnet / SIZE_BYTE;
-    bits = i * SIZE_BYTE;
-    mask = mask >> (SIZE_BYTE * i);
+    assert(dhcp);
 
-    if (bits < bits_in_subnet) {
-    ip[i] = (ip[i] >> (SIZE_BYTE - (bits_in_subnet % SIZE_BYTE))) << 
-                      (SIZE_BYTE - (bits_in_subnet % SIZE_BYTE));
-    ip[i] |= ((result_ip & mask) >> ((BYTES_IN_IP - i - 1) * SIZE_BYTE));
-    mask >>= SIZE_BYTE;
-    ++i;
-}
-    while (i < BYTES_IN_IP)
+    if (-1 != dhcp->journal_fd && 0 < dhcp->journal_used &&
+        DHCP_STATUS_SUCCESS != WriteAll(dhcp->journal_fd, dhcp->journal,
+                                        dhcp->journal_used))
     {
-        ip[i] = (result_ip & mask) >> ((BYTES_IN_IP - i - 1) * SIZE_BYTE);
-        mask = mask >> SIZE_BYTE;
-        i++;
+        dhcp->journal_failed = 1;
     }
+    dhcp->journal_used = 0;
+
+    return (dhcp->journal_failed ? DHCP_STATUS_FAIL : DHCP_STATUS_SUCCESS);
 }
 
-static unsigned int CharToInt(const unsigned char *requested_ip, size_t bits_in_subnet)
+status_t DHCPJournalReplay(dhcp_t *dhcp, int fd)
 {
-    unsigned int host = 0;
-    size_t bits = 0;
-    int i = 0;
+    unsigned char *buffer = NULL;
+    unsigned char *record = NULL;
+    size_t size = HostsInPool(dhcp);
+    size_t got = 0;
+    size_t first = 0;
+    size_t end = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
 
-    i = bits_in_subnet / SIZE_BYTE;
-    bits = i * SIZE_BYTE;
+    assert(dhcp);
 
-    if (bits < bits_in_subnet)
+    buffer = (unsigned char *)malloc(JOURNAL_RECORDS * RECORD_SIZE);
+    if (NULL == buffer)
     {
-        host = requested_ip[i] << (bits_in_subnet % SIZE_BYTE);
-        host = host >> (bits_in_subnet % SIZE_BYTE);
-        i++;
+        return (DHCP_STATUS_FAIL);
     }
 
-    while (i < BYTES_IN_IP)
+    do
     {
-        host = host << SIZE_BYTE;
-        host = host | requested_ip[i];
-        i++;
-    }
+        got = ReadAll(fd, buffer, JOURNAL_RECORDS * RECORD_SIZE);
+        for (record = buffer; DHCP_STATUS_SUCCESS == status &&
+             record + RECORD_SIZE <= buffer + got; record += RECORD_SIZE)
+        {
+            first = Get32(record + WORD_SIZE);
+            end = Get32(record + 2 * WORD_SIZE) + 1;
+            if (first >= end || end > size)
+            {
+                status = DHCP_STATUS_FAIL;
+            }
+            else if (JOURNAL_TAKE == Get32(record))
+            {
+                status = TakeHosts(dhcp, first, end);
+            }
+            else if (JOURNAL_RELEASE == Get32(record))
+            {
+                status = ReleaseHosts(dhcp, first, end);
+            }
+            else
+            {
+                status = DHCP_STATUS_FAIL;
+            }
+        }
+    } while (DHCP_STATUS_SUCCESS == status &&
+             JOURNAL_RECORDS * RECORD_SIZE == got);
+    free(buffer);
 
-    return host;
+    return (status);
 }
 
-static int IsFull(trie_node_t *root)
+/******************************************************************************/
+
+/****************************Utilities Functions*******************************/
+
+/******************************************************************************/
+
+static int PoolCreate(dhcp_t *dhcp)
 {
-    return (NULL != root->children[LEFT] && FULL == root->children[LEFT]->is_full &&
-            NULL != root->children[RIGHT] && FULL == root->children[RIGHT]->is_full);
+    dhcp->nodes = (trie_node_t *)malloc(INITIAL_POOL_SIZE * sizeof(trie_node_t));
+    if (NULL == dhcp->nodes)
+    {
+        return (DHCP_STATUS_FAIL);
+    }
+
+    dhcp->pool_size = INITIAL_POOL_SIZE;
+    dhcp->pool_used = ROOT + 1;
+    dhcp->free_nodes = NIL;
+    memset(dhcp->nodes, 0, (ROOT + 1) * sizeof(trie_node_t));
+
+    return (DHCP_STATUS_SUCCESS);
 }
 
-static unsigned int ExtractBitsFromArray(const unsigned char requested[BYTES_IN_IP])
+/* makes room for count more nodes without counting the free list, so
+   NodeAlloc never fails after it */
+static int PoolReserve(dhcp_t *dhcp, size_t count)
 {
-    unsigned int result = 0;
-    size_t i = 0;
-    for (i = 0; i < 4; i++)
+    trie_node_t *nodes = NULL;
+    size_t new_size = dhcp->pool_size;
+
+    if (dhcp->pool_used + count <= dhcp->pool_size)
     {
-        result |= (unsigned int)(requested[i]) << ((BYTES_IN_IP - 1 - i) * 8);
+        return (DHCP_STATUS_SUCCESS);
+    }
+
+    while (new_size < dhcp->pool_used + count)
+    {
+        new_size *= 2;
+    }
+
+    nodes = (trie_node_t *)realloc(dhcp->nodes, new_size * sizeof(trie_node_t));
+    if (NULL == nodes)
+    {
+        return (DHCP_STATUS_FAIL);
+    }
+
+    dhcp->nodes = nodes;
+    dhcp->pool_size = new_size;
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+static node_idx_t NodeAlloc(dhcp_t *dhcp)
+{
+    node_idx_t node = dhcp->free_nodes;
+
+    if (NIL != node)
+    {
+        dhcp->free_nodes = dhcp->nodes[node].children[LEFT];
+    }
+    else
+    {
+        assert(dhcp->pool_used < dhcp->pool_size);
+        node = (node_idx_t)dhcp->pool_used++;
+    }
+
+    dhcp->nodes[node].children[LEFT] = NIL;
+    dhcp->nodes[node].children[RIGHT] = NIL;
+    dhcp->nodes[node].taken = 0;
+
+    return (node);
+}
+
+static void NodeRelease(dhcp_t *dhcp, node_idx_t node)
+{
+    dhcp->nodes[node].children[LEFT] = dhcp->free_nodes;
+    dhcp->free_nodes = node;
+}
+
+/* walks down the path of from. Every time the path goes left and the
+   right sibling has room, that sibling is the best fallback so far - the
+   deepest one holds the smallest free host above from. run_end is where
+   the empty subtree the host was found in ends */
+static int TrieFindFree(const dhcp_t *dhcp, unsigned int from,
+                        unsigned int *host, size_t *run_end)
+{
+    const trie_node_t *nodes = dhcp->nodes;
+    unsigned int height = SIZE_HOST(dhcp);
+    unsigned int prefix = 0;
+    unsigned int fallback_prefix = 0;
+    unsigned int fallback_height = 0;
+    node_idx_t fallback = NIL;
+    int has_fallback = 0;
+    node_idx_t node = ROOT;
+    node_idx_t child = NIL;
+    unsigned int bit = 0;
+
+    if (SUBTREE_SIZE(height) == nodes[ROOT].taken)
+    {
+        return (0);
+    }
+
+    while (0 < height)
+    {
+        --height;
+        bit = (from >> height) & 1;
+        if (LEFT == bit &&
+            SUBTREE_SIZE(height) > nodes[nodes[node].children[RIGHT]].taken)
+        {
+            fallback = nodes[node].children[RIGHT];
+            fallback_prefix = (prefix << 1) | RIGHT;
+            fallback_height = height;
+            has_fallback = 1;
+        }
+
+        child = nodes[node].children[bit];
+        prefix = (prefix << 1) | bit;
+        if (NIL == child)
+        {
+            *host = from;
+            *run_end = ((size_t)prefix + 1) << height;
+            return (1);
+        }
+        if (SUBTREE_SIZE(height) == nodes[child].taken)
+        {
+            break;
+        }
+        node = child;
+    }
+
+    if (!has_fallback)
+    {
+        return (0);
+    }
+
+    *host = TrieLeftmostFree(dhcp, fallback, fallback_prefix, fallback_height,
+                             run_end);
+
+    return (1);
+}
+
+/* the smallest free host under a subtree that is not full */
+static unsigned int TrieLeftmostFree(const dhcp_t *dhcp, node_idx_t node,
+                                     unsigned int prefix, unsigned int height,
+                                     size_t *run_end)
+{
+    const trie_node_t *nodes = dhcp->nodes;
+    node_idx_t left = NIL;
+
+    while (NIL != node && 0 < height)
+    {
+        --height;
+        left = nodes[node].children[LEFT];
+        prefix <<= 1;
+        if (SUBTREE_SIZE(height) > nodes[left].taken)
+        {
+            node = left;
+        }
+        else
+        {
+            prefix |= RIGHT;
+            node = nodes[node].children[RIGHT];
+        }
+    }
+
+    *run_end = ((size_t)prefix + 1) << height;
+
+    return ((unsigned int)((size_t)prefix << height));
+}
+
+/* takes every host of the aligned block of 2^block_height hosts that
+   starts at first. The block node drops its children and keeps only
+   taken == its size, so a block is O(log n) however big it is.
+   The caller reserved a node per level, so this cannot fail */
+static void TrieFillBlock(dhcp_t *dhcp, unsigned int first,
+                          unsigned int block_height)
+{
+    node_idx_t path[SIZE_IP + 1];
+    unsigned int height = SIZE_HOST(dhcp);
+    unsigned int depth = 0;
+    unsigned int added = 0;
+    node_idx_t node = ROOT;
+    node_idx_t child = NIL;
+    unsigned int bit = 0;
+
+    path[0] = ROOT;
+    while (height > block_height)
+    {
+        /* inside a full subtree everything is taken already */
+        if (SUBTREE_SIZE(height) == dhcp->nodes[node].taken)
+        {
+            return;
+        }
+
+        --height;
+        bit = (first >> height) & 1;
+        child = dhcp->nodes[node].children[bit];
+        if (NIL == child)
+        {
+            child = NodeAlloc(dhcp);
+            dhcp->nodes[node].children[bit] = child;
+        }
+        node = child;
+        path[++depth] = node;
+    }
+
+    added = (unsigned int)SUBTREE_SIZE(height) - dhcp->nodes[node].taken;
+    TrieFreeSubtree(dhcp, dhcp->nodes[node].children[LEFT]);
+    TrieFreeSubtree(dhcp, dhcp->nodes[node].children[RIGHT]);
+    dhcp->nodes[node].children[LEFT] = NIL;
+    dhcp->nodes[node].children[RIGHT] = NIL;
+
+    while (0 < depth)
+    {
+        dhcp->nodes[path[depth]].taken += added;
+        --depth;
+    }
+    dhcp->nodes[ROOT].taken += added;
+}
+
+/* frees every host of an aligned block, a single host when block_height
+   is 0. Nothing changes when the block has no taken host, which is a
+   double free for a single host. Then drops the counts bottom up and
+   gives back the nodes left empty */
+static status_t TrieClearBlock(dhcp_t *dhcp, unsigned int first,
+                               unsigned int block_height)
+{
+    node_idx_t path[SIZE_IP + 1];
+    unsigned int height = SIZE_HOST(dhcp);
+    unsigned int depth = 0;
+    unsigned int removed = 0;
+    node_idx_t node = ROOT;
+    node_idx_t child = NIL;
+
+    path[0] = ROOT;
+    while (height > block_height)
+    {
+        if (0 == dhcp->nodes[node].taken)
+        {
+            return (DHCP_STATUS_DOUBLE_FREE_ERR);
+        }
+        if (DHCP_STATUS_SUCCESS != TrieExpand(dhcp, node, height))
+        {
+            return (DHCP_STATUS_FAIL);
+        }
+
+        --height;
+        child = dhcp->nodes[node].children[(first >> height) & 1];
+        if (NIL == child)
+        {
+            return (DHCP_STATUS_DOUBLE_FREE_ERR);
+        }
+        node = child;
+        path[++depth] = node;
+    }
+
+    removed = dhcp->nodes[node].taken;
+    if (0 == removed)
+    {
+        return (DHCP_STATUS_DOUBLE_FREE_ERR);
+    }
+    TrieFreeSubtree(dhcp, dhcp->nodes[node].children[LEFT]);
+    TrieFreeSubtree(dhcp, dhcp->nodes[node].children[RIGHT]);
+    dhcp->nodes[node].children[LEFT] = NIL;
+    dhcp->nodes[node].children[RIGHT] = NIL;
+
+    for (height = block_height; 0 < depth; --depth, ++height)
+    {
+        node = path[depth];
+        dhcp->nodes[node].taken -= removed;
+        if (0 == dhcp->nodes[node].taken)
+        {
+            dhcp->nodes[path[depth - 1]].children[(first >> height) & 1] = NIL;
+            NodeRelease(dhcp, node);
+        }
+    }
+    dhcp->nodes[ROOT].taken -= removed;
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* a full block with no children gets two full children, so a part of
+   it can be freed. Once one node needs it every node below it on the
+   path will, so the nodes for all of them are reserved at once */
+static status_t TrieExpand(dhcp_t *dhcp, node_idx_t node, unsigned int height)
+{
+    node_idx_t child = NIL;
+    int side = LEFT;
+
+    if (0 == height || NIL != dhcp->nodes[node].children[LEFT] ||
+        SUBTREE_SIZE(height) != dhcp->nodes[node].taken)
+    {
+        return (DHCP_STATUS_SUCCESS);
+    }
+
+    if (DHCP_STATUS_SUCCESS != PoolReserve(dhcp, 2 * height))
+    {
+        return (DHCP_STATUS_FAIL);
+    }
+
+    for (side = LEFT; side < NUM_OF_CHILDREN; ++side)
+    {
+        child = NodeAlloc(dhcp);
+        dhcp->nodes[child].taken = (unsigned int)SUBTREE_SIZE(height - 1);
+        dhcp->nodes[node].children[side] = child;
+    }
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* gives back every node of a subtree without a stack: a node with a
+   left child is rotated right until it has none, then it is released
+   and the walk goes on to its right */
+static void TrieFreeSubtree(dhcp_t *dhcp, node_idx_t node)
+{
+    trie_node_t *nodes = dhcp->nodes;
+    node_idx_t left = NIL;
+    node_idx_t next = NIL;
+
+    while (NIL != node)
+    {
+        left = nodes[node].children[LEFT];
+        if (NIL == left)
+        {
+            next = nodes[node].children[RIGHT];
+            NodeRelease(dhcp, node);
+            node = next;
+        }
+        else
+        {
+            nodes[node].children[LEFT] = nodes[left].children[RIGHT];
+            nodes[left].children[RIGHT] = node;
+            node = left;
+        }
+    }
+}
+
+/* [first, end) as the fewest aligned blocks. Needs 2 * height blocks at
+   most, each with a node per level */
+static void TrieFillRange(dhcp_t *dhcp, size_t first, size_t end)
+{
+    unsigned int block_height = 0;
+
+    while (first < end)
+    {
+        block_height = BlockHeight(first, end, SIZE_HOST(dhcp));
+        TrieFillBlock(dhcp, (unsigned int)first, block_height);
+        first += SUBTREE_SIZE(block_height);
+    }
+}
+
+static status_t TrieClearRange(dhcp_t *dhcp, size_t first, size_t end)
+{
+    unsigned int block_height = 0;
+
+    while (first < end)
+    {
+        block_height = BlockHeight(first, end, SIZE_HOST(dhcp));
+        if (DHCP_STATUS_FAIL == TrieClearBlock(dhcp, (unsigned int)first,
+                                               block_height))
+        {
+            return (DHCP_STATUS_FAIL);
+        }
+        first += SUBTREE_SIZE(block_height);
+    }
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* the biggest aligned block that starts at first and ends by end */
+static unsigned int BlockHeight(size_t first, size_t end, unsigned int max_height)
+{
+    unsigned int height = 0;
+
+    while (height < max_height &&
+           0 == (first & (SUBTREE_SIZE(height + 1) - 1)) &&
+           first + SUBTREE_SIZE(height + 1) <= end)
+    {
+        ++height;
+    }
+
+    return (height);
+}
+
+/* walks down by the free counts of the left subtrees. Once a child is
+   missing the rest of the subtree is free, and n is the offset in it */
+static unsigned int TrieNthFree(const dhcp_t *dhcp, size_t n)
+{
+    const trie_node_t *nodes = dhcp->nodes;
+    unsigned int height = SIZE_HOST(dhcp);
+    unsigned int host = 0;
+    size_t left_free = 0;
+    node_idx_t node = ROOT;
+
+    while (0 < height && NIL != node)
+    {
+        --height;
+        left_free = SUBTREE_SIZE(height) - nodes[nodes[node].children[LEFT]].taken;
+        host <<= 1;
+        if (n < left_free)
+        {
+            node = nodes[node].children[LEFT];
+        }
+        else
+        {
+            n -= left_free;
+            host |= RIGHT;
+            node = nodes[node].children[RIGHT];
+        }
+    }
+
+    return ((unsigned int)(((size_t)host << height) | n));
+}
+
+/* the number of free hosts smaller than host */
+static size_t TrieFreeBelow(const dhcp_t *dhcp, unsigned int host)
+{
+    const trie_node_t *nodes = dhcp->nodes;
+    unsigned int height = SIZE_HOST(dhcp);
+    size_t free_hosts = 0;
+    node_idx_t node = ROOT;
+
+    while (0 < height && NIL != node &&
+           SUBTREE_SIZE(height) != nodes[node].taken)
+    {
+        --height;
+        if ((host >> height) & 1)
+        {
+            free_hosts += SUBTREE_SIZE(height) -
+                          nodes[nodes[node].children[LEFT]].taken;
+            node = nodes[node].children[RIGHT];
+        }
+        else
+        {
+            node = nodes[node].children[LEFT];
+        }
+    }
+
+    /* a missing subtree is free below host too, a full one is not */
+    if (NIL == node)
+    {
+        free_hosts += host & (SUBTREE_SIZE(height) - 1);
+    }
+
+    return (free_hosts);
+}
+
+static int TrieIsTaken(const dhcp_t *dhcp, unsigned int host)
+{
+    unsigned int height = SIZE_HOST(dhcp);
+    node_idx_t node = ROOT;
+
+    while (0 < height && NIL != node &&
+           SUBTREE_SIZE(height) != dhcp->nodes[node].taken)
+    {
+        --height;
+        node = dhcp->nodes[node].children[(host >> height) & 1];
+    }
+
+    return (NIL != node && 0 != dhcp->nodes[node].taken);
+}
+
+static int FindFree(const dhcp_t *dhcp, unsigned int from, unsigned int *host,
+                    size_t *run_end)
+{
+    size_t found = 0;
+
+    if (DHCP_BACKEND_TRIE == dhcp->backend)
+    {
+        return (TrieFindFree(dhcp, from, host, run_end));
+    }
+
+    found = HBitmapFindClear(dhcp->bitmap, from);
+    if (found == HBitmapSize(dhcp->bitmap))
+    {
+        return (0);
+    }
+    *host = (unsigned int)found;
+    *run_end = found + 1;
+
+    return (1);
+}
+
+/* nodes for the fill are reserved first, so the range is either taken
+   whole or not at all */
+static status_t TakeHosts(dhcp_t *dhcp, size_t first, size_t end)
+{
+    size_t height = SIZE_HOST(dhcp);
+
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
+    {
+        HBitmapSetRange(dhcp->bitmap, first, end);
+    }
+    else if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        CBitmapSetRange(dhcp->shared, first, end);
+    }
+    else if (DHCP_STATUS_SUCCESS != PoolReserve(dhcp, 2 * height * height))
+    {
+        return (DHCP_STATUS_FAIL);
+    }
+    else
+    {
+        TrieFillRange(dhcp, first, end);
+    }
+    JournalAppend(dhcp, JOURNAL_TAKE, first, end);
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* each block may split the full blocks above it, two nodes a level */
+static status_t ReleaseHosts(dhcp_t *dhcp, size_t first, size_t end)
+{
+    size_t height = SIZE_HOST(dhcp);
+
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
+    {
+        HBitmapClearRange(dhcp->bitmap, first, end);
+    }
+    else if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        CBitmapClearRange(dhcp->shared, first, end);
+    }
+    else if (DHCP_STATUS_SUCCESS != PoolReserve(dhcp, 4 * height * height) ||
+             DHCP_STATUS_SUCCESS != TrieClearRange(dhcp, first, end))
+    {
+        return (DHCP_STATUS_FAIL);
+    }
+    JournalAppend(dhcp, JOURNAL_RELEASE, first, end);
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+static size_t CountFreeHosts(const dhcp_t *dhcp, unsigned int first,
+                             unsigned int last)
+{
+    if (first > last)
+    {
+        return (0);
+    }
+
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
+    {
+        return ((last - first + 1) -
+                HBitmapCountSetRange(dhcp->bitmap, first, (size_t)last + 1));
+    }
+    if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        return ((last - first + 1) -
+                CBitmapCountSetRange(dhcp->shared, first, (size_t)last + 1));
+    }
+
+    /* free below last + 1, minus free below first */
+    return (TrieFreeBelow(dhcp, last) + !TrieIsTaken(dhcp, last) -
+            TrieFreeBelow(dhcp, first));
+}
+
+/* gives back the first n addresses of a failed DHCPAllocateMany. Its
+   runs are unions of the blocks it filled, so clearing them splits
+   nothing and needs no memory */
+static void UndoMany(dhcp_t *dhcp, const unsigned char *ips, size_t n)
+{
+    size_t first = 0;
+    size_t end = 0;
+    size_t i = 0;
+
+    while (i < n)
+    {
+        first = ExtractBitsFromArray(ips + i * BYTES_IN_IP) & HOST_MASK(dhcp);
+        end = first + 1;
+        for (++i; i < n && end == (ExtractBitsFromArray(ips + i * BYTES_IN_IP) &
+                                   HOST_MASK(dhcp)); ++i)
+        {
+            ++end;
+        }
+
+        if (DHCP_BACKEND_BITMAP == dhcp->backend)
+        {
+            HBitmapClearRange(dhcp->bitmap, first, end);
+        }
+        else
+        {
+            TrieClearRange(dhcp, first, end);
+        }
+        JournalAppend(dhcp, JOURNAL_RELEASE, first, end);
+    }
+}
+
+static void ExtractNum(unsigned char *ip, unsigned int result_ip, size_t bits_in_subnet)
+{
+    unsigned mask = 0xFF000000;
+    size_t bits = 0;
+    int i = 0;
+
+    i = bits_in_subnet / SIZE_BYTE;
+    bits = i * SIZE_BYTE;
+    mask = mask >> (SIZE_BYTE * i);
+
+    if (bits < bits_in_subnet) {
+    ip[i] = (ip[i] >> (SIZE_BYTE - (bits_in_subnet % SIZE_BYTE))) << 
+                      (SIZE_BYTE - (bits_in_subnet % SIZE_BYTE));
+    ip[i] |= ((result_ip & mask) >> ((BYTES_IN_IP - i - 1) * SIZE_BYTE));
+    mask >>= SIZE_BYTE;
+    ++i;
+}
+    while (i < BYTES_IN_IP)
+    {
+        ip[i] = (result_ip & mask) >> ((BYTES_IN_IP - i - 1) * SIZE_BYTE);
+        mask = mask >> SIZE_BYTE;
+        i++;
+    }
+}
+
+static unsigned int CharToInt(const unsigned char *requested_ip, size_t bits_in_subnet)
+{
+    unsigned int host = 0;
+    size_t bits = 0;
+    int i = 0;
+
+    i = bits_in_subnet / SIZE_BYTE;
+    bits = i * SIZE_BYTE;
+
+    if (bits < bits_in_subnet)
+    {
+        host = requested_ip[i] << (bits_in_subnet % SIZE_BYTE);
+        host = host >> (bits_in_subnet % SIZE_BYTE);
+        i++;
+    }
+
+    while (i < BYTES_IN_IP)
+    {
+        host = host << SIZE_BYTE;
+        host = host | requested_ip[i];
+        i++;
+    }
+
+    return host;
+}
+
+static unsigned int ExtractBitsFromArray(const unsigned char requested[BYTES_IN_IP])
+{
+    unsigned int result = 0;
+    size_t i = 0;
+    for (i = 0; i < 4; i++)
+    {
+        result |= (unsigned int)(requested[i]) << ((BYTES_IN_IP - 1 - i) * 8);
     }
     return result;
 }
+
+static status_t BitmapFree(dhcp_t *dhcp, unsigned int host)
+{
+    if (!HBitmapClear(dhcp->bitmap, host))
+    {
+        return (DHCP_STATUS_DOUBLE_FREE_ERR);
+    }
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* the requested host if it is free, else the next free one, wrapping
+   around. Without a request the search starts at the thread's hint in
+   this pool. A slot's first search in a pool starts at the pool's next
+   spot, so the threads using a pool are spread over it whatever other
+   pools they used before */
+static status_t SharedAllocate(dhcp_t *dhcp, unsigned char result_ip[BYTES_IN_IP],
+                               const unsigned char requested_ip[BYTES_IN_IP])
+{
+    size_t size = CBitmapSize(dhcp->shared);
+    size_t host = 0;
+    size_t spot = 0;
+    hint_t *hint = NULL;
+
+    if (NULL != requested_ip)
+    {
+        host = CharToInt(requested_ip, dhcp->bits_in_subnet) & HOST_MASK(dhcp);
+        if (!CBitmapClaimBit(dhcp->shared, host))
+        {
+            host = CBitmapClaim(dhcp->shared, host);
+        }
+    }
+    else
+    {
+        if (!thread_has_slot)
+        {
+            thread_slot = atomic_fetch_add(&next_thread_slot, 1) % HINT_SLOTS;
+            thread_has_slot = 1;
+        }
+        hint = dhcp->hints + thread_slot;
+
+        /* spots follow the golden ratio, so any number of threads stay
+           about evenly apart */
+        spot = atomic_load_explicit(&hint->spot, memory_order_relaxed);
+        if (0 == spot)
+        {
+            spot = atomic_fetch_add(&dhcp->next_spot, 1) *
+                   0x9E3779B9UL % 0x100000000UL;
+            spot = (size_t)(((unsigned long)spot * size) >> 32) + 1;
+        }
+        host = CBitmapClaim(dhcp->shared, (spot - 1) % size);
+        if (host != size)
+        {
+            atomic_store_explicit(&hint->spot, (host + 1) % size + 1,
+                                  memory_order_relaxed);
+        }
+    }
+
+    memcpy(result_ip, dhcp->subnet_addr, BYTES_IN_IP);
+    if (host == size)
+    {
+        ExtractNum(result_ip, 0, dhcp->bits_in_subnet);
+        return (DHCP_STATUS_FULL_ERR);
+    }
+    ExtractNum(result_ip, (unsigned int)host, dhcp->bits_in_subnet);
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* the first run of taken hosts at or after from */
+static int NextTakenRun(const dhcp_t *dhcp, size_t from, size_t *first,
+                        size_t *end)
+{
+    size_t size = HostsInPool(dhcp);
+    unsigned int host = 0;
+    size_t run_end = 0;
+
+    if (DHCP_BACKEND_BITMAP == dhcp->backend)
+    {
+        *first = HBitmapFindSet(dhcp->bitmap, from, size);
+        *end = HBitmapFindClear(dhcp->bitmap, *first);
+    }
+    else if (DHCP_BACKEND_CONCURRENT == dhcp->backend)
+    {
+        *first = CBitmapFindNext(dhcp->shared, from, 1);
+        *end = CBitmapFindNext(dhcp->shared, *first, 0);
+    }
+    else
+    {
+        /* free runs end at taken hosts or at aligned block boundaries */
+        *first = from;
+        while (*first < size &&
+               TrieFindFree(dhcp, (unsigned int)*first, &host, &run_end) &&
+               host == *first)
+        {
+            *first = run_end;
+        }
+        *end = size;
+        if (*first < size &&
+            TrieFindFree(dhcp, (unsigned int)*first, &host, &run_end))
+        {
+            *end = host;
+        }
+    }
+
+    return (*first < size);
+}
+
+static size_t HostsInPool(const dhcp_t *dhcp)
+{
+    return (SUBTREE_SIZE(SIZE_HOST(dhcp)));
+}
+
+/* runs that follow each other merge into the last record */
+static void JournalAppend(dhcp_t *dhcp, journal_op_t op, size_t first,
+                          size_t end)
+{
+    unsigned char *last = NULL;
+
+    if (-1 == dhcp->journal_fd)
+    {
+        return;
+    }
+
+    if (0 < dhcp->journal_used)
+    {
+        last = dhcp->journal + dhcp->journal_used - RECORD_SIZE;
+        if (op == Get32(last) && first == Get32(last + 2 * WORD_SIZE) + 1)
+        {
+            Put32(last + 2 * WORD_SIZE, end - 1);
+            return;
+        }
+    }
+
+    if (JOURNAL_RECORDS * RECORD_SIZE == dhcp->journal_used)
+    {
+        DHCPJournalFlush(dhcp);
+    }
+    Put32(dhcp->journal + dhcp->journal_used, op);
+    Put32(dhcp->journal + dhcp->journal_used + WORD_SIZE, first);
+    Put32(dhcp->journal + dhcp->journal_used + 2 * WORD_SIZE, end - 1);
+    dhcp->journal_used += RECORD_SIZE;
+}
+
+/* the bitmap is built one chunk at a time from the taken runs */
+static status_t WriteRaw(const dhcp_t *dhcp, int fd, unsigned char *buffer)
+{
+    size_t chunk_hosts = IO_CHUNK * SIZE_BYTE;
+    size_t size = HostsInPool(dhcp);
+    size_t chunk_first = 0;
+    size_t chunk_end = 0;
+    size_t first = 0;
+    size_t end = 0;
+    int has_run = NextTakenRun(dhcp, 0, &first, &end);
+
+    for (chunk_first = 0; chunk_first < size; chunk_first = chunk_end)
+    {
+        chunk_end = (size - chunk_first < chunk_hosts) ? size :
+                                                         chunk_first + chunk_hosts;
+        memset(buffer, 0, IO_CHUNK);
+        while (has_run && first < chunk_end)
+        {
+            SetBits(buffer, first - chunk_first,
+                    ((end < chunk_end) ? end : chunk_end) - chunk_first);
+            if (end > chunk_end)
+            {
+                first = chunk_end;
+                break;
+            }
+            has_run = NextTakenRun(dhcp, end, &first, &end);
+        }
+
+        if (DHCP_STATUS_SUCCESS !=
+            WriteAll(fd, buffer,
+                     (chunk_end - chunk_first + SIZE_BYTE - 1) / SIZE_BYTE))
+        {
+            return (DHCP_STATUS_FAIL);
+        }
+    }
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+static status_t WriteRuns(const dhcp_t *dhcp, int fd, unsigned char *buffer)
+{
+    size_t used = 0;
+    size_t first = 0;
+    size_t end = 0;
+
+    while (NextTakenRun(dhcp, end, &first, &end))
+    {
+        if (IO_CHUNK == used)
+        {
+            if (DHCP_STATUS_SUCCESS != WriteAll(fd, buffer, used))
+            {
+                return (DHCP_STATUS_FAIL);
+            }
+            used = 0;
+        }
+        Put32(buffer + used, first);
+        Put32(buffer + used + WORD_SIZE, end - first);
+        used += RUN_SIZE;
+    }
+
+    return (WriteAll(fd, buffer, used));
+}
+
+/* bitmap backends take the bytes a word at a time. For the trie a run
+   goes on over whole bytes of ones, and is taken when a clear bit or the
+   end of the bitmap closes it */
+static status_t LoadRaw(dhcp_t *dhcp, int fd, size_t num_bytes,
+                        unsigned char *buffer)
+{
+    size_t size = HostsInPool(dhcp);
+    size_t chunk = (IO_CHUNK - HEADER_SIZE) / sizeof(unsigned long) *
+                   sizeof(unsigned long);
+    size_t host = 0;
+    size_t run_first = 0;
+    int in_run = 0;
+    size_t got = 0;
+    size_t i = 0;
+    int bit = 0;
+
+    if (num_bytes != (size + SIZE_BYTE - 1) / SIZE_BYTE)
+    {
+        return (DHCP_STATUS_FAIL);
+    }
+
+    while (0 < num_bytes)
+    {
+        got = ReadAll(fd, buffer, (num_bytes < chunk) ? num_bytes : chunk);
+        if (0 == got)
+        {
+            return (DHCP_STATUS_FAIL);
+        }
+        num_bytes -= got;
+
+        if (DHCP_BACKEND_TRIE != dhcp->backend)
+        {
+            OrRawWords(dhcp, host / (sizeof(unsigned long) * SIZE_BYTE),
+                       buffer, got);
+            host += got * SIZE_BYTE;
+            continue;
+        }
+
+        for (i = 0; i < got; ++i, host += SIZE_BYTE)
+        {
+            if ((in_run && 0xFF == buffer[i]) || (!in_run && 0 == buffer[i]))
+            {
+                continue;
+            }
+            for (bit = 0; SIZE_BYTE > bit && size > host + bit; ++bit)
+            {
+                if (in_run == !((buffer[i] >> bit) & 1))
+                {
+                    if (in_run && DHCP_STATUS_SUCCESS !=
+                        TakeHosts(dhcp, run_first, host + bit))
+                    {
+                        return (DHCP_STATUS_FAIL);
+                    }
+                    run_first = host + bit;
+                    in_run = !in_run;
+                }
+            }
+        }
+    }
+
+    return ((in_run) ? TakeHosts(dhcp, run_first, size) : DHCP_STATUS_SUCCESS);
+}
+
+/* runs must come in increasing order and stay inside the pool */
+static status_t LoadRuns(dhcp_t *dhcp, int fd, size_t num_runs,
+                         unsigned char *buffer)
+{
+    size_t size = HostsInPool(dhcp);
+    size_t chunk_runs = (IO_CHUNK - HEADER_SIZE) / RUN_SIZE;
+    size_t prev_end = 0;
+    size_t first = 0;
+    size_t count = 0;
+    size_t batch = 0;
+    size_t i = 0;
+
+    while (0 < num_runs)
+    {
+        batch = (num_runs < chunk_runs) ? num_runs : chunk_runs;
+        if (batch * RUN_SIZE != ReadAll(fd, buffer, batch * RUN_SIZE))
+        {
+            return (DHCP_STATUS_FAIL);
+        }
+        num_runs -= batch;
+
+        for (i = 0; i < batch; ++i)
+        {
+            first = Get32(buffer + i * RUN_SIZE);
+            count = Get32(buffer + i * RUN_SIZE + WORD_SIZE);
+            if (first < prev_end || first >= size || 0 == count ||
+                size - first < count ||
+                DHCP_STATUS_SUCCESS != TakeHosts(dhcp, first, first + count))
+            {
+                return (DHCP_STATUS_FAIL);
+            }
+            prev_end = first + count;
+        }
+    }
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* num_bytes of a raw snapshot from word first_word on. bits past the
+   pool fall on padding bits, which are set already */
+static void OrRawWords(dhcp_t *dhcp, size_t first_word,
+                       const unsigned char *bytes, size_t num_bytes)
+{
+    unsigned long bits = 0;
+    size_t i = 0;
+
+    for (i = 0; i < num_bytes; ++i)
+    {
+        bits |= (unsigned long)bytes[i] << (i % sizeof(bits) * SIZE_BYTE);
+        if (sizeof(bits) - 1 == i % sizeof(bits) || num_bytes - 1 == i)
+        {
+            if (0 != bits && DHCP_BACKEND_BITMAP == dhcp->backend)
+            {
+                HBitmapOrWord(dhcp->bitmap, first_word + i / sizeof(bits),
+                              bits);
+            }
+            else if (0 != bits)
+            {
+                CBitmapOrWord(dhcp->shared, first_word + i / sizeof(bits),
+                              bits);
+            }
+            bits = 0;
+        }
+    }
+}
+
+/* bits [from, to) of a bitmap whose bit 0 is the low bit of byte 0 */
+static void SetBits(unsigned char *bytes, size_t from, size_t to)
+{
+    for (; from < to && 0 != from % SIZE_BYTE; ++from)
+    {
+        bytes[from / SIZE_BYTE] |= 1 << (from % SIZE_BYTE);
+    }
+    if (to - from >= SIZE_BYTE && from < to)
+    {
+        memset(bytes + from / SIZE_BYTE, 0xFF, (to - from) / SIZE_BYTE);
+        from += (to - from) / SIZE_BYTE * SIZE_BYTE;
+    }
+    for (; from < to; ++from)
+    {
+        bytes[from / SIZE_BYTE] |= 1 << (from % SIZE_BYTE);
+    }
+}
+
+static void Put32(unsigned char *bytes, size_t value)
+{
+    bytes[0] = (unsigned char)(value >> 24);
+    bytes[1] = (unsigned char)(value >> 16);
+    bytes[2] = (unsigned char)(value >> 8);
+    bytes[3] = (unsigned char)value;
+}
+
+static size_t Get32(const unsigned char *bytes)
+{
+    return (((size_t)bytes[0] << 24) | ((size_t)bytes[1] << 16) |
+            ((size_t)bytes[2] << 8) | (size_t)bytes[3]);
+}
+
+static status_t WriteAll(int fd, const unsigned char *bytes, size_t size)
+{
+    ssize_t written = 0;
+
+    while (0 < size)
+    {
+        written = write(fd, bytes, size);
+        if (0 > written && EINTR != errno)
+        {
+            return (DHCP_STATUS_FAIL);
+        }
+        if (0 < written)
+        {
+            bytes += written;
+            size -= (size_t)written;
+        }
+    }
+
+    return (DHCP_STATUS_SUCCESS);
+}
+
+/* less than size only at the end of the file or on an error */
+static size_t ReadAll(int fd, unsigned char *bytes, size_t size)
+{
+    ssize_t got = 0;
+    size_t total = 0;
+
+    while (total < size)
+    {
+        got = read(fd, bytes + total, size - total);
+        if (0 == got || (0 > got && EINTR != errno))
+        {
+            break;
+        }
+        if (0 < got)
+        {
+            total += (size_t)got;
+        }
+    }
+
+    return (total);
+}
@@ -0,0 +1,500 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+
+#include "dhcp6.h" /* dhcp6_t */
+
+#define WORD_BITS (32)
+#define NUM_WORDS (BITS_IN_IP6 / WORD_BITS)
+#define BYTES_IN_WORD (BYTES_IN_IP6 / NUM_WORDS)
+/* a node per prefix length at most on a path */
+#define MAX_DEPTH (BITS_IN_IP6 + 1)
+/* the best of a node that has no free block below it */
+#define NO_FREE (BITS_IN_IP6 + 1)
+
+/* an address, most significant word first */
+typedef struct key6
+{
+    unsigned int words[NUM_WORDS];
+} key6_t;
+
+typedef struct block_node block_node_t;
+
+/* a node stands for the first len bits of key. It is an allocated block,
+   or only joins two branches that differ at bit number len. best is the
+   shortest prefix length of a free block inside the node's range */
+struct block_node
+{
+    key6_t key;
+    size_t len;
+    block_node_t *children[2];
+    size_t best;
+    int is_allocated;
+};
+
+struct dhcp6
+{
+    key6_t prefix;
+    size_t prefix_len;
+    block_node_t *root;
+    size_t count;
+};
+
+static key6_t KeyFromBytes(const unsigned char bytes[BYTES_IN_IP6],
+                           size_t len);
+static void KeyToBytes(const key6_t *key, unsigned char bytes[BYTES_IN_IP6]);
+static int KeyBit(const key6_t *key, size_t pos);
+static void KeySetBit(key6_t *key, size_t pos);
+static void KeyMask(key6_t *key, size_t len);
+static size_t KeyCommon(const key6_t *key1, const key6_t *key2, size_t limit);
+static int IsInPool(const dhcp6_t *dhcp6, const key6_t *key, size_t len);
+static int IsFree(const dhcp6_t *dhcp6, const key6_t *key, size_t len);
+static status_t FindFree(const dhcp6_t *dhcp6, size_t len, key6_t *key);
+static status_t Insert(dhcp6_t *dhcp6, const key6_t *key, size_t len);
+static size_t RegionBest(const block_node_t *top, size_t region_len);
+static void UpdateBest(block_node_t *node);
+static block_node_t *NewNode(const key6_t *key, size_t len);
+
+dhcp6_t *DHCP6Create(const unsigned char prefix[BYTES_IN_IP6],
+                     size_t prefix_len)
+{
+    dhcp6_t *dhcp6 = NULL;
+
+    if (BITS_IN_IP6 < prefix_len)
+    {
+        return NULL;
+    }
+
+    dhcp6 = (dhcp6_t *)malloc(sizeof(dhcp6_t));
+    if (NULL == dhcp6)
+    {
+        return NULL;
+    }
+
+    dhcp6->prefix = KeyFromBytes(prefix, prefix_len);
+    dhcp6->prefix_len = prefix_len;
+    dhcp6->root = NULL;
+    dhcp6->count = 0;
+
+    return dhcp6;
+}
+
+/* a node with a left child is rotated right until it has none, so no
+   stack is needed */
+void DHCP6Destroy(dhcp6_t *dhcp6)
+{
+    block_node_t *node = NULL;
+    block_node_t *left = NULL;
+    block_node_t *next = NULL;
+
+    if (NULL == dhcp6)
+    {
+        return;
+    }
+
+    node = dhcp6->root;
+    while (NULL != node)
+    {
+        left = node->children[0];
+        if (NULL == left)
+        {
+            next = node->children[1];
+            free(node);
+            node = next;
+        }
+        else
+        {
+            node->children[0] = left->children[1];
+            left->children[1] = node;
+            node = left;
+        }
+    }
+
+    free(dhcp6);
+}
+
+status_t DHCP6Allocate(dhcp6_t *dhcp6, size_t block_len,
+                       unsigned char result[BYTES_IN_IP6],
+                       const unsigned char requested[BYTES_IN_IP6])
+{
+    key6_t key;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != dhcp6);
+    assert(NULL != result);
+
+    if (BITS_IN_IP6 < block_len || dhcp6->prefix_len > block_len)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    key = dhcp6->prefix;
+    if (NULL != requested)
+    {
+        key = KeyFromBytes(requested, block_len);
+    }
+    if (NULL == requested || !IsInPool(dhcp6, &key, block_len) ||
+        !IsFree(dhcp6, &key, block_len))
+    {
+        status = FindFree(dhcp6, block_len, &key);
+        if (DHCP_STATUS_SUCCESS != status)
+        {
+            return status;
+        }
+    }
+
+    status = Insert(dhcp6, &key, block_len);
+    if (DHCP_STATUS_SUCCESS == status)
+    {
+        KeyToBytes(&key, result);
+    }
+
+    return status;
+}
+
+/* the parent of a freed block only joined it to its sibling, so the
+   sibling takes the parent's place */
+status_t DHCP6Free(dhcp6_t *dhcp6, const unsigned char block[BYTES_IN_IP6],
+                   size_t block_len)
+{
+    block_node_t **links[MAX_DEPTH];
+    block_node_t **link = NULL;
+    block_node_t *node = NULL;
+    block_node_t *parent = NULL;
+    size_t depth = 0;
+    key6_t key;
+
+    assert(NULL != dhcp6);
+
+    if (BITS_IN_IP6 < block_len)
+    {
+        return DHCP_STATUS_DOUBLE_FREE_ERR;
+    }
+    key = KeyFromBytes(block, block_len);
+
+    link = &dhcp6->root;
+    while (NULL != (node = *link) && node->len < block_len &&
+           KeyCommon(&node->key, &key, node->len) == node->len)
+    {
+        links[depth++] = link;
+        link = &node->children[KeyBit(&key, node->len)];
+    }
+
+    if (NULL == node || node->len != block_len || !node->is_allocated ||
+        KeyCommon(&node->key, &key, block_len) != block_len)
+    {
+        return DHCP_STATUS_DOUBLE_FREE_ERR;
+    }
+
+    *link = NULL;
+    free(node);
+
+    if (0 < depth)
+    {
+        link = links[--depth];
+        parent = *link;
+        *link = (NULL != parent->children[0]) ? parent->children[0] :
+                                                parent->children[1];
+        free(parent);
+    }
+    while (0 < depth)
+    {
+        UpdateBest(*links[--depth]);
+    }
+    --dhcp6->count;
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+int DHCP6IsFree(const dhcp6_t *dhcp6, const unsigned char block[BYTES_IN_IP6],
+                size_t block_len)
+{
+    key6_t key;
+
+    assert(NULL != dhcp6);
+
+    if (BITS_IN_IP6 < block_len)
+    {
+        return 0;
+    }
+    key = KeyFromBytes(block, block_len);
+
+    return (IsInPool(dhcp6, &key, block_len) &&
+            IsFree(dhcp6, &key, block_len));
+}
+
+size_t DHCP6CountAllocated(const dhcp6_t *dhcp6)
+{
+    assert(NULL != dhcp6);
+
+    return dhcp6->count;
+}
+
+/******************************************************************************/
+
+/* the first len bits of the address, the rest cleared */
+static key6_t KeyFromBytes(const unsigned char bytes[BYTES_IN_IP6],
+                           size_t len)
+{
+    key6_t key;
+    size_t i = 0;
+
+    for (i = 0; NUM_WORDS > i; ++i)
+    {
+        key.words[i] = ((unsigned int)bytes[BYTES_IN_WORD * i] << 24) |
+                       ((unsigned int)bytes[BYTES_IN_WORD * i + 1] << 16) |
+                       ((unsigned int)bytes[BYTES_IN_WORD * i + 2] << 8) |
+                       (unsigned int)bytes[BYTES_IN_WORD * i + 3];
+    }
+    KeyMask(&key, len);
+
+    return key;
+}
+
+static void KeyToBytes(const key6_t *key, unsigned char bytes[BYTES_IN_IP6])
+{
+    size_t i = 0;
+
+    for (i = 0; BYTES_IN_IP6 > i; ++i)
+    {
+        bytes[i] = (unsigned char)(key->words[i / BYTES_IN_WORD] >>
+                                   (8 * (BYTES_IN_WORD - 1 - i % BYTES_IN_WORD)));
+    }
+}
+
+/* bit 0 is the most significant */
+static int KeyBit(const key6_t *key, size_t pos)
+{
+    return ((key->words[pos / WORD_BITS] >> (WORD_BITS - 1 - pos % WORD_BITS)) &
+            1);
+}
+
+static void KeySetBit(key6_t *key, size_t pos)
+{
+    key->words[pos / WORD_BITS] |= 1U << (WORD_BITS - 1 - pos % WORD_BITS);
+}
+
+static void KeyMask(key6_t *key, size_t len)
+{
+    size_t i = 0;
+
+    for (i = 0; NUM_WORDS > i; ++i)
+    {
+        if (len <= i * WORD_BITS)
+        {
+            key->words[i] = 0;
+        }
+        else if (len < (i + 1) * WORD_BITS)
+        {
+            key->words[i] &= 0xFFFFFFFFU << ((i + 1) * WORD_BITS - len);
+        }
+    }
+}
+
+/* the number of leading bits the keys share, at most limit */
+static size_t KeyCommon(const key6_t *key1, const key6_t *key2, size_t limit)
+{
+    unsigned int diff = 0;
+    size_t common = BITS_IN_IP6;
+    size_t i = 0;
+
+    for (i = 0; NUM_WORDS > i; ++i)
+    {
+        diff = key1->words[i] ^ key2->words[i];
+        if (0 != diff)
+        {
+            common = i * WORD_BITS + (size_t)__builtin_clz(diff);
+            break;
+        }
+    }
+
+    return ((common < limit) ? common : limit);
+}
+
+static int IsInPool(const dhcp6_t *dhcp6, const key6_t *key, size_t len)
+{
+    return (dhcp6->prefix_len <= len &&
+            KeyCommon(&dhcp6->prefix, key, dhcp6->prefix_len) ==
+            dhcp6->prefix_len);
+}
+
+/* walks down while a node's prefix contains the block. The block is
+   taken if such a node is allocated or is the block itself, and also if
+   the block contains the node where the walk parts from the trie */
+static int IsFree(const dhcp6_t *dhcp6, const key6_t *key, size_t len)
+{
+    const block_node_t *node = dhcp6->root;
+    size_t common = 0;
+
+    while (NULL != node)
+    {
+        common = KeyCommon(&node->key, key,
+                           (node->len < len) ? node->len : len);
+        if (common < node->len)
+        {
+            return (common < len);
+        }
+        if (node->is_allocated || node->len == len)
+        {
+            return 0;
+        }
+        node = node->children[KeyBit(key, node->len)];
+    }
+
+    return 1;
+}
+
+/* the lowest free block of len bits. The region starts as the pool and
+   halves each step toward the lower half that still holds such a block.
+   A half the trie does not reach is all free */
+static status_t FindFree(const dhcp6_t *dhcp6, size_t len, key6_t *key)
+{
+    const block_node_t *node = dhcp6->root;
+    size_t region_len = dhcp6->prefix_len;
+    int side = 0;
+
+    if (RegionBest(node, region_len) > len)
+    {
+        return DHCP_STATUS_FULL_ERR;
+    }
+
+    *key = dhcp6->prefix;
+    while (NULL != node)
+    {
+        if (node->len > region_len)
+        {
+            if (KeyBit(&node->key, region_len))
+            {
+                return DHCP_STATUS_SUCCESS;
+            }
+            if (RegionBest(node, region_len + 1) > len)
+            {
+                KeySetBit(key, region_len);
+                return DHCP_STATUS_SUCCESS;
+            }
+        }
+        else
+        {
+            side = (RegionBest(node->children[0], region_len + 1) > len);
+            if (side)
+            {
+                KeySetBit(key, region_len);
+            }
+            node = node->children[side];
+        }
+        ++region_len;
+    }
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+/* the block must be free. It either hangs where the walk falls off the
+   trie, or parts from a node there and both go under a new joining node */
+static status_t Insert(dhcp6_t *dhcp6, const key6_t *key, size_t len)
+{
+    block_node_t *path[MAX_DEPTH];
+    block_node_t **link = &dhcp6->root;
+    block_node_t *node = NULL;
+    block_node_t *joint = NULL;
+    block_node_t *added = NULL;
+    size_t depth = 0;
+    size_t common = 0;
+
+    while (NULL != (node = *link))
+    {
+        common = KeyCommon(&node->key, key,
+                           (node->len < len) ? node->len : len);
+        if (common < node->len)
+        {
+            break;
+        }
+        assert(!node->is_allocated && node->len < len);
+        path[depth++] = node;
+        link = &node->children[KeyBit(key, node->len)];
+    }
+
+    added = NewNode(key, len);
+    if (NULL == added)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+    added->is_allocated = 1;
+    added->best = NO_FREE;
+
+    if (NULL != node)
+    {
+        assert(common < len);
+        joint = NewNode(key, common);
+        if (NULL == joint)
+        {
+            free(added);
+            return DHCP_STATUS_FAIL;
+        }
+        joint->children[KeyBit(&node->key, common)] = node;
+        joint->children[KeyBit(key, common)] = added;
+        UpdateBest(joint);
+        added = joint;
+    }
+    *link = added;
+
+    while (0 < depth)
+    {
+        UpdateBest(path[--depth]);
+    }
+    ++dhcp6->count;
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+/* the best of a region of region_len bits whose trie starts at top */
+static size_t RegionBest(const block_node_t *top, size_t region_len)
+{
+    if (NULL == top)
+    {
+        return region_len;
+    }
+    if (top->len > region_len)
+    {
+        /* the half top is not in */
+        return region_len + 1;
+    }
+
+    return top->best;
+}
+
+static void UpdateBest(block_node_t *node)
+{
+    size_t left = 0;
+    size_t right = 0;
+
+    if (node->is_allocated)
+    {
+        node->best = NO_FREE;
+        return;
+    }
+
+    left = RegionBest(node->children[0], node->len + 1);
+    right = RegionBest(node->children[1], node->len + 1);
+    node->best = (left < right) ? left : right;
+}
+
+static block_node_t *NewNode(const key6_t *key, size_t len)
+{
+    block_node_t *node = (block_node_t *)calloc(1, sizeof(block_node_t));
+    if (NULL == node)
+    {
+        return NULL;
+    }
+
+    node->key = *key;
+    KeyMask(&node->key, len);
+    node->len = len;
+
+    return node;
+}
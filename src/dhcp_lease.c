@@ -0,0 +1,615 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memcpy */
+#include <assert.h> /* assert */
+
+#include "dhcp_lease.h" /* dhcp_lease_table_t */
+
+/* a power of two, one second each. Leases further away than a lap wait
+   in their slot and are passed over once a lap */
+#define WHEEL_SLOTS (4096)
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+#define INITIAL_LEASES (64)
+/* a power of two, kept at most half full */
+#define INITIAL_INDEX_SLOTS (128)
+/* leases[0] is never used, so 0 ends the lists */
+#define NIL (0)
+
+typedef struct lease lease_t;
+typedef struct index_slot index_slot_t;
+typedef struct lease_index lease_index_t;
+
+/* next links the slot list of a live lease, or the free list */
+struct lease
+{
+    time_t expiry;
+    lease_id_t prev;
+    lease_id_t next;
+    unsigned int slot;
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char owner[HWADDR_LEN];
+    unsigned char is_live;
+};
+
+/* keys are inline so a probe never leaves the slot array. Addresses are
+   keyed by their BYTES_IN_IP bytes and zeros after them */
+struct index_slot
+{
+    unsigned char key[HWADDR_LEN];
+    lease_id_t lease;
+};
+
+/* linear probing, an empty slot has lease NIL. Removal shifts the rest
+   of the cluster back, so there are no tombstones */
+struct lease_index
+{
+    index_slot_t *slots;
+    size_t capacity;
+    size_t count;
+};
+
+/* leases live in one array linked by index, so it grows with realloc.
+   cursor is the first second whose slot DHCPLeaseExpire looks at */
+struct dhcp_lease_table
+{
+    dhcp_t *dhcp;
+    lease_t *leases;
+    size_t capacity;
+    size_t used;
+    size_t count;
+    lease_id_t free_leases;
+    time_t cursor;
+    lease_expire_func_t expire_func;
+    void *param;
+    lease_index_t by_client;
+    lease_index_t by_ip;
+    lease_id_t slots[WHEEL_SLOTS];
+};
+
+static int IsLive(const dhcp_lease_table_t *table, lease_id_t lease);
+static int ReserveLease(dhcp_lease_table_t *table);
+static lease_id_t NewLease(dhcp_lease_table_t *table);
+static void DeleteLease(dhcp_lease_table_t *table, lease_id_t lease);
+static void Link(dhcp_lease_table_t *table, lease_id_t lease);
+static void Unlink(dhcp_lease_table_t *table, lease_id_t lease);
+static void Forget(dhcp_lease_table_t *table, lease_id_t lease);
+static void IPKey(const unsigned char ip[BYTES_IN_IP],
+                  unsigned char key[HWADDR_LEN]);
+
+static int IndexCreate(lease_index_t *index);
+static int IndexReserve(lease_index_t *index);
+static size_t IndexHome(const lease_index_t *index,
+                        const unsigned char key[HWADDR_LEN]);
+static lease_id_t IndexFind(const lease_index_t *index,
+                            const unsigned char key[HWADDR_LEN]);
+static void IndexInsert(lease_index_t *index,
+                        const unsigned char key[HWADDR_LEN], lease_id_t lease);
+static void IndexRemove(lease_index_t *index,
+                        const unsigned char key[HWADDR_LEN]);
+
+dhcp_lease_table_t *DHCPLeaseCreate(dhcp_t *dhcp, time_t now,
+                                    lease_expire_func_t expire_func,
+                                    void *param)
+{
+    dhcp_lease_table_t *table = NULL;
+
+    assert(NULL != dhcp);
+
+    table = (dhcp_lease_table_t *)malloc(sizeof(dhcp_lease_table_t));
+    if (NULL == table)
+    {
+        return NULL;
+    }
+
+    table->leases = (lease_t *)malloc(INITIAL_LEASES * sizeof(lease_t));
+    if (NULL == table->leases)
+    {
+        free(table);
+        return NULL;
+    }
+
+    if (!IndexCreate(&table->by_client))
+    {
+        free(table->leases);
+        free(table);
+        return NULL;
+    }
+
+    if (!IndexCreate(&table->by_ip))
+    {
+        free(table->by_client.slots);
+        free(table->leases);
+        free(table);
+        return NULL;
+    }
+
+    table->dhcp = dhcp;
+    table->capacity = INITIAL_LEASES;
+    table->used = NIL + 1;
+    table->count = 0;
+    table->free_leases = NIL;
+    table->cursor = now;
+    table->expire_func = expire_func;
+    table->param = param;
+    memset(table->slots, 0, sizeof(table->slots));
+
+    return table;
+}
+
+void DHCPLeaseDestroy(dhcp_lease_table_t *table)
+{
+    if (NULL == table)
+    {
+        return;
+    }
+
+    free(table->by_ip.slots);
+    free(table->by_client.slots);
+    free(table->leases);
+    free(table);
+}
+
+lease_id_t DHCPLeaseGrant(dhcp_lease_table_t *table,
+                          const unsigned char owner[HWADDR_LEN],
+                          const unsigned char requested_ip[BYTES_IN_IP],
+                          time_t duration, time_t now,
+                          unsigned char result_ip[BYTES_IN_IP])
+{
+    unsigned char ip_key[HWADDR_LEN];
+    lease_id_t lease = NIL;
+    lease_t *record = NULL;
+
+    assert(NULL != table);
+    assert(NULL != owner);
+
+    lease = IndexFind(&table->by_client, owner);
+    if (NIL != lease)
+    {
+        DHCPLeaseRenew(table, lease, duration, now);
+        memcpy(result_ip, table->leases[lease].ip, BYTES_IN_IP);
+
+        return lease;
+    }
+
+    /* room for the record first, so a failure leaves no address taken */
+    if (!ReserveLease(table) || !IndexReserve(&table->by_client) ||
+        !IndexReserve(&table->by_ip) ||
+        DHCP_STATUS_SUCCESS != DHCPAllocateIP(table->dhcp, result_ip,
+                                              requested_ip))
+    {
+        return LEASE_INVALID;
+    }
+
+    lease = NewLease(table);
+    record = &table->leases[lease];
+    memcpy(record->ip, result_ip, BYTES_IN_IP);
+    memcpy(record->owner, owner, HWADDR_LEN);
+    record->expiry = now + duration;
+    Link(table, lease);
+
+    IPKey(result_ip, ip_key);
+    IndexInsert(&table->by_client, owner, lease);
+    IndexInsert(&table->by_ip, ip_key, lease);
+
+    return lease;
+}
+
+status_t DHCPLeaseRenew(dhcp_lease_table_t *table, lease_id_t lease,
+                        time_t duration, time_t now)
+{
+    assert(NULL != table);
+
+    if (!IsLive(table, lease))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    Unlink(table, lease);
+    table->leases[lease].expiry = now + duration;
+    Link(table, lease);
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+status_t DHCPLeaseRelease(dhcp_lease_table_t *table, lease_id_t lease)
+{
+    assert(NULL != table);
+
+    if (!IsLive(table, lease))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    Forget(table, lease);
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+/* a slot holds every lease whose expiry falls on it in any lap, so each
+   slot is looked at once for every second that passed, and a gap of a
+   lap or more only needs the last lap. The cursor stays on now, since
+   leases can still come due in this second. The expire function must
+   not call into the table */
+size_t DHCPLeaseExpire(dhcp_lease_table_t *table, time_t now, size_t max)
+{
+    lease_t *record = NULL;
+    lease_id_t lease = NIL;
+    lease_id_t next = NIL;
+    size_t reclaimed = 0;
+
+    assert(NULL != table);
+
+    if (now < table->cursor)
+    {
+        return 0;
+    }
+    if (now - table->cursor >= WHEEL_SLOTS)
+    {
+        table->cursor = now - WHEEL_SLOTS + 1;
+    }
+
+    while (1)
+    {
+        lease = table->slots[(unsigned long)table->cursor & SLOT_MASK];
+        while (NIL != lease)
+        {
+            record = &table->leases[lease];
+            next = record->next;
+            if (record->expiry <= now)
+            {
+                if (reclaimed == max)
+                {
+                    return reclaimed;
+                }
+
+                Forget(table, lease);
+                ++reclaimed;
+                if (NULL != table->expire_func)
+                {
+                    table->expire_func(lease, record->ip, record->owner,
+                                       table->param);
+                }
+            }
+            lease = next;
+        }
+
+        if (table->cursor == now)
+        {
+            return reclaimed;
+        }
+        ++table->cursor;
+    }
+}
+
+lease_id_t DHCPLeaseFindByClient(const dhcp_lease_table_t *table,
+                                 const unsigned char owner[HWADDR_LEN])
+{
+    assert(NULL != table);
+
+    return IndexFind(&table->by_client, owner);
+}
+
+lease_id_t DHCPLeaseFindByIP(const dhcp_lease_table_t *table,
+                             const unsigned char ip[BYTES_IN_IP])
+{
+    unsigned char key[HWADDR_LEN];
+
+    assert(NULL != table);
+
+    IPKey(ip, key);
+
+    return IndexFind(&table->by_ip, key);
+}
+
+status_t DHCPLeaseGetIP(const dhcp_lease_table_t *table, lease_id_t lease,
+                        unsigned char ip[BYTES_IN_IP])
+{
+    assert(NULL != table);
+
+    if (!IsLive(table, lease))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+    memcpy(ip, table->leases[lease].ip, BYTES_IN_IP);
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+status_t DHCPLeaseGetOwner(const dhcp_lease_table_t *table, lease_id_t lease,
+                           unsigned char owner[HWADDR_LEN])
+{
+    assert(NULL != table);
+
+    if (!IsLive(table, lease))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+    memcpy(owner, table->leases[lease].owner, HWADDR_LEN);
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+time_t DHCPLeaseGetExpiry(const dhcp_lease_table_t *table, lease_id_t lease)
+{
+    assert(NULL != table);
+
+    if (!IsLive(table, lease))
+    {
+        return (time_t)-1;
+    }
+
+    return table->leases[lease].expiry;
+}
+
+size_t DHCPLeaseCount(const dhcp_lease_table_t *table)
+{
+    assert(NULL != table);
+
+    return table->count;
+}
+
+/******************************************************************************/
+
+static int IsLive(const dhcp_lease_table_t *table, lease_id_t lease)
+{
+    return (NIL != lease && lease < table->used &&
+            table->leases[lease].is_live);
+}
+
+static int ReserveLease(dhcp_lease_table_t *table)
+{
+    lease_t *leases = NULL;
+
+    if (NIL != table->free_leases || table->used < table->capacity)
+    {
+        return 1;
+    }
+
+    leases = (lease_t *)realloc(table->leases,
+                                2 * table->capacity * sizeof(lease_t));
+    if (NULL == leases)
+    {
+        return 0;
+    }
+    table->leases = leases;
+    table->capacity *= 2;
+
+    return 1;
+}
+
+/* ReserveLease made sure there is one */
+static lease_id_t NewLease(dhcp_lease_table_t *table)
+{
+    lease_id_t lease = table->free_leases;
+
+    if (NIL != lease)
+    {
+        table->free_leases = table->leases[lease].next;
+    }
+    else
+    {
+        assert(table->used < table->capacity);
+        lease = (lease_id_t)table->used++;
+    }
+    table->leases[lease].is_live = 1;
+    ++table->count;
+
+    return lease;
+}
+
+/* the record keeps its ip and owner for the expire function */
+static void DeleteLease(dhcp_lease_table_t *table, lease_id_t lease)
+{
+    table->leases[lease].is_live = 0;
+    table->leases[lease].next = table->free_leases;
+    table->free_leases = lease;
+    --table->count;
+}
+
+/* a lease that is already due goes to the next slot to be looked at */
+static void Link(dhcp_lease_table_t *table, lease_id_t lease)
+{
+    lease_t *record = &table->leases[lease];
+    time_t when = record->expiry;
+    lease_id_t *head = NULL;
+
+    if (when < table->cursor)
+    {
+        when = table->cursor;
+    }
+    record->slot = (unsigned int)((unsigned long)when & SLOT_MASK);
+
+    head = &table->slots[record->slot];
+    record->prev = NIL;
+    record->next = *head;
+    if (NIL != *head)
+    {
+        table->leases[*head].prev = lease;
+    }
+    *head = lease;
+}
+
+static void Unlink(dhcp_lease_table_t *table, lease_id_t lease)
+{
+    lease_t *record = &table->leases[lease];
+
+    if (NIL != record->prev)
+    {
+        table->leases[record->prev].next = record->next;
+    }
+    else
+    {
+        table->slots[record->slot] = record->next;
+    }
+
+    if (NIL != record->next)
+    {
+        table->leases[record->next].prev = record->prev;
+    }
+}
+
+/* ends a live lease everywhere and gives its address back */
+static void Forget(dhcp_lease_table_t *table, lease_id_t lease)
+{
+    unsigned char ip_key[HWADDR_LEN];
+    lease_t *record = &table->leases[lease];
+
+    IPKey(record->ip, ip_key);
+    IndexRemove(&table->by_client, record->owner);
+    IndexRemove(&table->by_ip, ip_key);
+    Unlink(table, lease);
+    DHCPFreeIP(table->dhcp, record->ip);
+    DeleteLease(table, lease);
+}
+
+static void IPKey(const unsigned char ip[BYTES_IN_IP],
+                  unsigned char key[HWADDR_LEN])
+{
+    memset(key, 0, HWADDR_LEN);
+    memcpy(key, ip, BYTES_IN_IP);
+}
+
+static int IndexCreate(lease_index_t *index)
+{
+    index->slots = (index_slot_t *)calloc(INITIAL_INDEX_SLOTS,
+                                          sizeof(index_slot_t));
+    index->capacity = INITIAL_INDEX_SLOTS;
+    index->count = 0;
+
+    return (NULL != index->slots);
+}
+
+/* room for one more key at most half full, doubling and rehashing when
+   there is none */
+static int IndexReserve(lease_index_t *index)
+{
+    lease_index_t bigger;
+    size_t i = 0;
+
+    if (2 * (index->count + 1) <= index->capacity)
+    {
+        return 1;
+    }
+
+    bigger.capacity = 2 * index->capacity;
+    bigger.count = 0;
+    bigger.slots = (index_slot_t *)calloc(bigger.capacity,
+                                          sizeof(index_slot_t));
+    if (NULL == bigger.slots)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < index->capacity; ++i)
+    {
+        if (NIL != index->slots[i].lease)
+        {
+            IndexInsert(&bigger, index->slots[i].key, index->slots[i].lease);
+        }
+    }
+
+    free(index->slots);
+    *index = bigger;
+
+    return 1;
+}
+
+/* both halves of the key multiplied in, the high bits of the mix pick
+   the slot */
+static size_t IndexHome(const lease_index_t *index,
+                        const unsigned char key[HWADDR_LEN])
+{
+    unsigned long low = (unsigned long)key[0] | ((unsigned long)key[1] << 8) |
+                        ((unsigned long)key[2] << 16) |
+                        ((unsigned long)key[3] << 24);
+    unsigned long high = (unsigned long)key[4] | ((unsigned long)key[5] << 8);
+    unsigned long hash = (low * 0x9E3779B1UL) ^ (high * 0x85EBCA77UL);
+
+    hash &= 0xFFFFFFFFUL;
+    hash ^= hash >> 15;
+    hash = (hash * 0x2C1B3C6DUL) & 0xFFFFFFFFUL;
+    hash ^= hash >> 13;
+
+    return (size_t)hash & (index->capacity - 1);
+}
+
+static lease_id_t IndexFind(const lease_index_t *index,
+                            const unsigned char key[HWADDR_LEN])
+{
+    size_t mask = index->capacity - 1;
+    size_t i = IndexHome(index, key);
+
+    while (NIL != index->slots[i].lease)
+    {
+        if (0 == memcmp(index->slots[i].key, key, HWADDR_LEN))
+        {
+            return index->slots[i].lease;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return NIL;
+}
+
+/* the key is not in the index and IndexReserve made room */
+static void IndexInsert(lease_index_t *index,
+                        const unsigned char key[HWADDR_LEN], lease_id_t lease)
+{
+    size_t mask = index->capacity - 1;
+    size_t i = IndexHome(index, key);
+
+    while (NIL != index->slots[i].lease)
+    {
+        i = (i + 1) & mask;
+    }
+
+    memcpy(index->slots[i].key, key, HWADDR_LEN);
+    index->slots[i].lease = lease;
+    ++index->count;
+}
+
+/* the key is in the index. Every later key of the cluster that the hole
+   would cut off from its home slot moves into the hole */
+static void IndexRemove(lease_index_t *index,
+                        const unsigned char key[HWADDR_LEN])
+{
+    size_t mask = index->capacity - 1;
+    size_t hole = IndexHome(index, key);
+    size_t next = 0;
+    size_t home = 0;
+
+    while (0 != memcmp(index->slots[hole].key, key, HWADDR_LEN))
+    {
+        assert(NIL != index->slots[hole].lease);
+        hole = (hole + 1) & mask;
+    }
+
+    next = hole;
+    while (1)
+    {
+        next = (next + 1) & mask;
+        if (NIL == index->slots[next].lease)
+        {
+            break;
+        }
+
+        /* keys whose home is in (hole, next] stay where they are */
+        home = IndexHome(index, index->slots[next].key);
+        if (hole <= next ? (hole < home && home <= next) :
+                           (hole < home || home <= next))
+        {
+            continue;
+        }
+        index->slots[hole] = index->slots[next];
+        hole = next;
+    }
+
+    index->slots[hole].lease = NIL;
+    --index->count;
+}
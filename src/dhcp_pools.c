@@ -0,0 +1,657 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+
+#include "dhcp_pools.h" /* dhcp_pools_t */
+
+#define SIZE_IP (32)
+/* the network, server and broadcast addresses need at least a /30 */
+#define MAX_POOL_BITS (30)
+/* the server and broadcast addresses end every pool */
+#define RESERVED_AT_END (2)
+
+typedef struct prefix_node prefix_node_t;
+
+/* a node stands for the first bits of key. Its children differ from it
+   at bit number bits, and skip every bit on which all of their prefixes
+   agree. A node without a pool only joins two branches */
+struct prefix_node
+{
+    unsigned int key;
+    size_t bits;
+    prefix_node_t *children[2];
+    dhcp_t *pool;
+    dhcp_pool_stats_t stats;
+};
+
+struct dhcp_pools
+{
+    prefix_node_t *root;
+    size_t count;
+};
+
+typedef status_t (*nested_func_t)(prefix_node_t *nested, void *param);
+
+/* what the visits of the pools nested in one pool share */
+typedef struct nested_walk
+{
+    prefix_node_t *outer;
+    size_t counter;
+} nested_walk_t;
+
+static unsigned int ToKey(const unsigned char addr[BYTES_IN_IP]);
+static unsigned char *ToBytes(size_t addr, unsigned char ip[BYTES_IN_IP]);
+static unsigned int PrefixMask(size_t bits);
+static int BitAt(unsigned int key, size_t pos);
+static size_t CommonBits(unsigned int key1, unsigned int key2, size_t limit);
+static prefix_node_t *NewNode(unsigned int key, size_t bits);
+static prefix_node_t **FindExact(prefix_node_t **link, unsigned int key,
+                                 size_t bits, prefix_node_t ***parent_link,
+                                 prefix_node_t **outer);
+static prefix_node_t *FindLongest(const dhcp_pools_t *pools, unsigned int key);
+static void RemoveNode(prefix_node_t **link, prefix_node_t **parent_link);
+static void DestroyTree(prefix_node_t *node);
+static status_t ForEachNested(prefix_node_t *node, nested_func_t func,
+                              void *param);
+static int ClipToHosts(const prefix_node_t *outer, const prefix_node_t *inner,
+                       size_t *first, size_t *last);
+static status_t ChangeSpan(prefix_node_t *outer, size_t first, size_t last,
+                           int reserve);
+static status_t CountNested(prefix_node_t *nested, void *param);
+static status_t ReserveNested(prefix_node_t *nested, void *param);
+static status_t ReleaseBeforeNested(prefix_node_t *nested, void *param);
+static status_t CarveOut(prefix_node_t *outer, prefix_node_t *inner);
+static status_t GiveBack(prefix_node_t *outer, prefix_node_t *inner);
+
+dhcp_pools_t *DHCPPoolsCreate(void)
+{
+    dhcp_pools_t *pools = (dhcp_pools_t *)malloc(sizeof(dhcp_pools_t));
+    if (NULL == pools)
+    {
+        return NULL;
+    }
+
+    pools->root = NULL;
+    pools->count = 0;
+
+    return pools;
+}
+
+void DHCPPoolsDestroy(dhcp_pools_t *pools)
+{
+    if (NULL == pools)
+    {
+        return;
+    }
+
+    DestroyTree(pools->root);
+    free(pools);
+}
+
+/* walks down while the new prefix extends the node's. Where it parts
+   from a node, the node moves under the new one, or under a new joining
+   node when neither prefix contains the other. The new node is linked
+   before its pool is carved, and unlinked again if that fails */
+status_t DHCPPoolsAdd(dhcp_pools_t *pools,
+                      const unsigned char subnet_addr[BYTES_IN_IP],
+                      size_t bits_in_subnet, dhcp_backend_t backend)
+{
+    prefix_node_t **link = NULL;
+    prefix_node_t *node = NULL;
+    prefix_node_t *outer = NULL;
+    prefix_node_t *joint = NULL;
+    prefix_node_t *added = NULL;
+    prefix_node_t *target = NULL;
+    unsigned int key = 0;
+    size_t common = 0;
+    dhcp_t *pool = NULL;
+
+    assert(NULL != pools);
+
+    if (MAX_POOL_BITS < bits_in_subnet)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+    key = ToKey(subnet_addr) & PrefixMask(bits_in_subnet);
+
+    link = &pools->root;
+    while (NULL != (node = *link))
+    {
+        common = CommonBits(node->key, key,
+                            (node->bits < bits_in_subnet) ? node->bits :
+                                                            bits_in_subnet);
+        if (common < node->bits || node->bits == bits_in_subnet)
+        {
+            break;
+        }
+        if (NULL != node->pool)
+        {
+            outer = node;
+        }
+        link = &node->children[BitAt(key, node->bits)];
+    }
+
+    if (NULL != node && node->bits == bits_in_subnet && common == node->bits)
+    {
+        if (NULL != node->pool)
+        {
+            return DHCP_STATUS_FAIL;
+        }
+        target = node;
+    }
+    else
+    {
+        target = added = NewNode(key, bits_in_subnet);
+        if (NULL == added)
+        {
+            return DHCP_STATUS_FAIL;
+        }
+        if (NULL != node && common < bits_in_subnet)
+        {
+            joint = NewNode(key & PrefixMask(common), common);
+            if (NULL == joint)
+            {
+                free(added);
+                return DHCP_STATUS_FAIL;
+            }
+        }
+    }
+
+    pool = DHCPCreateWithBackend(subnet_addr, bits_in_subnet, backend);
+    if (NULL == pool)
+    {
+        free(joint);
+        free(added);
+        return DHCP_STATUS_FAIL;
+    }
+
+    if (NULL != joint)
+    {
+        joint->children[BitAt(node->key, common)] = node;
+        joint->children[BitAt(key, common)] = added;
+        *link = joint;
+    }
+    else if (NULL != added)
+    {
+        if (NULL != node)
+        {
+            added->children[BitAt(node->key, bits_in_subnet)] = node;
+        }
+        *link = added;
+    }
+    target->pool = pool;
+
+    if (DHCP_STATUS_SUCCESS != CarveOut(outer, target))
+    {
+        target->pool = NULL;
+        *link = node;
+        DHCPDestroy(pool);
+        free(joint);
+        free(added);
+
+        return DHCP_STATUS_FAIL;
+    }
+    ++pools->count;
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+status_t DHCPPoolsRemove(dhcp_pools_t *pools,
+                         const unsigned char subnet_addr[BYTES_IN_IP],
+                         size_t bits_in_subnet)
+{
+    prefix_node_t **parent_link = NULL;
+    prefix_node_t **link = NULL;
+    prefix_node_t *outer = NULL;
+
+    assert(NULL != pools);
+
+    if (MAX_POOL_BITS < bits_in_subnet)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    link = FindExact(&pools->root,
+                     ToKey(subnet_addr) & PrefixMask(bits_in_subnet),
+                     bits_in_subnet, &parent_link, &outer);
+    if (NULL == link || DHCP_STATUS_SUCCESS != GiveBack(outer, *link))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    DHCPDestroy((*link)->pool);
+    (*link)->pool = NULL;
+    RemoveNode(link, parent_link);
+    --pools->count;
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+dhcp_t *DHCPPoolsLookup(const dhcp_pools_t *pools,
+                        const unsigned char addr[BYTES_IN_IP])
+{
+    prefix_node_t *node = NULL;
+
+    assert(NULL != pools);
+
+    node = FindLongest(pools, ToKey(addr));
+
+    return ((NULL != node) ? node->pool : NULL);
+}
+
+status_t DHCPPoolsAllocateIP(dhcp_pools_t *pools,
+                             const unsigned char relay_addr[BYTES_IN_IP],
+                             unsigned char result_ip[BYTES_IN_IP],
+                             const unsigned char requested_ip[BYTES_IN_IP])
+{
+    prefix_node_t *node = NULL;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != pools);
+
+    node = FindLongest(pools, ToKey(relay_addr));
+    if (NULL == node)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    status = DHCPAllocateIP(node->pool, result_ip, requested_ip);
+    if (DHCP_STATUS_SUCCESS == status)
+    {
+        ++node->stats.allocations;
+    }
+    else
+    {
+        ++node->stats.failures;
+    }
+
+    return status;
+}
+
+status_t DHCPPoolsFreeIP(dhcp_pools_t *pools,
+                         const unsigned char ip_addr[BYTES_IN_IP])
+{
+    prefix_node_t *node = NULL;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != pools);
+
+    node = FindLongest(pools, ToKey(ip_addr));
+    if (NULL == node)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    status = DHCPFreeIP(node->pool, ip_addr);
+    if (DHCP_STATUS_SUCCESS == status)
+    {
+        ++node->stats.frees;
+    }
+
+    return status;
+}
+
+status_t DHCPPoolsGetStats(const dhcp_pools_t *pools,
+                           const unsigned char subnet_addr[BYTES_IN_IP],
+                           size_t bits_in_subnet, dhcp_pool_stats_t *stats)
+{
+    prefix_node_t **parent_link = NULL;
+    prefix_node_t **link = NULL;
+    prefix_node_t *root = NULL;
+    prefix_node_t *outer = NULL;
+
+    assert(NULL != pools);
+    assert(NULL != stats);
+
+    if (MAX_POOL_BITS < bits_in_subnet)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    root = pools->root;
+    link = FindExact(&root, ToKey(subnet_addr) & PrefixMask(bits_in_subnet),
+                     bits_in_subnet, &parent_link, &outer);
+    if (NULL == link)
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    *stats = (*link)->stats;
+    stats->num_addresses = (size_t)1 << (SIZE_IP - bits_in_subnet);
+    stats->num_free = DHCPCountFree((*link)->pool);
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+size_t DHCPPoolsCount(const dhcp_pools_t *pools)
+{
+    assert(NULL != pools);
+
+    return pools->count;
+}
+
+/******************************************************************************/
+
+static unsigned int ToKey(const unsigned char addr[BYTES_IN_IP])
+{
+    return (((unsigned int)addr[0] << 24) | ((unsigned int)addr[1] << 16) |
+            ((unsigned int)addr[2] << 8) | (unsigned int)addr[3]);
+}
+
+static unsigned char *ToBytes(size_t addr, unsigned char ip[BYTES_IN_IP])
+{
+    size_t i = 0;
+
+    for (i = 0; BYTES_IN_IP > i; ++i)
+    {
+        ip[i] = (unsigned char)(addr >> (8 * (BYTES_IN_IP - 1 - i)));
+    }
+
+    return ip;
+}
+
+static unsigned int PrefixMask(size_t bits)
+{
+    return ((0 == bits) ? 0 : (0xFFFFFFFFU << (SIZE_IP - bits)));
+}
+
+/* bit 0 is the most significant */
+static int BitAt(unsigned int key, size_t pos)
+{
+    return ((key >> (SIZE_IP - 1 - pos)) & 1);
+}
+
+/* the number of leading bits the keys share, at most limit */
+static size_t CommonBits(unsigned int key1, unsigned int key2, size_t limit)
+{
+    unsigned int diff = key1 ^ key2;
+    size_t common = (0 == diff) ? SIZE_IP : (size_t)__builtin_clz(diff);
+
+    return ((common < limit) ? common : limit);
+}
+
+static prefix_node_t *NewNode(unsigned int key, size_t bits)
+{
+    prefix_node_t *node = (prefix_node_t *)calloc(1, sizeof(prefix_node_t));
+    if (NULL == node)
+    {
+        return NULL;
+    }
+
+    node->key = key;
+    node->bits = bits;
+
+    return node;
+}
+
+/* the link to the node holding exactly this prefix as a pool, the link
+   to its parent (NULL at the root) and the nearest pool around it */
+static prefix_node_t **FindExact(prefix_node_t **link, unsigned int key,
+                                 size_t bits, prefix_node_t ***parent_link,
+                                 prefix_node_t **outer)
+{
+    prefix_node_t *node = NULL;
+
+    *parent_link = NULL;
+    *outer = NULL;
+    while (NULL != (node = *link) && node->bits <= bits &&
+           0 == ((node->key ^ key) & PrefixMask(node->bits)))
+    {
+        if (node->bits == bits)
+        {
+            return ((NULL != node->pool) ? link : NULL);
+        }
+        if (NULL != node->pool)
+        {
+            *outer = node;
+        }
+        *parent_link = link;
+        link = &node->children[BitAt(key, node->bits)];
+    }
+
+    return NULL;
+}
+
+/* the deepest node on the path of key that has a pool. The walk stops
+   at the first node whose prefix key does not start with */
+static prefix_node_t *FindLongest(const dhcp_pools_t *pools, unsigned int key)
+{
+    prefix_node_t *node = pools->root;
+    prefix_node_t *best = NULL;
+
+    while (NULL != node && 0 == ((node->key ^ key) & PrefixMask(node->bits)))
+    {
+        if (NULL != node->pool)
+        {
+            best = node;
+        }
+        node = node->children[BitAt(key, node->bits)];
+    }
+
+    return best;
+}
+
+/* a node whose pool is gone stays only while it joins two branches.
+   Taking it out may leave its parent, a joining node, with one branch */
+static void RemoveNode(prefix_node_t **link, prefix_node_t **parent_link)
+{
+    prefix_node_t *node = *link;
+    prefix_node_t *parent = NULL;
+
+    if (NULL != node->children[0] && NULL != node->children[1])
+    {
+        return;
+    }
+
+    *link = (NULL != node->children[0]) ? node->children[0] :
+                                          node->children[1];
+    free(node);
+
+    if (NULL == parent_link)
+    {
+        return;
+    }
+
+    parent = *parent_link;
+    if (NULL == parent->pool &&
+        (NULL == parent->children[0] || NULL == parent->children[1]))
+    {
+        *parent_link = (NULL != parent->children[0]) ? parent->children[0] :
+                                                       parent->children[1];
+        free(parent);
+    }
+}
+
+/* every node of a subtree, a node with a left child is rotated right
+   until it has none, so no stack is needed */
+static void DestroyTree(prefix_node_t *node)
+{
+    prefix_node_t *left = NULL;
+    prefix_node_t *next = NULL;
+
+    while (NULL != node)
+    {
+        left = node->children[0];
+        if (NULL == left)
+        {
+            next = node->children[1];
+            DHCPDestroy(node->pool);
+            free(node);
+            node = next;
+        }
+        else
+        {
+            node->children[0] = left->children[1];
+            left->children[1] = node;
+            node = left;
+        }
+    }
+}
+
+/* calls func on the nearest pools below node, in increasing order, and
+   does not go into them. stops at the first failure */
+static status_t ForEachNested(prefix_node_t *node, nested_func_t func,
+                              void *param)
+{
+    status_t status = DHCP_STATUS_SUCCESS;
+    prefix_node_t *child = NULL;
+    int side = 0;
+
+    for (side = 0; 2 > side && DHCP_STATUS_SUCCESS == status; ++side)
+    {
+        child = node->children[side];
+        if (NULL != child)
+        {
+            status = (NULL != child->pool) ? func(child, param) :
+                                             ForEachNested(child, func, param);
+        }
+    }
+
+    return status;
+}
+
+/* the part of inner's addresses that outer may hand out, 0 if none */
+static int ClipToHosts(const prefix_node_t *outer, const prefix_node_t *inner,
+                       size_t *first, size_t *last)
+{
+    size_t outer_last = (size_t)(outer->key | ~PrefixMask(outer->bits));
+
+    *first = inner->key;
+    *last = (size_t)(inner->key | ~PrefixMask(inner->bits));
+    if (*first <= outer->key)
+    {
+        *first = (size_t)outer->key + 1;
+    }
+    if (*last > outer_last - RESERVED_AT_END)
+    {
+        *last = outer_last - RESERVED_AT_END;
+    }
+
+    return (*first <= *last);
+}
+
+static status_t ChangeSpan(prefix_node_t *outer, size_t first, size_t last,
+                           int reserve)
+{
+    unsigned char first_ip[BYTES_IN_IP];
+    unsigned char last_ip[BYTES_IN_IP];
+
+    ToBytes(first, first_ip);
+    ToBytes(last, last_ip);
+
+    return (reserve ? DHCPReserveRange(outer->pool, first_ip, last_ip) :
+                      DHCPReleaseRange(outer->pool, first_ip, last_ip));
+}
+
+static status_t CountNested(prefix_node_t *nested, void *param)
+{
+    nested_walk_t *walk = (nested_walk_t *)param;
+    size_t first = 0;
+    size_t last = 0;
+
+    if (ClipToHosts(walk->outer, nested, &first, &last))
+    {
+        walk->counter += last - first + 1;
+    }
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+static status_t ReserveNested(prefix_node_t *nested, void *param)
+{
+    nested_walk_t *walk = (nested_walk_t *)param;
+    size_t first = 0;
+    size_t last = 0;
+
+    if (!ClipToHosts(walk->outer, nested, &first, &last))
+    {
+        return DHCP_STATUS_SUCCESS;
+    }
+
+    return ChangeSpan(walk->outer, first, last, 1);
+}
+
+/* frees what lies between the previous nested pool and this one */
+static status_t ReleaseBeforeNested(prefix_node_t *nested, void *param)
+{
+    nested_walk_t *walk = (nested_walk_t *)param;
+    size_t first = walk->counter;
+    size_t last = nested->key;
+
+    walk->counter = (size_t)(nested->key | ~PrefixMask(nested->bits)) + 1;
+    if (first >= last)
+    {
+        return DHCP_STATUS_SUCCESS;
+    }
+
+    return ChangeSpan(walk->outer, first, last - 1, 0);
+}
+
+/* inner's own nested pools are taken out of it, and inner is taken out
+   of outer. Fails when outer already handed out some of inner's
+   addresses, those would then belong to two pools */
+static status_t CarveOut(prefix_node_t *outer, prefix_node_t *inner)
+{
+    unsigned char first_ip[BYTES_IN_IP];
+    unsigned char last_ip[BYTES_IN_IP];
+    nested_walk_t walk;
+    size_t first = 0;
+    size_t last = 0;
+
+    walk.outer = inner;
+    walk.counter = 0;
+    if (DHCP_STATUS_SUCCESS != ForEachNested(inner, ReserveNested, &walk))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    if (NULL == outer || !ClipToHosts(outer, inner, &first, &last))
+    {
+        return DHCP_STATUS_SUCCESS;
+    }
+
+    walk.outer = outer;
+    ForEachNested(inner, CountNested, &walk);
+    if (last - first + 1 - walk.counter !=
+        DHCPCountFreeInRange(outer->pool, ToBytes(first, first_ip),
+                             ToBytes(last, last_ip)))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+
+    return ChangeSpan(outer, first, last, 1);
+}
+
+/* inner's addresses go back to outer, but for its nested pools that now
+   are outer's */
+static status_t GiveBack(prefix_node_t *outer, prefix_node_t *inner)
+{
+    nested_walk_t walk;
+    size_t first = 0;
+    size_t last = 0;
+
+    if (NULL == outer || !ClipToHosts(outer, inner, &first, &last))
+    {
+        return DHCP_STATUS_SUCCESS;
+    }
+
+    walk.outer = outer;
+    walk.counter = first;
+    if (DHCP_STATUS_SUCCESS !=
+        ForEachNested(inner, ReleaseBeforeNested, &walk))
+    {
+        return DHCP_STATUS_FAIL;
+    }
+    if (walk.counter > last)
+    {
+        return DHCP_STATUS_SUCCESS;
+    }
+
+    return ChangeSpan(outer, walk.counter, last, 0);
+}
@@ -0,0 +1,660 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#define _GNU_SOURCE /* recvmmsg, sendmmsg */
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memcpy, memset */
+#include <assert.h> /* assert */
+#include <errno.h> /* errno */
+#include <unistd.h> /* close */
+#include <stdatomic.h> /* atomic_int */
+#include <sys/socket.h> /* recvmmsg, sendmmsg */
+#include <sys/time.h> /* struct timeval */
+#include <netinet/in.h> /* struct sockaddr_in */
+
+#include "dhcp_server.h" /* dhcp_server_t */
+#include "dhcp_lease.h" /* dhcp_lease_table_t */
+
+#define BATCH (64)
+#define PACKET_SIZE (1500)
+/* every DHCP client takes a message this long */
+#define REPLY_SIZE (576)
+/* the BOOTP minimum, shorter replies are padded */
+#define MIN_REPLY (300)
+#define RECEIVE_TIMEOUT_US (100000)
+/* room for a few batches of bursts queued behind the one in hand */
+#define RECEIVE_BUFFER (1 << 20)
+#define EXPIRE_PER_BATCH (256)
+#define SERVER_PORT (67)
+#define CLIENT_PORT (68)
+
+/* the fixed part of a BOOTP message */
+#define OFF_OP (0)
+#define OFF_HTYPE (1)
+#define OFF_HLEN (2)
+#define OFF_XID (4)
+#define OFF_FLAGS (10)
+#define OFF_CIADDR (12)
+#define OFF_YIADDR (16)
+#define OFF_GIADDR (24)
+#define OFF_CHADDR (28)
+#define OFF_COOKIE (236)
+#define OFF_OPTIONS (240)
+#define CHADDR_LEN (16)
+
+#define BOOTREQUEST (1)
+#define BOOTREPLY (2)
+#define HTYPE_ETHERNET (1)
+/* the top bit of the first flags byte */
+#define FLAG_BROADCAST (0x80)
+
+typedef enum dhcp_message
+{
+    DHCPDISCOVER = 1,
+    DHCPOFFER,
+    DHCPREQUEST,
+    DHCPDECLINE,
+    DHCPACK,
+    DHCPNAK,
+    DHCPRELEASE
+} dhcp_message_t;
+
+typedef enum dhcp_option
+{
+    OPTION_PAD = 0,
+    OPTION_SUBNET_MASK = 1,
+    OPTION_REQUESTED_IP = 50,
+    OPTION_LEASE_TIME = 51,
+    OPTION_MESSAGE_TYPE = 53,
+    OPTION_SERVER_ID = 54,
+    OPTION_END = 255
+} dhcp_option_t;
+
+/* a request as it lies in the receive buffer. The options that matter
+   point into it, NULL when missing */
+typedef struct request_view
+{
+    const unsigned char *packet;
+    int type;
+    const unsigned char *requested_ip;
+    const unsigned char *server_id;
+} request_view_t;
+
+/* the message headers point at the buffers once, at creation */
+struct dhcp_server
+{
+    dhcp_t *dhcp;
+    dhcp_lease_table_t *leases;
+    dhcp_server_config_t config;
+    int sock;
+    unsigned short port;
+    atomic_int running;
+    dhcp_server_stats_t stats;
+    struct mmsghdr in_msgs[BATCH];
+    struct mmsghdr out_msgs[BATCH];
+    struct iovec in_iovs[BATCH];
+    struct iovec out_iovs[BATCH];
+    struct sockaddr_in sources[BATCH];
+    struct sockaddr_in destinations[BATCH];
+    unsigned char in_packets[BATCH][PACKET_SIZE];
+    unsigned char out_packets[BATCH][REPLY_SIZE];
+};
+
+static const unsigned char magic_cookie[] = {99, 130, 83, 99};
+static const unsigned char no_ip[BYTES_IN_IP] = {0, 0, 0, 0};
+
+static int OpenSocket(dhcp_server_t *server);
+static void SetUpMessages(dhcp_server_t *server);
+static void SendReplies(dhcp_server_t *server, size_t num_replies);
+static int ParseRequest(const unsigned char *packet, size_t len,
+                        request_view_t *view);
+static size_t Offer(dhcp_server_t *server, const request_view_t *view,
+                    unsigned char *reply, time_t now);
+static size_t Acknowledge(dhcp_server_t *server, const request_view_t *view,
+                          unsigned char *reply, time_t now);
+static void Release(dhcp_server_t *server, const request_view_t *view);
+static size_t BuildReply(const dhcp_server_t *server,
+                         const request_view_t *view, dhcp_message_t type,
+                         const unsigned char ip[BYTES_IN_IP],
+                         unsigned char *reply);
+static unsigned char *PutOption(unsigned char *option, dhcp_option_t code,
+                                const unsigned char *value, size_t len);
+static void PutSeconds(unsigned char bytes[BYTES_IN_IP], time_t seconds);
+static void ReplyAddress(const unsigned char *request,
+                         const unsigned char *reply,
+                         const struct sockaddr_in *source,
+                         struct sockaddr_in *destination);
+
+dhcp_server_t *DHCPServerCreate(const dhcp_server_config_t *config)
+{
+    dhcp_server_t *server = NULL;
+
+    assert(NULL != config);
+
+    server = (dhcp_server_t *)calloc(1, sizeof(dhcp_server_t));
+    if (NULL == server)
+    {
+        return NULL;
+    }
+
+    server->config = *config;
+    server->sock = -1;
+    atomic_init(&server->running, 1);
+    server->dhcp = DHCPCreateWithBackend(config->subnet_addr,
+                                         config->bits_in_subnet,
+                                         config->backend);
+    if (NULL != server->dhcp)
+    {
+        server->leases = DHCPLeaseCreate(server->dhcp, time(NULL), NULL, NULL);
+    }
+    if (NULL == server->leases || !OpenSocket(server))
+    {
+        DHCPServerDestroy(server);
+        return NULL;
+    }
+    SetUpMessages(server);
+
+    return server;
+}
+
+void DHCPServerDestroy(dhcp_server_t *server)
+{
+    if (NULL == server)
+    {
+        return;
+    }
+
+    if (-1 != server->sock)
+    {
+        close(server->sock);
+    }
+    if (NULL != server->leases)
+    {
+        DHCPLeaseDestroy(server->leases);
+    }
+    DHCPDestroy(server->dhcp);
+    free(server);
+}
+
+/* a receive waits for the first packet of a batch and takes whatever
+   else came with it. It times out now and then, so leases keep expiring
+   and a stop is seen without traffic */
+status_t DHCPServerRun(dhcp_server_t *server)
+{
+    int received = 0;
+    size_t num_replies = 0;
+    size_t len = 0;
+    time_t now = 0;
+    int i = 0;
+
+    assert(NULL != server);
+
+    while (atomic_load(&server->running))
+    {
+        for (i = 0; BATCH > i; ++i)
+        {
+            server->in_msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+
+        received = recvmmsg(server->sock, server->in_msgs, BATCH,
+                            MSG_WAITFORONE, NULL);
+        if (0 > received)
+        {
+            if (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)
+            {
+                return DHCP_STATUS_FAIL;
+            }
+            received = 0;
+        }
+
+        now = time(NULL);
+        DHCPLeaseExpire(server->leases, now, EXPIRE_PER_BATCH);
+
+        num_replies = 0;
+        for (i = 0; i < received; ++i)
+        {
+            len = DHCPServerHandle(server, server->in_packets[i],
+                                   server->in_msgs[i].msg_len,
+                                   server->out_packets[num_replies],
+                                   REPLY_SIZE, now);
+            if (0 < len)
+            {
+                server->out_iovs[num_replies].iov_len = len;
+                ReplyAddress(server->in_packets[i],
+                             server->out_packets[num_replies],
+                             &server->sources[i],
+                             &server->destinations[num_replies]);
+                ++num_replies;
+            }
+        }
+        SendReplies(server, num_replies);
+    }
+
+    return DHCP_STATUS_SUCCESS;
+}
+
+void DHCPServerStop(dhcp_server_t *server)
+{
+    assert(NULL != server);
+
+    atomic_store(&server->running, 0);
+}
+
+size_t DHCPServerHandle(dhcp_server_t *server, const unsigned char *request,
+                        size_t request_len, unsigned char *reply,
+                        size_t reply_size, time_t now)
+{
+    request_view_t view;
+
+    assert(NULL != server);
+    assert(NULL != request);
+    assert(NULL != reply);
+
+    ++server->stats.received;
+    if (REPLY_SIZE > reply_size || !ParseRequest(request, request_len, &view))
+    {
+        ++server->stats.dropped;
+        return 0;
+    }
+
+    switch (view.type)
+    {
+        case DHCPDISCOVER:
+            return Offer(server, &view, reply, now);
+
+        case DHCPREQUEST:
+            return Acknowledge(server, &view, reply, now);
+
+        case DHCPRELEASE:
+            Release(server, &view);
+            return 0;
+
+        default:
+            ++server->stats.dropped;
+            return 0;
+    }
+}
+
+unsigned short DHCPServerPort(const dhcp_server_t *server)
+{
+    assert(NULL != server);
+
+    return server->port;
+}
+
+void DHCPServerGetStats(const dhcp_server_t *server,
+                        dhcp_server_stats_t *stats)
+{
+    assert(NULL != server);
+    assert(NULL != stats);
+
+    *stats = server->stats;
+}
+
+/******************************************************************************/
+
+/* broadcast replies need SO_BROADCAST. The port actually bound is read
+   back, since port 0 lets the kernel pick. A receive buffer the kernel
+   caps lower is no reason to fail */
+static int OpenSocket(dhcp_server_t *server)
+{
+    struct sockaddr_in addr;
+    struct timeval timeout;
+    socklen_t addr_len = sizeof(addr);
+    int on = 1;
+    int rcvbuf = RECEIVE_BUFFER;
+
+    server->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (-1 == server->sock)
+    {
+        return 0;
+    }
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = RECEIVE_TIMEOUT_US;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(server->config.port);
+    setsockopt(server->sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    if (0 != setsockopt(server->sock, SOL_SOCKET, SO_REUSEADDR, &on,
+                        sizeof(on)) ||
+        0 != setsockopt(server->sock, SOL_SOCKET, SO_BROADCAST, &on,
+                        sizeof(on)) ||
+        0 != setsockopt(server->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                        sizeof(timeout)) ||
+        0 != bind(server->sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+        0 != getsockname(server->sock, (struct sockaddr *)&addr, &addr_len))
+    {
+        return 0;
+    }
+    server->port = ntohs(addr.sin_port);
+
+    return 1;
+}
+
+static void SetUpMessages(dhcp_server_t *server)
+{
+    struct msghdr *hdr = NULL;
+    size_t i = 0;
+
+    for (i = 0; BATCH > i; ++i)
+    {
+        server->in_iovs[i].iov_base = server->in_packets[i];
+        server->in_iovs[i].iov_len = PACKET_SIZE;
+        hdr = &server->in_msgs[i].msg_hdr;
+        hdr->msg_name = &server->sources[i];
+        hdr->msg_namelen = sizeof(struct sockaddr_in);
+        hdr->msg_iov = &server->in_iovs[i];
+        hdr->msg_iovlen = 1;
+
+        server->out_iovs[i].iov_base = server->out_packets[i];
+        hdr = &server->out_msgs[i].msg_hdr;
+        hdr->msg_name = &server->destinations[i];
+        hdr->msg_namelen = sizeof(struct sockaddr_in);
+        hdr->msg_iov = &server->out_iovs[i];
+        hdr->msg_iovlen = 1;
+    }
+}
+
+/* a reply that cannot be sent is dropped, the client asks again */
+static void SendReplies(dhcp_server_t *server, size_t num_replies)
+{
+    size_t done = 0;
+    int sent = 0;
+
+    while (done < num_replies)
+    {
+        sent = sendmmsg(server->sock, server->out_msgs + done,
+                        (unsigned int)(num_replies - done), 0);
+        if (0 < sent)
+        {
+            done += (size_t)sent;
+        }
+        else if (0 > sent && EINTR == errno)
+        {
+            continue;
+        }
+        else
+        {
+            ++server->stats.dropped;
+            ++done;
+        }
+    }
+}
+
+/* an Ethernet BOOTREQUEST with the DHCP cookie and a message type. An
+   option that runs past the end makes the whole request invalid */
+static int ParseRequest(const unsigned char *packet, size_t len,
+                        request_view_t *view)
+{
+    size_t pos = OFF_OPTIONS;
+    size_t option_len = 0;
+
+    if (OFF_OPTIONS > len || BOOTREQUEST != packet[OFF_OP] ||
+        HTYPE_ETHERNET != packet[OFF_HTYPE] ||
+        HWADDR_LEN != packet[OFF_HLEN] ||
+        0 != memcmp(packet + OFF_COOKIE, magic_cookie, sizeof(magic_cookie)))
+    {
+        return 0;
+    }
+
+    view->packet = packet;
+    view->type = 0;
+    view->requested_ip = NULL;
+    view->server_id = NULL;
+
+    while (pos < len && OPTION_END != packet[pos])
+    {
+        if (OPTION_PAD == packet[pos])
+        {
+            ++pos;
+            continue;
+        }
+        if (pos + 1 >= len || pos + 2 + packet[pos + 1] > len)
+        {
+            return 0;
+        }
+        option_len = packet[pos + 1];
+
+        if (OPTION_MESSAGE_TYPE == packet[pos] && 1 == option_len)
+        {
+            view->type = packet[pos + 2];
+        }
+        else if (OPTION_REQUESTED_IP == packet[pos] && BYTES_IN_IP == option_len)
+        {
+            view->requested_ip = packet + pos + 2;
+        }
+        else if (OPTION_SERVER_ID == packet[pos] && BYTES_IN_IP == option_len)
+        {
+            view->server_id = packet + pos + 2;
+        }
+        pos += 2 + option_len;
+    }
+
+    return (0 != view->type);
+}
+
+/* a client that has a lease or an offer is offered the same address
+   again, held at least offer_time from now */
+static size_t Offer(dhcp_server_t *server, const request_view_t *view,
+                    unsigned char *reply, time_t now)
+{
+    const unsigned char *client = view->packet + OFF_CHADDR;
+    unsigned char ip[BYTES_IN_IP];
+    lease_id_t lease = DHCPLeaseFindByClient(server->leases, client);
+
+    if (LEASE_INVALID != lease)
+    {
+        DHCPLeaseGetIP(server->leases, lease, ip);
+        if (DHCPLeaseGetExpiry(server->leases, lease) <
+            now + server->config.offer_time)
+        {
+            DHCPLeaseRenew(server->leases, lease, server->config.offer_time,
+                           now);
+        }
+    }
+    else if (LEASE_INVALID ==
+             DHCPLeaseGrant(server->leases, client, view->requested_ip,
+                            server->config.offer_time, now, ip))
+    {
+        ++server->stats.dropped;
+        return 0;
+    }
+
+    ++server->stats.offers;
+
+    return BuildReply(server, view, DHCPOFFER, ip, reply);
+}
+
+/* a REQUEST naming another server means our offer was turned down. The
+   address asked for is the requested IP option when selecting or
+   rebooting, ciaddr when renewing, and must be the client's own.
+   A rebooting client - no server id but a requested IP - that we have
+   no record of gets no answer at all (RFC 2131 4.3.2) */
+static size_t Acknowledge(dhcp_server_t *server, const request_view_t *view,
+                          unsigned char *reply, time_t now)
+{
+    const unsigned char *client = view->packet + OFF_CHADDR;
+    const unsigned char *wanted = (NULL != view->requested_ip) ?
+                                  view->requested_ip :
+                                  view->packet + OFF_CIADDR;
+    unsigned char ip[BYTES_IN_IP];
+    lease_id_t lease = DHCPLeaseFindByClient(server->leases, client);
+
+    if (NULL != view->server_id &&
+        0 != memcmp(view->server_id, server->config.server_ip, BYTES_IN_IP))
+    {
+        if (LEASE_INVALID != lease)
+        {
+            DHCPLeaseRelease(server->leases, lease);
+        }
+        return 0;
+    }
+
+    if (LEASE_INVALID == lease && NULL == view->server_id &&
+        NULL != view->requested_ip)
+    {
+        ++server->stats.dropped;
+        return 0;
+    }
+
+    if (LEASE_INVALID == lease ||
+        DHCP_STATUS_SUCCESS != DHCPLeaseGetIP(server->leases, lease, ip) ||
+        0 != memcmp(ip, wanted, BYTES_IN_IP))
+    {
+        ++server->stats.naks;
+        return BuildReply(server, view, DHCPNAK, no_ip, reply);
+    }
+
+    DHCPLeaseRenew(server->leases, lease, server->config.lease_time, now);
+    ++server->stats.acks;
+
+    return BuildReply(server, view, DHCPACK, ip, reply);
+}
+
+static void Release(dhcp_server_t *server, const request_view_t *view)
+{
+    unsigned char ip[BYTES_IN_IP];
+    lease_id_t lease = DHCPLeaseFindByClient(server->leases,
+                                             view->packet + OFF_CHADDR);
+
+    if (LEASE_INVALID != lease &&
+        DHCP_STATUS_SUCCESS == DHCPLeaseGetIP(server->leases, lease, ip) &&
+        0 == memcmp(ip, view->packet + OFF_CIADDR, BYTES_IN_IP))
+    {
+        DHCPLeaseRelease(server->leases, lease);
+        ++server->stats.releases;
+    }
+    else
+    {
+        ++server->stats.dropped;
+    }
+}
+
+/* the client's xid, flags, giaddr and chaddr come back as they were.
+   ciaddr only comes back in an ACK, and a NAK carries no address or
+   lease options. A NAK through a relay has the broadcast bit set, so
+   the relay broadcasts it to the client (RFC 2131 4.3.2). The message
+   type is always the first option */
+static size_t BuildReply(const dhcp_server_t *server,
+                         const request_view_t *view, dhcp_message_t type,
+                         const unsigned char ip[BYTES_IN_IP],
+                         unsigned char *reply)
+{
+    const unsigned char *request = view->packet;
+    unsigned char value[BYTES_IN_IP];
+    unsigned char *option = reply + OFF_OPTIONS;
+    size_t len = 0;
+
+    memset(reply, 0, OFF_OPTIONS);
+    reply[OFF_OP] = BOOTREPLY;
+    reply[OFF_HTYPE] = request[OFF_HTYPE];
+    reply[OFF_HLEN] = request[OFF_HLEN];
+    memcpy(reply + OFF_XID, request + OFF_XID, BYTES_IN_IP);
+    memcpy(reply + OFF_FLAGS, request + OFF_FLAGS, 2);
+    if (DHCPNAK == type &&
+        0 != memcmp(request + OFF_GIADDR, no_ip, BYTES_IN_IP))
+    {
+        reply[OFF_FLAGS] |= FLAG_BROADCAST;
+    }
+    if (DHCPACK == type)
+    {
+        memcpy(reply + OFF_CIADDR, request + OFF_CIADDR, BYTES_IN_IP);
+    }
+    memcpy(reply + OFF_YIADDR, ip, BYTES_IN_IP);
+    memcpy(reply + OFF_GIADDR, request + OFF_GIADDR, BYTES_IN_IP);
+    memcpy(reply + OFF_CHADDR, request + OFF_CHADDR, CHADDR_LEN);
+    memcpy(reply + OFF_COOKIE, magic_cookie, sizeof(magic_cookie));
+
+    value[0] = (unsigned char)type;
+    option = PutOption(option, OPTION_MESSAGE_TYPE, value, 1);
+    option = PutOption(option, OPTION_SERVER_ID, server->config.server_ip,
+                       BYTES_IN_IP);
+    if (DHCPNAK != type)
+    {
+        PutSeconds(value, server->config.lease_time);
+        option = PutOption(option, OPTION_LEASE_TIME, value, BYTES_IN_IP);
+        PutSeconds(value, 0);
+        memset(value, 0xFF, server->config.bits_in_subnet / 8);
+        if (0 != server->config.bits_in_subnet % 8)
+        {
+            value[server->config.bits_in_subnet / 8] =
+                (unsigned char)(0xFF << (8 - server->config.bits_in_subnet % 8));
+        }
+        option = PutOption(option, OPTION_SUBNET_MASK, value, BYTES_IN_IP);
+    }
+    *option++ = OPTION_END;
+
+    len = (size_t)(option - reply);
+    if (MIN_REPLY > len)
+    {
+        memset(option, 0, MIN_REPLY - len);
+        len = MIN_REPLY;
+    }
+
+    return len;
+}
+
+static unsigned char *PutOption(unsigned char *option, dhcp_option_t code,
+                                const unsigned char *value, size_t len)
+{
+    option[0] = (unsigned char)code;
+    option[1] = (unsigned char)len;
+    memcpy(option + 2, value, len);
+
+    return option + 2 + len;
+}
+
+static void PutSeconds(unsigned char bytes[BYTES_IN_IP], time_t seconds)
+{
+    bytes[0] = (unsigned char)(seconds >> 24);
+    bytes[1] = (unsigned char)(seconds >> 16);
+    bytes[2] = (unsigned char)(seconds >> 8);
+    bytes[3] = (unsigned char)seconds;
+}
+
+/* a NAK not sent through a relay is always broadcast, since the client
+   may no longer have the address in ciaddr (RFC 2131 4.1) */
+static void ReplyAddress(const unsigned char *request,
+                         const unsigned char *reply,
+                         const struct sockaddr_in *source,
+                         struct sockaddr_in *destination)
+{
+    memset(destination, 0, sizeof(*destination));
+    destination->sin_family = AF_INET;
+
+    if (0 != memcmp(request + OFF_GIADDR, no_ip, BYTES_IN_IP))
+    {
+        memcpy(&destination->sin_addr.s_addr, request + OFF_GIADDR,
+               BYTES_IN_IP);
+        destination->sin_port = htons(SERVER_PORT);
+    }
+    else if (DHCPNAK == reply[OFF_OPTIONS + 2])
+    {
+        destination->sin_addr.s_addr = htonl(INADDR_BROADCAST);
+        destination->sin_port = htons(CLIENT_PORT);
+    }
+    else if (0 != memcmp(request + OFF_CIADDR, no_ip, BYTES_IN_IP))
+    {
+        memcpy(&destination->sin_addr.s_addr, request + OFF_CIADDR,
+               BYTES_IN_IP);
+        destination->sin_port = htons(CLIENT_PORT);
+    }
+    else if ((request[OFF_FLAGS] & FLAG_BROADCAST) ||
+             htonl(INADDR_ANY) == source->sin_addr.s_addr)
+    {
+        destination->sin_addr.s_addr = htonl(INADDR_BROADCAST);
+        destination->sin_port = htons(CLIENT_PORT);
+    }
+    else
+    {
+        *destination = *source;
+    }
+}
@@ -0,0 +1,88 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread dhcpd.c dhcp_server.c dhcp_lease.c dhcp.c hbitmap.c
+    cbitmap.c -I../inc -o dhcpd.out
+usage: dhcpd.out <server ip> <subnet> <bits in subnet> [port]
+port defaults to 67, which needs root
+*/
+
+#define _POSIX_C_SOURCE 200809L /* sigaction */
+
+#include <stdio.h> /* fprintf */
+#include <stdlib.h> /* strtoul */
+#include <string.h> /* memset */
+#include <signal.h> /* sigaction */
+#include <arpa/inet.h> /* inet_pton */
+
+#include "dhcp_server.h" /* dhcp_server_t */
+
+#define DEFAULT_PORT (67)
+#define LEASE_TIME (3600)
+#define OFFER_TIME (60)
+
+static dhcp_server_t *g_server = NULL;
+
+static void StopHandler(int sig);
+
+int main(int argc, char *argv[])
+{
+    dhcp_server_config_t config;
+    dhcp_server_stats_t stats;
+    struct sigaction action;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    memset(&config, 0, sizeof(config));
+    if (4 > argc || 1 != inet_pton(AF_INET, argv[1], config.server_ip) ||
+        1 != inet_pton(AF_INET, argv[2], config.subnet_addr))
+    {
+        fprintf(stderr, "usage: %s <server ip> <subnet> <bits> [port]\n",
+                argv[0]);
+        return 1;
+    }
+    config.bits_in_subnet = strtoul(argv[3], NULL, 10);
+    config.port = (5 == argc) ? (unsigned short)strtoul(argv[4], NULL, 10) :
+                                DEFAULT_PORT;
+    config.backend = DHCP_BACKEND_BITMAP;
+    config.lease_time = LEASE_TIME;
+    config.offer_time = OFFER_TIME;
+
+    g_server = DHCPServerCreate(&config);
+    if (NULL == g_server)
+    {
+        perror("dhcpd");
+        return 1;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = StopHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("serving %s/%s on port %u\n", argv[2], argv[3],
+           DHCPServerPort(g_server));
+    status = DHCPServerRun(g_server);
+
+    DHCPServerGetStats(g_server, &stats);
+    printf("received %lu dropped %lu offers %lu acks %lu naks %lu "
+           "releases %lu\n", (unsigned long)stats.received,
+           (unsigned long)stats.dropped, (unsigned long)stats.offers,
+           (unsigned long)stats.acks, (unsigned long)stats.naks,
+           (unsigned long)stats.releases);
+    DHCPServerDestroy(g_server);
+
+    return (DHCP_STATUS_SUCCESS == status) ? 0 : 1;
+}
+
+static void StopHandler(int sig)
+{
+    (void)sig;
+
+    DHCPServerStop(g_server);
+}
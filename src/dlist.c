@@ -5,19 +5,44 @@
 
 typedef struct node node_t;
 
+typedef struct pool_chunk pool_chunk_t;
+
 struct node
 {
     void *data;
     node_t *next;
     node_t *prev;
+    dlist_pool_t *pool;
 };
 
+/* the sentinels carry the list's pool, a node inserted before "where"
+   is taken from where's pool. count is kept by every operation, iterators
+   carry their list so DListInsert and DListRemove can update it */
 struct dlist
 {
     node_t head;
     node_t tail;
+    size_t count;
+};
+
+/* nodes are carved from chunks and recycled through free_nodes (linked by
+   next), the chunks are only returned on DListPoolDestroy */
+struct pool_chunk
+{
+    pool_chunk_t *next;
+    node_t nodes[1];
 };
 
+struct dlist_pool
+{
+    size_t nodes_per_chunk;
+    pool_chunk_t *chunks;
+    node_t *free_nodes;
+};
+
+/* enough levels for any list that fits in memory: level i holds 2^i nodes */
+#define SORT_LEVELS (sizeof(size_t) * 8)
+
 enum
 {
 	SUCCESS = 0,
@@ -26,9 +51,13 @@ enum
 };
 
 static node_t* IterToNode(dlist_iter_t iter);
-static dlist_iter_t NodeToIter(node_t* node);
-static node_t* NodeCreate(void* data, void* next, void* prev);
-static int ActionFunc(void *data, void *add_factor);
+static dlist_iter_t NodeToIter(node_t* node, const dlist_t *list);
+static node_t* NodeCreate(dlist_pool_t *pool, void* data, void* next, void* prev);
+static void NodeFree(node_t *node);
+static int PoolGrow(dlist_pool_t *pool);
+static size_t CountRange(node_t *from, node_t *to);
+static void Relink(node_t *from, node_t *to, node_t *where);
+static node_t *MergeChains(node_t *first, node_t *second, dlist_cmp_func_t cmp);
 static int ISWhereInRange(dlist_iter_t from, dlist_iter_t to , dlist_iter_t where);
 
 
@@ -47,20 +76,41 @@ dlist_t *DListCreate()
     list->tail.prev = &(list->head);
     list->tail.next = NULL;
 
+    list->head.pool = NULL;
+    list->tail.pool = NULL;
+    list->count = 0;
+
+    return (list);
+}
+
+dlist_t *DListCreateFromPool(dlist_pool_t *pool)
+{
+    dlist_t* list = NULL;
+
+    assert(NULL != pool);
+
+    list = DListCreate();
+    if (NULL != list)
+    {
+        list->head.pool = pool;
+        list->tail.pool = pool;
+    }
+
     return (list);
 }
 
 void DListDestroy(dlist_t *list)
 {
-    dlist_iter_t current = NodeToIter(list->head.next);
-    dlist_iter_t next = current;
+    node_t *current = NULL;
+    node_t *next = NULL;
     
     assert(NULL != list);
     
-    while (current != DListEnd(list))
+    current = list->head.next;
+    while (current != &(list->tail))
     {
          next = current->next;
-         free(current);
+         NodeFree(current);
          current = next;
     }
 
@@ -71,7 +121,7 @@ dlist_iter_t DListBegin(const dlist_t *list)
 {
     assert(NULL != list);
     
-    return NodeToIter(list->head.next);
+    return NodeToIter(list->head.next, list);
 }
 
 
@@ -79,22 +129,22 @@ dlist_iter_t DListEnd(const dlist_t *list)
 {
     assert(NULL != list);
     
-    return NodeToIter((node_t*)&(list->tail));
+    return NodeToIter((node_t*)&(list->tail), list);
 }
 
 
 dlist_iter_t DListNext(dlist_iter_t iter)
 {
-    assert(NULL != iter);
+    assert(NULL != IterToNode(iter));
     
-    return NodeToIter(IterToNode(iter)->next);
+    return NodeToIter(IterToNode(iter)->next, iter.list);
 }
 
 dlist_iter_t DListPrev(dlist_iter_t iter)
 {
-    assert(NULL != iter);
+    assert(NULL != IterToNode(iter));
     
-    return NodeToIter(IterToNode(iter)->prev);
+    return NodeToIter(IterToNode(iter)->prev, iter.list);
 }
 
 int DListIsIterSame(dlist_iter_t element1, dlist_iter_t element2)
@@ -107,50 +157,51 @@ int DListIsIterSame(dlist_iter_t element1, dlist_iter_t element2)
 
 dlist_iter_t DListInsert(dlist_iter_t where, void* data)
 {
+     node_t* where_node = IterToNode(where);
      node_t* new_node = NULL;
      
-     assert(NULL != where);
+     assert(NULL != where_node);
      assert(NULL != data);
 
-     new_node = NodeCreate(data, where, where->prev);
+     new_node = NodeCreate(where_node->pool, data, where_node, where_node->prev);
      if (NULL == new_node)
      {
-         while (NULL != where->next)
-         {
-              where = where->next;
-         }
-         return where;
+         return DListEnd(where.list);
      }
      
-     where->prev->next = new_node;
-     where->prev = new_node;
+     where_node->prev->next = new_node;
+     where_node->prev = new_node;
+     ++where.list->count;
      
-     return new_node;
+     return NodeToIter(new_node, where.list);
 }
 
 dlist_iter_t DListRemove(dlist_iter_t to_remove)
 {
-     dlist_iter_t tmp = to_remove->next;
+     node_t* node = IterToNode(to_remove);
+     node_t* next = NULL;
      
-     assert(NULL != to_remove);
+     assert(NULL != node);
      
-     to_remove->prev->next = tmp;
-     tmp->prev = to_remove->prev;
-     free(to_remove);
+     next = node->next;
+     node->prev->next = next;
+     next->prev = node->prev;
+     NodeFree(node);
+     --to_remove.list->count;
      
-     return tmp;
+     return NodeToIter(next, to_remove.list);
 }
 
 void *DListGetData(const dlist_iter_t iter)
 {
-     assert(NULL != iter);
+     assert(NULL != IterToNode(iter));
      
      return (IterToNode(iter)->data);
 }
 
 void DListSetData(dlist_iter_t iter, void *data)
 {
-     assert(NULL != iter);
+     assert(NULL != IterToNode(iter));
      assert(NULL != data);
      
      IterToNode(iter)->data = data;
@@ -191,7 +242,7 @@ int DListForEach(dlist_iter_t from, dlist_iter_t to,
     
     while (!DListIsIterSame(runner, to) && SUCCESS == result)
     {
-        result = action(runner->data, param);
+        result = action(IterToNode(runner)->data, param);
         runner = DListNext(runner);
     }
     
@@ -200,30 +251,169 @@ int DListForEach(dlist_iter_t from, dlist_iter_t to,
 
 size_t DListCount(const dlist_t *list)
 {
-    size_t counter = 0;
-    dlist_iter_t start = DListBegin(list);
-    dlist_iter_t end = DListEnd(list);
-    
     assert(NULL != list);
     
-    DListForEach(start, end, &ActionFunc, &counter);
-    return (counter);
+    return (list->count);
 }
 
 void DListSplice(dlist_iter_t from, dlist_iter_t to, dlist_iter_t where)
 {
-     node_t* tmp = where->prev;
+     size_t moved = 0;
      
      assert(ISWhereInRange(from, to, where));
 
-     to->prev->next = where;
-     where->prev = to->prev;
-     
-     from->prev->next = to;
-     to->prev = from->prev;
-     
-     tmp->next = from;
-     from->prev = tmp;
+     /* within one list the count does not change, between lists the
+        range has to be counted */
+     if (from.list != where.list)
+     {
+          moved = CountRange(IterToNode(from), IterToNode(to));
+          from.list->count -= moved;
+          where.list->count += moved;
+     }
+
+     Relink(IterToNode(from), IterToNode(to), IterToNode(where));
+}
+
+void DListConcat(dlist_t *dest, dlist_t *src)
+{
+     assert(NULL != dest);
+     assert(NULL != src);
+     assert(dest != src);
+
+     if (0 == src->count)
+     {
+          return;
+     }
+
+     Relink(src->head.next, &(src->tail), &(dest->tail));
+     dest->count += src->count;
+     src->count = 0;
+}
+
+void DListSplit(dlist_iter_t where, dlist_t *dest)
+{
+     dlist_t *src = where.list;
+     node_t *forward = IterToNode(where);
+     node_t *backward = IterToNode(where);
+     size_t moved = 0;
+     size_t kept = 0;
+
+     assert(NULL != dest);
+     assert(src != dest);
+
+     /* walk out from "where" in both directions and stop at whichever
+        sentinel comes first, so only the shorter part is counted */
+     while (forward != &(src->tail) && backward != &(src->head))
+     {
+          forward = forward->next;
+          ++moved;
+          backward = backward->prev;
+          ++kept;
+     }
+     if (forward == &(src->tail))
+     {
+          kept = src->count - moved;
+     }
+     else
+     {
+          --kept;
+          moved = src->count - kept;
+     }
+
+     Relink(IterToNode(where), &(src->tail), &(dest->tail));
+     src->count = kept;
+     dest->count += moved;
+}
+
+void DListSort(dlist_t *list, dlist_cmp_func_t cmp)
+{
+     node_t *levels[SORT_LEVELS] = {NULL};
+     node_t *carry = NULL;
+     node_t *next = NULL;
+     node_t *prev = NULL;
+     size_t level = 0;
+
+     assert(NULL != list);
+     assert(cmp);
+
+     if (2 > list->count)
+     {
+          return;
+     }
+
+     /* the nodes form a NULL terminated chain through next while sorting,
+        prev is fixed up at the end in one pass */
+     list->tail.prev->next = NULL;
+     for (carry = list->head.next; NULL != carry; carry = next)
+     {
+          next = carry->next;
+          carry->next = NULL;
+
+          /* like a binary counter: merge equal sized runs upwards. Older
+             runs go first so equal elements keep their order */
+          for (level = 0; NULL != levels[level] && level + 1 < SORT_LEVELS;
+               ++level)
+          {
+               carry = MergeChains(levels[level], carry, cmp);
+               levels[level] = NULL;
+          }
+          levels[level] = MergeChains(levels[level], carry, cmp);
+     }
+
+     carry = NULL;
+     for (level = 0; level < SORT_LEVELS; ++level)
+     {
+          carry = MergeChains(levels[level], carry, cmp);
+     }
+
+     prev = &(list->head);
+     for (; NULL != carry; carry = carry->next)
+     {
+          prev->next = carry;
+          carry->prev = prev;
+          prev = carry;
+     }
+     prev->next = &(list->tail);
+     list->tail.prev = prev;
+}
+
+void DListMerge(dlist_t *dest, dlist_t *src, dlist_cmp_func_t cmp)
+{
+     node_t *where = NULL;
+     node_t *run_end = NULL;
+
+     assert(NULL != dest);
+     assert(NULL != src);
+     assert(dest != src);
+     assert(cmp);
+
+     where = dest->head.next;
+     while (src->head.next != &(src->tail))
+     {
+          while (where != &(dest->tail) &&
+                 0 >= cmp(where->data, src->head.next->data))
+          {
+               where = where->next;
+          }
+          if (where == &(dest->tail))
+          {
+               run_end = &(src->tail);
+          }
+          else
+          {
+               /* move every src node that goes before "where" at once */
+               run_end = src->head.next->next;
+               while (run_end != &(src->tail) &&
+                      0 > cmp(run_end->data, where->data))
+               {
+                    run_end = run_end->next;
+               }
+          }
+          Relink(src->head.next, run_end, where);
+     }
+
+     dest->count += src->count;
+     src->count = 0;
 }
 
 int DListMultiFind(dlist_iter_t from, dlist_iter_t to, match_func_t is_match, 
@@ -262,11 +452,12 @@ dlist_iter_t DListPushBack(dlist_t *list, void *data)
 
 void *DListPopBack(dlist_t *list)
 {
-    void *data = DListGetData(DListEnd(list)->prev);
+    dlist_iter_t last = DListPrev(DListEnd(list));
+    void *data = DListGetData(last);
     
     assert(list);
     
-    DListRemove(DListEnd(list)->prev);
+    DListRemove(last);
     
     return data;
 }
@@ -293,23 +484,107 @@ void *DListPopFront(dlist_t *list)
 }
 
 
+dlist_pool_t *DListPoolCreate(size_t nodes_per_chunk)
+{
+    dlist_pool_t *pool = NULL;
+
+    assert(0 != nodes_per_chunk);
+
+    pool = (dlist_pool_t *)malloc(sizeof(dlist_pool_t));
+    if (NULL == pool)
+    {
+        return NULL;
+    }
+
+    pool->nodes_per_chunk = nodes_per_chunk;
+    pool->chunks = NULL;
+    pool->free_nodes = NULL;
+
+    return (pool);
+}
+
+void DListPoolDestroy(dlist_pool_t *pool)
+{
+    pool_chunk_t *next = NULL;
+
+    assert(NULL != pool);
+
+    while (NULL != pool->chunks)
+    {
+        next = pool->chunks->next;
+        free(pool->chunks);
+        pool->chunks = next;
+    }
+    free(pool);
+}
+
+void DListLinkInit(dlist_link_t *head)
+{
+    assert(NULL != head);
+
+    head->next = head;
+    head->prev = head;
+}
+
+void DListLinkInsert(dlist_link_t *where, dlist_link_t *link)
+{
+    assert(NULL != where);
+    assert(NULL != link);
+
+    link->next = where;
+    link->prev = where->prev;
+    where->prev->next = link;
+    where->prev = link;
+}
+
+void DListLinkRemove(dlist_link_t *link)
+{
+    assert(NULL != link);
+
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = link;
+    link->prev = link;
+}
+
+int DListLinkIsEmpty(const dlist_link_t *head)
+{
+    assert(NULL != head);
+
+    return (head->next == head);
+}
+
+
 /*////////////////////////////////////////////////*/
 
-dlist_iter_t NodeToIter(node_t* node)
+dlist_iter_t NodeToIter(node_t* node, const dlist_t *list)
 {
-     return ((dlist_iter_t)node);
+     dlist_iter_t iter;
+
+     iter.node = node;
+     iter.list = (dlist_t*)list;
+
+     return (iter);
 }
 
 node_t* IterToNode(dlist_iter_t iter)
 {
-     return ((node_t*)iter);
+     return (iter.node);
 }
 
-node_t* NodeCreate(void* data, void* next, void* prev)
+node_t* NodeCreate(dlist_pool_t *pool, void* data, void* next, void* prev)
 {
      node_t* node = NULL;
      
-     node = (node_t*)malloc(sizeof(dlist_t));
+     if (NULL == pool)
+     {
+          node = (node_t*)malloc(sizeof(node_t));
+     }
+     else if (NULL != pool->free_nodes || SUCCESS == PoolGrow(pool))
+     {
+          node = pool->free_nodes;
+          pool->free_nodes = node->next;
+     }
      if (NULL == node)
      {
           return NULL;
@@ -318,23 +593,122 @@ node_t* NodeCreate(void* data, void* next, void* prev)
      node->data = data;
      node->next = next;
      node->prev = prev;
+     node->pool = pool;
      
      return (node);
 }
 
-int ActionFunc(void *data, void *add_factor)
+void NodeFree(node_t *node)
+{
+     if (NULL == node->pool)
+     {
+          free(node);
+          return;
+     }
+
+     node->next = node->pool->free_nodes;
+     node->pool->free_nodes = node;
+}
+
+int PoolGrow(dlist_pool_t *pool)
+{
+     pool_chunk_t *chunk = NULL;
+     size_t i = 0;
+
+     chunk = (pool_chunk_t *)malloc(sizeof(pool_chunk_t) +
+                                    (pool->nodes_per_chunk - 1) * sizeof(node_t));
+     if (NULL == chunk)
+     {
+          return FAILURE;
+     }
+
+     chunk->next = pool->chunks;
+     pool->chunks = chunk;
+     for (i = 0; i < pool->nodes_per_chunk; ++i)
+     {
+          chunk->nodes[i].next = pool->free_nodes;
+          pool->free_nodes = &chunk->nodes[i];
+     }
+
+     return SUCCESS;
+}
+
+size_t CountRange(node_t *from, node_t *to)
+{
+     size_t counter = 0;
+
+     for (; from != to; from = from->next)
+     {
+          ++counter;
+     }
+
+     return (counter);
+}
+
+/* moves [from, to) before where */
+void Relink(node_t *from, node_t *to, node_t *where)
+{
+     node_t* tmp = where->prev;
+
+     if (from == to)
+     {
+          return;
+     }
+
+     to->prev->next = where;
+     where->prev = to->prev;
+     
+     from->prev->next = to;
+     to->prev = from->prev;
+     
+     tmp->next = from;
+     from->prev = tmp;
+}
+
+/* merges two NULL terminated chains linked by next, first wins ties */
+node_t *MergeChains(node_t *first, node_t *second, dlist_cmp_func_t cmp)
 {
-    (void)data;
-    *(int*)add_factor += 1;
-    return (0);
+     node_t merged;
+     node_t *last = &merged;
+
+     if (NULL == first)
+     {
+          return (second);
+     }
+     if (NULL == second)
+     {
+          return (first);
+     }
+
+     while (NULL != first && NULL != second)
+     {
+          /* the walk is bound by cache misses on large lists: start
+             loading whichever node comes next in both chains */
+          __builtin_prefetch(first->next);
+          __builtin_prefetch(second->next);
+          if (0 >= cmp(first->data, second->data))
+          {
+               last->next = first;
+               first = first->next;
+          }
+          else
+          {
+               last->next = second;
+               second = second->next;
+          }
+          last = last->next;
+     }
+     last->next = (NULL != first) ? first : second;
+
+     return (merged.next);
 }
 
 int ISWhereInRange(dlist_iter_t from, dlist_iter_t to , dlist_iter_t where)
 {
-     dlist_iter_t current = from;
-     while (current != to)
+     node_t *current = IterToNode(from);
+     while (current != IterToNode(to))
      {
-         if (current == where)
+         if (current == IterToNode(where))
          {
              return 0;
          }
@@ -343,12 +717,3 @@ int ISWhereInRange(dlist_iter_t from, dlist_iter_t to , dlist_iter_t where)
      
      return 1;
 }
-
-dlist_iter_t GetToEnd(dlist_iter_t where)
-{
-	while (NULL != where->next)
-         {
-              where = where->next;
-         }
-    return where;
-}
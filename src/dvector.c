@@ -1,18 +1,57 @@
 /*//////////////////////////////////////
 Name: Alon Weinberg                    /
 Reviewer:                              /
-last date updated: 06/2/24             /
+last date updated: 19/10/26            /
 File type: header file                 /
-//////////////////////////////////////*/ 
+//////////////////////////////////////*/
+
+#define _GNU_SOURCE /* mremap, MREMAP_MAYMOVE, MADV_HUGEPAGE */
 
 #include "../inc/dvector.h"
 #include <stdlib.h> /* malloc */
 #include <string.h> /* memcpy */
 #include <assert.h> /* assert */
+#include <unistd.h> /* sysconf, ftruncate, close */
+#include <fcntl.h> /* open */
+#include <sys/mman.h> /* mmap, mremap, munmap, madvise, msync */
+#include <sys/stat.h> /* fstat */
+
+#if defined(__x86_64__)
+#define DVECTOR_SIMD
+#include <immintrin.h> /* _mm_cmpeq_epi32, _mm256_cmpeq_epi64 */
+#endif
 
 #define SUCCESS (0)
 #define FAILURE (-1)
 #define GROWTH_FACTOR (2)
+#define HUGEPAGE_SIZE ((size_t)2 * 1024 * 1024)
+#define FILE_MAGIC ("DVECTOR")
+#define FILE_HEADER_SIZE (64)
+#define FNV_OFFSET (2166136261UL)
+#define FNV_PRIME (16777619UL)
+#define INSERTION_SORT_LIMIT (16)
+#define RADIX_BITS (8)
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+typedef enum backing
+{
+    BACKING_HEAP = 0,
+    BACKING_MMAP,
+    BACKING_FILE,
+    BACKING_INLINE
+} backing_t;
+
+/* first FILE_HEADER_SIZE bytes of a file backed vector, the elements
+   follow it directly */
+typedef struct file_header
+{
+    char magic[8];
+    size_t element_size;
+    size_t size;
+    size_t capacity;
+    unsigned long checksum;
+    int is_dirty;
+} file_header_t;
 
 struct dvector_t
 {
@@ -20,12 +59,57 @@ struct dvector_t
     size_t element_size;
     size_t size;
     void *elements;
+    backing_t backing;
+    int map_flags;
+    size_t mapped_bytes;
+    int fd;
+    file_header_t *header;
+    size_t inline_capacity;
 };
 
+static int Resize(dvector_t *dvector, size_t capacity);
+static int ResizeInline(dvector_t *dvector, size_t capacity);
+static void *InlineElements(const dvector_t *dvector);
+static size_t MappedBytes(const dvector_t *dvector, size_t capacity);
+static void AdviseHugepage(const dvector_t *dvector);
+static unsigned long Checksum(const dvector_t *dvector);
+static void UpdateHeader(dvector_t *dvector);
+static dvector_t *AbortOpen(dvector_t *dvector);
+
+static size_t Scan(const dvector_t *dvector, const void *key, int is_count);
+static size_t ScanScalar(const char *elements, size_t from, size_t size,
+                         size_t element_size, const void *key, int is_count);
+#ifdef DVECTOR_SIMD
+static size_t Scan32Sse2(const unsigned int *elements, size_t size,
+                         unsigned int key, int is_count);
+static size_t Scan64Sse2(const unsigned long *elements, size_t size,
+                         unsigned long key, int is_count);
+static size_t Scan32Avx2(const unsigned int *elements, size_t size,
+                         unsigned int key, int is_count);
+static size_t Scan64Avx2(const unsigned long *elements, size_t size,
+                         unsigned long key, int is_count);
+#endif
+static int RadixSort(dvector_t *dvector);
+static unsigned long LoadKey(const char *element, size_t element_size);
+static int CompareUnsigned(const void *lhs, const void *rhs, size_t size);
+static void IntroSort(char *base, size_t count, size_t size,
+                      dvector_cmp_func_t cmp, size_t depth_limit);
+static void InsertionSort(char *base, size_t count, size_t size,
+                          dvector_cmp_func_t cmp);
+static void HeapSort(char *base, size_t count, size_t size,
+                     dvector_cmp_func_t cmp);
+static void SiftDown(char *base, size_t root, size_t count, size_t size,
+                     dvector_cmp_func_t cmp);
+static size_t Partition(char *base, size_t count, size_t size,
+                        dvector_cmp_func_t cmp);
+static int Compare(const void *lhs, const void *rhs, size_t size,
+                   dvector_cmp_func_t cmp);
+static void SwapBytes(char *lhs, char *rhs, size_t size);
+
 dvector_t *DvectorCreate(size_t capacity , size_t element_size)
 {
      dvector_t* dvector = (dvector_t*)malloc(sizeof(dvector_t));
-     
+
      assert(0 != element_size);
      assert(0 != capacity);
      if (NULL != dvector)
@@ -33,6 +117,12 @@ dvector_t *DvectorCreate(size_t capacity , size_t element_size)
           dvector->capacity = capacity;
           dvector->element_size = element_size;
           dvector->size = 0;
+          dvector->backing = BACKING_HEAP;
+          dvector->map_flags = DVECTOR_MAP_DEFAULT;
+          dvector->mapped_bytes = 0;
+          dvector->fd = -1;
+          dvector->header = NULL;
+          dvector->inline_capacity = 0;
           dvector->elements = malloc(dvector->capacity * dvector->element_size);
           if(NULL == dvector->elements)
           {
@@ -48,11 +138,193 @@ dvector_t *DvectorCreate(size_t capacity , size_t element_size)
 }
 
 
+dvector_t *DvectorCreateMapped(size_t capacity, size_t element_size, int flags)
+{
+     dvector_t* dvector = (dvector_t*)malloc(sizeof(dvector_t));
+
+     assert(0 != element_size);
+     assert(0 != capacity);
+     if (NULL == dvector)
+     {
+          return NULL;
+     }
+
+     dvector->capacity = capacity;
+     dvector->element_size = element_size;
+     dvector->size = 0;
+     dvector->backing = BACKING_MMAP;
+     dvector->map_flags = flags;
+     dvector->fd = -1;
+     dvector->header = NULL;
+     dvector->inline_capacity = 0;
+     dvector->mapped_bytes = MappedBytes(dvector, capacity);
+     dvector->elements = mmap(NULL, dvector->mapped_bytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     if (MAP_FAILED == dvector->elements)
+     {
+          free(dvector);
+          return NULL;
+     }
+     AdviseHugepage(dvector);
+
+     return dvector;
+}
+
+
+dvector_t *DvectorCreateSmall(size_t inline_capacity, size_t element_size)
+{
+     dvector_t* dvector = NULL;
+
+     assert(0 != element_size);
+     assert(0 != inline_capacity);
+
+     /* one block - the struct followed by the inline elements */
+     dvector = (dvector_t*)malloc(sizeof(dvector_t) +
+                                  inline_capacity * element_size);
+     if (NULL == dvector)
+     {
+          return NULL;
+     }
+
+     dvector->capacity = inline_capacity;
+     dvector->element_size = element_size;
+     dvector->size = 0;
+     dvector->backing = BACKING_INLINE;
+     dvector->map_flags = DVECTOR_MAP_DEFAULT;
+     dvector->mapped_bytes = 0;
+     dvector->fd = -1;
+     dvector->header = NULL;
+     dvector->inline_capacity = inline_capacity;
+     dvector->elements = InlineElements(dvector);
+
+     return dvector;
+}
+
+
+dvector_t *DvectorOpenFile(const char *path, size_t capacity,
+                           size_t element_size)
+{
+     struct stat file_stat;
+     file_header_t *header = NULL;
+     int is_new = 0;
+     dvector_t* dvector = (dvector_t*)malloc(sizeof(dvector_t));
+
+     assert(NULL != path);
+     assert(0 != element_size);
+     assert(0 != capacity);
+     if (NULL == dvector)
+     {
+          return NULL;
+     }
+
+     dvector->backing = BACKING_FILE;
+     dvector->map_flags = DVECTOR_MAP_DEFAULT;
+     dvector->element_size = element_size;
+     dvector->header = NULL;
+     dvector->inline_capacity = 0;
+     dvector->fd = open(path, O_RDWR | O_CREAT, 0666);
+     if (-1 == dvector->fd || -1 == fstat(dvector->fd, &file_stat))
+     {
+          return AbortOpen(dvector);
+     }
+
+     is_new = (0 == file_stat.st_size);
+     if (is_new)
+     {
+          dvector->mapped_bytes = MappedBytes(dvector, capacity);
+          if (-1 == ftruncate(dvector->fd, (off_t)dvector->mapped_bytes))
+          {
+               return AbortOpen(dvector);
+          }
+     }
+     else
+     {
+          dvector->mapped_bytes = (size_t)file_stat.st_size;
+     }
+
+     header = mmap(NULL, dvector->mapped_bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, dvector->fd, 0);
+     if (MAP_FAILED == header)
+     {
+          return AbortOpen(dvector);
+     }
+     dvector->header = header;
+     dvector->elements = (char *)header + FILE_HEADER_SIZE;
+
+     if (is_new)
+     {
+          memcpy(header->magic, FILE_MAGIC, sizeof(header->magic));
+          header->element_size = element_size;
+          header->capacity = capacity;
+          header->size = 0;
+          header->is_dirty = 1;
+     }
+     else if (0 != memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) ||
+              element_size != header->element_size ||
+              header->size > header->capacity ||
+              FILE_HEADER_SIZE + header->capacity * element_size >
+                                                       dvector->mapped_bytes)
+     {
+          return AbortOpen(dvector);
+     }
+
+     dvector->size = header->size;
+     dvector->capacity = header->capacity;
+     if (!header->is_dirty && header->checksum != Checksum(dvector))
+     {
+          return AbortOpen(dvector);
+     }
+
+     if (capacity > dvector->capacity && FAILURE == Resize(dvector, capacity))
+     {
+          return AbortOpen(dvector);
+     }
+     UpdateHeader(dvector);
+
+     return dvector;
+}
+
+
+int DvectorSync(dvector_t *dvector)
+{
+     file_header_t *header = NULL;
+
+     assert(NULL != dvector);
+     if (BACKING_FILE != dvector->backing)
+     {
+          return SUCCESS;
+     }
+
+     header = dvector->header;
+     header->checksum = Checksum(dvector);
+     header->is_dirty = 0;
+     if (-1 == msync(header, dvector->mapped_bytes, MS_SYNC))
+     {
+          header->is_dirty = 1;
+          return FAILURE;
+     }
+
+     return SUCCESS;
+}
+
+
 void DvectorDestroy(dvector_t* dvector)
 {
-     assert(NULL != dvector); 
+     assert(NULL != dvector);
 
-     free(dvector->elements);
+     if (BACKING_FILE == dvector->backing)
+     {
+          munmap(dvector->header, dvector->mapped_bytes);
+          close(dvector->fd);
+     }
+     else if (BACKING_MMAP == dvector->backing)
+     {
+          munmap(dvector->elements, dvector->mapped_bytes);
+     }
+     else if (dvector->elements != InlineElements(dvector))
+     {
+          free(dvector->elements);
+     }
      free(dvector);
      dvector = NULL;
 }
@@ -64,6 +336,11 @@ void *DvectorGetAccessToElement(const dvector_t *dvector, size_t idx)
      assert(idx < dvector->size);
      if (idx < dvector->size)
      {
+         if (NULL != dvector->header)
+         {
+             /* the caller may write through the pointer */
+             dvector->header->is_dirty = 1;
+         }
          return (char *)dvector->elements + (idx * dvector->element_size);
      }
      return NULL;
@@ -72,61 +349,44 @@ void *DvectorGetAccessToElement(const dvector_t *dvector, size_t idx)
 
 int DvectorPushBack(dvector_t *dvector, const void *data)
 {
-     dvector_t* tmp = NULL;
      void* push_adress = NULL;
-     dvector->size++;
      assert(NULL != dvector);
-     if (dvector->size >= dvector->capacity)
+     dvector->size++;
+     if (dvector->size > dvector->capacity)
      {
-          dvector->capacity *= GROWTH_FACTOR;
-          tmp = realloc(dvector->elements, dvector->capacity * dvector->element_size);
-          if (NULL == tmp)
+          if (FAILURE == Resize(dvector, dvector->capacity * GROWTH_FACTOR))
           {
-               dvector->capacity /= GROWTH_FACTOR;
                dvector->size--;
                return FAILURE;
           }
-          else
-          {
-               dvector->elements = tmp;
-          }
      }
      push_adress = (char *)dvector->elements + ((dvector->size - 1) * dvector->element_size);
      memcpy(push_adress, data, dvector->element_size);
+     UpdateHeader(dvector);
      return SUCCESS;
 }
 
 
 void DvectorPopBack(dvector_t *dvector)
 {
-     dvector_t* tmp = NULL;
-     dvector->size--;
      assert(NULL != dvector);
-     if (dvector->size <= 0.25 * dvector->capacity)
+     dvector->size--;
+     if (dvector->size <= 0.25 * dvector->capacity && 1 < dvector->capacity)
      {
-          dvector->capacity /= GROWTH_FACTOR;
-          tmp = realloc(dvector->elements, dvector->capacity * dvector->element_size);
-          if (NULL == tmp)
-          {
-               dvector->capacity *= GROWTH_FACTOR;
-               dvector->size++;
-          }
-          else
-          {
-               dvector->elements = tmp;
-          }
-     }     
+          Resize(dvector, dvector->capacity / GROWTH_FACTOR);
+     }
+     UpdateHeader(dvector);
 }
 
 
 size_t DvectorSize(const dvector_t *dvector)
 {
       assert(NULL != dvector);
-     
+
       return dvector->size;
 }
 
- 
+
 size_t DvectorCapacity(const dvector_t *dvector)
 {
       assert(NULL != dvector);
@@ -136,37 +396,677 @@ size_t DvectorCapacity(const dvector_t *dvector)
 
 int DvectorReserve(dvector_t *dvector, size_t capacity)
 {
-      dvector_t* tmp = NULL;
       assert(NULL != dvector);
       if (capacity < dvector->size)
       {
            capacity = dvector->size;
       }
-      tmp = realloc(dvector->elements, capacity * dvector->element_size);
-      if (NULL == tmp)
+      return Resize(dvector, capacity);
+}
+
+int DvectorShrink(dvector_t *dvector)
+{
+      assert(NULL != dvector);
+      return Resize(dvector, dvector->size * GROWTH_FACTOR);
+}
+
+
+size_t DvectorFind(const dvector_t *dvector, const void *key)
+{
+      assert(NULL != dvector);
+      assert(NULL != key);
+
+      return Scan(dvector, key, 0);
+}
+
+
+size_t DvectorCount(const dvector_t *dvector, const void *key)
+{
+      assert(NULL != dvector);
+      assert(NULL != key);
+
+      return Scan(dvector, key, 1);
+}
+
+
+int DvectorSort(dvector_t *dvector, dvector_cmp_func_t cmp)
+{
+      size_t depth_limit = 0;
+      size_t count = 0;
+
+      assert(NULL != dvector);
+
+      UpdateHeader(dvector);
+      if (NULL == cmp)
+      {
+           assert(sizeof(unsigned int) == dvector->element_size ||
+                  sizeof(unsigned long) == dvector->element_size);
+           if (SUCCESS == RadixSort(dvector))
+           {
+                return SUCCESS;
+           }
+      }
+
+      /* no room for the radix buffer - fall back to sorting in place */
+      for (count = dvector->size; count > 1; count >>= 1)
       {
-           return FAILURE;
+           depth_limit += 2;
       }
-      else
+      IntroSort(dvector->elements, dvector->size, dvector->element_size, cmp,
+                depth_limit);
+
+      return SUCCESS;
+}
+
+/*////////////////////////////////////////////////*/
+
+/* changes the capacity in place, heap vectors through realloc and mapped
+   vectors through mremap, so growth never copies the elements by hand */
+static int Resize(dvector_t *dvector, size_t capacity)
+{
+      void *tmp = NULL;
+      size_t new_bytes = 0;
+      int is_file = (BACKING_FILE == dvector->backing);
+
+      if (0 == capacity)
+      {
+           capacity = 1;
+      }
+
+      if (BACKING_INLINE == dvector->backing)
       {
+           return ResizeInline(dvector, capacity);
+      }
+
+      if (BACKING_HEAP == dvector->backing)
+      {
+           tmp = realloc(dvector->elements, capacity * dvector->element_size);
+           if (NULL == tmp)
+           {
+                return FAILURE;
+           }
            dvector->elements = tmp;
            dvector->capacity = capacity;
            return SUCCESS;
       }
+
+      new_bytes = MappedBytes(dvector, capacity);
+      if (new_bytes != dvector->mapped_bytes)
+      {
+           /* the file has to cover the mapping before it grows */
+           if (is_file && new_bytes > dvector->mapped_bytes &&
+               -1 == ftruncate(dvector->fd, (off_t)new_bytes))
+           {
+                return FAILURE;
+           }
+           tmp = mremap(is_file ? (void *)dvector->header : dvector->elements,
+                        dvector->mapped_bytes, new_bytes, MREMAP_MAYMOVE);
+           if (MAP_FAILED == tmp)
+           {
+                return FAILURE;
+           }
+           if (is_file)
+           {
+                dvector->header = tmp;
+                tmp = (char *)tmp + FILE_HEADER_SIZE;
+                if (new_bytes < dvector->mapped_bytes)
+                {
+                     ftruncate(dvector->fd, (off_t)new_bytes);
+                }
+           }
+           dvector->elements = tmp;
+           dvector->mapped_bytes = new_bytes;
+           AdviseHugepage(dvector);
+      }
+      dvector->capacity = capacity;
+      UpdateHeader(dvector);
+
+      return SUCCESS;
 }
 
-int DvectorShrink(dvector_t *dvector)
+/* spills to the heap past the inline capacity and moves back into the
+   inline storage once the elements fit it again */
+static int ResizeInline(dvector_t *dvector, size_t capacity)
 {
-      dvector_t* tmp = NULL;
-      assert(NULL != dvector);
-      tmp = realloc(dvector->elements, dvector->size * GROWTH_FACTOR * dvector->element_size);
-      if (NULL == tmp)
+      void *inline_elements = InlineElements(dvector);
+      void *tmp = NULL;
+      size_t used = dvector->size < dvector->capacity ? dvector->size :
+                                                        dvector->capacity;
+      size_t used_bytes = used * dvector->element_size;
+
+      if (capacity <= dvector->inline_capacity)
       {
-           return FAILURE;
+           if (dvector->elements != inline_elements)
+           {
+                memcpy(inline_elements, dvector->elements, used_bytes);
+                free(dvector->elements);
+                dvector->elements = inline_elements;
+           }
+           dvector->capacity = dvector->inline_capacity;
+           return SUCCESS;
+      }
+
+      if (dvector->elements == inline_elements)
+      {
+           tmp = malloc(capacity * dvector->element_size);
+           if (NULL == tmp)
+           {
+                return FAILURE;
+           }
+           memcpy(tmp, inline_elements, used_bytes);
       }
       else
       {
-           dvector->capacity = dvector->size * GROWTH_FACTOR;
+           tmp = realloc(dvector->elements, capacity * dvector->element_size);
+           if (NULL == tmp)
+           {
+                return FAILURE;
+           }
+      }
+      dvector->elements = tmp;
+      dvector->capacity = capacity;
+
+      return SUCCESS;
+}
+
+static void *InlineElements(const dvector_t *dvector)
+{
+      return (void *)(dvector + 1);
+}
+
+static size_t MappedBytes(const dvector_t *dvector, size_t capacity)
+{
+      size_t page = (size_t)sysconf(_SC_PAGESIZE);
+      size_t bytes = capacity * dvector->element_size;
+
+      if (BACKING_FILE == dvector->backing)
+      {
+           bytes += FILE_HEADER_SIZE;
+      }
+
+      if (DVECTOR_MAP_HUGEPAGE & dvector->map_flags && HUGEPAGE_SIZE <= bytes)
+      {
+           page = HUGEPAGE_SIZE;
+      }
+
+      return ((bytes + page - 1) / page) * page;
+}
+
+static void AdviseHugepage(const dvector_t *dvector)
+{
+#ifdef MADV_HUGEPAGE
+      if (DVECTOR_MAP_HUGEPAGE & dvector->map_flags)
+      {
+           /* advice only - the vector works the same without THP */
+           madvise(dvector->elements, dvector->mapped_bytes, MADV_HUGEPAGE);
+      }
+#else
+      (void)dvector;
+#endif
+}
+
+/* FNV-1a over the live elements */
+static unsigned long Checksum(const dvector_t *dvector)
+{
+      const unsigned char *runner = dvector->elements;
+      const unsigned char *end = runner + dvector->size * dvector->element_size;
+      unsigned long hash = FNV_OFFSET;
+
+      while (runner < end)
+      {
+           hash = (hash ^ *runner) * FNV_PRIME;
+           ++runner;
+      }
+
+      return hash;
+}
+
+/* keeps the on-disk header in step with the vector, the checksum is only
+   refreshed by DvectorSync */
+static void UpdateHeader(dvector_t *dvector)
+{
+      if (NULL == dvector->header)
+      {
+           return;
+      }
+
+      dvector->header->size = dvector->size;
+      dvector->header->capacity = dvector->capacity;
+      dvector->header->is_dirty = 1;
+}
+
+static dvector_t *AbortOpen(dvector_t *dvector)
+{
+      if (NULL != dvector->header)
+      {
+           munmap(dvector->header, dvector->mapped_bytes);
+      }
+      if (-1 != dvector->fd)
+      {
+           close(dvector->fd);
+      }
+      free(dvector);
+
+      return NULL;
+}
+
+/******************************* Find / Count *********************************/
+
+/* returns the index of the first match, or the number of matches */
+static size_t Scan(const dvector_t *dvector, const void *key, int is_count)
+{
+#ifdef DVECTOR_SIMD
+      unsigned int key32 = 0;
+      unsigned long key64 = 0;
+      int has_avx2 = __builtin_cpu_supports("avx2");
+
+      if (sizeof(unsigned int) == dvector->element_size)
+      {
+           memcpy(&key32, key, sizeof(key32));
+           return (has_avx2 ? Scan32Avx2 : Scan32Sse2)(dvector->elements,
+                                              dvector->size, key32, is_count);
+      }
+      if (sizeof(unsigned long) == dvector->element_size)
+      {
+           memcpy(&key64, key, sizeof(key64));
+           return (has_avx2 ? Scan64Avx2 : Scan64Sse2)(dvector->elements,
+                                              dvector->size, key64, is_count);
+      }
+#endif
+      return ScanScalar(dvector->elements, 0, dvector->size,
+                        dvector->element_size, key, is_count);
+}
+
+static size_t ScanScalar(const char *elements, size_t from, size_t size,
+                         size_t element_size, const void *key, int is_count)
+{
+      size_t found = 0;
+      size_t i = 0;
+
+      for (i = from; i < size; ++i)
+      {
+           if (0 == memcmp(elements + i * element_size, key, element_size))
+           {
+                if (!is_count)
+                {
+                     return i;
+                }
+                ++found;
+           }
+      }
+
+      return (is_count ? found : size);
+}
+
+#ifdef DVECTOR_SIMD
+/* SSE2 is part of the x86-64 baseline, AVX2 is picked at run time */
+
+static size_t Scan32Sse2(const unsigned int *elements, size_t size,
+                         unsigned int key, int is_count)
+{
+      __m128i keys = _mm_set1_epi32((int)key);
+      size_t found = 0;
+      size_t i = 0;
+      int mask = 0;
+
+      for (i = 0; i + 4 <= size; i += 4)
+      {
+           mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(
+                      _mm_loadu_si128((const __m128i *)(elements + i)), keys)));
+           if (0 != mask)
+           {
+                if (!is_count)
+                {
+                     return (i + __builtin_ctz(mask));
+                }
+                found += __builtin_popcount(mask);
+           }
+      }
+
+      return (found + ScanScalar((const char *)elements, i, size,
+                                 sizeof(key), &key, is_count));
+}
+
+static size_t Scan64Sse2(const unsigned long *elements, size_t size,
+                         unsigned long key, int is_count)
+{
+      __m128i keys = _mm_set1_epi64x((long)key);
+      __m128i halves;
+      size_t found = 0;
+      size_t i = 0;
+      int mask = 0;
+
+      for (i = 0; i + 2 <= size; i += 2)
+      {
+           /* SSE2 has no 64 bit compare - a lane matches when both of its
+              32 bit halves do */
+           halves = _mm_cmpeq_epi32(
+                      _mm_loadu_si128((const __m128i *)(elements + i)), keys);
+           halves = _mm_and_si128(halves,
+                      _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+           mask = _mm_movemask_pd(_mm_castsi128_pd(halves));
+           if (0 != mask)
+           {
+                if (!is_count)
+                {
+                     return (i + __builtin_ctz(mask));
+                }
+                found += __builtin_popcount(mask);
+           }
+      }
+
+      return (found + ScanScalar((const char *)elements, i, size,
+                                 sizeof(key), &key, is_count));
+}
+
+__attribute__((target("avx2")))
+static size_t Scan32Avx2(const unsigned int *elements, size_t size,
+                         unsigned int key, int is_count)
+{
+      __m256i keys = _mm256_set1_epi32((int)key);
+      size_t found = 0;
+      size_t i = 0;
+      int mask = 0;
+
+      for (i = 0; i + 8 <= size; i += 8)
+      {
+           mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                   _mm256_loadu_si256((const __m256i *)(elements + i)), keys)));
+           if (0 != mask)
+           {
+                if (!is_count)
+                {
+                     return (i + __builtin_ctz(mask));
+                }
+                found += __builtin_popcount(mask);
+           }
+      }
+
+      return (found + ScanScalar((const char *)elements, i, size,
+                                 sizeof(key), &key, is_count));
+}
+
+__attribute__((target("avx2")))
+static size_t Scan64Avx2(const unsigned long *elements, size_t size,
+                         unsigned long key, int is_count)
+{
+      __m256i keys = _mm256_set1_epi64x((long)key);
+      size_t found = 0;
+      size_t i = 0;
+      int mask = 0;
+
+      for (i = 0; i + 4 <= size; i += 4)
+      {
+           mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(
+                   _mm256_loadu_si256((const __m256i *)(elements + i)), keys)));
+           if (0 != mask)
+           {
+                if (!is_count)
+                {
+                     return (i + __builtin_ctz(mask));
+                }
+                found += __builtin_popcount(mask);
+           }
+      }
+
+      return (found + ScanScalar((const char *)elements, i, size,
+                                 sizeof(key), &key, is_count));
+}
+#endif /* DVECTOR_SIMD */
+
+/*********************************** Sort *************************************/
+
+/* LSD radix sort on 8 bit digits, passes where every key has the same digit
+   are skipped */
+static int RadixSort(dvector_t *dvector)
+{
+      size_t counts[RADIX_BUCKETS];
+      size_t size = dvector->element_size;
+      char *from = dvector->elements;
+      char *to = NULL;
+      char *tmp = NULL;
+      size_t shift = 0;
+      size_t digit = 0;
+      size_t offset = 0;
+      size_t i = 0;
+
+      if (dvector->size < INSERTION_SORT_LIMIT)
+      {
+           InsertionSort(from, dvector->size, size, NULL);
            return SUCCESS;
       }
+
+      to = malloc(dvector->size * size);
+      if (NULL == to)
+      {
+           return FAILURE;
+      }
+
+      for (shift = 0; shift < size * 8; shift += RADIX_BITS)
+      {
+           memset(counts, 0, sizeof(counts));
+           for (i = 0; i < dvector->size; ++i)
+           {
+                ++counts[(LoadKey(from + i * size, size) >> shift) &
+                                                         (RADIX_BUCKETS - 1)];
+           }
+           digit = (LoadKey(from, size) >> shift) & (RADIX_BUCKETS - 1);
+           if (counts[digit] == dvector->size)
+           {
+                continue;
+           }
+
+           for (offset = 0, digit = 0; digit < RADIX_BUCKETS; ++digit)
+           {
+                i = counts[digit];
+                counts[digit] = offset;
+                offset += i;
+           }
+           for (i = 0; i < dvector->size; ++i)
+           {
+                digit = (LoadKey(from + i * size, size) >> shift) &
+                                                          (RADIX_BUCKETS - 1);
+                memcpy(to + counts[digit] * size, from + i * size, size);
+                ++counts[digit];
+           }
+           tmp = from;
+           from = to;
+           to = tmp;
+      }
+
+      if (from != dvector->elements)
+      {
+           memcpy(dvector->elements, from, dvector->size * size);
+           to = from;
+      }
+      free(to);
+
+      return SUCCESS;
+}
+
+static unsigned long LoadKey(const char *element, size_t element_size)
+{
+      unsigned int key32 = 0;
+      unsigned long key64 = 0;
+
+      if (sizeof(key32) == element_size)
+      {
+           memcpy(&key32, element, sizeof(key32));
+           return key32;
+      }
+      memcpy(&key64, element, sizeof(key64));
+
+      return key64;
+}
+
+static int CompareUnsigned(const void *lhs, const void *rhs, size_t size)
+{
+      unsigned long left = LoadKey(lhs, size);
+      unsigned long right = LoadKey(rhs, size);
+
+      return ((left > right) - (left < right));
+}
+
+static int Compare(const void *lhs, const void *rhs, size_t size,
+                   dvector_cmp_func_t cmp)
+{
+      return (NULL == cmp ? CompareUnsigned(lhs, rhs, size) : cmp(lhs, rhs));
+}
+
+/* quicksort that switches to heapsort past depth_limit, so the worst case
+   stays O(nlogn), and leaves short ranges to insertion sort */
+static void IntroSort(char *base, size_t count, size_t size,
+                      dvector_cmp_func_t cmp, size_t depth_limit)
+{
+      size_t pivot = 0;
+
+      while (count > INSERTION_SORT_LIMIT)
+      {
+           if (0 == depth_limit)
+           {
+                HeapSort(base, count, size, cmp);
+                return;
+           }
+           --depth_limit;
+
+           pivot = Partition(base, count, size, cmp);
+
+           /* recurse into the smaller side, loop on the larger one */
+           if (pivot < count - pivot - 1)
+           {
+                IntroSort(base, pivot, size, cmp, depth_limit);
+                base += (pivot + 1) * size;
+                count -= pivot + 1;
+           }
+           else
+           {
+                IntroSort(base + (pivot + 1) * size, count - pivot - 1, size,
+                          cmp, depth_limit);
+                count = pivot;
+           }
+      }
+
+      InsertionSort(base, count, size, cmp);
+}
+
+/* median of three moved to the front, then both sides stop on keys equal
+   to the pivot so runs of equal keys split evenly */
+static size_t Partition(char *base, size_t count, size_t size,
+                        dvector_cmp_func_t cmp)
+{
+      char *mid = base + (count / 2) * size;
+      char *last = base + (count - 1) * size;
+      size_t i = 0;
+      size_t j = count;
+
+      if (Compare(mid, base, size, cmp) < 0)
+      {
+           SwapBytes(mid, base, size);
+      }
+      if (Compare(last, mid, size, cmp) < 0)
+      {
+           SwapBytes(last, mid, size);
+           if (Compare(mid, base, size, cmp) < 0)
+           {
+                SwapBytes(mid, base, size);
+           }
+      }
+      SwapBytes(base, mid, size);
+
+      while (1)
+      {
+           do
+           {
+                ++i;
+           } while (i < count - 1 && Compare(base + i * size, base, size, cmp) < 0);
+           do
+           {
+                --j;
+           } while (Compare(base, base + j * size, size, cmp) < 0);
+
+           if (i >= j)
+           {
+                break;
+           }
+           SwapBytes(base + i * size, base + j * size, size);
+      }
+      SwapBytes(base, base + j * size, size);
+
+      return j;
+}
+
+static void InsertionSort(char *base, size_t count, size_t size,
+                          dvector_cmp_func_t cmp)
+{
+      size_t i = 0;
+      size_t j = 0;
+
+      for (i = 1; i < count; ++i)
+      {
+           for (j = i; j > 0 &&
+                Compare(base + j * size, base + (j - 1) * size, size, cmp) < 0; --j)
+           {
+                SwapBytes(base + j * size, base + (j - 1) * size, size);
+           }
+      }
+}
+
+static void HeapSort(char *base, size_t count, size_t size,
+                     dvector_cmp_func_t cmp)
+{
+      size_t i = 0;
+
+      for (i = count / 2; i > 0; --i)
+      {
+           SiftDown(base, i - 1, count, size, cmp);
+      }
+      for (i = count - 1; i > 0; --i)
+      {
+           SwapBytes(base, base + i * size, size);
+           SiftDown(base, 0, i, size, cmp);
+      }
+}
+
+static void SiftDown(char *base, size_t root, size_t count, size_t size,
+                     dvector_cmp_func_t cmp)
+{
+      size_t child = 0;
+
+      while ((child = 2 * root + 1) < count)
+      {
+           if (child + 1 < count &&
+               Compare(base + child * size, base + (child + 1) * size, size, cmp) < 0)
+           {
+                ++child;
+           }
+           if (Compare(base + root * size, base + child * size, size, cmp) >= 0)
+           {
+                return;
+           }
+           SwapBytes(base + root * size, base + child * size, size);
+           root = child;
+      }
+}
+
+static void SwapBytes(char *lhs, char *rhs, size_t size)
+{
+      unsigned long word = 0;
+      char tmp = 0;
+
+      /* a word at a time while it fits, memcpy keeps unaligned
+         elements safe */
+      for (; size >= sizeof(word); size -= sizeof(word))
+      {
+           memcpy(&word, lhs, sizeof(word));
+           memcpy(lhs, rhs, sizeof(word));
+           memcpy(rhs, &word, sizeof(word));
+           lhs += sizeof(word);
+           rhs += sizeof(word);
+      }
+      while (0 < size--)
+      {
+           tmp = *lhs;
+           *lhs++ = *rhs;
+           *rhs++ = tmp;
+      }
 }
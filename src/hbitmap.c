@@ -0,0 +1,447 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+
+#include "hbitmap.h" /* hbitmap_t */
+
+#define WORD_BITS (sizeof(unsigned long) * 8)
+#define WORD_SHIFT (6)
+#define WORD_MASK (WORD_BITS - 1)
+#define ALL_ONES (~0UL)
+/* 64^6 bits is more than any address space this is used for */
+#define MAX_LEVELS (6)
+#define WORDS_FOR(bits) (((bits) + WORD_MASK) >> WORD_SHIFT)
+
+/* level 0 holds the bits themselves, bit i of level k + 1 is set when
+   word i of level k is all ones. The last level is a single word.
+   Padding bits past the end of every level are kept set, so they look
+   taken and are never returned */
+struct hbitmap
+{
+    size_t num_bits;
+    size_t count_set;
+    size_t num_levels;
+    size_t level_bits[MAX_LEVELS];
+    unsigned long *levels[MAX_LEVELS];
+};
+
+static void SetPadding(unsigned long *words, size_t bits);
+static void ChangeRange(hbitmap_t *hbitmap, size_t from, size_t to, int set);
+static void UpdateSummaries(hbitmap_t *hbitmap, size_t first, size_t last);
+
+hbitmap_t *HBitmapCreate(size_t num_bits)
+{
+    hbitmap_t *hbitmap = NULL;
+    unsigned long *words = NULL;
+    size_t total_words = 0;
+    size_t bits = num_bits;
+    size_t level = 0;
+
+    assert(0 != num_bits);
+    assert(WORD_BITS == ((size_t)1 << WORD_SHIFT));
+
+    hbitmap = (hbitmap_t *)malloc(sizeof(hbitmap_t));
+    if (NULL == hbitmap)
+    {
+        return NULL;
+    }
+
+    hbitmap->num_bits = num_bits;
+    hbitmap->count_set = 0;
+    hbitmap->num_levels = 0;
+    do
+    {
+        assert(MAX_LEVELS > hbitmap->num_levels);
+        hbitmap->level_bits[hbitmap->num_levels] = bits;
+        ++hbitmap->num_levels;
+        total_words += WORDS_FOR(bits);
+        bits = WORDS_FOR(bits);
+    }
+    while (1 < bits);
+
+    /* all the levels in one block */
+    words = (unsigned long *)calloc(total_words, sizeof(unsigned long));
+    if (NULL == words)
+    {
+        free(hbitmap);
+        return NULL;
+    }
+
+    for (level = 0; level < hbitmap->num_levels; ++level)
+    {
+        hbitmap->levels[level] = words;
+        SetPadding(words, hbitmap->level_bits[level]);
+        words += WORDS_FOR(hbitmap->level_bits[level]);
+    }
+
+    return hbitmap;
+}
+
+void HBitmapDestroy(hbitmap_t *hbitmap)
+{
+    assert(NULL != hbitmap);
+
+    free(hbitmap->levels[0]);
+    free(hbitmap);
+}
+
+int HBitmapSet(hbitmap_t *hbitmap, size_t idx)
+{
+    unsigned long *word = NULL;
+    unsigned long bit = 0;
+    size_t level = 0;
+
+    assert(NULL != hbitmap);
+    assert(idx < hbitmap->num_bits);
+
+    word = &hbitmap->levels[0][idx >> WORD_SHIFT];
+    bit = 1UL << (idx & WORD_MASK);
+    if (*word & bit)
+    {
+        return 1;
+    }
+    ++hbitmap->count_set;
+
+    /* a word that fills up sets its summary bit, which may fill the
+       summary word in turn */
+    for (level = 0; level < hbitmap->num_levels; ++level)
+    {
+        word = &hbitmap->levels[level][idx >> WORD_SHIFT];
+        *word |= 1UL << (idx & WORD_MASK);
+        if (ALL_ONES != *word)
+        {
+            break;
+        }
+        idx >>= WORD_SHIFT;
+    }
+
+    return 0;
+}
+
+int HBitmapClear(hbitmap_t *hbitmap, size_t idx)
+{
+    unsigned long *word = NULL;
+    unsigned long was = 0;
+    size_t level = 0;
+
+    assert(NULL != hbitmap);
+    assert(idx < hbitmap->num_bits);
+
+    if (!HBitmapTest(hbitmap, idx))
+    {
+        return 0;
+    }
+    --hbitmap->count_set;
+
+    /* a full word that loses a bit clears its summary bit */
+    for (level = 0; level < hbitmap->num_levels; ++level)
+    {
+        word = &hbitmap->levels[level][idx >> WORD_SHIFT];
+        was = *word;
+        *word &= ~(1UL << (idx & WORD_MASK));
+        if (ALL_ONES != was)
+        {
+            break;
+        }
+        idx >>= WORD_SHIFT;
+    }
+
+    return 1;
+}
+
+void HBitmapSetRange(hbitmap_t *hbitmap, size_t from, size_t to)
+{
+    ChangeRange(hbitmap, from, to, 1);
+}
+
+/* the summaries change only when the word becomes full */
+void HBitmapOrWord(hbitmap_t *hbitmap, size_t word, unsigned long bits)
+{
+    unsigned long was = 0;
+
+    assert(NULL != hbitmap);
+    assert(word < WORDS_FOR(hbitmap->num_bits));
+
+    was = hbitmap->levels[0][word];
+    hbitmap->levels[0][word] |= bits;
+    hbitmap->count_set += __builtin_popcountl(bits & ~was);
+    if (ALL_ONES == hbitmap->levels[0][word] && ALL_ONES != was)
+    {
+        UpdateSummaries(hbitmap, word, word);
+    }
+}
+
+void HBitmapClearRange(hbitmap_t *hbitmap, size_t from, size_t to)
+{
+    ChangeRange(hbitmap, from, to, 0);
+}
+
+int HBitmapTest(const hbitmap_t *hbitmap, size_t idx)
+{
+    assert(NULL != hbitmap);
+    assert(idx < hbitmap->num_bits);
+
+    return (0 != (hbitmap->levels[0][idx >> WORD_SHIFT] &
+                  (1UL << (idx & WORD_MASK))));
+}
+
+size_t HBitmapFindClear(const hbitmap_t *hbitmap, size_t from)
+{
+    unsigned long free_bits = 0;
+    size_t level = 0;
+    size_t idx = from;
+
+    assert(NULL != hbitmap);
+
+    if (from >= hbitmap->num_bits)
+    {
+        return hbitmap->num_bits;
+    }
+
+    /* climb until a word has a clear bit at or after idx. Past the first
+       word only whole words are left, so idx moves to the next word */
+    while (1)
+    {
+        free_bits = ~hbitmap->levels[level][idx >> WORD_SHIFT] &
+                    (ALL_ONES << (idx & WORD_MASK));
+        if (0 != free_bits)
+        {
+            idx = (idx & ~WORD_MASK) + __builtin_ctzl(free_bits);
+            break;
+        }
+
+        idx = (idx >> WORD_SHIFT) + 1;
+        ++level;
+        if (level == hbitmap->num_levels || idx >= hbitmap->level_bits[level])
+        {
+            return hbitmap->num_bits;
+        }
+    }
+
+    /* a clear summary bit means a word below with a clear bit */
+    while (0 < level)
+    {
+        --level;
+        idx = (idx << WORD_SHIFT) +
+              __builtin_ctzl(~hbitmap->levels[level][idx]);
+    }
+
+    return idx;
+}
+
+size_t HBitmapFindSet(const hbitmap_t *hbitmap, size_t from, size_t to)
+{
+    const unsigned long *words = NULL;
+    unsigned long set_bits = 0;
+    size_t idx = 0;
+    size_t found = 0;
+
+    assert(NULL != hbitmap);
+    assert(to <= hbitmap->num_bits);
+
+    if (from >= to)
+    {
+        return to;
+    }
+
+    /* summaries only tell about full words, so this is a plain scan */
+    words = hbitmap->levels[0];
+    idx = from >> WORD_SHIFT;
+    set_bits = words[idx] & (ALL_ONES << (from & WORD_MASK));
+    while (0 == set_bits)
+    {
+        ++idx;
+        if (idx > (to - 1) >> WORD_SHIFT)
+        {
+            return to;
+        }
+        set_bits = words[idx];
+    }
+
+    found = (idx << WORD_SHIFT) + __builtin_ctzl(set_bits);
+
+    return ((found < to) ? found : to);
+}
+
+size_t HBitmapFindNthClear(const hbitmap_t *hbitmap, size_t n)
+{
+    const unsigned long *words = NULL;
+    unsigned long free_bits = 0;
+    size_t free_in_word = 0;
+    size_t idx = 0;
+
+    assert(NULL != hbitmap);
+
+    if (n >= hbitmap->num_bits - hbitmap->count_set)
+    {
+        return hbitmap->num_bits;
+    }
+
+    /* whole words are skipped by popcount, padding bits count as set */
+    words = hbitmap->levels[0];
+    while (1)
+    {
+        free_bits = ~words[idx];
+        free_in_word = __builtin_popcountl(free_bits);
+        if (n < free_in_word)
+        {
+            break;
+        }
+        n -= free_in_word;
+        ++idx;
+    }
+
+    /* drop the n lowest clear bits of the word */
+    for (; 0 < n; --n)
+    {
+        free_bits &= free_bits - 1;
+    }
+
+    return ((idx << WORD_SHIFT) + __builtin_ctzl(free_bits));
+}
+
+size_t HBitmapCountSetRange(const hbitmap_t *hbitmap, size_t from, size_t to)
+{
+    const unsigned long *words = NULL;
+    unsigned long first_mask = 0;
+    unsigned long last_mask = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t count = 0;
+
+    assert(NULL != hbitmap);
+    assert(to <= hbitmap->num_bits);
+
+    if (from >= to)
+    {
+        return 0;
+    }
+
+    words = hbitmap->levels[0];
+    first = from >> WORD_SHIFT;
+    last = (to - 1) >> WORD_SHIFT;
+    first_mask = ALL_ONES << (from & WORD_MASK);
+    last_mask = ALL_ONES >> (WORD_MASK - ((to - 1) & WORD_MASK));
+
+    if (first == last)
+    {
+        return __builtin_popcountl(words[first] & first_mask & last_mask);
+    }
+
+    count = __builtin_popcountl(words[first] & first_mask);
+    for (++first; first < last; ++first)
+    {
+        count += __builtin_popcountl(words[first]);
+    }
+
+    return (count + __builtin_popcountl(words[last] & last_mask));
+}
+
+size_t HBitmapCountSet(const hbitmap_t *hbitmap)
+{
+    assert(NULL != hbitmap);
+
+    return hbitmap->count_set;
+}
+
+size_t HBitmapSize(const hbitmap_t *hbitmap)
+{
+    assert(NULL != hbitmap);
+
+    return hbitmap->num_bits;
+}
+
+/******************************************************************************/
+
+static void SetPadding(unsigned long *words, size_t bits)
+{
+    if (0 != (bits & WORD_MASK))
+    {
+        words[bits >> WORD_SHIFT] = ALL_ONES << (bits & WORD_MASK);
+    }
+}
+
+/* whole words at a time, then the summary bits of the words touched */
+static void ChangeRange(hbitmap_t *hbitmap, size_t from, size_t to, int set)
+{
+    unsigned long *words = NULL;
+    unsigned long mask = 0;
+    unsigned long was = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t idx = 0;
+
+    assert(NULL != hbitmap);
+    assert(to <= hbitmap->num_bits);
+
+    if (from >= to)
+    {
+        return;
+    }
+
+    words = hbitmap->levels[0];
+    first = from >> WORD_SHIFT;
+    last = (to - 1) >> WORD_SHIFT;
+    for (idx = first; idx <= last; ++idx)
+    {
+        mask = ALL_ONES;
+        if (idx == first)
+        {
+            mask &= ALL_ONES << (from & WORD_MASK);
+        }
+        if (idx == last)
+        {
+            mask &= ALL_ONES >> (WORD_MASK - ((to - 1) & WORD_MASK));
+        }
+
+        was = words[idx];
+        if (set)
+        {
+            words[idx] |= mask;
+            hbitmap->count_set += __builtin_popcountl(words[idx] & ~was);
+        }
+        else
+        {
+            words[idx] &= ~mask;
+            hbitmap->count_set -= __builtin_popcountl(was & ~words[idx]);
+        }
+    }
+
+    UpdateSummaries(hbitmap, first, last);
+}
+
+/* recomputes the summary bits of words [first, last] of level 0, and
+   the levels above them */
+static void UpdateSummaries(hbitmap_t *hbitmap, size_t first, size_t last)
+{
+    unsigned long *summary = NULL;
+    unsigned long bit = 0;
+    size_t level = 0;
+    size_t idx = 0;
+
+    for (level = 0; level + 1 < hbitmap->num_levels; ++level)
+    {
+        for (idx = first; idx <= last; ++idx)
+        {
+            summary = &hbitmap->levels[level + 1][idx >> WORD_SHIFT];
+            bit = 1UL << (idx & WORD_MASK);
+            if (ALL_ONES == hbitmap->levels[level][idx])
+            {
+                *summary |= bit;
+            }
+            else
+            {
+                *summary &= ~bit;
+            }
+        }
+        first >>= WORD_SHIFT;
+        last >>= WORD_SHIFT;
+    }
+}
@@ -0,0 +1,144 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+
+#include "mpsc_queue.h" /* mpsc_queue_t */
+
+#define CACHE_LINE (64)
+
+/* producers exchange themselves into head, the consumer walks from tail.
+   The stub keeps the list non empty, so push never touches tail */
+struct mpsc_queue
+{
+    atomic_uintptr_t head;
+    char pad[CACHE_LINE - sizeof(atomic_uintptr_t)];
+    mpsc_link_t *tail;
+    mpsc_link_t stub;
+};
+
+static mpsc_link_t *NextOf(const mpsc_link_t *link);
+
+mpsc_queue_t *MPSCQueueCreate(void)
+{
+    mpsc_queue_t *queue = (mpsc_queue_t *)malloc(sizeof(mpsc_queue_t));
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    atomic_init(&queue->stub.next, 0);
+    atomic_init(&queue->head, (uintptr_t)&queue->stub);
+    queue->tail = &queue->stub;
+
+    return queue;
+}
+
+void MPSCQueueDestroy(mpsc_queue_t *queue)
+{
+    assert(NULL != queue);
+
+    free(queue);
+}
+
+void MPSCQueuePush(mpsc_queue_t *queue, mpsc_link_t *link)
+{
+    mpsc_link_t *prev = NULL;
+
+    assert(NULL != queue);
+    assert(NULL != link);
+
+    atomic_store_explicit(&link->next, 0, memory_order_relaxed);
+    prev = (mpsc_link_t *)atomic_exchange_explicit(&queue->head,
+                                        (uintptr_t)link, memory_order_acq_rel);
+    /* until this store the consumer cannot reach link or anything after it */
+    atomic_store_explicit(&prev->next, (uintptr_t)link, memory_order_release);
+}
+
+mpsc_link_t *MPSCQueuePop(mpsc_queue_t *queue)
+{
+    mpsc_link_t *tail = NULL;
+    mpsc_link_t *next = NULL;
+
+    assert(NULL != queue);
+
+    tail = queue->tail;
+    next = NextOf(tail);
+
+    /* step over the stub */
+    if (&queue->stub == tail)
+    {
+        if (NULL == next)
+        {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = NextOf(next);
+    }
+
+    if (NULL != next)
+    {
+        queue->tail = next;
+        return tail;
+    }
+
+    /* tail looks like the last link. If a producer already exchanged past
+       it, its store is in flight - report empty and let a later pop see it */
+    if ((uintptr_t)tail != atomic_load_explicit(&queue->head,
+                                                memory_order_acquire))
+    {
+        return NULL;
+    }
+
+    /* tail is the only link: put the stub behind it so it can be taken */
+    MPSCQueuePush(queue, &queue->stub);
+    next = NextOf(tail);
+    if (NULL != next)
+    {
+        queue->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+size_t MPSCQueuePopBatch(mpsc_queue_t *queue, mpsc_link_t *links[],
+                         size_t max)
+{
+    size_t count = 0;
+
+    assert(NULL != queue);
+    assert(NULL != links || 0 == max);
+
+    for (; count < max; ++count)
+    {
+        links[count] = MPSCQueuePop(queue);
+        if (NULL == links[count])
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+int MPSCQueueIsEmpty(const mpsc_queue_t *queue)
+{
+    assert(NULL != queue);
+
+    return (&queue->stub == queue->tail && NULL == NextOf(queue->tail));
+}
+
+/******************************************************************************/
+
+static mpsc_link_t *NextOf(const mpsc_link_t *link)
+{
+    return (mpsc_link_t *)atomic_load_explicit(
+               (atomic_uintptr_t *)&link->next, memory_order_acquire);
+}
@@ -0,0 +1,569 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+#include <stdint.h> /* uintptr_t */
+#include <stdatomic.h> /* atomic_uintptr_t */
+#include <pthread.h> /* pthread_mutex_t */
+
+#include "skiplist.h" /* skiplist_t */
+
+/* a node reaches level k with probability 4^-k: 16 levels keep searches
+   O(log n) up to 4^16 elements */
+#define MAX_LEVEL (16)
+#define SUCCESS (0)
+
+typedef struct skip_node skip_node_t;
+
+/* next[] is allocated to the node's height. prev is kept on level 0 only,
+   and links the retired nodes once the node is unlinked */
+struct skip_node
+{
+    void *data;
+    skip_node_t *prev;
+    size_t height;
+    atomic_uintptr_t next[1];
+};
+
+/* every next pointer is atomic so readers can walk while a writer links
+   and unlinks. The other fields are only touched under write_lock.
+   A read section counts itself in readers[epoch % 2]. Nodes removed in
+   this epoch wait in retired; waiting holds the ones removed before the
+   last epoch change, which only sections counted in the other slot can
+   still see */
+struct skiplist
+{
+    skip_node_t *head;
+    skip_node_t *last;
+    skiplist_cmp_func_t cmp;
+    int flags;
+    unsigned long seed;
+    atomic_size_t size;
+    atomic_size_t epoch;
+    atomic_size_t readers[2];
+    skip_node_t *retired;
+    skip_node_t *waiting;
+    pthread_mutex_t write_lock;
+};
+
+static skip_node_t *NodeCreate(void *data, size_t height);
+static skip_node_t *Next(const skip_node_t *node, size_t level);
+static void SetNext(skip_node_t *node, size_t level, skip_node_t *next);
+static skip_node_t *Search(const skiplist_t *list, const void *key,
+                           int is_upper, skip_node_t *preds[]);
+static int IsBefore(const skiplist_t *list, const void *data,
+                    const void *key, int is_upper);
+static size_t RandomHeight(skiplist_t *list);
+static skiplist_iter_t MakeIter(skip_node_t *node, const skiplist_t *list);
+static void WriteLock(skiplist_t *list);
+static void WriteUnlock(skiplist_t *list);
+static void Retire(skiplist_t *list, skip_node_t *node);
+static void Reclaim(skiplist_t *list);
+static void FreeChain(skip_node_t *node);
+
+skiplist_t *SkipListCreate(skiplist_cmp_func_t cmp, int flags)
+{
+    skiplist_t *list = NULL;
+
+    assert(cmp);
+
+    list = (skiplist_t *)malloc(sizeof(skiplist_t));
+    if (NULL == list)
+    {
+        return NULL;
+    }
+
+    list->head = NodeCreate(NULL, MAX_LEVEL);
+    if (NULL == list->head)
+    {
+        free(list);
+        return NULL;
+    }
+
+    if (0 != pthread_mutex_init(&list->write_lock, NULL))
+    {
+        free(list->head);
+        free(list);
+        return NULL;
+    }
+
+    list->last = NULL;
+    list->cmp = cmp;
+    list->flags = flags;
+    list->seed = 2463534242UL;
+    atomic_init(&list->size, 0);
+    atomic_init(&list->epoch, 0);
+    atomic_init(&list->readers[0], 0);
+    atomic_init(&list->readers[1], 0);
+    list->retired = NULL;
+    list->waiting = NULL;
+
+    return list;
+}
+
+void SkipListDestroy(skiplist_t *list)
+{
+    skip_node_t *node = NULL;
+    skip_node_t *next = NULL;
+
+    assert(NULL != list);
+
+    for (node = list->head; NULL != node; node = next)
+    {
+        next = Next(node, 0);
+        free(node);
+    }
+    FreeChain(list->retired);
+    FreeChain(list->waiting);
+    pthread_mutex_destroy(&list->write_lock);
+    free(list);
+}
+
+skiplist_iter_t SkipListInsert(skiplist_t *list, void *data)
+{
+    skip_node_t *preds[MAX_LEVEL];
+    skip_node_t *node = NULL;
+    skip_node_t *next = NULL;
+    size_t height = 0;
+    size_t level = 0;
+
+    assert(NULL != list);
+
+    WriteLock(list);
+
+    height = RandomHeight(list);
+    node = NodeCreate(data, height);
+    if (NULL == node)
+    {
+        WriteUnlock(list);
+        return SkipListEnd(list);
+    }
+
+    Search(list, data, 1, preds);
+
+    /* the node is complete before it is reachable, and it is linked bottom
+       up: a reader that finds it on some level finds it on the lower ones */
+    for (level = 0; level < height; ++level)
+    {
+        atomic_store_explicit(&node->next[level], (uintptr_t)Next(preds[level],
+                              level), memory_order_relaxed);
+    }
+    for (level = 0; level < height; ++level)
+    {
+        SetNext(preds[level], level, node);
+    }
+
+    node->prev = (list->head == preds[0]) ? NULL : preds[0];
+    next = Next(node, 0);
+    if (NULL == next)
+    {
+        list->last = node;
+    }
+    else
+    {
+        next->prev = node;
+    }
+    atomic_fetch_add_explicit(&list->size, 1, memory_order_relaxed);
+
+    WriteUnlock(list);
+
+    return MakeIter(node, list);
+}
+
+skiplist_iter_t SkipListRemove(skiplist_iter_t to_remove)
+{
+    skip_node_t *preds[MAX_LEVEL];
+    skiplist_t *list = to_remove.list;
+    skip_node_t *node = to_remove.node;
+    skip_node_t *next = NULL;
+    size_t level = 0;
+
+    assert(NULL != list);
+    assert(NULL != node);
+
+    WriteLock(list);
+
+    /* the predecessors of the first equal element, then step over the
+       equal elements inserted before this one */
+    Search(list, node->data, 0, preds);
+    for (level = 0; level < node->height; ++level)
+    {
+        while (node != Next(preds[level], level))
+        {
+            preds[level] = Next(preds[level], level);
+        }
+    }
+
+    /* top down, so the node stays reachable on the lower levels until it
+       is gone from the upper ones */
+    for (level = node->height; 0 < level; --level)
+    {
+        SetNext(preds[level - 1], level - 1, Next(node, level - 1));
+    }
+
+    next = Next(node, 0);
+    if (NULL == next)
+    {
+        list->last = node->prev;
+    }
+    else
+    {
+        next->prev = node->prev;
+    }
+    atomic_fetch_sub_explicit(&list->size, 1, memory_order_relaxed);
+
+    Retire(list, node);
+    WriteUnlock(list);
+
+    return MakeIter(next, list);
+}
+
+skiplist_iter_t SkipListFind(const skiplist_t *list, const void *key)
+{
+    skip_node_t *node = NULL;
+
+    assert(NULL != list);
+
+    node = Search(list, key, 0, NULL);
+    if (NULL != node && 0 != list->cmp(node->data, key))
+    {
+        node = NULL;
+    }
+
+    return MakeIter(node, list);
+}
+
+skiplist_iter_t SkipListLowerBound(const skiplist_t *list, const void *key)
+{
+    assert(NULL != list);
+
+    return MakeIter(Search(list, key, 0, NULL), list);
+}
+
+skiplist_iter_t SkipListUpperBound(const skiplist_t *list, const void *key)
+{
+    assert(NULL != list);
+
+    return MakeIter(Search(list, key, 1, NULL), list);
+}
+
+skiplist_iter_t SkipListBegin(const skiplist_t *list)
+{
+    assert(NULL != list);
+
+    return MakeIter(Next(list->head, 0), list);
+}
+
+skiplist_iter_t SkipListEnd(const skiplist_t *list)
+{
+    assert(NULL != list);
+
+    return MakeIter(NULL, list);
+}
+
+skiplist_iter_t SkipListNext(skiplist_iter_t iter)
+{
+    assert(NULL != iter.node);
+
+    return MakeIter(Next(iter.node, 0), iter.list);
+}
+
+skiplist_iter_t SkipListPrev(skiplist_iter_t iter)
+{
+    if (NULL == iter.node)
+    {
+        return MakeIter(iter.list->last, iter.list);
+    }
+    assert(NULL != iter.node->prev);
+
+    return MakeIter(iter.node->prev, iter.list);
+}
+
+int SkipListIsIterSame(skiplist_iter_t iter1, skiplist_iter_t iter2)
+{
+    return (iter1.node == iter2.node);
+}
+
+void *SkipListGetData(skiplist_iter_t iter)
+{
+    assert(NULL != iter.node);
+
+    return (iter.node->data);
+}
+
+int SkipListForEach(skiplist_iter_t from, skiplist_iter_t to,
+                    skiplist_action_func_t action, void *param)
+{
+    skip_node_t *node = from.node;
+    int result = SUCCESS;
+
+    assert(action);
+
+    for (; node != to.node && SUCCESS == result; node = Next(node, 0))
+    {
+        result = action(node->data, param);
+    }
+
+    return (result);
+}
+
+void *SkipListPopFront(skiplist_t *list)
+{
+    skiplist_iter_t first = SkipListBegin(list);
+    void *data = SkipListGetData(first);
+
+    SkipListRemove(first);
+
+    return (data);
+}
+
+size_t SkipListSize(const skiplist_t *list)
+{
+    assert(NULL != list);
+
+    return atomic_load_explicit((atomic_size_t *)&list->size,
+                                memory_order_relaxed);
+}
+
+int SkipListIsEmpty(const skiplist_t *list)
+{
+    assert(NULL != list);
+
+    return (NULL == Next(list->head, 0));
+}
+
+skiplist_read_t SkipListReadBegin(skiplist_t *list)
+{
+    size_t epoch = 0;
+    skiplist_read_t section = 0;
+
+    assert(NULL != list);
+    assert(SKIPLIST_CONCURRENT_READS & list->flags);
+
+    /* pairs with the fences in Reclaim: either that write sees this
+       section counted, or the epoch moved on and the section counts
+       itself again in the new slot */
+    while (1)
+    {
+        epoch = atomic_load(&list->epoch);
+        section = (skiplist_read_t)(epoch % 2);
+        atomic_fetch_add(&list->readers[section], 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (epoch == atomic_load(&list->epoch))
+        {
+            return section;
+        }
+        atomic_fetch_sub_explicit(&list->readers[section], 1,
+                                  memory_order_release);
+    }
+}
+
+/* the last section of the old slot frees what it held back, unless a
+   write has the lock - that write does it on its way out */
+void SkipListReadEnd(skiplist_t *list, skiplist_read_t section)
+{
+    assert(NULL != list);
+    assert(2 > section);
+
+    if (1 == atomic_fetch_sub_explicit(&list->readers[section], 1,
+                                       memory_order_release) &&
+        section != atomic_load_explicit(&list->epoch,
+                                        memory_order_relaxed) % 2 &&
+        0 == pthread_mutex_trylock(&list->write_lock))
+    {
+        Reclaim(list);
+        pthread_mutex_unlock(&list->write_lock);
+    }
+}
+
+/******************************************************************************/
+
+static skip_node_t *NodeCreate(void *data, size_t height)
+{
+    skip_node_t *node = NULL;
+    size_t level = 0;
+
+    node = (skip_node_t *)malloc(sizeof(skip_node_t) +
+                                 (height - 1) * sizeof(atomic_uintptr_t));
+    if (NULL == node)
+    {
+        return NULL;
+    }
+
+    node->data = data;
+    node->prev = NULL;
+    node->height = height;
+    for (level = 0; level < height; ++level)
+    {
+        atomic_init(&node->next[level], 0);
+    }
+
+    return node;
+}
+
+static skip_node_t *Next(const skip_node_t *node, size_t level)
+{
+    return (skip_node_t *)atomic_load_explicit(
+               (atomic_uintptr_t *)&node->next[level], memory_order_acquire);
+}
+
+static void SetNext(skip_node_t *node, size_t level, skip_node_t *next)
+{
+    atomic_store_explicit(&node->next[level], (uintptr_t)next,
+                          memory_order_release);
+}
+
+/* returns the first node not before key (is_upper 0) or after key
+   (is_upper 1), and fills preds with the last node before it on each
+   level when preds is not NULL */
+static skip_node_t *Search(const skiplist_t *list, const void *key,
+                           int is_upper, skip_node_t *preds[])
+{
+    skip_node_t *node = list->head;
+    skip_node_t *next = NULL;
+    size_t level = MAX_LEVEL;
+
+    while (0 < level)
+    {
+        --level;
+        next = Next(node, level);
+        while (NULL != next && IsBefore(list, next->data, key, is_upper))
+        {
+            node = next;
+            next = Next(node, level);
+        }
+        if (NULL != preds)
+        {
+            preds[level] = node;
+        }
+    }
+
+    return (Next(node, 0));
+}
+
+/* with is_upper, elements equal to key count as before it */
+static int IsBefore(const skiplist_t *list, const void *data,
+                    const void *key, int is_upper)
+{
+    int order = list->cmp(data, key);
+
+    return (is_upper ? 0 >= order : 0 > order);
+}
+
+/* xorshift32, two bits per level for a 1/4 chance to go up */
+static size_t RandomHeight(skiplist_t *list)
+{
+    unsigned long bits = list->seed;
+    size_t height = 1;
+
+    bits ^= (bits << 13) & 0xFFFFFFFFUL;
+    bits ^= bits >> 17;
+    bits ^= (bits << 5) & 0xFFFFFFFFUL;
+    list->seed = bits;
+
+    while (height < MAX_LEVEL && 0 == (bits & 3))
+    {
+        ++height;
+        bits >>= 2;
+    }
+
+    return height;
+}
+
+static skiplist_iter_t MakeIter(skip_node_t *node, const skiplist_t *list)
+{
+    skiplist_iter_t iter;
+
+    iter.node = node;
+    iter.list = (skiplist_t *)list;
+
+    return (iter);
+}
+
+static void WriteLock(skiplist_t *list)
+{
+    if (SKIPLIST_CONCURRENT_READS & list->flags)
+    {
+        pthread_mutex_lock(&list->write_lock);
+    }
+}
+
+static void WriteUnlock(skiplist_t *list)
+{
+    if (SKIPLIST_CONCURRENT_READS & list->flags)
+    {
+        Reclaim(list);
+        pthread_mutex_unlock(&list->write_lock);
+    }
+}
+
+/* without concurrent readers the node goes at once. Otherwise it joins the
+   retired chain until Reclaim finds it safe */
+static void Retire(skiplist_t *list, skip_node_t *node)
+{
+    if (!(SKIPLIST_CONCURRENT_READS & list->flags))
+    {
+        free(node);
+        return;
+    }
+
+    node->prev = list->retired;
+    list->retired = node;
+}
+
+/* under write_lock. Once the old slot is empty no section can see the
+   waiting nodes, so they go, the retired ones start waiting and the epoch
+   moves on: sections that begin after it cannot reach them. If the old
+   slot is empty at once too, they go as well. Acquire pairs with the
+   release in SkipListReadEnd, so whatever a finished section read is done
+   before its nodes are freed */
+static void Reclaim(skiplist_t *list)
+{
+    size_t epoch = 0;
+
+    if (NULL == list->retired && NULL == list->waiting)
+    {
+        return;
+    }
+
+    epoch = atomic_load_explicit(&list->epoch, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (0 != atomic_load_explicit(&list->readers[(epoch + 1) % 2],
+                                  memory_order_acquire))
+    {
+        return;
+    }
+
+    FreeChain(list->waiting);
+    list->waiting = list->retired;
+    list->retired = NULL;
+    if (NULL == list->waiting)
+    {
+        return;
+    }
+
+    atomic_store(&list->epoch, epoch + 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (0 == atomic_load_explicit(&list->readers[epoch % 2],
+                                  memory_order_acquire))
+    {
+        FreeChain(list->waiting);
+        list->waiting = NULL;
+    }
+}
+
+static void FreeChain(skip_node_t *node)
+{
+    skip_node_t *prev = NULL;
+
+    for (; NULL != node; node = prev)
+    {
+        prev = node->prev;
+        free(node);
+    }
+}
@@ -0,0 +1,288 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memcpy */
+#include <assert.h> /* assert */
+
+#include "soa.h" /* soa_t */
+
+#define SUCCESS (0)
+#define FAILURE (-1)
+#define GROWTH_FACTOR (2)
+#define SCAN_BLOCK (64)
+
+typedef struct column
+{
+    size_t element_size;
+    char *elements;
+} column_t;
+
+struct soa
+{
+    size_t num_columns;
+    size_t size;
+    size_t capacity;
+    column_t columns[1];
+};
+
+static int ResizeColumns(soa_t *soa, size_t capacity);
+static size_t MarkLessBlock(const long *values, size_t count, long threshold,
+                            unsigned char marks[SCAN_BLOCK]);
+
+soa_t *SoaCreate(size_t num_columns, const size_t column_sizes[],
+                 size_t capacity)
+{
+    soa_t *soa = NULL;
+    size_t i = 0;
+
+    assert(0 != num_columns);
+    assert(NULL != column_sizes);
+    assert(0 != capacity);
+
+    soa = (soa_t *)malloc(sizeof(soa_t) + (num_columns - 1) * sizeof(column_t));
+    if (NULL == soa)
+    {
+        return NULL;
+    }
+
+    soa->num_columns = num_columns;
+    soa->size = 0;
+    soa->capacity = capacity;
+    for (i = 0; i < num_columns; ++i)
+    {
+        assert(0 != column_sizes[i]);
+        soa->columns[i].element_size = column_sizes[i];
+        soa->columns[i].elements = malloc(capacity * column_sizes[i]);
+        if (NULL == soa->columns[i].elements)
+        {
+            soa->num_columns = i;
+            SoaDestroy(soa);
+            return NULL;
+        }
+    }
+
+    return soa;
+}
+
+void SoaDestroy(soa_t *soa)
+{
+    size_t i = 0;
+
+    assert(NULL != soa);
+
+    for (i = 0; i < soa->num_columns; ++i)
+    {
+        free(soa->columns[i].elements);
+    }
+    free(soa);
+}
+
+int SoaPushBack(soa_t *soa, const void *const fields[])
+{
+    column_t *column = NULL;
+    size_t i = 0;
+
+    assert(NULL != soa);
+    assert(NULL != fields);
+
+    if (soa->size == soa->capacity &&
+        FAILURE == ResizeColumns(soa, soa->capacity * GROWTH_FACTOR))
+    {
+        return FAILURE;
+    }
+
+    for (i = 0; i < soa->num_columns; ++i)
+    {
+        column = &soa->columns[i];
+        memcpy(column->elements + soa->size * column->element_size, fields[i],
+               column->element_size);
+    }
+    ++soa->size;
+
+    return SUCCESS;
+}
+
+void SoaPopBack(soa_t *soa)
+{
+    assert(NULL != soa);
+    assert(0 < soa->size);
+
+    --soa->size;
+}
+
+void SoaSwapRemove(soa_t *soa, size_t idx)
+{
+    column_t *column = NULL;
+    size_t last = 0;
+    size_t i = 0;
+
+    assert(NULL != soa);
+    assert(idx < soa->size);
+
+    last = soa->size - 1;
+    if (idx != last)
+    {
+        for (i = 0; i < soa->num_columns; ++i)
+        {
+            column = &soa->columns[i];
+            memcpy(column->elements + idx * column->element_size,
+                   column->elements + last * column->element_size,
+                   column->element_size);
+        }
+    }
+    soa->size = last;
+}
+
+void *SoaGetColumn(const soa_t *soa, size_t column)
+{
+    assert(NULL != soa);
+    assert(column < soa->num_columns);
+
+    return soa->columns[column].elements;
+}
+
+void *SoaGetField(const soa_t *soa, size_t column, size_t idx)
+{
+    assert(NULL != soa);
+    assert(column < soa->num_columns);
+    assert(idx < soa->size);
+
+    return (soa->columns[column].elements +
+            idx * soa->columns[column].element_size);
+}
+
+size_t SoaSize(const soa_t *soa)
+{
+    assert(NULL != soa);
+
+    return soa->size;
+}
+
+size_t SoaCapacity(const soa_t *soa)
+{
+    assert(NULL != soa);
+
+    return soa->capacity;
+}
+
+int SoaReserve(soa_t *soa, size_t capacity)
+{
+    assert(NULL != soa);
+
+    if (capacity < soa->size)
+    {
+        capacity = soa->size;
+    }
+    if (0 == capacity)
+    {
+        capacity = 1;
+    }
+
+    return ResizeColumns(soa, capacity);
+}
+
+size_t SoaFilterLess(const soa_t *soa, size_t column, long threshold,
+                     size_t indices[])
+{
+    const long *values = NULL;
+    unsigned char marks[SCAN_BLOCK];
+    size_t found = 0;
+    size_t block = 0;
+    size_t count = 0;
+    size_t i = 0;
+
+    assert(NULL != soa);
+    assert(column < soa->num_columns);
+    assert(sizeof(long) == soa->columns[column].element_size);
+    assert(NULL != indices);
+
+    values = (const long *)soa->columns[column].elements;
+    for (block = 0; block < soa->size; block += SCAN_BLOCK)
+    {
+        count = soa->size - block < SCAN_BLOCK ? soa->size - block : SCAN_BLOCK;
+        if (0 == MarkLessBlock(values + block, count, threshold, marks))
+        {
+            continue;
+        }
+
+        /* branch-free compaction - every index is written, only the
+           matching ones advance the output */
+        for (i = 0; i < count; ++i)
+        {
+            indices[found] = block + i;
+            found += marks[i];
+        }
+    }
+
+    return found;
+}
+
+size_t SoaCountLess(const soa_t *soa, size_t column, long threshold)
+{
+    const long *values = NULL;
+    size_t found = 0;
+    size_t i = 0;
+
+    assert(NULL != soa);
+    assert(column < soa->num_columns);
+    assert(sizeof(long) == soa->columns[column].element_size);
+
+    values = (const long *)soa->columns[column].elements;
+    for (i = 0; i < soa->size; ++i)
+    {
+        found += (values[i] < threshold);
+    }
+
+    return found;
+}
+
+/******************************************************************************/
+
+static int ResizeColumns(soa_t *soa, size_t capacity)
+{
+    column_t *column = NULL;
+    char *tmp = NULL;
+    size_t i = 0;
+
+    /* a failure part way leaves the earlier columns larger than capacity,
+       which is harmless - capacity only grows once all of them did, and a
+       column that failed to shrink still holds every row */
+    for (i = 0; i < soa->num_columns; ++i)
+    {
+        column = &soa->columns[i];
+        tmp = realloc(column->elements, capacity * column->element_size);
+        if (NULL == tmp)
+        {
+            if (capacity > soa->capacity)
+            {
+                return FAILURE;
+            }
+            continue;
+        }
+        column->elements = tmp;
+    }
+    soa->capacity = capacity;
+
+    return SUCCESS;
+}
+
+/* no early exit and no branches, so the loop vectorizes */
+static size_t MarkLessBlock(const long *values, size_t count, long threshold,
+                            unsigned char marks[SCAN_BLOCK])
+{
+    size_t any = 0;
+    size_t i = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        marks[i] = (values[i] < threshold);
+        any |= marks[i];
+    }
+
+    return any;
+}
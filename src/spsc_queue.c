@@ -0,0 +1,163 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memcpy */
+#include <assert.h> /* assert */
+#include <stdatomic.h> /* atomic_size_t */
+
+#include "spsc_queue.h" /* spsc_queue_t */
+
+#define SUCCESS (0)
+#define FAILURE (-1)
+#define CACHE_LINE (64)
+
+/* head and tail count up forever and are masked on access, so
+   tail - head is the size even after they wrap around */
+struct spsc_queue
+{
+    /* consumer side */
+    atomic_size_t head;
+    size_t cached_tail;
+    char pad0[CACHE_LINE - sizeof(atomic_size_t) - sizeof(size_t)];
+
+    /* producer side */
+    atomic_size_t tail;
+    size_t cached_head;
+    char pad1[CACHE_LINE - sizeof(atomic_size_t) - sizeof(size_t)];
+
+    size_t mask;
+    size_t element_size;
+    char *buffer;
+};
+
+static size_t RoundUpPowerOfTwo(size_t value);
+
+spsc_queue_t *SPSCQueueCreate(size_t capacity, size_t element_size)
+{
+    spsc_queue_t *queue = NULL;
+
+    assert(0 != capacity);
+    assert(0 != element_size);
+
+    queue = (spsc_queue_t *)malloc(sizeof(spsc_queue_t));
+    if (NULL == queue)
+    {
+        return NULL;
+    }
+
+    capacity = RoundUpPowerOfTwo(capacity);
+    queue->buffer = (char *)malloc(capacity * element_size);
+    if (NULL == queue->buffer)
+    {
+        free(queue);
+        return NULL;
+    }
+
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    queue->cached_tail = 0;
+    queue->cached_head = 0;
+    queue->mask = capacity - 1;
+    queue->element_size = element_size;
+
+    return queue;
+}
+
+void SPSCQueueDestroy(spsc_queue_t *queue)
+{
+    assert(NULL != queue);
+
+    free(queue->buffer);
+    free(queue);
+}
+
+int SPSCQueueEnqueue(spsc_queue_t *queue, const void *data)
+{
+    size_t tail = 0;
+
+    assert(NULL != queue);
+    assert(NULL != data);
+
+    tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - queue->cached_head > queue->mask)
+    {
+        queue->cached_head = atomic_load_explicit(&queue->head,
+                                                  memory_order_acquire);
+        if (tail - queue->cached_head > queue->mask)
+        {
+            return FAILURE;
+        }
+    }
+
+    memcpy(queue->buffer + (tail & queue->mask) * queue->element_size, data,
+           queue->element_size);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+    return SUCCESS;
+}
+
+int SPSCQueueDequeue(spsc_queue_t *queue, void *data)
+{
+    size_t head = 0;
+
+    assert(NULL != queue);
+    assert(NULL != data);
+
+    head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == queue->cached_tail)
+    {
+        queue->cached_tail = atomic_load_explicit(&queue->tail,
+                                                  memory_order_acquire);
+        if (head == queue->cached_tail)
+        {
+            return FAILURE;
+        }
+    }
+
+    memcpy(data, queue->buffer + (head & queue->mask) * queue->element_size,
+           queue->element_size);
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+    return SUCCESS;
+}
+
+size_t SPSCQueueSize(const spsc_queue_t *queue)
+{
+    size_t head = 0;
+    size_t tail = 0;
+
+    assert(NULL != queue);
+
+    head = atomic_load_explicit((atomic_size_t *)&queue->head,
+                                memory_order_acquire);
+    tail = atomic_load_explicit((atomic_size_t *)&queue->tail,
+                                memory_order_acquire);
+
+    return (tail - head);
+}
+
+size_t SPSCQueueCapacity(const spsc_queue_t *queue)
+{
+    assert(NULL != queue);
+
+    return (queue->mask + 1);
+}
+
+/******************************************************************************/
+
+static size_t RoundUpPowerOfTwo(size_t value)
+{
+    size_t power = 1;
+
+    while (power < value)
+    {
+        power <<= 1;
+    }
+
+    return power;
+}
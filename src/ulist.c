@@ -0,0 +1,399 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg                    /
+Reviewer:                              /
+last date updated: 19/10/26            /
+File type: source file                 /
+//////////////////////////////////////*/
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memmove */
+#include <assert.h> /* assert */
+
+#include "ulist.h" /* ulist_t */
+
+/* 13 items, the count and two links fill exactly two cache lines */
+#define ITEMS_PER_NODE (13)
+#define MERGE_LIMIT ((ITEMS_PER_NODE * 3) / 4)
+
+typedef struct unode unode_t;
+
+struct unode
+{
+    void *items[ITEMS_PER_NODE];
+    unsigned int count;
+    unode_t *next;
+    unode_t *prev;
+};
+
+/* head and tail are empty sentinels, the end iterator is {tail, 0} */
+struct ulist
+{
+    unode_t head;
+    unode_t tail;
+    size_t count;
+};
+
+enum
+{
+    SUCCESS = 0,
+    FAILURE
+};
+
+static ulist_iter_t MakeIter(unode_t *node, size_t idx, const ulist_t *list);
+static unode_t *NodeCreate(unode_t *prev);
+static void NodeUnlink(unode_t *node);
+static void InsertAt(unode_t *node, size_t idx, void *data);
+static void MergeNext(unode_t *node);
+
+ulist_t *UListCreate(void)
+{
+    ulist_t *list = (ulist_t *)malloc(sizeof(ulist_t));
+    if (NULL == list)
+    {
+        return NULL;
+    }
+
+    list->head.count = 0;
+    list->head.prev = NULL;
+    list->head.next = &(list->tail);
+    list->tail.count = 0;
+    list->tail.prev = &(list->head);
+    list->tail.next = NULL;
+    list->count = 0;
+
+    return (list);
+}
+
+void UListDestroy(ulist_t *list)
+{
+    unode_t *current = NULL;
+    unode_t *next = NULL;
+
+    assert(NULL != list);
+
+    for (current = list->head.next; current != &(list->tail); current = next)
+    {
+        next = current->next;
+        free(current);
+    }
+    free(list);
+}
+
+ulist_iter_t UListBegin(const ulist_t *list)
+{
+    assert(NULL != list);
+
+    return MakeIter(list->head.next, 0, list);
+}
+
+ulist_iter_t UListEnd(const ulist_t *list)
+{
+    assert(NULL != list);
+
+    return MakeIter((unode_t *)&(list->tail), 0, list);
+}
+
+ulist_iter_t UListNext(ulist_iter_t iter)
+{
+    assert(NULL != iter.node);
+
+    if (iter.idx + 1 < iter.node->count)
+    {
+        ++iter.idx;
+        return (iter);
+    }
+
+    return MakeIter(iter.node->next, 0, iter.list);
+}
+
+ulist_iter_t UListPrev(ulist_iter_t iter)
+{
+    assert(NULL != iter.node);
+
+    if (0 < iter.idx)
+    {
+        --iter.idx;
+        return (iter);
+    }
+
+    assert(NULL != iter.node->prev->prev);
+
+    return MakeIter(iter.node->prev, iter.node->prev->count - 1, iter.list);
+}
+
+int UListIsIterSame(ulist_iter_t iter1, ulist_iter_t iter2)
+{
+    return (iter1.node == iter2.node && iter1.idx == iter2.idx);
+}
+
+ulist_iter_t UListInsert(ulist_iter_t where, void *data)
+{
+    unode_t *node = where.node;
+    unode_t *fresh = NULL;
+    size_t idx = where.idx;
+    size_t half = 0;
+
+    assert(NULL != node);
+    assert(NULL != data);
+
+    /* the end iterator appends to the last node */
+    if (&(where.list->tail) == node)
+    {
+        node = node->prev;
+        idx = node->count;
+    }
+
+    if (&(where.list->head) == node || ITEMS_PER_NODE == node->count)
+    {
+        fresh = NodeCreate(node);
+        if (NULL == fresh)
+        {
+            return UListEnd(where.list);
+        }
+
+        /* split a full node down the middle, unless appending past its
+           end where the fresh node simply takes the new item */
+        if (&(where.list->head) != node && idx < node->count)
+        {
+            half = node->count / 2;
+            fresh->count = node->count - half;
+            memcpy(fresh->items, node->items + half,
+                   fresh->count * sizeof(void *));
+            node->count = half;
+        }
+
+        if (&(where.list->head) == node || idx >= node->count)
+        {
+            idx -= node->count;
+            node = fresh;
+        }
+    }
+
+    InsertAt(node, idx, data);
+    ++where.list->count;
+
+    return MakeIter(node, idx, where.list);
+}
+
+ulist_iter_t UListRemove(ulist_iter_t to_remove)
+{
+    unode_t *node = to_remove.node;
+    size_t idx = to_remove.idx;
+
+    assert(NULL != node);
+    assert(idx < node->count);
+
+    --node->count;
+    memmove(node->items + idx, node->items + idx + 1,
+            (node->count - idx) * sizeof(void *));
+    --to_remove.list->count;
+
+    if (0 == node->count)
+    {
+        to_remove.node = node->next;
+        NodeUnlink(node);
+        return MakeIter(to_remove.node, 0, to_remove.list);
+    }
+
+    if (&(to_remove.list->tail) != node->next &&
+        node->count + node->next->count <= MERGE_LIMIT)
+    {
+        MergeNext(node);
+    }
+
+    if (idx < node->count)
+    {
+        return MakeIter(node, idx, to_remove.list);
+    }
+
+    return MakeIter(node->next, 0, to_remove.list);
+}
+
+void *UListGetData(ulist_iter_t iter)
+{
+    assert(NULL != iter.node);
+    assert(iter.idx < iter.node->count);
+
+    return (iter.node->items[iter.idx]);
+}
+
+void UListSetData(ulist_iter_t iter, void *data)
+{
+    assert(NULL != iter.node);
+    assert(iter.idx < iter.node->count);
+    assert(NULL != data);
+
+    iter.node->items[iter.idx] = data;
+}
+
+size_t UListCount(const ulist_t *list)
+{
+    assert(NULL != list);
+
+    return (list->count);
+}
+
+int UListIsEmpty(const ulist_t *list)
+{
+    assert(NULL != list);
+
+    return (0 == list->count);
+}
+
+ulist_iter_t UListFind(ulist_iter_t from, ulist_iter_t to,
+                       ulist_match_func_t is_match, void *param)
+{
+    unode_t *node = from.node;
+    size_t idx = from.idx;
+    size_t last = 0;
+
+    assert(NULL != node);
+    assert(NULL != to.node);
+    assert(is_match);
+
+    /* a node at a time - the inner loop stays within one node's array */
+    while (node != to.node)
+    {
+        for (; idx < node->count; ++idx)
+        {
+            if (is_match(node->items[idx], param))
+            {
+                return MakeIter(node, idx, from.list);
+            }
+        }
+        node = node->next;
+        idx = 0;
+    }
+
+    for (last = to.idx; idx < last; ++idx)
+    {
+        if (is_match(node->items[idx], param))
+        {
+            return MakeIter(node, idx, from.list);
+        }
+    }
+
+    return (to);
+}
+
+int UListForEach(ulist_iter_t from, ulist_iter_t to,
+                 ulist_action_func_t action, void *param)
+{
+    unode_t *node = from.node;
+    size_t idx = from.idx;
+    size_t last = 0;
+    int result = SUCCESS;
+
+    assert(NULL != node);
+    assert(NULL != to.node);
+    assert(action);
+
+    while (SUCCESS == result)
+    {
+        last = (node == to.node) ? to.idx : node->count;
+        for (; idx < last && SUCCESS == result; ++idx)
+        {
+            result = action(node->items[idx], param);
+        }
+        if (node == to.node)
+        {
+            break;
+        }
+        node = node->next;
+        idx = 0;
+    }
+
+    return (result);
+}
+
+ulist_iter_t UListPushBack(ulist_t *list, void *data)
+{
+    assert(list);
+    assert(data);
+
+    return UListInsert(UListEnd(list), data);
+}
+
+void *UListPopBack(ulist_t *list)
+{
+    ulist_iter_t last = UListPrev(UListEnd(list));
+    void *data = UListGetData(last);
+
+    UListRemove(last);
+
+    return (data);
+}
+
+ulist_iter_t UListPushFront(ulist_t *list, void *data)
+{
+    assert(list);
+    assert(data);
+
+    return UListInsert(UListBegin(list), data);
+}
+
+void *UListPopFront(ulist_t *list)
+{
+    ulist_iter_t first = UListBegin(list);
+    void *data = UListGetData(first);
+
+    UListRemove(first);
+
+    return (data);
+}
+
+/******************************************************************************/
+
+static ulist_iter_t MakeIter(unode_t *node, size_t idx, const ulist_t *list)
+{
+    ulist_iter_t iter;
+
+    iter.node = node;
+    iter.idx = idx;
+    iter.list = (ulist_t *)list;
+
+    return (iter);
+}
+
+/* creates an empty node linked after prev */
+static unode_t *NodeCreate(unode_t *prev)
+{
+    unode_t *node = (unode_t *)malloc(sizeof(unode_t));
+    if (NULL == node)
+    {
+        return NULL;
+    }
+
+    node->count = 0;
+    node->prev = prev;
+    node->next = prev->next;
+    prev->next->prev = node;
+    prev->next = node;
+
+    return (node);
+}
+
+static void NodeUnlink(unode_t *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    free(node);
+}
+
+static void InsertAt(unode_t *node, size_t idx, void *data)
+{
+    memmove(node->items + idx + 1, node->items + idx,
+            (node->count - idx) * sizeof(void *));
+    node->items[idx] = data;
+    ++node->count;
+}
+
+static void MergeNext(unode_t *node)
+{
+    unode_t *next = node->next;
+
+    memcpy(node->items + node->count, next->items,
+           next->count * sizeof(void *));
+    node->count += next->count;
+    NodeUnlink(next);
+}
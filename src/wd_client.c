@@ -8,7 +8,7 @@ Last Modefy Date: 19/21/24
 /*
 compile with:
 make TARGET=wd_client
-gd -pthread wd.c wd_client.c scheduler.c dhcp.c dlist.c dvector.c heap.c pq_heap.c task.c uid.c -I../inc -lm -o wd.out
+gcc -pthread wd.c wd_client.c scheduler.c dvector.c heap.c pq_heap.c task.c uid.c -I../inc -lm -o wd.out
 */
 
 #define _POSIX_C_SOURCE 200809L /*for sigaction related cpmmands*/
@@ -0,0 +1,405 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread cbitmap_test.c ../src/cbitmap.c -I../inc -o cbitmap.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <pthread.h> /* pthread_create */
+
+#include "cbitmap.h" /* cbitmap_t */
+
+#define WORD_BITS (64)
+#define HINT_BITS (WORD_BITS * WORD_BITS)
+#define RANDOM_OPS (3000)
+#define MAX_THREADS (8)
+#define THREAD_BITS (1 << 16)
+#define THREAD_ROUNDS (8)
+
+typedef struct claimer
+{
+    cbitmap_t *cbitmap;
+    size_t hint;
+    size_t count;
+    size_t *claimed;
+} claimer_t;
+
+static double NowNs(void);
+static void TestSize(size_t num_bits);
+static void TestFillAndRelease(size_t num_bits);
+static double TestThreads(size_t num_threads, int spread);
+static void *Claim(void *arg);
+static void RandomOp(cbitmap_t *cbitmap, unsigned char *model, size_t num_bits);
+static void Check(const cbitmap_t *cbitmap, const unsigned char *model,
+                  size_t num_bits);
+static size_t Position(size_t limit);
+
+int main(void)
+{
+    size_t sizes[] = {1, 63, 64, 65, HINT_BITS - 1, HINT_BITS, HINT_BITS + 1,
+                      2 * HINT_BITS + 7};
+    size_t threads = 0;
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        TestSize(sizes[i]);
+        TestFillAndRelease(sizes[i]);
+    }
+
+    printf("%d bits claimed by the threads, then half released and claimed "
+           "again %d times\n", THREAD_BITS, THREAD_ROUNDS);
+    printf("%8s %18s %18s\n", "threads", "spread Mclaim/s", "same hint");
+    for (threads = 1; threads <= MAX_THREADS; threads *= 2)
+    {
+        printf("%8lu %18.2f %18.2f\n", (unsigned long)threads,
+               TestThreads(threads, 1), TestThreads(threads, 0));
+    }
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+/* random claims and changes at and around word and hint word boundaries,
+   against one byte per bit */
+static void TestSize(size_t num_bits)
+{
+    cbitmap_t *cbitmap = CBitmapCreate(num_bits);
+    unsigned char *model = (unsigned char *)calloc(num_bits, 1);
+    size_t i = 0;
+
+    assert(NULL != cbitmap && NULL != model);
+    assert(num_bits == CBitmapSize(cbitmap));
+    Check(cbitmap, model, num_bits);
+
+    for (i = 0; i < RANDOM_OPS; ++i)
+    {
+        RandomOp(cbitmap, model, num_bits);
+        if (0 == i % (RANDOM_OPS / 8))
+        {
+            Check(cbitmap, model, num_bits);
+        }
+    }
+    Check(cbitmap, model, num_bits);
+
+    free(model);
+    CBitmapDestroy(cbitmap);
+}
+
+/* claims until nothing is left, so every word is marked full, then single
+   bits at the edges of words and hint words are released and have to be
+   claimed back through the marks, from any hint */
+static void TestFillAndRelease(size_t num_bits)
+{
+    cbitmap_t *cbitmap = CBitmapCreate(num_bits);
+    size_t holes[] = {0, 63, 64, HINT_BITS - 1, HINT_BITS, HINT_BITS + 64};
+    size_t idx = 0;
+    size_t hole = 0;
+    size_t i = 0;
+    int was = 0;
+
+    assert(NULL != cbitmap);
+    for (i = 0; i < num_bits; ++i)
+    {
+        idx = CBitmapClaim(cbitmap, num_bits - 1);
+        assert((0 == i ? num_bits - 1 : i - 1) == idx);
+    }
+    idx = CBitmapClaim(cbitmap, 0);
+    assert(num_bits == idx);
+    assert(num_bits == CBitmapCountSetRange(cbitmap, 0, num_bits));
+    idx = CBitmapFindNthClear(cbitmap, 0);
+    assert(num_bits == idx);
+
+    for (i = 0; i <= sizeof(holes) / sizeof(holes[0]); ++i)
+    {
+        /* the last bit, with the padding after it, goes last */
+        hole = (i == sizeof(holes) / sizeof(holes[0])) ? num_bits - 1 :
+               holes[i];
+        if (hole >= num_bits)
+        {
+            continue;
+        }
+
+        was = CBitmapRelease(cbitmap, hole);
+        assert(1 == was);
+        idx = CBitmapFindNext(cbitmap, 0, 0);
+        assert(hole == idx);
+        idx = CBitmapFindNthClear(cbitmap, 0);
+        assert(hole == idx);
+        idx = CBitmapClaim(cbitmap, hole + 1);
+        assert(hole == idx);
+        idx = CBitmapClaim(cbitmap, (size_t)-1);
+        assert(num_bits == idx);
+    }
+
+    /* a range across hint words is released at once */
+    if (2 * HINT_BITS < num_bits)
+    {
+        CBitmapClearRange(cbitmap, HINT_BITS - 3, 2 * HINT_BITS + 5);
+        idx = CBitmapFindNext(cbitmap, HINT_BITS - 3, 1);
+        assert(2 * HINT_BITS + 5 == idx);
+        idx = CBitmapClaim(cbitmap, 2 * HINT_BITS + 5);
+        assert(HINT_BITS - 3 == idx);
+        CBitmapSetRange(cbitmap, HINT_BITS - 3, 2 * HINT_BITS + 5);
+        idx = CBitmapClaim(cbitmap, 0);
+        assert(num_bits == idx);
+    }
+
+    CBitmapDestroy(cbitmap);
+    (void)idx;
+    (void)was;
+}
+
+/* every thread claims its share of the bits, then releases and claims
+   them again. No bit may be claimed by two threads, and every bit is set
+   at the end */
+static double TestThreads(size_t num_threads, int spread)
+{
+    pthread_t threads[MAX_THREADS];
+    claimer_t claimers[MAX_THREADS];
+    cbitmap_t *cbitmap = CBitmapCreate(THREAD_BITS);
+    unsigned char *seen = (unsigned char *)calloc(THREAD_BITS, 1);
+    size_t idx = 0;
+    size_t i = 0;
+    size_t j = 0;
+    double ns = 0;
+    int status = 0;
+
+    assert(NULL != cbitmap && NULL != seen);
+    for (i = 0; i < num_threads; ++i)
+    {
+        claimers[i].cbitmap = cbitmap;
+        claimers[i].hint = spread ? i * (THREAD_BITS / num_threads) : 0;
+        claimers[i].count = THREAD_BITS / num_threads;
+        claimers[i].claimed = (size_t *)malloc(claimers[i].count *
+                                               sizeof(size_t));
+        assert(NULL != claimers[i].claimed);
+    }
+
+    ns = NowNs();
+    for (i = 0; i < num_threads; ++i)
+    {
+        status = pthread_create(&threads[i], NULL, Claim, &claimers[i]);
+        assert(0 == status);
+    }
+    for (i = 0; i < num_threads; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    ns = NowNs() - ns;
+
+    for (i = 0; i < num_threads; ++i)
+    {
+        for (j = 0; j < claimers[i].count; ++j)
+        {
+            assert(claimers[i].claimed[j] < THREAD_BITS);
+            assert(!seen[claimers[i].claimed[j]]);
+            seen[claimers[i].claimed[j]] = 1;
+        }
+        free(claimers[i].claimed);
+    }
+    assert(THREAD_BITS == CBitmapCountSetRange(cbitmap, 0, THREAD_BITS));
+    idx = CBitmapClaim(cbitmap, 0);
+    assert(THREAD_BITS == idx);
+
+    free(seen);
+    CBitmapDestroy(cbitmap);
+    (void)status;
+    (void)idx;
+
+    return ((THREAD_BITS + THREAD_ROUNDS * THREAD_BITS / 2) / ns * 1e3);
+}
+
+static void *Claim(void *arg)
+{
+    claimer_t *claimer = (claimer_t *)arg;
+    size_t round = 0;
+    size_t i = 0;
+    int was = 0;
+
+    for (i = 0; i < claimer->count; ++i)
+    {
+        claimer->claimed[i] = CBitmapClaim(claimer->cbitmap, claimer->hint);
+    }
+
+    for (round = 0; round < THREAD_ROUNDS; ++round)
+    {
+        for (i = round % 2; i < claimer->count; i += 2)
+        {
+            was = CBitmapRelease(claimer->cbitmap, claimer->claimed[i]);
+            assert(1 == was);
+        }
+        for (i = round % 2; i < claimer->count; i += 2)
+        {
+            claimer->claimed[i] = CBitmapClaim(claimer->cbitmap,
+                                               claimer->hint);
+        }
+    }
+    (void)was;
+
+    return NULL;
+}
+
+static void RandomOp(cbitmap_t *cbitmap, unsigned char *model, size_t num_bits)
+{
+    size_t from = Position(num_bits);
+    size_t to = Position(num_bits + 1);
+    unsigned long bits = 0;
+    size_t expected = 0;
+    size_t word = 0;
+    size_t idx = 0;
+    size_t i = 0;
+    int was = 0;
+
+    if (from > to)
+    {
+        i = from;
+        from = to;
+        to = i;
+    }
+
+    switch (rand() % 6)
+    {
+        case 0:
+            /* the first clear bit from the hint on, wrapping around */
+            for (i = 0; i < num_bits && model[(from + i) % num_bits]; ++i)
+            {
+            }
+            expected = (i == num_bits) ? num_bits : (from + i) % num_bits;
+            idx = CBitmapClaim(cbitmap, from);
+            assert(expected == idx);
+            if (idx < num_bits)
+            {
+                model[idx] = 1;
+            }
+            break;
+        case 1:
+            was = CBitmapClaimBit(cbitmap, from);
+            assert((0 == model[from]) == was);
+            model[from] = 1;
+            break;
+        case 2:
+            was = CBitmapRelease(cbitmap, from);
+            assert(model[from] == was);
+            model[from] = 0;
+            break;
+        case 3:
+            CBitmapSetRange(cbitmap, from, to);
+            memset(model + from, 1, to - from);
+            break;
+        case 4:
+            CBitmapClearRange(cbitmap, from, to);
+            memset(model + from, 0, to - from);
+            break;
+        default:
+            word = from / WORD_BITS;
+            bits = ((unsigned long)rand() << 33) ^
+                   ((unsigned long)rand() << 11) ^ (unsigned long)rand();
+            CBitmapOrWord(cbitmap, word, bits);
+            for (i = 0; i < WORD_BITS && word * WORD_BITS + i < num_bits; ++i)
+            {
+                model[word * WORD_BITS + i] |= (bits >> i) & 1;
+            }
+            break;
+    }
+    (void)expected;
+    (void)idx;
+    (void)was;
+}
+
+/* the counting and finding functions against plain loops over the model */
+static void Check(const cbitmap_t *cbitmap, const unsigned char *model,
+                  size_t num_bits)
+{
+    size_t count = 0;
+    size_t clear = 0;
+    size_t nth = 0;
+    size_t from = 0;
+    size_t to = 0;
+    size_t round = 0;
+    size_t i = 0;
+
+    for (i = 0; i < num_bits; ++i)
+    {
+        count += model[i];
+    }
+    assert(count == CBitmapCountSetRange(cbitmap, 0, num_bits));
+    clear = num_bits - count;
+
+    for (round = 0; round < 16; ++round)
+    {
+        from = Position(num_bits);
+        to = from + Position(num_bits - from + 1);
+
+        count = 0;
+        for (i = from; i < to; ++i)
+        {
+            count += model[i];
+        }
+        assert(count == CBitmapCountSetRange(cbitmap, from, to));
+
+        for (i = from; i < num_bits && !model[i]; ++i)
+        {
+        }
+        assert(i == CBitmapFindNext(cbitmap, from, 1));
+        for (i = from; i < num_bits && model[i]; ++i)
+        {
+        }
+        assert(i == CBitmapFindNext(cbitmap, from, 0));
+
+        /* the n-th clear bit, and one past the last */
+        nth = Position(clear + 1);
+        count = 0;
+        for (i = 0; i < num_bits; ++i)
+        {
+            if (!model[i] && nth == count++)
+            {
+                break;
+            }
+        }
+        assert(i == CBitmapFindNthClear(cbitmap, nth));
+    }
+    (void)cbitmap;
+    (void)count;
+    (void)nth;
+}
+
+/* a random position in [0, limit), biased towards word and hint word
+   edges and the ends */
+static size_t Position(size_t limit)
+{
+    size_t edges[] = {0, 1, WORD_BITS - 1, WORD_BITS, WORD_BITS + 1,
+                      HINT_BITS - 1, HINT_BITS, HINT_BITS + 1,
+                      2 * HINT_BITS - 1, 2 * HINT_BITS};
+    size_t pick = (size_t)rand() % 16;
+
+    if (pick < sizeof(edges) / sizeof(edges[0]) && edges[pick] < limit)
+    {
+        return edges[pick];
+    }
+    if (14 == pick)
+    {
+        return limit - 1;
+    }
+
+    return (((size_t)rand() << 15 ^ (size_t)rand()) % limit);
+}
@@ -0,0 +1,160 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread cvector_test.c ../src/cvector.c ../src/dvector.c -I../inc -o cvector.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* calloc */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <pthread.h> /* pthread_create */
+
+#include "cvector.h" /* cvector_t */
+#include "dvector.h" /* dvector_t */
+
+#define TOTAL_PUSHES (4000000)
+#define MAX_THREADS (32)
+
+typedef struct producer
+{
+    size_t first;
+    size_t count;
+} producer_t;
+
+static cvector_t *shared_cvector = NULL;
+static dvector_t *shared_dvector = NULL;
+static pthread_mutex_t dvector_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double NowNs(void);
+static double Run(size_t threads, void *(*producer)(void *));
+static void *PushCVector(void *arg);
+static void *PushLockedDVector(void *arg);
+static void CheckAllPushed(void);
+
+int main(void)
+{
+    size_t threads = 0;
+    double cvector_ns = 0;
+    double dvector_ns = 0;
+
+    printf("%d pushes of size_t split between the threads\n", TOTAL_PUSHES);
+    printf("%8s %18s %18s\n", "threads", "cvector Mpush/s", "locked dvector");
+    for (threads = 1; threads <= MAX_THREADS; threads *= 2)
+    {
+        shared_cvector = CVectorCreate(sizeof(size_t));
+        assert(NULL != shared_cvector);
+        cvector_ns = Run(threads, PushCVector);
+        CheckAllPushed();
+        CVectorDestroy(shared_cvector);
+
+        shared_dvector = DvectorCreate(16, sizeof(size_t));
+        assert(NULL != shared_dvector);
+        dvector_ns = Run(threads, PushLockedDVector);
+        assert(TOTAL_PUSHES == DvectorSize(shared_dvector));
+        DvectorDestroy(shared_dvector);
+
+        printf("%8lu %18.1f %18.1f\n", (unsigned long)threads,
+               TOTAL_PUSHES / cvector_ns * 1e3, TOTAL_PUSHES / dvector_ns * 1e3);
+    }
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static double Run(size_t threads, void *(*producer)(void *))
+{
+    pthread_t ids[MAX_THREADS];
+    producer_t work[MAX_THREADS];
+    double start = 0;
+    size_t i = 0;
+    int status = 0;
+
+    for (i = 0; i < threads; ++i)
+    {
+        work[i].first = i * (TOTAL_PUSHES / threads);
+        work[i].count = (i + 1 == threads) ? TOTAL_PUSHES - work[i].first :
+                                             TOTAL_PUSHES / threads;
+    }
+
+    start = NowNs();
+    for (i = 0; i < threads; ++i)
+    {
+        status = pthread_create(&ids[i], NULL, producer, &work[i]);
+        assert(0 == status);
+    }
+    for (i = 0; i < threads; ++i)
+    {
+        pthread_join(ids[i], NULL);
+    }
+    (void)status;
+
+    return (NowNs() - start);
+}
+
+static void *PushCVector(void *arg)
+{
+    producer_t *work = arg;
+    size_t value = 0;
+    int status = 0;
+
+    for (value = work->first; value < work->first + work->count; ++value)
+    {
+        status = CVectorPushBack(shared_cvector, &value);
+        assert(0 == status);
+    }
+    (void)status;
+
+    return NULL;
+}
+
+static void *PushLockedDVector(void *arg)
+{
+    producer_t *work = arg;
+    size_t value = 0;
+    int status = 0;
+
+    for (value = work->first; value < work->first + work->count; ++value)
+    {
+        pthread_mutex_lock(&dvector_lock);
+        status = DvectorPushBack(shared_dvector, &value);
+        assert(0 == status);
+        pthread_mutex_unlock(&dvector_lock);
+    }
+    (void)status;
+
+    return NULL;
+}
+
+/* every value shows up exactly once in the committed prefix */
+static void CheckAllPushed(void)
+{
+    unsigned char *seen = calloc(TOTAL_PUSHES, 1);
+    size_t value = 0;
+    size_t i = 0;
+
+    assert(NULL != seen);
+    assert(TOTAL_PUSHES == CVectorSize(shared_cvector));
+    for (i = 0; i < TOTAL_PUSHES; ++i)
+    {
+        value = *(size_t *)CVectorGetAccessToElement(shared_cvector, i);
+        assert(value < TOTAL_PUSHES && 0 == seen[value]);
+        seen[value] = 1;
+    }
+    free(seen);
+}
@@ -0,0 +1,146 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 dhcp6_test.c ../src/dhcp6.c -I../inc -o dhcp6.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf, fopen */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memcpy */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "dhcp6.h" /* dhcp6_t */
+
+#define NUM_ADDRESSES (1000000)
+#define NUM_DELEGATIONS (65536)
+
+static const unsigned char prefix[BYTES_IN_IP6] =
+    {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static double NowNs(void);
+static long RssKB(void);
+static void Addresses(int random_requests);
+static void Delegations(void);
+
+/* a million addresses of a /64, lowest first and then at random, and
+   every /56 of a /40. memory grows with the allocations, a bitmap of the
+   /64 alone would not fit in any machine */
+int main(void)
+{
+    Addresses(0);
+    Addresses(1);
+    Delegations();
+
+    return 0;
+}
+
+static void Addresses(int random_requests)
+{
+    dhcp6_t *dhcp6 = DHCP6Create(prefix, 64);
+    unsigned char *ips = (unsigned char *)malloc(NUM_ADDRESSES * BYTES_IN_IP6);
+    unsigned char requested[BYTES_IN_IP6];
+    long rss = 0;
+    double alloc_ns = 0;
+    double free_ns = 0;
+    size_t i = 0;
+    size_t j = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != dhcp6 && NULL != ips);
+    memcpy(requested, prefix, BYTES_IN_IP6);
+
+    alloc_ns = NowNs();
+    for (i = 0; NUM_ADDRESSES > i; ++i)
+    {
+        for (j = 8; random_requests && BYTES_IN_IP6 > j; ++j)
+        {
+            requested[j] = (unsigned char)rand();
+        }
+        status = DHCP6Allocate(dhcp6, BITS_IN_IP6, ips + i * BYTES_IN_IP6,
+                               random_requests ? requested : NULL);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    alloc_ns = NowNs() - alloc_ns;
+    assert(NUM_ADDRESSES == DHCP6CountAllocated(dhcp6));
+    rss = RssKB();
+
+    free_ns = NowNs();
+    for (i = 0; NUM_ADDRESSES > i; ++i)
+    {
+        status = DHCP6Free(dhcp6, ips + i * BYTES_IN_IP6, BITS_IN_IP6);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    free_ns = NowNs() - free_ns;
+    assert(0 == DHCP6CountAllocated(dhcp6));
+
+    printf("/64 %-8s allocate %6.1f ns  free %6.1f ns  rss %ld KB\n",
+           random_requests ? "random" : "lowest", alloc_ns / NUM_ADDRESSES,
+           free_ns / NUM_ADDRESSES, rss);
+
+    DHCP6Destroy(dhcp6);
+    free(ips);
+    (void)status;
+}
+
+static void Delegations(void)
+{
+    dhcp6_t *dhcp6 = DHCP6Create(prefix, 40);
+    unsigned char block[BYTES_IN_IP6];
+    double alloc_ns = 0;
+    size_t i = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != dhcp6);
+
+    alloc_ns = NowNs();
+    for (i = 0; NUM_DELEGATIONS > i; ++i)
+    {
+        status = DHCP6Allocate(dhcp6, 56, block, NULL);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    alloc_ns = NowNs() - alloc_ns;
+    status = DHCP6Allocate(dhcp6, 56, block, NULL);
+    assert(DHCP_STATUS_FULL_ERR == status);
+
+    printf("/40 every /56   allocate %6.1f ns\n", alloc_ns / NUM_DELEGATIONS);
+
+    DHCP6Destroy(dhcp6);
+    (void)status;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((double)now.tv_sec * 1e9 + (double)now.tv_nsec);
+}
+
+/* resident pages from /proc, assuming 4KB pages */
+static long RssKB(void)
+{
+    FILE *statm = fopen("/proc/self/statm", "r");
+    long size = 0;
+    long resident = 0;
+
+    if (NULL == statm)
+    {
+        return -1;
+    }
+    if (2 != fscanf(statm, "%ld %ld", &size, &resident))
+    {
+        resident = -1;
+    }
+    fclose(statm);
+
+    return ((0 > resident) ? -1 : resident * 4);
+}
@@ -0,0 +1,295 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 dhcp_lease_test.c ../src/dhcp_lease.c ../src/dhcp.c ../src/hbitmap.c
+    ../src/cbitmap.c -I../inc -o dhcp_lease.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memcmp */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "dhcp_lease.h" /* dhcp_lease_table_t */
+
+#define NUM_LEASES (1000000)
+#define LEASE_TIME (3600)
+#define BLIP_TIME (600)
+#define EXPIRE_STEP (10)
+#define EXPIRE_BATCH (4096)
+#define INDEX_LEASES (1500)
+#define INDEX_EXPIRY (8)
+
+static const unsigned char subnet[BYTES_IN_IP] = {10, 0, 0, 0};
+
+static double NowNs(void);
+static void SetOwner(unsigned char owner[HWADDR_LEN], size_t client);
+static void CountExpired(lease_id_t lease, const unsigned char ip[BYTES_IN_IP],
+                         const unsigned char owner[HWADDR_LEN], void *param);
+static void TestIndexes(void);
+static void CheckIndexes(const dhcp_lease_table_t *table,
+                         const lease_id_t *leases,
+                         unsigned char ips[][BYTES_IN_IP],
+                         const unsigned char *is_live);
+
+/* a million leases spread over an hour, looked up and asked for again
+   by their clients, then every client renews in the same second after a
+   network blip, then the clock runs until all of them expire */
+int main(void)
+{
+    dhcp_t *dhcp = DHCPCreateWithBackend(subnet, 12, DHCP_BACKEND_BITMAP);
+    dhcp_lease_table_t *table = NULL;
+    lease_id_t *leases = (lease_id_t *)malloc(NUM_LEASES * sizeof(lease_id_t));
+    unsigned char owner[HWADDR_LEN] = {0x02, 0, 0, 0, 0, 0};
+    unsigned char ip[BYTES_IN_IP];
+    size_t free_before = 0;
+    size_t expired = 0;
+    size_t reported = 0;
+    size_t i = 0;
+    size_t j = 0;
+    lease_id_t tmp = 0;
+    lease_id_t lease = LEASE_INVALID;
+    time_t now = 0;
+    double grant_ns = 0;
+    double renew_ns = 0;
+    double lookup_ns = 0;
+    double request_ns = 0;
+    double expire_ns = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    TestIndexes();
+
+    assert(NULL != dhcp && NULL != leases);
+    table = DHCPLeaseCreate(dhcp, 0, CountExpired, &reported);
+    assert(NULL != table);
+    free_before = DHCPCountFree(dhcp);
+
+    grant_ns = NowNs();
+    for (i = 0; i < NUM_LEASES; ++i)
+    {
+        SetOwner(owner, i);
+        leases[i] = DHCPLeaseGrant(table, owner, NULL,
+                                   LEASE_TIME / 2 + rand() % LEASE_TIME, 0, ip);
+        assert(LEASE_INVALID != leases[i]);
+    }
+    grant_ns = (NowNs() - grant_ns) / NUM_LEASES;
+
+    lookup_ns = NowNs();
+    for (i = 0; i < NUM_LEASES; ++i)
+    {
+        SetOwner(owner, (size_t)rand() % NUM_LEASES);
+        lease = DHCPLeaseFindByClient(table, owner);
+        assert(LEASE_INVALID != lease);
+    }
+    lookup_ns = (NowNs() - lookup_ns) / NUM_LEASES;
+
+    /* a known client asking again gets its own lease, not a new address */
+    request_ns = NowNs();
+    for (i = 0; i < NUM_LEASES; ++i)
+    {
+        SetOwner(owner, (size_t)rand() % NUM_LEASES);
+        lease = DHCPLeaseGrant(table, owner, NULL, LEASE_TIME, 0, ip);
+        assert(LEASE_INVALID != lease);
+    }
+    request_ns = (NowNs() - request_ns) / NUM_LEASES;
+    assert(NUM_LEASES == DHCPLeaseCount(table));
+    assert(free_before - NUM_LEASES == DHCPCountFree(dhcp));
+
+    /* the storm comes in random order */
+    for (i = NUM_LEASES - 1; 0 < i; --i)
+    {
+        j = (size_t)rand() % (i + 1);
+        tmp = leases[i];
+        leases[i] = leases[j];
+        leases[j] = tmp;
+    }
+
+    renew_ns = NowNs();
+    for (i = 0; i < NUM_LEASES; ++i)
+    {
+        status = DHCPLeaseRenew(table, leases[i], LEASE_TIME, BLIP_TIME);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    renew_ns = (NowNs() - renew_ns) / NUM_LEASES;
+
+    expire_ns = NowNs();
+    for (now = 0; 0 < DHCPLeaseCount(table); now += EXPIRE_STEP)
+    {
+        while (EXPIRE_BATCH == (j = DHCPLeaseExpire(table, now, EXPIRE_BATCH)))
+        {
+            expired += j;
+        }
+        expired += j;
+    }
+    expire_ns = (NowNs() - expire_ns) / NUM_LEASES;
+
+    assert(NUM_LEASES == expired && NUM_LEASES == reported);
+    assert(free_before == DHCPCountFree(dhcp));
+    assert(BLIP_TIME + LEASE_TIME <= now);
+
+    printf("%d leases, ns per lease\n", NUM_LEASES);
+    printf("grant %.1f  lookup %.1f  known client grant %.1f\n",
+           grant_ns, lookup_ns, request_ns);
+    printf("renew storm %.1f  expire %.1f\n", renew_ns, expire_ns);
+
+    DHCPLeaseDestroy(table);
+    DHCPDestroy(dhcp);
+    free(leases);
+    (void)status;
+    (void)lease;
+    (void)free_before;
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static void SetOwner(unsigned char owner[HWADDR_LEN], size_t client)
+{
+    owner[3] = (unsigned char)(client >> 16);
+    owner[4] = (unsigned char)(client >> 8);
+    owner[5] = (unsigned char)client;
+}
+
+static void CountExpired(lease_id_t lease, const unsigned char ip[BYTES_IN_IP],
+                         const unsigned char owner[HWADDR_LEN], void *param)
+{
+    (void)lease;
+    (void)ip;
+    (void)owner;
+    ++*(size_t *)param;
+}
+
+/* leases granted in a /20, so the indexes hold clusters, then released
+   in random order and expired. After every change each gone key misses
+   in both indexes and every live one still hits, which only holds if
+   removal shifts the rest of each cluster back correctly */
+static void TestIndexes(void)
+{
+    dhcp_t *dhcp = DHCPCreateWithBackend(subnet, 20, DHCP_BACKEND_BITMAP);
+    dhcp_lease_table_t *table = NULL;
+    lease_id_t leases[INDEX_LEASES];
+    unsigned char ips[INDEX_LEASES][BYTES_IN_IP];
+    unsigned char is_live[INDEX_LEASES];
+    unsigned char owner[HWADDR_LEN] = {0x02, 0, 0, 0, 0, 0};
+    size_t reported = 0;
+    size_t expired = 0;
+    size_t pick = 0;
+    size_t i = 0;
+    time_t now = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != dhcp);
+    table = DHCPLeaseCreate(dhcp, 0, CountExpired, &reported);
+    assert(NULL != table);
+
+    for (i = 0; i < INDEX_LEASES; ++i)
+    {
+        SetOwner(owner, i);
+        leases[i] = DHCPLeaseGrant(table, owner, NULL,
+                                   1 + (time_t)(i % INDEX_EXPIRY), 0, ips[i]);
+        assert(LEASE_INVALID != leases[i]);
+        is_live[i] = 1;
+    }
+    CheckIndexes(table, leases, ips, is_live);
+
+    /* a third released, one at a time */
+    for (i = 0; i < INDEX_LEASES / 3; ++i)
+    {
+        do
+        {
+            pick = (size_t)rand() % INDEX_LEASES;
+        } while (!is_live[pick]);
+
+        status = DHCPLeaseRelease(table, leases[pick]);
+        assert(DHCP_STATUS_SUCCESS == status);
+        is_live[pick] = 0;
+        if (0 == i % 50)
+        {
+            CheckIndexes(table, leases, ips, is_live);
+        }
+    }
+    CheckIndexes(table, leases, ips, is_live);
+
+    /* a second at a time, each taking the leases that ran out then */
+    for (now = 1; now <= INDEX_EXPIRY; ++now)
+    {
+        expired = DHCPLeaseExpire(table, now, INDEX_LEASES);
+        for (i = 0; i < INDEX_LEASES; ++i)
+        {
+            if (is_live[i] && (time_t)(1 + i % INDEX_EXPIRY) <= now)
+            {
+                is_live[i] = 0;
+                --expired;
+            }
+        }
+        assert(0 == expired);
+        CheckIndexes(table, leases, ips, is_live);
+    }
+    assert(0 == DHCPLeaseCount(table));
+    assert(INDEX_LEASES - INDEX_LEASES / 3 == reported);
+
+    DHCPLeaseDestroy(table);
+    DHCPDestroy(dhcp);
+    (void)status;
+}
+
+/* a live lease is found by its address and client, and knows both */
+static void CheckIndexes(const dhcp_lease_table_t *table,
+                         const lease_id_t *leases,
+                         unsigned char ips[][BYTES_IN_IP],
+                         const unsigned char *is_live)
+{
+    unsigned char owner[HWADDR_LEN] = {0x02, 0, 0, 0, 0, 0};
+    unsigned char got[HWADDR_LEN];
+    lease_id_t lease = LEASE_INVALID;
+    size_t live = 0;
+    size_t i = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    for (i = 0; i < INDEX_LEASES; ++i)
+    {
+        SetOwner(owner, i);
+        if (!is_live[i])
+        {
+            lease = DHCPLeaseFindByIP(table, ips[i]);
+            assert(LEASE_INVALID == lease);
+            lease = DHCPLeaseFindByClient(table, owner);
+            assert(LEASE_INVALID == lease);
+            status = DHCPLeaseGetOwner(table, leases[i], got);
+            assert(DHCP_STATUS_SUCCESS != status);
+            continue;
+        }
+
+        ++live;
+        lease = DHCPLeaseFindByIP(table, ips[i]);
+        assert(leases[i] == lease);
+        lease = DHCPLeaseFindByClient(table, owner);
+        assert(leases[i] == lease);
+        status = DHCPLeaseGetOwner(table, lease, got);
+        assert(DHCP_STATUS_SUCCESS == status);
+        assert(0 == memcmp(owner, got, HWADDR_LEN));
+        status = DHCPLeaseGetIP(table, lease, got);
+        assert(DHCP_STATUS_SUCCESS == status);
+        assert(0 == memcmp(ips[i], got, BYTES_IN_IP));
+    }
+    assert(live == DHCPLeaseCount(table));
+    (void)lease;
+    (void)live;
+    (void)status;
+}
@@ -0,0 +1,391 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 dhcp_pools_test.c ../src/dhcp_pools.c ../src/dhcp.c ../src/hbitmap.c ../src/cbitmap.c -I../inc -pthread -o dhcp_pools.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "dhcp_pools.h" /* dhcp_pools_t */
+
+#define NUM_BACKENDS (3)
+#define MAX_BENCH_POOLS (4096)
+#define BENCH_LOOKUPS (1000000)
+
+/* the nested prefixes of the tests, outermost first */
+#define OUTER (0x0A000000U) /* 10.0.0.0/8 */
+#define MIDDLE (0x0A010000U) /* 10.1.0.0/16 */
+#define INNER (0x0A010200U) /* 10.1.2.0/24 */
+#define INNERMOST (0x0A010280U) /* 10.1.2.128/25 */
+#define OTHER (0xC0A80000U) /* 192.168.0.0/16 */
+
+static double NowNs(void);
+static void TestLookup(dhcp_backend_t backend, int outer_first);
+static void TestDuplicate(dhcp_backend_t backend);
+static void TestRefused(dhcp_backend_t backend);
+static void TestRemove(dhcp_backend_t backend);
+static void AddAll(dhcp_pools_t *pools, dhcp_backend_t backend,
+                   int outer_first);
+static void CheckRoute(dhcp_pools_t *pools, unsigned int relay,
+                       unsigned int key, size_t bits, unsigned int nested,
+                       size_t nested_bits);
+static size_t FreeOf(const dhcp_pools_t *pools, unsigned int key, size_t bits);
+static unsigned char *ToIp(unsigned int key, unsigned char ip[BYTES_IN_IP]);
+static unsigned int ToKey(const unsigned char ip[BYTES_IN_IP]);
+static int IsIn(unsigned int addr, unsigned int key, size_t bits);
+static void BenchLookup(void);
+
+int main(void)
+{
+    dhcp_backend_t backends[NUM_BACKENDS] = {DHCP_BACKEND_TRIE,
+                                             DHCP_BACKEND_BITMAP,
+                                             DHCP_BACKEND_CONCURRENT};
+    size_t i = 0;
+
+    for (i = 0; i < NUM_BACKENDS; ++i)
+    {
+        TestLookup(backends[i], 1);
+        TestLookup(backends[i], 0);
+        TestDuplicate(backends[i]);
+        TestRefused(backends[i]);
+        TestRemove(backends[i]);
+    }
+
+    BenchLookup();
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+/* every address goes to the most specific pool around it, and gets an
+   address that no pool nested in that one owns. The same whichever of the
+   nested pools was added first */
+static void TestLookup(dhcp_backend_t backend, int outer_first)
+{
+    dhcp_pools_t *pools = DHCPPoolsCreate();
+    unsigned char ip[BYTES_IN_IP];
+    dhcp_t *pool = NULL;
+
+    assert(NULL != pools);
+    AddAll(pools, backend, outer_first);
+    assert(5 == DHCPPoolsCount(pools));
+
+    pool = DHCPPoolsLookup(pools, ToIp(INNERMOST + 100, ip));
+    assert(NULL != pool && pool != DHCPPoolsLookup(pools, ToIp(INNER, ip)));
+    pool = DHCPPoolsLookup(pools, ToIp(0x0B000001U, ip));
+    assert(NULL == pool);
+    pool = DHCPPoolsLookup(pools, ToIp(0x09FFFFFFU, ip));
+    assert(NULL == pool);
+
+    CheckRoute(pools, INNERMOST + 70, INNERMOST, 25, 0, 0);
+    CheckRoute(pools, INNER + 5, INNER, 24, INNERMOST, 25);
+    CheckRoute(pools, INNER + 127, INNER, 24, INNERMOST, 25);
+    CheckRoute(pools, 0x0A010301U, MIDDLE, 16, INNER, 24);
+    CheckRoute(pools, 0x0AC80001U, OUTER, 8, MIDDLE, 16);
+    CheckRoute(pools, 0x0AFFFF00U, OUTER, 8, MIDDLE, 16);
+    CheckRoute(pools, OTHER + 0xFF00, OTHER, 16, 0, 0);
+
+    /* every pool keeps 3 addresses, and the outer pools count without what
+       they gave to the nested ones: a nested pool takes its whole prefix,
+       clipped to the hosts of the pool around it */
+    assert(128 - 3 == FreeOf(pools, INNERMOST, 25));
+    assert(256 - 3 - (128 - 2) == FreeOf(pools, INNER, 24));
+    assert(65536 - 3 - 256 == FreeOf(pools, MIDDLE, 16));
+    assert((1U << 24) - 3 - 65536 == FreeOf(pools, OUTER, 8));
+    assert(65536 - 3 == FreeOf(pools, OTHER, 16));
+
+    DHCPPoolsDestroy(pools);
+    (void)pool;
+}
+
+/* the same prefix twice, also written with host bits, fails and changes
+   nothing. So does a prefix too long to leave hosts */
+static void TestDuplicate(dhcp_backend_t backend)
+{
+    dhcp_pools_t *pools = DHCPPoolsCreate();
+    unsigned char ip[BYTES_IN_IP];
+    size_t free_before = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != pools);
+    AddAll(pools, backend, 1);
+    free_before = FreeOf(pools, OUTER, 8);
+
+    status = DHCPPoolsAdd(pools, ToIp(MIDDLE, ip), 16, backend);
+    assert(DHCP_STATUS_FAIL == status);
+    status = DHCPPoolsAdd(pools, ToIp(MIDDLE + 0x6363, ip), 16, backend);
+    assert(DHCP_STATUS_FAIL == status);
+    status = DHCPPoolsAdd(pools, ToIp(OUTER, ip), 8, backend);
+    assert(DHCP_STATUS_FAIL == status);
+    status = DHCPPoolsAdd(pools, ToIp(INNER + 4, ip), 31, backend);
+    assert(DHCP_STATUS_FAIL == status);
+    assert(5 == DHCPPoolsCount(pools));
+    assert(free_before == FreeOf(pools, OUTER, 8));
+
+    CheckRoute(pools, 0x0A010301U, MIDDLE, 16, INNER, 24);
+
+    DHCPPoolsDestroy(pools);
+    (void)free_before;
+    (void)status;
+}
+
+/* a pool that would take addresses the pool around it already handed out
+   is refused, and added once they are back */
+static void TestRefused(dhcp_backend_t backend)
+{
+    dhcp_pools_t *pools = DHCPPoolsCreate();
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char result[BYTES_IN_IP];
+    unsigned char requested[BYTES_IN_IP];
+    size_t free_before = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != pools);
+    status = DHCPPoolsAdd(pools, ToIp(MIDDLE, ip), 16, backend);
+    assert(DHCP_STATUS_SUCCESS == status);
+
+    status = DHCPPoolsAllocateIP(pools, ToIp(MIDDLE + 1, ip), result,
+                                 ToIp(INNER + 10, requested));
+    assert(DHCP_STATUS_SUCCESS == status && INNER + 10 == ToKey(result));
+    free_before = FreeOf(pools, MIDDLE, 16);
+
+    status = DHCPPoolsAdd(pools, ToIp(INNER, ip), 24, backend);
+    assert(DHCP_STATUS_FAIL == status);
+    assert(1 == DHCPPoolsCount(pools));
+    assert(free_before == FreeOf(pools, MIDDLE, 16));
+    CheckRoute(pools, INNER + 20, MIDDLE, 16, 0, 0);
+
+    /* a nested pool beside the taken address is fine */
+    status = DHCPPoolsAdd(pools, ToIp(INNERMOST, ip), 25, backend);
+    assert(DHCP_STATUS_SUCCESS == status);
+    status = DHCPPoolsRemove(pools, ToIp(INNERMOST, ip), 25);
+    assert(DHCP_STATUS_SUCCESS == status);
+
+    status = DHCPPoolsFreeIP(pools, ToIp(INNER + 10, ip));
+    assert(DHCP_STATUS_SUCCESS == status);
+    status = DHCPPoolsAdd(pools, ToIp(INNER, ip), 24, backend);
+    assert(DHCP_STATUS_SUCCESS == status);
+    assert(2 == DHCPPoolsCount(pools));
+    CheckRoute(pools, INNER + 20, INNER, 24, 0, 0);
+
+    DHCPPoolsDestroy(pools);
+    (void)free_before;
+    (void)status;
+}
+
+/* a removed pool's addresses are the outer pool's again, as many as
+   before it was added, and can be asked for by address */
+static void TestRemove(dhcp_backend_t backend)
+{
+    dhcp_pools_t *pools = DHCPPoolsCreate();
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char result[BYTES_IN_IP];
+    unsigned char requested[BYTES_IN_IP];
+    size_t middle_alone = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != pools);
+    status = DHCPPoolsAdd(pools, ToIp(MIDDLE, ip), 16, backend);
+    assert(DHCP_STATUS_SUCCESS == status);
+    middle_alone = FreeOf(pools, MIDDLE, 16);
+    status = DHCPPoolsAdd(pools, ToIp(INNER, ip), 24, backend);
+    assert(DHCP_STATUS_SUCCESS == status);
+    status = DHCPPoolsAdd(pools, ToIp(INNERMOST, ip), 25, backend);
+    assert(DHCP_STATUS_SUCCESS == status);
+
+    /* the middle one, with a pool still nested in it */
+    status = DHCPPoolsRemove(pools, ToIp(INNER, ip), 24);
+    assert(DHCP_STATUS_SUCCESS == status);
+    assert(2 == DHCPPoolsCount(pools));
+    assert(middle_alone - 128 == FreeOf(pools, MIDDLE, 16));
+    CheckRoute(pools, INNER + 5, MIDDLE, 16, INNERMOST, 25);
+    CheckRoute(pools, INNERMOST + 5, INNERMOST, 25, 0, 0);
+
+    status = DHCPPoolsRemove(pools, ToIp(INNER, ip), 24);
+    assert(DHCP_STATUS_FAIL == status);
+    status = DHCPPoolsRemove(pools, ToIp(OTHER, ip), 16);
+    assert(DHCP_STATUS_FAIL == status);
+
+    status = DHCPPoolsRemove(pools, ToIp(INNERMOST, ip), 25);
+    assert(DHCP_STATUS_SUCCESS == status);
+    assert(1 == DHCPPoolsCount(pools));
+    assert(middle_alone == FreeOf(pools, MIDDLE, 16));
+    assert(NULL == DHCPPoolsLookup(pools, ToIp(OTHER, ip)));
+
+    /* the first and last of the removed prefix, by address */
+    status = DHCPPoolsAllocateIP(pools, ToIp(INNERMOST, ip), result,
+                                 ToIp(INNERMOST, requested));
+    assert(DHCP_STATUS_SUCCESS == status && INNERMOST == ToKey(result));
+    status = DHCPPoolsAllocateIP(pools, ToIp(INNERMOST + 127, ip), result,
+                                 ToIp(INNERMOST + 127, requested));
+    assert(DHCP_STATUS_SUCCESS == status && INNERMOST + 127 == ToKey(result));
+
+    /* the last pool, then the index is empty */
+    status = DHCPPoolsRemove(pools, ToIp(MIDDLE, ip), 16);
+    assert(DHCP_STATUS_SUCCESS == status);
+    assert(0 == DHCPPoolsCount(pools));
+    assert(NULL == DHCPPoolsLookup(pools, ToIp(INNER, ip)));
+    status = DHCPPoolsAllocateIP(pools, ToIp(INNER, ip), result, NULL);
+    assert(DHCP_STATUS_FAIL == status);
+
+    DHCPPoolsDestroy(pools);
+    (void)middle_alone;
+    (void)status;
+}
+
+static void AddAll(dhcp_pools_t *pools, dhcp_backend_t backend,
+                   int outer_first)
+{
+    unsigned int keys[] = {OUTER, MIDDLE, INNER, INNERMOST, OTHER};
+    size_t bits[] = {8, 16, 24, 25, 16};
+    unsigned char ip[BYTES_IN_IP];
+    size_t i = 0;
+    size_t j = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    for (i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+    {
+        j = outer_first ? i : sizeof(keys) / sizeof(keys[0]) - 1 - i;
+        status = DHCPPoolsAdd(pools, ToIp(keys[j], ip), bits[j], backend);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    (void)status;
+}
+
+/* an address allocated through relay comes from key/bits, and not from
+   the pool nested in it at nested/nested_bits, if any */
+static void CheckRoute(dhcp_pools_t *pools, unsigned int relay,
+                       unsigned int key, size_t bits, unsigned int nested,
+                       size_t nested_bits)
+{
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char result[BYTES_IN_IP];
+    unsigned char requested[BYTES_IN_IP];
+    int is_right = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    /* asks for the relay's own address, which may belong to the nested
+       pool: the answer is the next free address of the right one */
+    status = DHCPPoolsAllocateIP(pools, ToIp(relay, ip), result,
+                                 ToIp(relay, requested));
+    assert(DHCP_STATUS_SUCCESS == status);
+    is_right = IsIn(ToKey(result), key, bits) &&
+               (0 == nested_bits || !IsIn(ToKey(result), nested, nested_bits));
+    assert(is_right);
+    assert(DHCPPoolsLookup(pools, ip) == DHCPPoolsLookup(pools, result));
+
+    status = DHCPPoolsFreeIP(pools, result);
+    assert(DHCP_STATUS_SUCCESS == status);
+    (void)status;
+    (void)is_right;
+}
+
+static size_t FreeOf(const dhcp_pools_t *pools, unsigned int key, size_t bits)
+{
+    dhcp_pool_stats_t stats;
+    unsigned char ip[BYTES_IN_IP];
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    status = DHCPPoolsGetStats(pools, ToIp(key, ip), bits, &stats);
+    assert(DHCP_STATUS_SUCCESS == status);
+    assert(((size_t)1 << (32 - bits)) == stats.num_addresses);
+    (void)status;
+
+    return stats.num_free;
+}
+
+static unsigned char *ToIp(unsigned int key, unsigned char ip[BYTES_IN_IP])
+{
+    ip[0] = (unsigned char)(key >> 24);
+    ip[1] = (unsigned char)(key >> 16);
+    ip[2] = (unsigned char)(key >> 8);
+    ip[3] = (unsigned char)key;
+
+    return ip;
+}
+
+static unsigned int ToKey(const unsigned char ip[BYTES_IN_IP])
+{
+    return (((unsigned int)ip[0] << 24) | ((unsigned int)ip[1] << 16) |
+            ((unsigned int)ip[2] << 8) | ip[3]);
+}
+
+static int IsIn(unsigned int addr, unsigned int key, size_t bits)
+{
+    return (0 == ((addr ^ key) >> (32 - bits)));
+}
+
+/* /24 pools under one /16 each, looked up by random addresses inside
+   them. The trie only branches where the prefixes do */
+static void BenchLookup(void)
+{
+    unsigned int *addrs = (unsigned int *)malloc(BENCH_LOOKUPS *
+                                                 sizeof(unsigned int));
+    unsigned char ip[BYTES_IN_IP];
+    dhcp_pools_t *pools = NULL;
+    size_t num_pools = 0;
+    size_t found = 0;
+    size_t i = 0;
+    double ns = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != addrs);
+    printf("%d lookups of random addresses in /24 pools nested in /16s\n",
+           BENCH_LOOKUPS);
+    printf("%10s %16s\n", "pools", "ns per lookup");
+    for (num_pools = 16; num_pools <= MAX_BENCH_POOLS; num_pools *= 16)
+    {
+        pools = DHCPPoolsCreate();
+        assert(NULL != pools);
+        for (i = 0; i < num_pools; ++i)
+        {
+            if (0 == i % 256)
+            {
+                status = DHCPPoolsAdd(pools, ToIp(OUTER + (i << 8), ip), 16,
+                                      DHCP_BACKEND_TRIE);
+                assert(DHCP_STATUS_SUCCESS == status);
+            }
+            status = DHCPPoolsAdd(pools, ToIp(OUTER + (i << 8), ip), 24,
+                                  DHCP_BACKEND_TRIE);
+            assert(DHCP_STATUS_SUCCESS == status);
+        }
+        for (i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            addrs[i] = OUTER + (((unsigned int)rand() % num_pools) << 8) +
+                       (unsigned int)rand() % 256;
+        }
+
+        found = 0;
+        ns = NowNs();
+        for (i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            found += (NULL != DHCPPoolsLookup(pools, ToIp(addrs[i], ip)));
+        }
+        ns = (NowNs() - ns) / BENCH_LOOKUPS;
+        assert(BENCH_LOOKUPS == found);
+
+        printf("%10lu %16.1f\n", (unsigned long)num_pools, ns);
+        DHCPPoolsDestroy(pools);
+    }
+
+    free(addrs);
+    (void)status;
+}
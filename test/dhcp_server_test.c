@@ -0,0 +1,571 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread dhcp_server_test.c ../src/dhcp_server.c ../src/dhcp_lease.c
+    ../src/dhcp.c ../src/hbitmap.c ../src/cbitmap.c -I../inc
+    -o dhcp_server.out
+run with no arguments to load a server of its own on loopback, or with
+<server ip> <port> to load a running dhcpd.out, built in ../src with the
+compile line at the top of dhcpd.c
+*/
+
+#define _GNU_SOURCE /* recvmmsg, sendmmsg, clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, qsort */
+#include <string.h> /* memset, memcpy */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* close */
+#include <pthread.h> /* pthread_create */
+#include <sys/socket.h> /* recvmmsg, sendmmsg */
+#include <sys/time.h> /* struct timeval */
+#include <netinet/in.h> /* struct sockaddr_in */
+#include <arpa/inet.h> /* inet_pton */
+
+#include "dhcp_server.h" /* dhcp_server_t */
+
+#define NUM_CLIENTS (4096)
+#define ROUNDS (8)
+#define WINDOW (128)
+#define BATCH (64)
+#define PACKET_SIZE (576)
+#define RECEIVE_TIMEOUT_US (20000)
+#define RESEND_NS (200e6)
+
+#define OFF_XID (4)
+#define OFF_FLAGS (10)
+#define OFF_YIADDR (16)
+#define OFF_CIADDR (12)
+#define OFF_GIADDR (24)
+#define OFF_CHADDR (28)
+#define OFF_COOKIE (236)
+#define OFF_OPTIONS (240)
+
+#define DHCPDISCOVER (1)
+#define DHCPOFFER (2)
+#define DHCPREQUEST (3)
+#define DHCPACK (5)
+#define DHCPNAK (6)
+#define DHCPRELEASE (7)
+#define FLAG_BROADCAST (0x80)
+
+/* what a client waits for. A client that is not waiting sits in the
+   ready ring with its next message */
+typedef enum client_state
+{
+    WANT_OFFER = 0,
+    WANT_ACK,
+    DONE
+} client_state_t;
+
+typedef struct client
+{
+    client_state_t state;
+    int waiting;
+    unsigned int round;
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char server_id[BYTES_IN_IP];
+    double sent_at;
+} client_t;
+
+typedef struct load
+{
+    int sock;
+    struct sockaddr_in server;
+    client_t clients[NUM_CLIENTS];
+    size_t ready[NUM_CLIENTS];
+    size_t ready_head;
+    size_t num_ready;
+    size_t outstanding;
+    size_t finished;
+    size_t resent;
+    double *latencies;
+    size_t num_latencies;
+    struct mmsghdr msgs[BATCH];
+    struct iovec iovs[BATCH];
+    unsigned char packets[BATCH][PACKET_SIZE];
+} load_t;
+
+static void TestRequests(const dhcp_server_config_t *config);
+static size_t BuildReboot(size_t id, const char *wanted, const char *relay,
+                          unsigned char *packet);
+static void *ServerThread(void *server);
+static void RunLoad(load_t *load);
+static size_t FillBatch(load_t *load, double now);
+static void SendBatch(load_t *load, size_t num);
+static void ReceiveBatch(load_t *load);
+static void ResendLost(load_t *load, double now);
+static size_t BuildRequest(const load_t *load, size_t id, int type,
+                           unsigned char *packet);
+static const unsigned char *FindOption(const unsigned char *packet,
+                                       size_t len, int code, size_t size);
+static void MakeReady(load_t *load, size_t id);
+static int CompareDoubles(const void *a, const void *b);
+static double NowNs(void);
+
+static const unsigned char magic_cookie[] = {99, 130, 83, 99};
+
+/* every client goes DISCOVER, REQUEST, RELEASE ROUNDS times, with up to
+   WINDOW requests in the air. Latency is from the send of a DISCOVER or
+   REQUEST to its reply, a lost request is sent again and counted */
+int main(int argc, char *argv[])
+{
+    static load_t load;
+    dhcp_server_config_t config;
+    dhcp_server_stats_t stats;
+    dhcp_server_t *server = NULL;
+    pthread_t thread;
+    struct timeval timeout;
+    double elapsed = 0;
+    int rcvbuf = 1 << 20;
+    int status = 0;
+
+    memset(&config, 0, sizeof(config));
+    memset(&load.server, 0, sizeof(load.server));
+    load.server.sin_family = AF_INET;
+    inet_pton(AF_INET, "10.0.255.254", config.server_ip);
+    inet_pton(AF_INET, "10.0.0.0", config.subnet_addr);
+
+    if (3 == argc)
+    {
+        status = inet_pton(AF_INET, argv[1], &load.server.sin_addr);
+        assert(1 == status);
+        load.server.sin_port = htons((unsigned short)atoi(argv[2]));
+    }
+    else
+    {
+        config.bits_in_subnet = 16;
+        config.backend = DHCP_BACKEND_BITMAP;
+        config.lease_time = 3600;
+        config.offer_time = 60;
+        TestRequests(&config);
+        server = DHCPServerCreate(&config);
+        assert(NULL != server);
+        status = pthread_create(&thread, NULL, ServerThread, server);
+        assert(0 == status);
+        load.server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        load.server.sin_port = htons(DHCPServerPort(server));
+    }
+
+    load.sock = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(-1 != load.sock);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = RECEIVE_TIMEOUT_US;
+    setsockopt(load.sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(load.sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    load.latencies = (double *)malloc(sizeof(double) * NUM_CLIENTS * ROUNDS * 2);
+    assert(NULL != load.latencies);
+
+    elapsed = NowNs();
+    RunLoad(&load);
+    elapsed = NowNs() - elapsed;
+
+    qsort(load.latencies, load.num_latencies, sizeof(double), CompareDoubles);
+    printf("%lu requests in %.2f s: %.0f req/s  p50 %.1f us  p99 %.1f us  "
+           "resent %lu\n", (unsigned long)load.num_latencies, elapsed / 1e9,
+           load.num_latencies / (elapsed / 1e9),
+           load.latencies[load.num_latencies / 2] / 1e3,
+           load.latencies[load.num_latencies * 99 / 100] / 1e3,
+           (unsigned long)load.resent);
+
+    if (NULL != server)
+    {
+        DHCPServerStop(server);
+        pthread_join(thread, NULL);
+        DHCPServerGetStats(server, &stats);
+        printf("server: received %lu dropped %lu offers %lu acks %lu "
+               "naks %lu releases %lu\n", (unsigned long)stats.received,
+               (unsigned long)stats.dropped, (unsigned long)stats.offers,
+               (unsigned long)stats.acks, (unsigned long)stats.naks,
+               (unsigned long)stats.releases);
+        assert(NUM_CLIENTS * ROUNDS <= stats.acks);
+        assert(0 == stats.naks);
+        DHCPServerDestroy(server);
+    }
+
+    close(load.sock);
+    free(load.latencies);
+    (void)status;
+
+    return 0;
+}
+
+/* straight through DHCPServerHandle, on a server of its own. A rebooting
+   client with no lease is not answered, one asking for an address that is
+   not its own is NAKed - with the broadcast bit set when it came through a
+   relay - and one asking for its own is ACKed */
+static void TestRequests(const dhcp_server_config_t *config)
+{
+    dhcp_server_t *server = DHCPServerCreate(config);
+    dhcp_server_stats_t stats;
+    unsigned char request[PACKET_SIZE];
+    unsigned char reply[PACKET_SIZE];
+    char offered[INET_ADDRSTRLEN];
+    const unsigned char *type = NULL;
+    size_t len = 0;
+
+    assert(NULL != server);
+
+    len = BuildReboot(1, "10.0.1.1", NULL, request);
+    len = DHCPServerHandle(server, request, len, reply, sizeof(reply), 0);
+    assert(0 == len);
+
+    len = BuildReboot(2, NULL, NULL, request);
+    request[OFF_OPTIONS + 2] = DHCPDISCOVER;
+    len = DHCPServerHandle(server, request, len, reply, sizeof(reply), 0);
+    type = FindOption(reply, len, 53, 1);
+    assert(NULL != type && DHCPOFFER == *type);
+    inet_ntop(AF_INET, reply + OFF_YIADDR, offered, sizeof(offered));
+
+    len = BuildReboot(2, "10.0.200.1", NULL, request);
+    len = DHCPServerHandle(server, request, len, reply, sizeof(reply), 0);
+    type = FindOption(reply, len, 53, 1);
+    assert(NULL != type && DHCPNAK == *type);
+    assert(0 == (reply[OFF_FLAGS] & FLAG_BROADCAST));
+
+    len = BuildReboot(2, "10.0.200.1", "10.1.0.1", request);
+    len = DHCPServerHandle(server, request, len, reply, sizeof(reply), 0);
+    type = FindOption(reply, len, 53, 1);
+    assert(NULL != type && DHCPNAK == *type);
+    assert(0 != (reply[OFF_FLAGS] & FLAG_BROADCAST));
+    assert(0 == memcmp(reply + OFF_GIADDR, request + OFF_GIADDR, BYTES_IN_IP));
+
+    len = BuildReboot(2, offered, NULL, request);
+    len = DHCPServerHandle(server, request, len, reply, sizeof(reply), 0);
+    type = FindOption(reply, len, 53, 1);
+    assert(NULL != type && DHCPACK == *type);
+    /* the requested IP follows the message type option */
+    assert(0 == memcmp(reply + OFF_YIADDR, request + OFF_OPTIONS + 5,
+                       BYTES_IN_IP));
+
+    DHCPServerGetStats(server, &stats);
+    assert(1 == stats.dropped && 1 == stats.offers && 2 == stats.naks &&
+           1 == stats.acks);
+    DHCPServerDestroy(server);
+    (void)type;
+    (void)len;
+}
+
+/* a REQUEST from client id with no server id, asking for wanted when it is
+   not NULL, through the relay at relay when that is not NULL */
+static size_t BuildReboot(size_t id, const char *wanted, const char *relay,
+                          unsigned char *packet)
+{
+    unsigned char *option = packet + OFF_OPTIONS;
+    int status = 1;
+
+    memset(packet, 0, OFF_OPTIONS);
+    packet[0] = 1;
+    packet[1] = 1;
+    packet[2] = 6;
+    packet[OFF_XID + 3] = (unsigned char)id;
+    packet[OFF_CHADDR] = 2;
+    packet[OFF_CHADDR + 5] = (unsigned char)id;
+    memcpy(packet + OFF_COOKIE, magic_cookie, sizeof(magic_cookie));
+    if (NULL != relay)
+    {
+        status = inet_pton(AF_INET, relay, packet + OFF_GIADDR);
+        assert(1 == status);
+    }
+
+    *option++ = 53;
+    *option++ = 1;
+    *option++ = DHCPREQUEST;
+    if (NULL != wanted)
+    {
+        *option++ = 50;
+        *option++ = BYTES_IN_IP;
+        status = inet_pton(AF_INET, wanted, option);
+        assert(1 == status);
+        option += BYTES_IN_IP;
+    }
+    *option++ = 255;
+    (void)status;
+
+    return (size_t)(option - packet);
+}
+
+static void *ServerThread(void *server)
+{
+    status_t status = DHCPServerRun((dhcp_server_t *)server);
+
+    assert(DHCP_STATUS_SUCCESS == status);
+    (void)status;
+
+    return NULL;
+}
+
+static void RunLoad(load_t *load)
+{
+    size_t i = 0;
+    size_t num = 0;
+
+    for (i = 0; BATCH > i; ++i)
+    {
+        load->iovs[i].iov_base = load->packets[i];
+        load->msgs[i].msg_hdr.msg_iov = &load->iovs[i];
+        load->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (i = 0; NUM_CLIENTS > i; ++i)
+    {
+        MakeReady(load, i);
+    }
+
+    while (NUM_CLIENTS > load->finished)
+    {
+        while (0 < (num = FillBatch(load, NowNs())))
+        {
+            SendBatch(load, num);
+        }
+        ReceiveBatch(load);
+    }
+}
+
+/* the next messages of ready clients, while the window has room. A
+   RELEASE gets no reply, the client goes on to its next round */
+static size_t FillBatch(load_t *load, double now)
+{
+    client_t *client = NULL;
+    size_t num = 0;
+    size_t id = 0;
+
+    while (BATCH > num && 0 < load->num_ready && WINDOW > load->outstanding)
+    {
+        id = load->ready[load->ready_head];
+        load->ready_head = (load->ready_head + 1) % NUM_CLIENTS;
+        --load->num_ready;
+        client = &load->clients[id];
+
+        if (DONE == client->state)
+        {
+            load->iovs[num].iov_len =
+                BuildRequest(load, id, DHCPRELEASE, load->packets[num]);
+            ++num;
+            ++client->round;
+            if (ROUNDS == client->round)
+            {
+                ++load->finished;
+                continue;
+            }
+            client->state = WANT_OFFER;
+            MakeReady(load, id);
+            continue;
+        }
+
+        load->iovs[num].iov_len =
+            BuildRequest(load, id, (WANT_OFFER == client->state) ?
+                                   DHCPDISCOVER : DHCPREQUEST,
+                         load->packets[num]);
+        ++num;
+        client->waiting = 1;
+        client->sent_at = now;
+        ++load->outstanding;
+    }
+
+    return num;
+}
+
+static void SendBatch(load_t *load, size_t num)
+{
+    size_t done = 0;
+    size_t i = 0;
+    int sent = 0;
+
+    for (i = 0; num > i; ++i)
+    {
+        load->msgs[i].msg_hdr.msg_name = &load->server;
+        load->msgs[i].msg_hdr.msg_namelen = sizeof(load->server);
+    }
+    while (done < num)
+    {
+        sent = sendmmsg(load->sock, load->msgs + done,
+                        (unsigned int)(num - done), 0);
+        assert(0 < sent);
+        done += (size_t)sent;
+    }
+}
+
+/* a reply to an older round or a request that was answered already is
+   a duplicate of a resend and is ignored */
+static void ReceiveBatch(load_t *load)
+{
+    client_t *client = NULL;
+    const unsigned char *type = NULL;
+    const unsigned char *server_id = NULL;
+    unsigned int xid = 0;
+    double now = 0;
+    size_t id = 0;
+    int received = 0;
+    int i = 0;
+
+    for (i = 0; BATCH > i; ++i)
+    {
+        load->iovs[i].iov_len = PACKET_SIZE;
+        load->msgs[i].msg_hdr.msg_name = NULL;
+        load->msgs[i].msg_hdr.msg_namelen = 0;
+    }
+
+    received = recvmmsg(load->sock, load->msgs, BATCH, MSG_WAITFORONE, NULL);
+    now = NowNs();
+    if (0 >= received)
+    {
+        ResendLost(load, now);
+        return;
+    }
+
+    for (i = 0; i < received; ++i)
+    {
+        type = FindOption(load->packets[i], load->msgs[i].msg_len, 53, 1);
+        server_id = FindOption(load->packets[i], load->msgs[i].msg_len, 54,
+                               BYTES_IN_IP);
+        xid = ((unsigned int)load->packets[i][OFF_XID] << 24) |
+              ((unsigned int)load->packets[i][OFF_XID + 1] << 16) |
+              ((unsigned int)load->packets[i][OFF_XID + 2] << 8) |
+              load->packets[i][OFF_XID + 3];
+        id = xid % NUM_CLIENTS;
+        client = &load->clients[id];
+
+        if (NULL == type || NULL == server_id ||
+            xid / NUM_CLIENTS != client->round || !client->waiting ||
+            (WANT_OFFER == client->state && DHCPOFFER != *type) ||
+            (WANT_ACK == client->state && DHCPACK != *type))
+        {
+            continue;
+        }
+
+        load->latencies[load->num_latencies++] = now - client->sent_at;
+        client->waiting = 0;
+        --load->outstanding;
+        if (WANT_OFFER == client->state)
+        {
+            memcpy(client->ip, load->packets[i] + OFF_YIADDR, BYTES_IN_IP);
+            memcpy(client->server_id, server_id, BYTES_IN_IP);
+            client->state = WANT_ACK;
+        }
+        else
+        {
+            client->state = DONE;
+        }
+        MakeReady(load, id);
+    }
+}
+
+static void ResendLost(load_t *load, double now)
+{
+    size_t i = 0;
+
+    for (i = 0; NUM_CLIENTS > i; ++i)
+    {
+        if (load->clients[i].waiting &&
+            RESEND_NS < now - load->clients[i].sent_at)
+        {
+            load->clients[i].waiting = 0;
+            --load->outstanding;
+            ++load->resent;
+            MakeReady(load, i);
+        }
+    }
+}
+
+/* client id has the MAC 02:00:00:00:hi:lo and xid round * NUM_CLIENTS + id */
+static size_t BuildRequest(const load_t *load, size_t id, int type,
+                           unsigned char *packet)
+{
+    const client_t *client = &load->clients[id];
+    unsigned int xid = client->round * NUM_CLIENTS + (unsigned int)id;
+    unsigned char *option = packet + OFF_OPTIONS;
+
+    memset(packet, 0, OFF_OPTIONS);
+    packet[0] = 1;
+    packet[1] = 1;
+    packet[2] = 6;
+    packet[OFF_XID] = (unsigned char)(xid >> 24);
+    packet[OFF_XID + 1] = (unsigned char)(xid >> 16);
+    packet[OFF_XID + 2] = (unsigned char)(xid >> 8);
+    packet[OFF_XID + 3] = (unsigned char)xid;
+    packet[OFF_CHADDR] = 2;
+    packet[OFF_CHADDR + 4] = (unsigned char)(id >> 8);
+    packet[OFF_CHADDR + 5] = (unsigned char)id;
+    memcpy(packet + OFF_COOKIE, magic_cookie, sizeof(magic_cookie));
+
+    *option++ = 53;
+    *option++ = 1;
+    *option++ = (unsigned char)type;
+    if (DHCPREQUEST == type)
+    {
+        *option++ = 50;
+        *option++ = BYTES_IN_IP;
+        memcpy(option, client->ip, BYTES_IN_IP);
+        option += BYTES_IN_IP;
+        *option++ = 54;
+        *option++ = BYTES_IN_IP;
+        memcpy(option, client->server_id, BYTES_IN_IP);
+        option += BYTES_IN_IP;
+    }
+    else if (DHCPRELEASE == type)
+    {
+        memcpy(packet + OFF_CIADDR, client->ip, BYTES_IN_IP);
+    }
+    *option++ = 255;
+
+    return (size_t)(option - packet);
+}
+
+/* the value of option code in a BOOTREPLY, NULL if it is missing or is
+   not size bytes long */
+static const unsigned char *FindOption(const unsigned char *packet,
+                                       size_t len, int code, size_t size)
+{
+    size_t pos = OFF_OPTIONS;
+
+    if (OFF_OPTIONS > len || 2 != packet[0] ||
+        0 != memcmp(packet + OFF_COOKIE, magic_cookie, sizeof(magic_cookie)))
+    {
+        return NULL;
+    }
+
+    while (pos + 1 < len && 255 != packet[pos])
+    {
+        if (0 == packet[pos])
+        {
+            ++pos;
+            continue;
+        }
+        if (code == packet[pos] && size == packet[pos + 1] &&
+            pos + 2 + size <= len)
+        {
+            return packet + pos + 2;
+        }
+        pos += 2 + packet[pos + 1];
+    }
+
+    return NULL;
+}
+
+static void MakeReady(load_t *load, size_t id)
+{
+    load->ready[(load->ready_head + load->num_ready) % NUM_CLIENTS] = id;
+    ++load->num_ready;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double diff = *(const double *)a - *(const double *)b;
+
+    return (0 < diff) - (0 > diff);
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((double)now.tv_sec * 1e9 + (double)now.tv_nsec);
+}
@@ -0,0 +1,758 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 dhcp_test.c ../src/dhcp.c ../src/hbitmap.c ../src/cbitmap.c -I../inc -pthread -o dhcp.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf, tmpfile */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* lseek */
+#include <pthread.h> /* pthread_create */
+
+#include "dhcp.h" /* dhcp_t */
+
+#define CHURN_OPS (1000000)
+#define CHURN_FILL_PERCENT (90)
+#define BULK_HOSTS (65536)
+#define MAX_THREADS (32)
+#define THREAD_OPS (200000)
+#define THREAD_HELD (64)
+#define JOURNAL_OPS (1000000)
+#define SWEEP_OPS (50000)
+#define COUNT_OPS (100)
+#define QUERY_OPS (4000)
+#define QUERY_ROUNDS (16)
+
+static const unsigned char subnet[BYTES_IN_IP] = {10, 0, 0, 0};
+/* in tenths of a percent of the usable addresses */
+static const size_t fill_permille[] = {0, 250, 500, 750, 900, 990, 999};
+static const char *engine_names[] = {"trie", "bitmap", "concurrent"};
+
+typedef enum workload
+{
+    SEQUENTIAL = 0,
+    REQUESTED,
+    RANDOM_FREE,
+    NUM_WORKLOADS
+} workload_t;
+
+static double NowNs(void);
+static long RssKB(void);
+static void HostToIp(unsigned int host, unsigned char ip[BYTES_IN_IP]);
+static unsigned int IpToHost(const unsigned char ip[BYTES_IN_IP],
+                             size_t bits_in_subnet);
+static void TestFreeQueries(size_t bits_in_subnet, dhcp_backend_t backend);
+static void CheckFreeQueries(const dhcp_t *dhcp, const unsigned char *model,
+                             size_t bits_in_subnet);
+static void Sweep(size_t bits_in_subnet, dhcp_backend_t backend);
+static double Workload(dhcp_t *dhcp, size_t bits_in_subnet,
+                       unsigned int *taken, size_t count,
+                       workload_t workload);
+static void Churn(size_t bits_in_subnet, dhcp_backend_t backend);
+static void Bulk(size_t bits_in_subnet, dhcp_backend_t backend);
+static void Snapshot(size_t bits_in_subnet, dhcp_backend_t backend,
+                     int scattered);
+static double Threads(dhcp_backend_t backend, size_t num_threads,
+                      size_t num_pools);
+static void *ThreadChurn(void *arg);
+
+/* the bitmap backend needs one lock around every call to be shared.
+   With two pools every thread uses them in turn */
+typedef struct shared_pool
+{
+    dhcp_t *dhcp[2];
+    size_t num_pools;
+    pthread_mutex_t lock;
+    int use_lock;
+} shared_pool_t;
+
+int main(void)
+{
+    size_t bits = 0;
+    size_t threads = 0;
+
+    for (bits = 28; bits >= 16; bits -= 6)
+    {
+        TestFreeQueries(bits, DHCP_BACKEND_TRIE);
+        TestFreeQueries(bits, DHCP_BACKEND_BITMAP);
+        TestFreeQueries(bits, DHCP_BACKEND_CONCURRENT);
+    }
+
+    printf("ns/op at each fill level, rss in bytes per allocated address\n");
+    printf("%-7s %-10s %6s %9s %9s %8s %8s %8s %8s %8s\n", "subnet",
+           "engine", "fill", "allocated", "free", "rss", "seq", "req",
+           "rfree", "count");
+    for (bits = 24; bits >= 8; bits -= 4)
+    {
+        Sweep(bits, DHCP_BACKEND_TRIE);
+        Sweep(bits, DHCP_BACKEND_BITMAP);
+        Sweep(bits, DHCP_BACKEND_CONCURRENT);
+    }
+
+    printf("\n%-7s %-6s %12s %12s %12s\n", "subnet", "engine", "fill ns/op",
+           "drain ns/op", "churn ns/op");
+    for (bits = 20; bits >= 12; bits -= 4)
+    {
+        Churn(bits, DHCP_BACKEND_TRIE);
+        Churn(bits, DHCP_BACKEND_BITMAP);
+    }
+
+    printf("\n%d addresses, us per batch\n", BULK_HOSTS);
+    printf("%-7s %-6s %10s %10s %10s %10s %10s %10s\n", "subnet", "engine",
+           "alloc 1x1", "many", "free 1x1", "many", "reserve", "release");
+    for (bits = 20; bits >= 12; bits -= 4)
+    {
+        Bulk(bits, DHCP_BACKEND_TRIE);
+        Bulk(bits, DHCP_BACKEND_BITMAP);
+    }
+
+    printf("\n/12 snapshot and journal\n");
+    printf("%-9s %-6s %10s %9s %9s %10s %10s %10s\n", "fill", "engine",
+           "bytes", "save ms", "load ms", "load GB/s", "journal ns",
+           "replay ms");
+    Snapshot(12, DHCP_BACKEND_TRIE, 0);
+    Snapshot(12, DHCP_BACKEND_BITMAP, 0);
+    Snapshot(12, DHCP_BACKEND_TRIE, 1);
+    Snapshot(12, DHCP_BACKEND_BITMAP, 1);
+
+    printf("\n/16 at half full, each thread allocates and frees, Mops/s\n");
+    printf("(two pools: a /20 and a /12, both half full, used in turn)\n");
+    printf("%-8s %14s %14s %14s\n", "threads", "bitmap+lock", "concurrent",
+           "two pools");
+    for (threads = 1; threads <= MAX_THREADS; threads *= 2)
+    {
+        printf("%-8lu %14.2f %14.2f %14.2f\n", (unsigned long)threads,
+               Threads(DHCP_BACKEND_BITMAP, threads, 1),
+               Threads(DHCP_BACKEND_CONCURRENT, threads, 1),
+               Threads(DHCP_BACKEND_CONCURRENT, threads, 2));
+    }
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static void HostToIp(unsigned int host, unsigned char ip[BYTES_IN_IP])
+{
+    unsigned int addr = ((unsigned int)subnet[0] << 24) | host;
+
+    ip[0] = addr >> 24;
+    ip[1] = addr >> 16;
+    ip[2] = addr >> 8;
+    ip[3] = addr;
+}
+
+static unsigned int IpToHost(const unsigned char ip[BYTES_IN_IP],
+                             size_t bits_in_subnet)
+{
+    unsigned int addr = ((unsigned int)ip[0] << 24) | (ip[1] << 16) |
+                        (ip[2] << 8) | ip[3];
+
+    return (addr & (0xFFFFFFFFU >> bits_in_subnet));
+}
+
+/* resident pages from /proc, assuming 4KB pages */
+static long RssKB(void)
+{
+    FILE *statm = fopen("/proc/self/statm", "r");
+    long size = 0;
+    long resident = 0;
+
+    if (NULL == statm)
+    {
+        return -1;
+    }
+    if (2 != fscanf(statm, "%ld %ld", &size, &resident))
+    {
+        resident = -1;
+    }
+    fclose(statm);
+
+    return ((0 > resident) ? -1 : resident * 4);
+}
+
+/* random allocations, frees and range changes, mirrored on one byte per
+   host. The network, server and broadcast addresses are never free */
+static void TestFreeQueries(size_t bits_in_subnet, dhcp_backend_t backend)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    unsigned char *model = (unsigned char *)calloc(hosts, 1);
+    dhcp_t *dhcp = DHCPCreateWithBackend(subnet, bits_in_subnet, backend);
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char last_ip[BYTES_IN_IP];
+    unsigned char result[BYTES_IN_IP];
+    const unsigned char *requested = NULL;
+    unsigned int host = 0;
+    unsigned int last = 0;
+    size_t op = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != model && NULL != dhcp);
+    model[0] = 1;
+    model[hosts - 2] = 1;
+    model[hosts - 1] = 1;
+    CheckFreeQueries(dhcp, model, bits_in_subnet);
+
+    for (op = 0; QUERY_OPS > op; ++op)
+    {
+        /* hosts below the server address, where every change is allowed */
+        host = 1 + (unsigned int)rand() % (hosts - 3);
+        last = host + (unsigned int)rand() % 64;
+        last = (last > hosts - 3) ? hosts - 3 : last;
+        HostToIp(host, ip);
+        HostToIp(last, last_ip);
+
+        switch (rand() % 5)
+        {
+            case 0:
+            case 1:
+                /* a requested host that is free is the one given */
+                requested = (0 == rand() % 3) ? NULL : ip;
+                status = DHCPAllocateIP(dhcp, result, requested);
+                if (DHCP_STATUS_SUCCESS == status)
+                {
+                    assert(NULL == requested || model[host] ||
+                           host == IpToHost(result, bits_in_subnet));
+                    host = IpToHost(result, bits_in_subnet);
+                    assert(!model[host]);
+                    model[host] = 1;
+                }
+                break;
+            case 2:
+                status = DHCPFreeIP(dhcp, ip);
+                assert((DHCP_STATUS_SUCCESS == status) == model[host]);
+                model[host] = 0;
+                break;
+            case 3:
+                status = DHCPReserveRange(dhcp, ip, last_ip);
+                assert(DHCP_STATUS_SUCCESS == status);
+                memset(model + host, 1, last - host + 1);
+                break;
+            default:
+                status = DHCPReleaseRange(dhcp, ip, last_ip);
+                assert(DHCP_STATUS_SUCCESS == status);
+                memset(model + host, 0, last - host + 1);
+                break;
+        }
+
+        if (0 == op % (QUERY_OPS / QUERY_ROUNDS))
+        {
+            CheckFreeQueries(dhcp, model, bits_in_subnet);
+        }
+    }
+    CheckFreeQueries(dhcp, model, bits_in_subnet);
+
+    DHCPDestroy(dhcp);
+    free(model);
+    (void)status;
+}
+
+/* DHCPCountFree, DHCPGetNthFree and DHCPCountFreeInRange against plain
+   loops over the model, at the ends and at random */
+static void CheckFreeQueries(const dhcp_t *dhcp, const unsigned char *model,
+                             size_t bits_in_subnet)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char last_ip[BYTES_IN_IP];
+    size_t free_count = 0;
+    size_t expected = 0;
+    size_t nth = 0;
+    size_t first = 0;
+    size_t last = 0;
+    size_t round = 0;
+    size_t i = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    for (i = 0; hosts > i; ++i)
+    {
+        free_count += !model[i];
+    }
+    assert(free_count == DHCPCountFree(dhcp));
+
+    for (round = 0; QUERY_ROUNDS > round; ++round)
+    {
+        /* the first, the last, one past the last, and random ones */
+        nth = (0 == round) ? 0 :
+              (1 == round) ? free_count - 1 :
+              (2 == round) ? free_count :
+              (size_t)rand() % (free_count + 1);
+        expected = 0;
+        for (i = 0; hosts > i; ++i)
+        {
+            if (!model[i] && nth == expected++)
+            {
+                break;
+            }
+        }
+        status = DHCPGetNthFree(dhcp, nth, ip);
+        if (hosts == i)
+        {
+            assert(DHCP_STATUS_FAIL == status);
+        }
+        else
+        {
+            assert(DHCP_STATUS_SUCCESS == status);
+            assert(i == IpToHost(ip, bits_in_subnet));
+        }
+
+        /* the whole subnet, single hosts, the reserved ends, and random */
+        first = (0 == round) ? 0 : (size_t)rand() % hosts;
+        last = (0 == round) ? hosts - 1 :
+               (1 == round) ? first :
+               first + (size_t)rand() % (hosts - first);
+        expected = 0;
+        for (i = first; last >= i; ++i)
+        {
+            expected += !model[i];
+        }
+        HostToIp((unsigned int)first, ip);
+        HostToIp((unsigned int)last, last_ip);
+        assert(expected == DHCPCountFreeInRange(dhcp, ip, last_ip));
+    }
+    (void)status;
+    (void)expected;
+}
+
+/* one pool per subnet and engine, filled lowest first up to each level in
+   turn. Every op of a workload leaves the fill level as it was:
+   seq:   allocate the first free address and free it again
+   req:   free a random taken address and request a random one
+   rfree: free a random taken address and allocate the first free one
+   count is DHCPCountFree. rss is what the process grew by since the pool
+   was created, so freed trie nodes kept by malloc are in it */
+static void Sweep(size_t bits_in_subnet, dhcp_backend_t backend)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    unsigned int *taken = (unsigned int *)malloc(hosts * sizeof(unsigned int));
+    dhcp_t *dhcp = NULL;
+    unsigned char ip[BYTES_IN_IP];
+    char rss_text[16];
+    double ns[NUM_WORKLOADS + 1];
+    size_t usable = 0;
+    size_t free_count = 0;
+    size_t target = 0;
+    size_t count = 0;
+    size_t level = 0;
+    size_t i = 0;
+    long rss = 0;
+    int workload = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != taken);
+    memset(taken, 0, hosts * sizeof(unsigned int));
+    rss = RssKB();
+    dhcp = DHCPCreateWithBackend(subnet, bits_in_subnet, backend);
+    assert(NULL != dhcp);
+    usable = DHCPCountFree(dhcp);
+
+    for (level = 0; sizeof(fill_permille) / sizeof(size_t) > level; ++level)
+    {
+        target = usable * fill_permille[level] / 1000;
+        while (count < target)
+        {
+            status = DHCPAllocateIP(dhcp, ip, NULL);
+            assert(DHCP_STATUS_SUCCESS == status);
+            taken[count++] = IpToHost(ip, bits_in_subnet);
+        }
+
+        for (workload = 0; NUM_WORKLOADS > workload; ++workload)
+        {
+            ns[workload] = Workload(dhcp, bits_in_subnet, taken, count,
+                                    (workload_t)workload);
+        }
+        ns[NUM_WORKLOADS] = NowNs();
+        for (i = 0; COUNT_OPS > i; ++i)
+        {
+            free_count = DHCPCountFree(dhcp);
+        }
+        ns[NUM_WORKLOADS] = (NowNs() - ns[NUM_WORKLOADS]) / COUNT_OPS;
+        assert(usable - count == free_count);
+
+        sprintf(rss_text, "-");
+        if (0 < count)
+        {
+            sprintf(rss_text, "%.1f", (RssKB() - rss) * 1024.0 / count);
+        }
+        printf("/%-6lu %-10s %5.1f%% %9lu %9lu %8s %8.1f %8.1f %8.1f %8.1f\n",
+               (unsigned long)bits_in_subnet, engine_names[backend],
+               fill_permille[level] / 10.0, (unsigned long)count,
+               (unsigned long)free_count, rss_text, ns[SEQUENTIAL],
+               ns[REQUESTED], ns[RANDOM_FREE], ns[NUM_WORKLOADS]);
+    }
+
+    DHCPDestroy(dhcp);
+    free(taken);
+    (void)status;
+}
+
+/* an empty pool has nothing to free first, there every workload
+   allocates and then frees what it got */
+static double Workload(dhcp_t *dhcp, size_t bits_in_subnet,
+                       unsigned int *taken, size_t count,
+                       workload_t workload)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char requested[BYTES_IN_IP];
+    const unsigned char *want = (REQUESTED == workload) ? requested : NULL;
+    size_t pick = 0;
+    size_t i = 0;
+    double ns = NowNs();
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    for (i = 0; SWEEP_OPS > i; ++i)
+    {
+        HostToIp((unsigned int)((size_t)rand() % hosts), requested);
+        if (SEQUENTIAL == workload || 0 == count)
+        {
+            status = DHCPAllocateIP(dhcp, ip, want);
+            assert(DHCP_STATUS_SUCCESS == status);
+            status = DHCPFreeIP(dhcp, ip);
+            assert(DHCP_STATUS_SUCCESS == status);
+            continue;
+        }
+
+        pick = (size_t)rand() % count;
+        HostToIp(taken[pick], ip);
+        status = DHCPFreeIP(dhcp, ip);
+        assert(DHCP_STATUS_SUCCESS == status);
+        status = DHCPAllocateIP(dhcp, ip, want);
+        assert(DHCP_STATUS_SUCCESS == status);
+        taken[pick] = IpToHost(ip, bits_in_subnet);
+    }
+    (void)status;
+
+    return ((NowNs() - ns) / (2 * SWEEP_OPS));
+}
+
+/* fill: first-free allocations until the pool is full
+   drain: free every address in random order
+   churn: at 90% full, free a random taken address and request a random
+          one, which lands on the next free address when it is taken */
+static void Churn(size_t bits_in_subnet, dhcp_backend_t backend)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    unsigned int *taken = (unsigned int *)malloc(hosts * sizeof(unsigned int));
+    dhcp_t *dhcp = DHCPCreateWithBackend(subnet, bits_in_subnet, backend);
+    unsigned char ip[BYTES_IN_IP];
+    unsigned char requested[BYTES_IN_IP];
+    size_t count = 0;
+    size_t pick = 0;
+    size_t i = 0;
+    double fill_ns = 0;
+    double drain_ns = 0;
+    double churn_ns = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != taken && NULL != dhcp);
+
+    fill_ns = NowNs();
+    while (DHCP_STATUS_SUCCESS == DHCPAllocateIP(dhcp, ip, NULL))
+    {
+        taken[count++] = IpToHost(ip, bits_in_subnet);
+    }
+    fill_ns = (NowNs() - fill_ns) / count;
+    assert(0 == DHCPCountFree(dhcp));
+
+    drain_ns = NowNs();
+    for (i = count; 0 < i; --i)
+    {
+        pick = (size_t)rand() % i;
+        HostToIp(taken[pick], ip);
+        status = DHCPFreeIP(dhcp, ip);
+        assert(DHCP_STATUS_SUCCESS == status);
+        taken[pick] = taken[i - 1];
+        taken[i - 1] = IpToHost(ip, bits_in_subnet);
+    }
+    drain_ns = (NowNs() - drain_ns) / count;
+
+    count = 0;
+    for (i = 0; i < hosts / 100 * CHURN_FILL_PERCENT; ++i)
+    {
+        status = DHCPAllocateIP(dhcp, ip, NULL);
+        assert(DHCP_STATUS_SUCCESS == status);
+        taken[count++] = IpToHost(ip, bits_in_subnet);
+    }
+
+    churn_ns = NowNs();
+    for (i = 0; i < CHURN_OPS; ++i)
+    {
+        pick = (size_t)rand() % count;
+        HostToIp(taken[pick], ip);
+        status = DHCPFreeIP(dhcp, ip);
+        assert(DHCP_STATUS_SUCCESS == status);
+        HostToIp((unsigned int)rand() % hosts, requested);
+        status = DHCPAllocateIP(dhcp, ip, requested);
+        assert(DHCP_STATUS_SUCCESS == status);
+        taken[pick] = IpToHost(ip, bits_in_subnet);
+    }
+    churn_ns = (NowNs() - churn_ns) / (2 * CHURN_OPS);
+
+    printf("/%-6lu %-6s %12.1f %12.1f %12.1f\n", (unsigned long)bits_in_subnet,
+           (DHCP_BACKEND_TRIE == backend) ? "trie" : "bitmap",
+           fill_ns, drain_ns, churn_ns);
+
+    DHCPDestroy(dhcp);
+    free(taken);
+    (void)status;
+}
+
+/* provisioning and reclaiming a block of addresses one call per address
+   against DHCPAllocateMany/DHCPFreeMany, and the same block as a range */
+static void Bulk(size_t bits_in_subnet, dhcp_backend_t backend)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    size_t batch = (BULK_HOSTS < hosts / 2) ? BULK_HOSTS : hosts / 2;
+    unsigned char *ips = (unsigned char *)malloc(batch * BYTES_IN_IP);
+    dhcp_t *dhcp = DHCPCreateWithBackend(subnet, bits_in_subnet, backend);
+    unsigned char first[BYTES_IN_IP];
+    unsigned char last[BYTES_IN_IP];
+    double ns[6];
+    size_t i = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != ips && NULL != dhcp);
+
+    ns[0] = NowNs();
+    for (i = 0; i < batch; ++i)
+    {
+        status = DHCPAllocateIP(dhcp, ips + i * BYTES_IN_IP, NULL);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    ns[0] = NowNs() - ns[0];
+
+    ns[2] = NowNs();
+    for (i = 0; i < batch; ++i)
+    {
+        status = DHCPFreeIP(dhcp, ips + i * BYTES_IN_IP);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    ns[2] = NowNs() - ns[2];
+
+    ns[1] = NowNs();
+    status = DHCPAllocateMany(dhcp, batch, ips);
+    assert(DHCP_STATUS_SUCCESS == status);
+    ns[1] = NowNs() - ns[1];
+
+    ns[3] = NowNs();
+    status = DHCPFreeMany(dhcp, batch, ips);
+    assert(DHCP_STATUS_SUCCESS == status);
+    ns[3] = NowNs() - ns[3];
+
+    HostToIp((unsigned int)(batch / 2), first);
+    HostToIp((unsigned int)(batch / 2 + batch - 1), last);
+    ns[4] = NowNs();
+    status = DHCPReserveRange(dhcp, first, last);
+    assert(DHCP_STATUS_SUCCESS == status);
+    ns[4] = NowNs() - ns[4];
+
+    ns[5] = NowNs();
+    status = DHCPReleaseRange(dhcp, first, last);
+    assert(DHCP_STATUS_SUCCESS == status);
+    ns[5] = NowNs() - ns[5];
+    assert(hosts - 3 == DHCPCountFree(dhcp));
+
+    printf("/%-6lu %-6s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           (unsigned long)bits_in_subnet,
+           (DHCP_BACKEND_TRIE == backend) ? "trie" : "bitmap",
+           ns[0] / 1000, ns[1] / 1000, ns[2] / 1000, ns[3] / 1000,
+           ns[4] / 1000, ns[5] / 1000);
+
+    DHCPDestroy(dhcp);
+    free(ips);
+    (void)status;
+}
+
+/* a pool 90% full in one run, or every other host taken at random, is
+   saved and loaded back. load GB/s is against the size of a bitmap of the
+   pool. Then a random allocation and a random free, which may find the
+   host free already, go to a journal for each op, and the journal is
+   replayed on the loaded pool */
+static void Snapshot(size_t bits_in_subnet, dhcp_backend_t backend,
+                     int scattered)
+{
+    size_t hosts = (size_t)1 << (32 - bits_in_subnet);
+    dhcp_t *dhcp = DHCPCreateWithBackend(subnet, bits_in_subnet, backend);
+    dhcp_t *loaded = NULL;
+    FILE *snapshot = tmpfile();
+    FILE *journal = tmpfile();
+    unsigned char first[BYTES_IN_IP];
+    unsigned char last[BYTES_IN_IP];
+    unsigned char ip[BYTES_IN_IP];
+    long bytes = 0;
+    size_t i = 0;
+    double save_ns = 0;
+    double load_ns = 0;
+    double journal_ns = 0;
+    double replay_ns = 0;
+    status_t status = DHCP_STATUS_SUCCESS;
+
+    assert(NULL != dhcp && NULL != snapshot && NULL != journal);
+
+    if (!scattered)
+    {
+        HostToIp(1, first);
+        HostToIp((unsigned int)(hosts / 10 * 9), last);
+        status = DHCPReserveRange(dhcp, first, last);
+        assert(DHCP_STATUS_SUCCESS == status);
+    }
+    for (i = 1; scattered && i < hosts - 2; ++i)
+    {
+        HostToIp((unsigned int)i, ip);
+        if (rand() & 1)
+        {
+            status = DHCPReserveRange(dhcp, ip, ip);
+            assert(DHCP_STATUS_SUCCESS == status);
+        }
+    }
+
+    save_ns = NowNs();
+    status = DHCPSave(dhcp, fileno(snapshot));
+    assert(DHCP_STATUS_SUCCESS == status);
+    save_ns = NowNs() - save_ns;
+    bytes = (long)lseek(fileno(snapshot), 0, SEEK_END);
+
+    lseek(fileno(snapshot), 0, SEEK_SET);
+    load_ns = NowNs();
+    loaded = DHCPLoad(fileno(snapshot), backend);
+    load_ns = NowNs() - load_ns;
+    assert(NULL != loaded && DHCPCountFree(dhcp) == DHCPCountFree(loaded));
+
+    status = DHCPJournalStart(dhcp, fileno(journal));
+    assert(DHCP_STATUS_SUCCESS == status);
+    journal_ns = NowNs();
+    for (i = 0; i < JOURNAL_OPS; ++i)
+    {
+        HostToIp((unsigned int)rand() % hosts, first);
+        DHCPAllocateIP(dhcp, ip, first);
+        HostToIp((unsigned int)rand() % hosts, ip);
+        DHCPFreeIP(dhcp, ip);
+    }
+    status = DHCPJournalFlush(dhcp);
+    assert(DHCP_STATUS_SUCCESS == status);
+    journal_ns = (NowNs() - journal_ns) / (2 * JOURNAL_OPS);
+
+    lseek(fileno(journal), 0, SEEK_SET);
+    replay_ns = NowNs();
+    status = DHCPJournalReplay(loaded, fileno(journal));
+    assert(DHCP_STATUS_SUCCESS == status);
+    replay_ns = NowNs() - replay_ns;
+    assert(DHCPCountFree(dhcp) == DHCPCountFree(loaded));
+
+    printf("%-9s %-6s %10ld %9.2f %9.2f %10.2f %10.1f %10.2f\n",
+           scattered ? "scattered" : "one run",
+           (DHCP_BACKEND_TRIE == backend) ? "trie" : "bitmap", bytes,
+           save_ns / 1e6, load_ns / 1e6, (double)hosts / 8 / load_ns,
+           journal_ns, replay_ns / 1e6);
+
+    DHCPDestroy(loaded);
+    DHCPDestroy(dhcp);
+    fclose(journal);
+    fclose(snapshot);
+    (void)status;
+}
+
+/* a /16 filled to half, then every thread keeps THREAD_HELD addresses
+   and frees its oldest one for each new one. Two pools are a /20 and a
+   /12 filled to half, and each thread starts in the small one */
+static double Threads(dhcp_backend_t backend, size_t num_threads,
+                      size_t num_pools)
+{
+    pthread_t threads[MAX_THREADS];
+    size_t bits[2][2] = {{16, 0}, {20, 12}};
+    shared_pool_t pool;
+    unsigned char ip[BYTES_IN_IP];
+    double ns = 0;
+    size_t p = 0;
+    size_t i = 0;
+    int status = 0;
+
+    pool.num_pools = num_pools;
+    pool.use_lock = (DHCP_BACKEND_CONCURRENT != backend);
+    for (p = 0; p < num_pools; ++p)
+    {
+        pool.dhcp[p] = DHCPCreateWithBackend(subnet, bits[num_pools - 1][p],
+                                             backend);
+        assert(NULL != pool.dhcp[p]);
+        for (i = 0; i < (size_t)1 << (31 - bits[num_pools - 1][p]); ++i)
+        {
+            status = DHCPAllocateIP(pool.dhcp[p], ip, NULL);
+            assert(DHCP_STATUS_SUCCESS == status);
+        }
+    }
+    status = pthread_mutex_init(&pool.lock, NULL);
+    assert(0 == status);
+
+    ns = NowNs();
+    for (i = 0; i < num_threads; ++i)
+    {
+        status = pthread_create(&threads[i], NULL, ThreadChurn, &pool);
+        assert(0 == status);
+    }
+    for (i = 0; i < num_threads; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    ns = NowNs() - ns;
+
+    pthread_mutex_destroy(&pool.lock);
+    for (p = 0; p < num_pools; ++p)
+    {
+        DHCPDestroy(pool.dhcp[p]);
+    }
+    (void)status;
+
+    return (2.0 * THREAD_OPS * num_threads / ns * 1000);
+}
+
+static void *ThreadChurn(void *arg)
+{
+    shared_pool_t *pool = (shared_pool_t *)arg;
+    unsigned char held[THREAD_HELD][BYTES_IN_IP];
+    dhcp_t *dhcp = NULL;
+    size_t i = 0;
+
+    for (i = 0; i < THREAD_OPS + THREAD_HELD; ++i)
+    {
+        if (pool->use_lock)
+        {
+            pthread_mutex_lock(&pool->lock);
+        }
+
+        /* THREAD_HELD is even, so a held address goes back to its pool */
+        dhcp = pool->dhcp[i % THREAD_HELD % pool->num_pools];
+        if (THREAD_HELD <= i)
+        {
+            DHCPFreeIP(dhcp, held[i % THREAD_HELD]);
+        }
+        if (i < THREAD_OPS)
+        {
+            DHCPAllocateIP(dhcp, held[i % THREAD_HELD], NULL);
+        }
+
+        if (pool->use_lock)
+        {
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,606 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, qsort */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "dlist.h" /* dlist_t */
+
+#define MIN_ELEMENTS (10000)
+#define MAX_ELEMENTS (10000000)
+#define KEY_RANGE (1000)
+#define POOL_CHUNK (4)
+#define POOL_NODES (10)
+#define LINKS (6)
+#define SPLIT_ELEMENTS (16)
+
+typedef struct record
+{
+    unsigned long key;
+    size_t order;
+} record_t;
+
+typedef struct item
+{
+    int value;
+    dlist_link_t link;
+} item_t;
+
+static double NowNs(void);
+static dlist_t *Build(record_t *records, size_t count);
+static double SortByCopy(dlist_t **list);
+static void CheckSorted(dlist_t *list, size_t count);
+static void TestMerge(void);
+static void TestPool(void);
+static void TestIntrusive(void);
+static void TestConcat(void);
+static void TestSplit(void);
+static void TestCounts(void);
+static dlist_t *MakeList(int first, int count);
+static void CheckList(const dlist_t *list, const int *expected, size_t count);
+static void PushNodes(dlist_t *list, struct node **nodes, size_t count);
+static size_t CountFrom(struct node **reused, struct node **nodes,
+                        size_t count);
+static void CheckLinks(const dlist_link_t *head, const int *values,
+                       size_t count);
+static int CompareRecords(const void *data1, const void *data2);
+static int CompareRecordPointers(const void *data1, const void *data2);
+
+static int split_values[SPLIT_ELEMENTS] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                            11, 12, 13, 14, 15};
+
+int main(void)
+{
+    record_t *records = NULL;
+    dlist_t *list = NULL;
+    size_t elements = 0;
+    size_t i = 0;
+    double start = 0;
+    double sort_ns = 0;
+    double copy_ns = 0;
+
+    TestMerge();
+    TestPool();
+    TestIntrusive();
+    TestConcat();
+    TestSplit();
+    TestCounts();
+
+    records = (record_t *)malloc(MAX_ELEMENTS * sizeof(record_t));
+    assert(NULL != records);
+    srand(26);
+
+    printf("%10s %16s %22s\n", "elements", "DListSort ms", "copy+qsort+rebuild ms");
+    for (elements = MIN_ELEMENTS; elements <= MAX_ELEMENTS; elements *= 10)
+    {
+        /* few distinct keys, so stability is checked through "order" */
+        for (i = 0; i < elements; ++i)
+        {
+            records[i].key = (unsigned long)rand() % KEY_RANGE;
+            records[i].order = i;
+        }
+
+        list = Build(records, elements);
+        start = NowNs();
+        DListSort(list, CompareRecords);
+        sort_ns = NowNs() - start;
+        CheckSorted(list, elements);
+        DListDestroy(list);
+
+        list = Build(records, elements);
+        copy_ns = SortByCopy(&list);
+        CheckSorted(list, elements);
+        DListDestroy(list);
+
+        printf("%10lu %16.1f %22.1f\n", (unsigned long)elements,
+               sort_ns / 1e6, copy_ns / 1e6);
+    }
+    free(records);
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static dlist_t *Build(record_t *records, size_t count)
+{
+    dlist_t *list = DListCreate();
+    dlist_iter_t iter;
+    size_t i = 0;
+
+    assert(NULL != list);
+    for (i = 0; i < count; ++i)
+    {
+        iter = DListPushBack(list, records + i);
+        assert(!DListIsIterSame(DListEnd(list), iter));
+    }
+    (void)iter;
+
+    return list;
+}
+
+/* the way a list was sorted before DListSort: copy out, qsort, and build
+   a new list with a malloc per node. qsort is not stable, so the order
+   field breaks ties */
+static double SortByCopy(dlist_t **list)
+{
+    size_t count = DListCount(*list);
+    record_t **array = (record_t **)malloc(count * sizeof(record_t *));
+    dlist_t *sorted = NULL;
+    dlist_iter_t iter;
+    double start = 0;
+    size_t i = 0;
+
+    assert(NULL != array);
+
+    start = NowNs();
+    for (iter = DListBegin(*list); !DListIsIterSame(iter, DListEnd(*list));
+         iter = DListNext(iter))
+    {
+        array[i++] = DListGetData(iter);
+    }
+    qsort(array, count, sizeof(record_t *), CompareRecordPointers);
+    sorted = DListCreate();
+    assert(NULL != sorted);
+    for (i = 0; i < count; ++i)
+    {
+        DListPushBack(sorted, array[i]);
+    }
+    DListDestroy(*list);
+    start = NowNs() - start;
+
+    *list = sorted;
+    free(array);
+
+    return start;
+}
+
+static void CheckSorted(dlist_t *list, size_t count)
+{
+    dlist_iter_t iter = DListBegin(list);
+    record_t *prev = DListGetData(iter);
+    record_t *current = NULL;
+
+    assert(count == DListCount(list));
+    for (iter = DListNext(iter); !DListIsIterSame(iter, DListEnd(list));
+         iter = DListNext(iter))
+    {
+        current = DListGetData(iter);
+        assert(prev->key < current->key ||
+               (prev->key == current->key && prev->order < current->order));
+        assert(DListGetData(DListPrev(iter)) == prev);
+        prev = current;
+    }
+    (void)prev;
+    (void)count;
+}
+
+/* merging the even and odd halves of a sequence gives it back sorted,
+   with the even (dest) record first among equal keys */
+static void TestMerge(void)
+{
+    static record_t records[1000];
+    dlist_t *even = DListCreate();
+    dlist_t *odd = DListCreate();
+    record_t *prev = NULL;
+    record_t *current = NULL;
+    dlist_iter_t iter;
+    size_t i = 0;
+
+    assert(NULL != even && NULL != odd);
+    for (i = 0; i < 1000; ++i)
+    {
+        records[i].key = i / 4;
+        records[i].order = i;
+        DListPushBack((0 == i % 2) ? even : odd, records + i);
+    }
+
+    DListMerge(even, odd, CompareRecords);
+    assert(1000 == DListCount(even));
+    assert(DListIsEmpty(odd) && 0 == DListCount(odd));
+
+    prev = DListGetData(DListBegin(even));
+    for (iter = DListNext(DListBegin(even));
+         !DListIsIterSame(iter, DListEnd(even)); iter = DListNext(iter))
+    {
+        current = DListGetData(iter);
+        assert(prev->key <= current->key);
+        assert(prev->key < current->key ||
+               prev->order % 2 <= current->order % 2);
+        assert(DListGetData(DListPrev(iter)) == prev);
+        prev = current;
+    }
+
+    DListDestroy(even);
+    DListDestroy(odd);
+    (void)prev;
+}
+
+/* nodes come back to the pool they were taken from and are handed out
+   again, across chunks, lists sharing the pool, and a splice into a list
+   without one. A pool node given to free would be caught under ASan */
+static void TestPool(void)
+{
+    dlist_pool_t *pool = DListPoolCreate(POOL_CHUNK);
+    struct node *nodes[POOL_NODES];
+    struct node *reused[POOL_NODES];
+    dlist_t *first = NULL;
+    dlist_t *second = NULL;
+    dlist_t *plain = NULL;
+    dlist_iter_t iter;
+    size_t found = 0;
+    size_t i = 0;
+
+    assert(NULL != pool);
+    first = DListCreateFromPool(pool);
+    second = DListCreateFromPool(pool);
+    plain = DListCreate();
+    assert(NULL != first && NULL != second && NULL != plain);
+
+    /* more than two chunks' worth */
+    PushNodes(first, nodes, POOL_NODES);
+    while (!DListIsEmpty(first))
+    {
+        DListPopFront(first);
+    }
+
+    PushNodes(second, reused, POOL_NODES);
+    found = CountFrom(reused, nodes, POOL_NODES);
+    assert(POOL_NODES == found);
+    iter = DListBegin(second);
+    for (i = 0; i < POOL_NODES; ++i)
+    {
+        assert(reused + i == DListGetData(iter));
+        iter = DListNext(iter);
+    }
+
+    /* spliced out of the pool, removed from a list that has none */
+    DListSplice(DListBegin(second), DListEnd(second), DListEnd(plain));
+    assert(0 == DListCount(second) && POOL_NODES == DListCount(plain));
+    iter = DListBegin(plain);
+    while (!DListIsIterSame(iter, DListEnd(plain)))
+    {
+        iter = DListRemove(iter);
+    }
+    assert(DListIsEmpty(plain));
+
+    PushNodes(first, reused, POOL_NODES);
+    found = CountFrom(reused, nodes, POOL_NODES);
+    assert(POOL_NODES == found);
+
+    /* destroying a pooled list gives its nodes back too */
+    DListDestroy(first);
+    PushNodes(second, reused, POOL_NODES);
+    found = CountFrom(reused, nodes, POOL_NODES);
+    assert(POOL_NODES == found);
+
+    DListDestroy(second);
+    DListDestroy(plain);
+    DListPoolDestroy(pool);
+    (void)found;
+}
+
+/* a circular list of caller owned links, in order both ways after
+   removals from the front, the middle and the back */
+static void TestIntrusive(void)
+{
+    item_t items[LINKS];
+    dlist_link_t head;
+    int all[] = {0, 1, 2, 3, 4, 5};
+    int after_removals[] = {1, 3, 4};
+    int reinserted[] = {0, 1, 3, 4, 5};
+    size_t i = 0;
+
+    DListLinkInit(&head);
+    assert(DListLinkIsEmpty(&head));
+    CheckLinks(&head, NULL, 0);
+
+    for (i = 0; i < LINKS; ++i)
+    {
+        items[i].value = (int)i;
+        DListLinkInsert(&head, &items[i].link);
+        assert(!DListLinkIsEmpty(&head));
+    }
+    CheckLinks(&head, all, LINKS);
+
+    DListLinkRemove(&items[0].link);
+    DListLinkRemove(&items[2].link);
+    DListLinkRemove(&items[LINKS - 1].link);
+    CheckLinks(&head, after_removals, 3);
+
+    /* back in at the front and at the back */
+    DListLinkInsert(head.next, &items[0].link);
+    DListLinkInsert(&head, &items[LINKS - 1].link);
+    CheckLinks(&head, reinserted, 5);
+
+    for (i = 0; i < LINKS; ++i)
+    {
+        if (2 != i)
+        {
+            DListLinkRemove(&items[i].link);
+        }
+    }
+    assert(DListLinkIsEmpty(&head));
+    CheckLinks(&head, NULL, 0);
+}
+
+/* every pair of empty, one element and longer lists. The emptied source
+   has to work as a list afterwards */
+static void TestConcat(void)
+{
+    int sizes[] = {0, 1, 5};
+    int expected[SPLIT_ELEMENTS];
+    dlist_t *dest = NULL;
+    dlist_t *src = NULL;
+    size_t d = 0;
+    size_t s = 0;
+    int i = 0;
+
+    for (d = 0; d < sizeof(sizes) / sizeof(sizes[0]); ++d)
+    {
+        for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        {
+            dest = MakeList(0, sizes[d]);
+            src = MakeList(sizes[d], sizes[s]);
+            for (i = 0; i < sizes[d] + sizes[s]; ++i)
+            {
+                expected[i] = i;
+            }
+
+            DListConcat(dest, src);
+            CheckList(dest, expected, sizes[d] + sizes[s]);
+            CheckList(src, NULL, 0);
+
+            DListPushBack(src, split_values);
+            CheckList(src, expected, 1);
+            DListConcat(dest, src);
+            expected[sizes[d] + sizes[s]] = 0;
+            CheckList(dest, expected, sizes[d] + sizes[s] + 1);
+            CheckList(src, NULL, 0);
+
+            DListDestroy(dest);
+            DListDestroy(src);
+        }
+    }
+}
+
+/* at every position of lists of 0, 1, 2 and more elements, into an empty
+   and a non empty dest. Positions near either end take the two ways of
+   counting the moved part */
+static void TestSplit(void)
+{
+    int expected[SPLIT_ELEMENTS];
+    int sizes[] = {0, 1, 2, 7};
+    dlist_t *src = NULL;
+    dlist_t *dest = NULL;
+    dlist_iter_t where;
+    size_t n = 0;
+    int dest_size = 0;
+    int k = 0;
+    int i = 0;
+
+    for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); ++n)
+    {
+        for (dest_size = 0; dest_size <= 2; dest_size += 2)
+        {
+            for (k = 0; k <= sizes[n]; ++k)
+            {
+                dest = MakeList(0, dest_size);
+                src = MakeList(dest_size, sizes[n]);
+
+                /* End when k is the size */
+                where = DListBegin(src);
+                for (i = 0; i < k; ++i)
+                {
+                    where = DListNext(where);
+                }
+                DListSplit(where, dest);
+
+                for (i = 0; i < k; ++i)
+                {
+                    expected[i] = dest_size + i;
+                }
+                CheckList(src, expected, k);
+                for (i = 0; i < dest_size; ++i)
+                {
+                    expected[i] = i;
+                }
+                for (i = k; i < sizes[n]; ++i)
+                {
+                    expected[dest_size + i - k] = dest_size + i;
+                }
+                CheckList(dest, expected, dest_size + sizes[n] - k);
+
+                DListDestroy(dest);
+                DListDestroy(src);
+            }
+        }
+    }
+}
+
+/* the cached count through every operation that changes it, including
+   iterators taken again from the list a node moved to */
+static void TestCounts(void)
+{
+    int expected[SPLIT_ELEMENTS];
+    dlist_t *first = MakeList(0, 4);
+    dlist_t *second = MakeList(4, 4);
+    dlist_iter_t iter;
+    void *data = NULL;
+
+    /* within a list nothing changes, between lists the range is counted */
+    DListSplice(DListBegin(first), DListNext(DListBegin(first)),
+                DListEnd(first));
+    assert(4 == DListCount(first));
+    DListSplice(DListBegin(second), DListPrev(DListEnd(second)),
+                DListBegin(first));
+    expected[0] = 4;
+    expected[1] = 5;
+    expected[2] = 6;
+    expected[3] = 1;
+    expected[4] = 2;
+    expected[5] = 3;
+    expected[6] = 0;
+    CheckList(first, expected, 7);
+    expected[0] = 7;
+    CheckList(second, expected, 1);
+
+    /* a moved node is removed through an iterator from its new list */
+    iter = DListRemove(DListBegin(first));
+    assert(split_values + 5 == DListGetData(iter));
+    assert(6 == DListCount(first) && 1 == DListCount(second));
+    iter = DListInsert(DListEnd(second), split_values + 8);
+    assert(2 == DListCount(second) && 6 == DListCount(first));
+
+    DListPushFront(first, split_values + 9);
+    assert(7 == DListCount(first));
+    data = DListPopBack(first);
+    assert(split_values + 0 == data && 6 == DListCount(first));
+    data = DListPopFront(first);
+    assert(split_values + 9 == data && 5 == DListCount(first));
+    while (!DListIsEmpty(first))
+    {
+        DListPopFront(first);
+    }
+    assert(0 == DListCount(first));
+
+    DListDestroy(first);
+    DListDestroy(second);
+    (void)iter;
+    (void)data;
+}
+
+/* count elements of split_values starting at first */
+static dlist_t *MakeList(int first, int count)
+{
+    dlist_t *list = DListCreate();
+    dlist_iter_t iter;
+    int i = 0;
+
+    assert(NULL != list);
+    for (i = 0; i < count; ++i)
+    {
+        iter = DListPushBack(list, split_values + first + i);
+        assert(!DListIsIterSame(DListEnd(list), iter));
+    }
+    assert((size_t)count == DListCount(list));
+    (void)iter;
+
+    return list;
+}
+
+/* the values both ways, the count and the empty flag */
+static void CheckList(const dlist_t *list, const int *expected, size_t count)
+{
+    dlist_iter_t iter = DListBegin(list);
+    size_t i = 0;
+
+    assert(count == DListCount(list));
+    assert((0 == count) == DListIsEmpty(list));
+    for (i = 0; i < count; ++i)
+    {
+        assert(expected[i] == *(int *)DListGetData(iter));
+        iter = DListNext(iter);
+    }
+    assert(DListIsIterSame(DListEnd(list), iter));
+
+    for (; 0 < i; --i)
+    {
+        iter = DListPrev(iter);
+        assert(expected[i - 1] == *(int *)DListGetData(iter));
+    }
+    assert(DListIsIterSame(DListBegin(list), iter));
+    (void)expected;
+}
+
+/* pushes count elements and keeps the node behind each */
+static void PushNodes(dlist_t *list, struct node **nodes, size_t count)
+{
+    dlist_iter_t iter;
+    size_t i = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        iter = DListPushBack(list, nodes + i);
+        assert(!DListIsIterSame(DListEnd(list), iter));
+        nodes[i] = iter.node;
+    }
+    assert(count == DListCount(list));
+}
+
+/* how many of reused are among nodes */
+static size_t CountFrom(struct node **reused, struct node **nodes,
+                        size_t count)
+{
+    size_t found = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        for (j = 0; j < count && reused[i] != nodes[j]; ++j)
+        {
+        }
+        found += (j < count);
+    }
+
+    return found;
+}
+
+static void CheckLinks(const dlist_link_t *head, const int *values,
+                       size_t count)
+{
+    const dlist_link_t *link = head->next;
+    size_t i = 0;
+
+    for (i = 0; i < count; ++i, link = link->next)
+    {
+        assert(values[i] == DLIST_LINK_ENTRY(link, const item_t, link)->value);
+        assert(link->next->prev == link);
+    }
+    assert(head == link);
+
+    for (link = head->prev; 0 < i; --i, link = link->prev)
+    {
+        assert(values[i - 1] ==
+               DLIST_LINK_ENTRY(link, const item_t, link)->value);
+    }
+    assert(head == link);
+    (void)values;
+}
+
+static int CompareRecords(const void *data1, const void *data2)
+{
+    const record_t *record1 = data1;
+    const record_t *record2 = data2;
+
+    return (record1->key > record2->key) - (record1->key < record2->key);
+}
+
+static int CompareRecordPointers(const void *data1, const void *data2)
+{
+    const record_t *record1 = *(record_t *const *)data1;
+    const record_t *record2 = *(record_t *const *)data2;
+
+    if (record1->key != record2->key)
+    {
+        return (record1->key > record2->key) ? 1 : -1;
+    }
+
+    return (record1->order > record2->order) - (record1->order < record2->order);
+}
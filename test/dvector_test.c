@@ -0,0 +1,451 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* qsort, rand */
+#include <assert.h> /* assert */
+#include <string.h> /* memcpy, memcmp */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* unlink */
+
+#include "dvector.h" /* dvector_t */
+
+#define ROUNDS (1000000)
+#define SHORT_LIVED_SIZE (8)
+#define INLINE_CAPACITY (16)
+#define SEARCH_SIZE (1000000)
+#define SEARCH_ROUNDS (50)
+#define FILE_PATH ("/tmp/dvector_test.bin")
+#define FILE_ELEMENTS (100)
+#define MAPPED_ELEMENTS (200000)
+#define MAPPED_WORDS (3)
+
+typedef dvector_t *(*create_func_t)(size_t capacity, size_t element_size);
+
+static double NowNs(void);
+static double BenchShortLived(create_func_t create, size_t pushes);
+static void TestSmallSpill(void);
+static void TestSmallSpillEdge(size_t inline_capacity, size_t element_size);
+static void TestFileWriteAfterSync(void);
+static void TestFileSortAfterSync(void);
+static dvector_t *MakeFile(void);
+static void TestMappedResize(int flags);
+static void CheckMapped(const dvector_t *dvector);
+static void MakeRecord(size_t idx, unsigned int *record);
+static void BenchSearch(size_t element_size);
+static void BenchSort(size_t element_size);
+static dvector_t *MakeRandom(size_t element_size, size_t size);
+static int CmpUInt(const void *lhs, const void *rhs);
+static int CmpULong(const void *lhs, const void *rhs);
+
+int main(void)
+{
+    size_t pushes[] = {1, SHORT_LIVED_SIZE, INLINE_CAPACITY, 4 * INLINE_CAPACITY};
+    size_t i = 0;
+
+    TestSmallSpill();
+    TestSmallSpillEdge(1, 1);
+    TestSmallSpillEdge(2, 3);
+    TestSmallSpillEdge(5, 8);
+    TestSmallSpillEdge(INLINE_CAPACITY, 24);
+    TestFileWriteAfterSync();
+    TestFileSortAfterSync();
+    TestMappedResize(DVECTOR_MAP_DEFAULT);
+    TestMappedResize(DVECTOR_MAP_HUGEPAGE);
+
+    printf("create + n pushes + destroy, %d rounds\n", ROUNDS);
+    printf("%10s %16s %16s\n", "n", "Create ns/op", "Small ns/op");
+    for (i = 0; i < sizeof(pushes) / sizeof(pushes[0]); ++i)
+    {
+        printf("%10lu %16.1f %16.1f\n", (unsigned long)pushes[i],
+               BenchShortLived(DvectorCreate, pushes[i]),
+               BenchShortLived(DvectorCreateSmall, pushes[i]));
+    }
+
+    printf("\n%d elements, %d rounds\n", SEARCH_SIZE, SEARCH_ROUNDS);
+    printf("%10s %16s %16s %16s %16s\n", "bytes", "loop find ms",
+           "DvectorFind ms", "loop count ms", "DvectorCount ms");
+    BenchSearch(sizeof(unsigned int));
+    BenchSearch(sizeof(unsigned long));
+
+    printf("\n%d elements\n", SEARCH_SIZE);
+    printf("%10s %16s %16s %16s\n", "bytes", "qsort ms", "radix ms",
+           "introsort ms");
+    BenchSort(sizeof(unsigned int));
+    BenchSort(sizeof(unsigned long));
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static double BenchShortLived(create_func_t create, size_t pushes)
+{
+    dvector_t *dvector = NULL;
+    double start = NowNs();
+    size_t sum = 0;
+    size_t i = 0;
+    size_t round = 0;
+
+    for (round = 0; round < ROUNDS; ++round)
+    {
+        dvector = create(INLINE_CAPACITY, sizeof(size_t));
+        assert(NULL != dvector);
+        for (i = 0; i < pushes; ++i)
+        {
+            DvectorPushBack(dvector, &i);
+        }
+        for (i = 0; i < pushes; ++i)
+        {
+            sum += *(size_t *)DvectorGetAccessToElement(dvector, i);
+        }
+        DvectorDestroy(dvector);
+    }
+    assert(sum == ROUNDS * (pushes * (pushes - 1) / 2));
+
+    return ((NowNs() - start) / ROUNDS);
+}
+
+static void TestSmallSpill(void)
+{
+    dvector_t *dvector = DvectorCreateSmall(4, sizeof(size_t));
+    size_t i = 0;
+    int status = 0;
+
+    for (i = 0; i < 100; ++i)
+    {
+        status = DvectorPushBack(dvector, &i);
+        assert(0 == status);
+    }
+    assert(100 <= DvectorCapacity(dvector));
+    for (i = 0; i < 100; ++i)
+    {
+        assert(i == *(size_t *)DvectorGetAccessToElement(dvector, i));
+    }
+    for (i = 0; i < 98; ++i)
+    {
+        DvectorPopBack(dvector);
+    }
+    assert(4 == DvectorCapacity(dvector));
+    assert(1 == *(size_t *)DvectorGetAccessToElement(dvector, 1));
+    DvectorDestroy(dvector);
+    (void)status;
+}
+
+/* the push that spills the inline buffer has already counted the new
+   element, so only capacity elements may be copied out of the inline
+   storage. A copy of size elements reads one past its end, which only
+   ASan sees */
+static void TestSmallSpillEdge(size_t inline_capacity, size_t element_size)
+{
+    dvector_t *dvector = DvectorCreateSmall(inline_capacity, element_size);
+    unsigned char element[24];
+    size_t i = 0;
+    size_t j = 0;
+    int status = 0;
+
+    assert(NULL != dvector && sizeof(element) >= element_size);
+    for (i = 0; i <= inline_capacity; ++i)
+    {
+        memset(element, (int)i + 1, element_size);
+        status = DvectorPushBack(dvector, element);
+        assert(0 == status);
+    }
+    assert(inline_capacity < DvectorCapacity(dvector));
+
+    /* and back towards the inline buffer */
+    while (0 < DvectorSize(dvector))
+    {
+        for (i = 0; i < DvectorSize(dvector); ++i)
+        {
+            for (j = 0; j < element_size; ++j)
+            {
+                assert(i + 1 == ((unsigned char *)
+                                 DvectorGetAccessToElement(dvector, i))[j]);
+            }
+        }
+        DvectorPopBack(dvector);
+    }
+
+    DvectorDestroy(dvector);
+    (void)status;
+}
+
+/* FILE_ELEMENTS counting down in a new file, synced */
+static dvector_t *MakeFile(void)
+{
+    dvector_t *dvector = NULL;
+    size_t value = 0;
+    size_t i = 0;
+    int status = 0;
+
+    unlink(FILE_PATH);
+    dvector = DvectorOpenFile(FILE_PATH, 8, sizeof(size_t));
+    assert(NULL != dvector);
+    for (i = 0; i < FILE_ELEMENTS; ++i)
+    {
+        value = FILE_ELEMENTS - i;
+        status = DvectorPushBack(dvector, &value);
+        assert(0 == status);
+    }
+    status = DvectorSync(dvector);
+    assert(0 == status);
+    (void)status;
+
+    return dvector;
+}
+
+/* a write through an element pointer after a sync must survive a reopen */
+static void TestFileWriteAfterSync(void)
+{
+    dvector_t *dvector = MakeFile();
+    int status = 0;
+
+    *(size_t *)DvectorGetAccessToElement(dvector, 5) = 1000;
+    DvectorDestroy(dvector);
+
+    dvector = DvectorOpenFile(FILE_PATH, 8, sizeof(size_t));
+    assert(NULL != dvector);
+    assert(FILE_ELEMENTS == DvectorSize(dvector));
+    assert(1000 == *(size_t *)DvectorGetAccessToElement(dvector, 5));
+    assert(FILE_ELEMENTS - 6 ==
+           *(size_t *)DvectorGetAccessToElement(dvector, 6));
+
+    /* synced again, the new contents pass the checksum */
+    status = DvectorSync(dvector);
+    assert(0 == status);
+    DvectorDestroy(dvector);
+    dvector = DvectorOpenFile(FILE_PATH, 8, sizeof(size_t));
+    assert(NULL != dvector);
+    assert(1000 == *(size_t *)DvectorGetAccessToElement(dvector, 5));
+    DvectorDestroy(dvector);
+    unlink(FILE_PATH);
+    (void)status;
+}
+
+static void TestFileSortAfterSync(void)
+{
+    dvector_t *dvector = MakeFile();
+    size_t i = 0;
+
+    DvectorSort(dvector, NULL);
+    DvectorDestroy(dvector);
+
+    dvector = DvectorOpenFile(FILE_PATH, 8, sizeof(size_t));
+    assert(NULL != dvector);
+    assert(FILE_ELEMENTS == DvectorSize(dvector));
+    for (i = 0; i < FILE_ELEMENTS; ++i)
+    {
+        assert(i + 1 == *(size_t *)DvectorGetAccessToElement(dvector, i));
+    }
+    DvectorDestroy(dvector);
+    unlink(FILE_PATH);
+}
+
+/* 12 byte records so elements straddle page boundaries. The vector grows
+   from one element past 2MB, where DVECTOR_MAP_HUGEPAGE changes the
+   rounding, falls back to a few pages on pops and grows again. Every
+   remap must keep the elements in place */
+static void TestMappedResize(int flags)
+{
+    dvector_t *dvector = DvectorCreateMapped(1, sizeof(unsigned int) *
+                                             MAPPED_WORDS, flags);
+    unsigned int record[MAPPED_WORDS];
+    size_t capacity = 0;
+    size_t peak = 0;
+    size_t round = 0;
+    size_t i = 0;
+    int status = 0;
+
+    assert(NULL != dvector);
+    for (round = 0; 2 > round; ++round)
+    {
+        for (i = DvectorSize(dvector); MAPPED_ELEMENTS > i; ++i)
+        {
+            capacity = DvectorCapacity(dvector);
+            MakeRecord(i, record);
+            status = DvectorPushBack(dvector, record);
+            assert(0 == status);
+            if (capacity != DvectorCapacity(dvector))
+            {
+                CheckMapped(dvector);
+            }
+        }
+        CheckMapped(dvector);
+
+        peak = DvectorCapacity(dvector);
+        while (MAPPED_ELEMENTS / 256 < DvectorSize(dvector))
+        {
+            capacity = DvectorCapacity(dvector);
+            DvectorPopBack(dvector);
+            if (capacity != DvectorCapacity(dvector))
+            {
+                CheckMapped(dvector);
+            }
+        }
+        assert(DvectorCapacity(dvector) < peak / 64);
+        CheckMapped(dvector);
+    }
+
+    status = DvectorReserve(dvector, MAPPED_ELEMENTS);
+    assert(0 == status);
+    CheckMapped(dvector);
+    status = DvectorShrink(dvector);
+    assert(0 == status);
+    assert(DvectorCapacity(dvector) < MAPPED_ELEMENTS);
+    CheckMapped(dvector);
+
+    DvectorDestroy(dvector);
+    (void)status;
+    (void)peak;
+}
+
+static void CheckMapped(const dvector_t *dvector)
+{
+    unsigned int record[MAPPED_WORDS];
+    size_t i = 0;
+
+    assert(DvectorSize(dvector) <= DvectorCapacity(dvector));
+    for (i = 0; i < DvectorSize(dvector); ++i)
+    {
+        MakeRecord(i, record);
+        assert(0 == memcmp(record, DvectorGetAccessToElement(dvector, i),
+                           sizeof(record)));
+    }
+}
+
+static void MakeRecord(size_t idx, unsigned int *record)
+{
+    record[0] = (unsigned int)idx;
+    record[1] = (unsigned int)idx * 2654435761u;
+    record[2] = ~(unsigned int)idx;
+}
+
+static dvector_t *MakeRandom(size_t element_size, size_t size)
+{
+    dvector_t *dvector = DvectorCreate(size, element_size);
+    unsigned long value = 0;
+    unsigned int value32 = 0;
+    size_t i = 0;
+
+    assert(NULL != dvector);
+    for (i = 0; i < size; ++i)
+    {
+        value = ((unsigned long)rand() << 31) ^ (unsigned long)rand();
+        value32 = (unsigned int)value;
+        DvectorPushBack(dvector, sizeof(value32) == element_size ?
+                                 (void *)&value32 : (void *)&value);
+    }
+
+    return dvector;
+}
+
+static void BenchSearch(size_t element_size)
+{
+    dvector_t *dvector = MakeRandom(element_size, SEARCH_SIZE);
+    unsigned long missing = 0;
+    double times[4];
+    size_t found = 0;
+    size_t i = 0;
+    size_t round = 0;
+
+    /* the key is not in the vector, so every find scans it all */
+    for (round = 0; round < SEARCH_ROUNDS; ++round)
+    {
+        times[0] = NowNs();
+        for (i = 0; i < SEARCH_SIZE &&
+             0 != memcmp(DvectorGetAccessToElement(dvector, i), &missing,
+                         element_size); ++i)
+        {
+        }
+        found += i;
+        times[1] = NowNs();
+        found -= DvectorFind(dvector, &missing);
+        times[2] = NowNs();
+        for (i = 0; i < SEARCH_SIZE; ++i)
+        {
+            found += (0 == memcmp(DvectorGetAccessToElement(dvector, i),
+                                  &missing, element_size));
+        }
+        times[3] = NowNs();
+        found -= DvectorCount(dvector, &missing);
+    }
+    assert(0 == found);
+
+    printf("%10lu %16.2f %16.2f %16.2f %16.2f\n", (unsigned long)element_size,
+           (times[1] - times[0]) / 1e6, (times[2] - times[1]) / 1e6,
+           (times[3] - times[2]) / 1e6, (NowNs() - times[3]) / 1e6);
+
+    memcpy(&missing, DvectorGetAccessToElement(dvector, SEARCH_SIZE / 2),
+           element_size);
+    assert(SEARCH_SIZE / 2 >= DvectorFind(dvector, &missing));
+    assert(1 <= DvectorCount(dvector, &missing));
+    DvectorDestroy(dvector);
+}
+
+static void BenchSort(size_t element_size)
+{
+    dvector_cmp_func_t cmp = sizeof(unsigned int) == element_size ?
+                             CmpUInt : CmpULong;
+    dvector_t *dvector = MakeRandom(element_size, SEARCH_SIZE);
+    void *copy = malloc(SEARCH_SIZE * element_size);
+    double times[4];
+    size_t i = 0;
+
+    assert(NULL != copy);
+    memcpy(copy, DvectorGetAccessToElement(dvector, 0),
+           SEARCH_SIZE * element_size);
+
+    times[0] = NowNs();
+    qsort(copy, SEARCH_SIZE, element_size, cmp);
+    times[1] = NowNs();
+    DvectorSort(dvector, NULL);
+    times[2] = NowNs();
+    assert(0 == memcmp(copy, DvectorGetAccessToElement(dvector, 0),
+                       SEARCH_SIZE * element_size));
+
+    DvectorDestroy(dvector);
+    dvector = MakeRandom(element_size, SEARCH_SIZE);
+    times[3] = NowNs();
+    DvectorSort(dvector, cmp);
+    printf("%10lu %16.2f %16.2f %16.2f\n", (unsigned long)element_size,
+           (times[1] - times[0]) / 1e6, (times[2] - times[1]) / 1e6,
+           (NowNs() - times[3]) / 1e6);
+    for (i = 1; i < SEARCH_SIZE; ++i)
+    {
+        assert(0 >= cmp(DvectorGetAccessToElement(dvector, i - 1),
+                        DvectorGetAccessToElement(dvector, i)));
+    }
+
+    DvectorDestroy(dvector);
+    free(copy);
+}
+
+static int CmpUInt(const void *lhs, const void *rhs)
+{
+    unsigned int left = *(const unsigned int *)lhs;
+    unsigned int right = *(const unsigned int *)rhs;
+
+    return ((left > right) - (left < right));
+}
+
+static int CmpULong(const void *lhs, const void *rhs)
+{
+    unsigned long left = *(const unsigned long *)lhs;
+    unsigned long right = *(const unsigned long *)rhs;
+
+    return ((left > right) - (left < right));
+}
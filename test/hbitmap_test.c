@@ -0,0 +1,356 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 hbitmap_test.c ../src/hbitmap.c -I../inc -o hbitmap.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "hbitmap.h" /* hbitmap_t */
+
+#define WORD_BITS (64)
+#define SUMMARY_BITS (WORD_BITS * WORD_BITS)
+#define RANDOM_OPS (3000)
+#define BENCH_BITS (1UL << 24)
+#define BENCH_FINDS (100000)
+
+static double NowNs(void);
+static void TestSize(size_t num_bits);
+static void TestFullSummaries(size_t num_bits);
+static void RandomOp(hbitmap_t *hbitmap, unsigned char *model, size_t num_bits);
+static void Check(const hbitmap_t *hbitmap, const unsigned char *model,
+                  size_t num_bits);
+static size_t Position(size_t num_bits);
+static void BenchFindClear(void);
+
+int main(void)
+{
+    size_t sizes[] = {1, 63, 64, 65, SUMMARY_BITS - 1, SUMMARY_BITS,
+                      SUMMARY_BITS + 1, SUMMARY_BITS * WORD_BITS + 13};
+    size_t i = 0;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        TestSize(sizes[i]);
+        TestFullSummaries(sizes[i]);
+    }
+
+    BenchFindClear();
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+/* random changes at and around word and summary word boundaries, against
+   one byte per bit */
+static void TestSize(size_t num_bits)
+{
+    hbitmap_t *hbitmap = HBitmapCreate(num_bits);
+    unsigned char *model = (unsigned char *)calloc(num_bits, 1);
+    size_t ops = (num_bits < RANDOM_OPS) ? RANDOM_OPS : num_bits / 64;
+    size_t i = 0;
+
+    assert(NULL != hbitmap && NULL != model);
+    assert(num_bits == HBitmapSize(hbitmap));
+    Check(hbitmap, model, num_bits);
+
+    for (i = 0; i < ops; ++i)
+    {
+        RandomOp(hbitmap, model, num_bits);
+        if (0 == i % (ops / 8))
+        {
+            Check(hbitmap, model, num_bits);
+        }
+    }
+    Check(hbitmap, model, num_bits);
+
+    free(model);
+    HBitmapDestroy(hbitmap);
+}
+
+/* every bit set, so every summary bit up to the top is set, then single
+   clear bits at the edges of words and summary words have to be found
+   from every level */
+static void TestFullSummaries(size_t num_bits)
+{
+    hbitmap_t *hbitmap = HBitmapCreate(num_bits);
+    size_t holes[] = {0, 63, 64, SUMMARY_BITS - 1, SUMMARY_BITS,
+                      SUMMARY_BITS + 64};
+    size_t found = 0;
+    size_t hole = 0;
+    size_t i = 0;
+    int was = 0;
+
+    assert(NULL != hbitmap);
+    HBitmapSetRange(hbitmap, 0, num_bits);
+    assert(num_bits == HBitmapCountSet(hbitmap));
+    found = HBitmapFindClear(hbitmap, 0);
+    assert(num_bits == found);
+    found = HBitmapFindNthClear(hbitmap, 0);
+    assert(num_bits == found);
+
+    for (i = 0; i <= sizeof(holes) / sizeof(holes[0]); ++i)
+    {
+        /* the last bit, with the padding after it, goes last */
+        hole = (i == sizeof(holes) / sizeof(holes[0])) ? num_bits - 1 :
+               holes[i];
+        if (hole >= num_bits)
+        {
+            continue;
+        }
+
+        was = HBitmapClear(hbitmap, hole);
+        assert(1 == was);
+        found = HBitmapFindClear(hbitmap, 0);
+        assert(hole == found);
+        found = HBitmapFindClear(hbitmap, hole);
+        assert(hole == found);
+        found = HBitmapFindNthClear(hbitmap, 0);
+        assert(hole == found);
+        found = HBitmapFindClear(hbitmap, hole + 1);
+        assert(num_bits == found);
+        assert(num_bits - 1 == HBitmapCountSet(hbitmap));
+
+        was = HBitmapSet(hbitmap, hole);
+        assert(0 == was);
+        found = HBitmapFindClear(hbitmap, 0);
+        assert(num_bits == found);
+    }
+
+    /* a range across summary words clears them all, and fills them again */
+    if (2 * SUMMARY_BITS < num_bits)
+    {
+        HBitmapClearRange(hbitmap, SUMMARY_BITS - 3, 2 * SUMMARY_BITS + 5);
+        found = HBitmapFindClear(hbitmap, 0);
+        assert(SUMMARY_BITS - 3 == found);
+        found = HBitmapFindClear(hbitmap, SUMMARY_BITS + 100);
+        assert(SUMMARY_BITS + 100 == found);
+        found = HBitmapFindSet(hbitmap, SUMMARY_BITS - 3, num_bits);
+        assert(2 * SUMMARY_BITS + 5 == found);
+        HBitmapSetRange(hbitmap, SUMMARY_BITS - 3, 2 * SUMMARY_BITS + 5);
+        found = HBitmapFindClear(hbitmap, 0);
+        assert(num_bits == found);
+    }
+
+    HBitmapDestroy(hbitmap);
+    (void)found;
+    (void)was;
+}
+
+static void RandomOp(hbitmap_t *hbitmap, unsigned char *model, size_t num_bits)
+{
+    size_t from = Position(num_bits);
+    size_t to = Position(num_bits + 1);
+    unsigned long bits = 0;
+    size_t word = 0;
+    size_t i = 0;
+    int was = 0;
+
+    if (from > to)
+    {
+        i = from;
+        from = to;
+        to = i;
+    }
+
+    switch (rand() % 5)
+    {
+        case 0:
+            was = HBitmapSet(hbitmap, from);
+            assert(model[from] == was);
+            model[from] = 1;
+            break;
+        case 1:
+            was = HBitmapClear(hbitmap, from);
+            assert(model[from] == was);
+            model[from] = 0;
+            break;
+        case 2:
+            HBitmapSetRange(hbitmap, from, to);
+            memset(model + from, 1, to - from);
+            break;
+        case 3:
+            HBitmapClearRange(hbitmap, from, to);
+            memset(model + from, 0, to - from);
+            break;
+        default:
+            word = from / WORD_BITS;
+            bits = ((unsigned long)rand() << 33) ^
+                   ((unsigned long)rand() << 11) ^ (unsigned long)rand();
+            HBitmapOrWord(hbitmap, word, bits);
+            for (i = 0; i < WORD_BITS && word * WORD_BITS + i < num_bits; ++i)
+            {
+                model[word * WORD_BITS + i] |= (bits >> i) & 1;
+            }
+            break;
+    }
+    (void)was;
+}
+
+/* every query against a plain loop over the model, from edge positions */
+static void Check(const hbitmap_t *hbitmap, const unsigned char *model,
+                  size_t num_bits)
+{
+    size_t count = 0;
+    size_t clear = 0;
+    size_t nth = 0;
+    size_t from = 0;
+    size_t to = 0;
+    size_t round = 0;
+    size_t i = 0;
+
+    for (i = 0; i < num_bits; ++i)
+    {
+        assert(model[i] == HBitmapTest(hbitmap, i));
+        count += model[i];
+    }
+    assert(count == HBitmapCountSet(hbitmap));
+
+    for (round = 0; round < 16; ++round)
+    {
+        from = Position(num_bits);
+        to = from + Position(num_bits - from + 1);
+
+        for (i = from; i < num_bits && model[i]; ++i)
+        {
+        }
+        assert(i == HBitmapFindClear(hbitmap, from));
+
+        for (i = from; i < to && !model[i]; ++i)
+        {
+        }
+        assert(i == HBitmapFindSet(hbitmap, from, to));
+
+        count = 0;
+        for (i = from; i < to; ++i)
+        {
+            count += model[i];
+        }
+        assert(count == HBitmapCountSetRange(hbitmap, from, to));
+
+        /* the n-th clear bit, and one past the last */
+        clear = 0;
+        for (i = 0; i < num_bits; ++i)
+        {
+            clear += !model[i];
+        }
+        nth = Position(clear + 1);
+        count = 0;
+        for (i = 0; i < num_bits; ++i)
+        {
+            if (!model[i] && nth == count++)
+            {
+                break;
+            }
+        }
+        assert(i == HBitmapFindNthClear(hbitmap, nth));
+    }
+    (void)hbitmap;
+    (void)count;
+    (void)nth;
+}
+
+/* a random position in [0, limit), biased towards word and summary word
+   edges and the ends */
+static size_t Position(size_t limit)
+{
+    size_t edges[] = {0, 1, WORD_BITS - 1, WORD_BITS, WORD_BITS + 1,
+                      SUMMARY_BITS - 1, SUMMARY_BITS, SUMMARY_BITS + 1,
+                      2 * SUMMARY_BITS - 1, 2 * SUMMARY_BITS};
+    size_t pick = (size_t)rand() % 16;
+
+    if (pick < sizeof(edges) / sizeof(edges[0]) && edges[pick] < limit)
+    {
+        return edges[pick];
+    }
+    if (14 == pick)
+    {
+        return limit - 1;
+    }
+
+    return (((size_t)rand() << 15 ^ (size_t)rand()) % limit);
+}
+
+/* the first clear bit of a bitmap with a few holes, against scanning the
+   same words one at a time */
+static void BenchFindClear(void)
+{
+    size_t holes[] = {1, 16, 256};
+    size_t words = BENCH_BITS / WORD_BITS;
+    unsigned long *flat = (unsigned long *)malloc(words * sizeof(long));
+    hbitmap_t *hbitmap = NULL;
+    size_t *froms = (size_t *)malloc(BENCH_FINDS * sizeof(size_t));
+    volatile size_t sink = 0;
+    size_t idx = 0;
+    size_t h = 0;
+    size_t i = 0;
+    size_t w = 0;
+    double hbitmap_ns = 0;
+    double flat_ns = 0;
+
+    assert(NULL != flat && NULL != froms);
+    printf("%lu bits, all set but a few, ns per search from a random bit\n",
+           BENCH_BITS);
+    printf("%10s %12s %12s\n", "clear bits", "hbitmap", "word scan");
+    for (h = 0; h < sizeof(holes) / sizeof(holes[0]); ++h)
+    {
+        hbitmap = HBitmapCreate(BENCH_BITS);
+        assert(NULL != hbitmap);
+        HBitmapSetRange(hbitmap, 0, BENCH_BITS);
+        memset(flat, 0xFF, words * sizeof(long));
+        for (i = 0; i < holes[h]; ++i)
+        {
+            idx = ((size_t)rand() << 15 ^ (size_t)rand()) % BENCH_BITS;
+            HBitmapClear(hbitmap, idx);
+            flat[idx / WORD_BITS] &= ~(1UL << (idx % WORD_BITS));
+        }
+        for (i = 0; i < BENCH_FINDS; ++i)
+        {
+            froms[i] = ((size_t)rand() << 15 ^ (size_t)rand()) % BENCH_BITS;
+        }
+
+        hbitmap_ns = NowNs();
+        for (i = 0; i < BENCH_FINDS; ++i)
+        {
+            sink += HBitmapFindClear(hbitmap, froms[i]);
+        }
+        hbitmap_ns = (NowNs() - hbitmap_ns) / BENCH_FINDS;
+
+        flat_ns = NowNs();
+        for (i = 0; i < BENCH_FINDS / 100; ++i)
+        {
+            for (w = froms[i] / WORD_BITS; w < words && ~0UL == flat[w]; ++w)
+            {
+            }
+            sink += w;
+        }
+        flat_ns = (NowNs() - flat_ns) / (BENCH_FINDS / 100);
+
+        printf("%10lu %12.1f %12.1f\n", (unsigned long)holes[h], hbitmap_ns,
+               flat_ns);
+        HBitmapDestroy(hbitmap);
+    }
+
+    free(froms);
+    free(flat);
+    (void)sink;
+}
@@ -0,0 +1,279 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread mpsc_queue_test.c ../src/mpsc_queue.c -I../inc -o mpsc_queue.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <sched.h> /* sched_yield */
+#include <pthread.h> /* pthread_create */
+
+#include "mpsc_queue.h" /* mpsc_queue_t */
+
+#define NUM_ITEMS (8)
+#define MAX_PRODUCERS (8)
+#define ITEMS_PER_PRODUCER (250000)
+#define BATCH (32)
+#define NO_ITEM ((size_t)-1)
+
+typedef struct item
+{
+    size_t producer;
+    size_t seq;
+    mpsc_link_t link;
+} item_t;
+
+typedef struct producer
+{
+    mpsc_queue_t *queue;
+    item_t *items;
+    size_t id;
+} producer_t;
+
+static double NowNs(void);
+static void TestSingleThread(void);
+static void TestPopBatch(void);
+static double TestProducers(size_t num_producers);
+static void *Produce(void *arg);
+static size_t PopSeq(mpsc_queue_t *queue);
+static size_t SeqOf(const mpsc_link_t *link);
+
+int main(void)
+{
+    size_t producers = 0;
+
+    TestSingleThread();
+    TestPopBatch();
+
+    printf("%d items per producer, one consumer popping batches of %d\n",
+           ITEMS_PER_PRODUCER, BATCH);
+    printf("%10s %12s\n", "producers", "Mitems/s");
+    for (producers = 1; producers <= MAX_PRODUCERS; producers *= 2)
+    {
+        printf("%10lu %12.2f\n", (unsigned long)producers,
+               TestProducers(producers));
+    }
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+/* the last link goes out through the stub, and links can be pushed again
+   once they are popped */
+static void TestSingleThread(void)
+{
+    mpsc_queue_t *queue = MPSCQueueCreate();
+    item_t items[NUM_ITEMS];
+    size_t round = 0;
+    size_t seq = 0;
+    size_t i = 0;
+
+    assert(NULL != queue);
+    seq = PopSeq(queue);
+    assert(NO_ITEM == seq && MPSCQueueIsEmpty(queue));
+
+    for (i = 0; i < NUM_ITEMS; ++i)
+    {
+        items[i].producer = 0;
+        items[i].seq = i;
+    }
+
+    for (round = 0; round < 3; ++round)
+    {
+        MPSCQueuePush(queue, &items[0].link);
+        assert(!MPSCQueueIsEmpty(queue));
+        seq = PopSeq(queue);
+        assert(0 == seq && MPSCQueueIsEmpty(queue));
+        seq = PopSeq(queue);
+        assert(NO_ITEM == seq);
+
+        for (i = 0; i < NUM_ITEMS; ++i)
+        {
+            MPSCQueuePush(queue, &items[i].link);
+        }
+        for (i = 0; i < NUM_ITEMS / 2; ++i)
+        {
+            seq = PopSeq(queue);
+            assert(i == seq);
+        }
+
+        /* pushes behind the ones still queued */
+        MPSCQueuePush(queue, &items[0].link);
+        for (i = NUM_ITEMS / 2; i < NUM_ITEMS; ++i)
+        {
+            seq = PopSeq(queue);
+            assert(i == seq);
+        }
+        seq = PopSeq(queue);
+        assert(0 == seq && MPSCQueueIsEmpty(queue));
+        seq = PopSeq(queue);
+        assert(NO_ITEM == seq);
+    }
+
+    MPSCQueueDestroy(queue);
+    (void)seq;
+}
+
+static void TestPopBatch(void)
+{
+    mpsc_queue_t *queue = MPSCQueueCreate();
+    item_t items[NUM_ITEMS];
+    mpsc_link_t *links[NUM_ITEMS + 1];
+    size_t count = 0;
+    size_t i = 0;
+
+    assert(NULL != queue);
+    count = MPSCQueuePopBatch(queue, links, NUM_ITEMS);
+    assert(0 == count);
+    count = MPSCQueuePopBatch(queue, NULL, 0);
+    assert(0 == count);
+
+    for (i = 0; i < NUM_ITEMS; ++i)
+    {
+        items[i].producer = 0;
+        items[i].seq = i;
+        MPSCQueuePush(queue, &items[i].link);
+    }
+
+    count = MPSCQueuePopBatch(queue, links, 0);
+    assert(0 == count);
+    count = MPSCQueuePopBatch(queue, links, 3);
+    assert(3 == count);
+    for (i = 0; i < count; ++i)
+    {
+        assert(i == SeqOf(links[i]));
+    }
+
+    /* asks for more than there is */
+    count = MPSCQueuePopBatch(queue, links, NUM_ITEMS + 1);
+    assert(NUM_ITEMS - 3 == count);
+    for (i = 0; i < count; ++i)
+    {
+        assert(i + 3 == SeqOf(links[i]));
+    }
+    assert(MPSCQueueIsEmpty(queue));
+    count = MPSCQueuePopBatch(queue, links, NUM_ITEMS);
+    assert(0 == count);
+
+    MPSCQueueDestroy(queue);
+    (void)count;
+}
+
+/* each producer pushes its own items in order. The consumer must get
+   every item once, and each producer's items in the order they were
+   pushed */
+static double TestProducers(size_t num_producers)
+{
+    pthread_t threads[MAX_PRODUCERS];
+    producer_t producers[MAX_PRODUCERS];
+    size_t next_seq[MAX_PRODUCERS];
+    mpsc_link_t *links[BATCH];
+    mpsc_queue_t *queue = MPSCQueueCreate();
+    item_t *item = NULL;
+    size_t total = num_producers * ITEMS_PER_PRODUCER;
+    size_t received = 0;
+    size_t count = 0;
+    size_t i = 0;
+    double ns = 0;
+    int status = 0;
+
+    assert(NULL != queue);
+    for (i = 0; i < num_producers; ++i)
+    {
+        producers[i].queue = queue;
+        producers[i].id = i;
+        producers[i].items = (item_t *)malloc(ITEMS_PER_PRODUCER *
+                                              sizeof(item_t));
+        assert(NULL != producers[i].items);
+        next_seq[i] = 0;
+    }
+
+    ns = NowNs();
+    for (i = 0; i < num_producers; ++i)
+    {
+        status = pthread_create(&threads[i], NULL, Produce, &producers[i]);
+        assert(0 == status);
+    }
+
+    while (received < total)
+    {
+        count = MPSCQueuePopBatch(queue, links, BATCH);
+        if (0 == count)
+        {
+            sched_yield();
+            continue;
+        }
+        for (i = 0; i < count; ++i)
+        {
+            item = MPSC_LINK_ENTRY(links[i], item_t, link);
+            assert(item->producer < num_producers);
+            assert(next_seq[item->producer] == item->seq);
+            ++next_seq[item->producer];
+        }
+        received += count;
+    }
+
+    for (i = 0; i < num_producers; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    ns = NowNs() - ns;
+
+    count = MPSCQueuePopBatch(queue, links, BATCH);
+    assert(0 == count && MPSCQueueIsEmpty(queue));
+    for (i = 0; i < num_producers; ++i)
+    {
+        assert(ITEMS_PER_PRODUCER == next_seq[i]);
+        free(producers[i].items);
+    }
+    MPSCQueueDestroy(queue);
+    (void)status;
+
+    return (total / ns * 1e3);
+}
+
+static void *Produce(void *arg)
+{
+    producer_t *producer = (producer_t *)arg;
+    size_t i = 0;
+
+    for (i = 0; i < ITEMS_PER_PRODUCER; ++i)
+    {
+        producer->items[i].producer = producer->id;
+        producer->items[i].seq = i;
+        MPSCQueuePush(producer->queue, &producer->items[i].link);
+    }
+
+    return NULL;
+}
+
+/* the seq of the popped item, NO_ITEM if nothing was popped */
+static size_t PopSeq(mpsc_queue_t *queue)
+{
+    mpsc_link_t *link = MPSCQueuePop(queue);
+
+    return ((NULL == link) ? NO_ITEM : SeqOf(link));
+}
+
+static size_t SeqOf(const mpsc_link_t *link)
+{
+    return MPSC_LINK_ENTRY(link, const item_t, link)->seq;
+}
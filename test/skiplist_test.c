@@ -0,0 +1,606 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread skiplist_test.c ../src/skiplist.c -I../inc -o skiplist.out
+the reader tests are meant to run under -fsanitize=address as well,
+which reports a reader touching a node that was freed under it
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* rand */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <stdatomic.h> /* atomic_int */
+#include <sched.h> /* sched_yield */
+#include <pthread.h> /* pthread_create */
+
+#include "skiplist.h" /* skiplist_t */
+
+#define NUM_RECORDS (4000)
+#define KEY_RANGE (1000)
+#define MAX_READERS (4)
+#define READ_ROUNDS (20000)
+#define READ_WALK (64)
+#define SHARED_KEYS (4096)
+#define RECLAIM_READERS (2)
+#define RECLAIM_OPS (500000)
+#define RECLAIM_SLACK_KB (4096)
+
+typedef struct record
+{
+    int key;
+    size_t id;
+} record_t;
+
+static record_t records[NUM_RECORDS];
+static record_t *model[NUM_RECORDS];
+static size_t model_size = 0;
+
+static record_t shared[SHARED_KEYS];
+static skiplist_t *shared_list = NULL;
+static atomic_int readers_done;
+static atomic_int writer_done;
+
+static double NowNs(void);
+static long RssKB(void);
+static int CmpRecords(const void *data1, const void *data2);
+static void TestInsertOrder(skiplist_t *list);
+static void TestFindAndBounds(const skiplist_t *list);
+static void TestForEach(const skiplist_t *list);
+static void TestRemove(skiplist_t *list);
+static void TestEmpty(void);
+static double TestConcurrentReads(size_t num_readers);
+static void *Read(void *arg);
+static void *Write(void *arg);
+static void TestReclaim(void);
+static void *ReadOverlapping(void *arg);
+static void CheckModel(const skiplist_t *list);
+static void ModelInsert(record_t *record);
+static void ModelRemove(size_t idx);
+static size_t ModelLowerBound(int key, int is_upper);
+static int Sum(void *data, void *param);
+static int StopAt(void *data, void *param);
+static size_t NextRandom(size_t *seed);
+
+int main(void)
+{
+    size_t readers = 0;
+    skiplist_t *list = SkipListCreate(CmpRecords, SKIPLIST_DEFAULT);
+
+    assert(NULL != list);
+    TestEmpty();
+    TestInsertOrder(list);
+    TestFindAndBounds(list);
+    TestForEach(list);
+    TestRemove(list);
+    SkipListDestroy(list);
+
+    printf("%d keys, one writer inserting and removing, read sections of a "
+           "find and a walk of %d\n", SHARED_KEYS, READ_WALK);
+    printf("%10s %16s\n", "readers", "Msections/s");
+    for (readers = 1; readers <= MAX_READERS; readers *= 2)
+    {
+        printf("%10lu %16.2f\n", (unsigned long)readers,
+               TestConcurrentReads(readers));
+    }
+    TestReclaim();
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static long RssKB(void)
+{
+    FILE *statm = fopen("/proc/self/statm", "r");
+    long size = 0;
+    long resident = 0;
+
+    if (NULL == statm)
+    {
+        return -1;
+    }
+    if (2 != fscanf(statm, "%ld %ld", &size, &resident))
+    {
+        resident = -1;
+    }
+    fclose(statm);
+
+    return ((0 > resident) ? -1 : resident * 4);
+}
+
+static int CmpRecords(const void *data1, const void *data2)
+{
+    return (((const record_t *)data1)->key - ((const record_t *)data2)->key);
+}
+
+static void TestEmpty(void)
+{
+    skiplist_t *list = SkipListCreate(CmpRecords, SKIPLIST_DEFAULT);
+    skiplist_iter_t iter;
+    record_t key;
+    void *data = NULL;
+
+    assert(NULL != list);
+    key.key = 0;
+    assert(SkipListIsEmpty(list) && 0 == SkipListSize(list));
+    assert(SkipListIsIterSame(SkipListBegin(list), SkipListEnd(list)));
+    assert(SkipListIsIterSame(SkipListFind(list, &key), SkipListEnd(list)));
+    assert(SkipListIsIterSame(SkipListLowerBound(list, &key),
+                              SkipListEnd(list)));
+
+    /* one element is both first and last */
+    iter = SkipListInsert(list, &key);
+    assert(!SkipListIsIterSame(iter, SkipListEnd(list)));
+    assert(SkipListIsIterSame(iter, SkipListBegin(list)));
+    assert(SkipListIsIterSame(iter, SkipListPrev(SkipListEnd(list))));
+    data = SkipListPopFront(list);
+    assert(&key == data && SkipListIsEmpty(list) && 0 == SkipListSize(list));
+
+    SkipListDestroy(list);
+    (void)iter;
+    (void)data;
+}
+
+/* random keys with many duplicates, which have to stay in insertion
+   order, against a sorted array of the same records */
+static void TestInsertOrder(skiplist_t *list)
+{
+    skiplist_iter_t iter;
+    size_t i = 0;
+
+    for (i = 0; i < NUM_RECORDS; ++i)
+    {
+        records[i].key = rand() % KEY_RANGE;
+        records[i].id = i;
+        iter = SkipListInsert(list, records + i);
+        assert(records + i == SkipListGetData(iter));
+        ModelInsert(records + i);
+        if (0 == i % 500)
+        {
+            CheckModel(list);
+        }
+    }
+    CheckModel(list);
+    (void)iter;
+}
+
+static void TestFindAndBounds(const skiplist_t *list)
+{
+    skiplist_iter_t iter;
+    record_t key;
+    size_t lower = 0;
+    size_t upper = 0;
+
+    for (key.key = -1; key.key <= KEY_RANGE; ++key.key)
+    {
+        lower = ModelLowerBound(key.key, 0);
+        upper = ModelLowerBound(key.key, 1);
+
+        iter = SkipListLowerBound(list, &key);
+        assert((lower == model_size) ?
+               SkipListIsIterSame(iter, SkipListEnd(list)) :
+               model[lower] == SkipListGetData(iter));
+
+        iter = SkipListUpperBound(list, &key);
+        assert((upper == model_size) ?
+               SkipListIsIterSame(iter, SkipListEnd(list)) :
+               model[upper] == SkipListGetData(iter));
+
+        /* the first of the equal ones, the earliest inserted */
+        iter = SkipListFind(list, &key);
+        assert((lower == upper) ?
+               SkipListIsIterSame(iter, SkipListEnd(list)) :
+               model[lower] == SkipListGetData(iter));
+    }
+    (void)iter;
+    (void)lower;
+    (void)upper;
+}
+
+static void TestForEach(const skiplist_t *list)
+{
+    record_t from;
+    record_t to;
+    size_t sum = 0;
+    size_t expected = 0;
+    size_t i = 0;
+    int result = 0;
+
+    from.key = KEY_RANGE / 4;
+    to.key = KEY_RANGE / 2;
+    for (i = ModelLowerBound(from.key, 0); i < ModelLowerBound(to.key, 1); ++i)
+    {
+        expected += model[i]->id;
+    }
+    result = SkipListForEach(SkipListLowerBound(list, &from),
+                             SkipListUpperBound(list, &to), Sum, &sum);
+    assert(0 == result && expected == sum);
+
+    /* stops at the first non zero result and returns it */
+    i = model_size / 2;
+    result = SkipListForEach(SkipListBegin(list), SkipListEnd(list), StopAt,
+                             model[i]);
+    assert(7 == result);
+
+    (void)result;
+    (void)expected;
+}
+
+/* removes from the front, the back, and the middle of runs of equal keys.
+   The returned iterator is the next element */
+static void TestRemove(skiplist_t *list)
+{
+    skiplist_iter_t iter;
+    void *data = NULL;
+    size_t idx = 0;
+    size_t i = 0;
+
+    while (0 < model_size)
+    {
+        switch (model_size % 4)
+        {
+            case 0:
+                data = SkipListPopFront(list);
+                assert(model[0] == data);
+                ModelRemove(0);
+                break;
+            case 1:
+                iter = SkipListPrev(SkipListEnd(list));
+                assert(model[model_size - 1] == SkipListGetData(iter));
+                iter = SkipListRemove(iter);
+                assert(SkipListIsIterSame(iter, SkipListEnd(list)));
+                ModelRemove(model_size - 1);
+                break;
+            default:
+                idx = (size_t)rand() % model_size;
+                iter = SkipListLowerBound(list, model[idx]);
+                for (i = ModelLowerBound(model[idx]->key, 0); i < idx; ++i)
+                {
+                    iter = SkipListNext(iter);
+                }
+                assert(model[idx] == SkipListGetData(iter));
+                iter = SkipListRemove(iter);
+                ModelRemove(idx);
+                assert((idx == model_size) ?
+                       SkipListIsIterSame(iter, SkipListEnd(list)) :
+                       model[idx] == SkipListGetData(iter));
+                break;
+        }
+
+        if (0 == model_size % 250)
+        {
+            CheckModel(list);
+        }
+    }
+    CheckModel(list);
+    assert(SkipListIsEmpty(list));
+    (void)data;
+}
+
+/* forward with Next and back with Prev, size each time */
+static void CheckModel(const skiplist_t *list)
+{
+    skiplist_iter_t iter = SkipListBegin(list);
+    size_t i = 0;
+
+    assert(model_size == SkipListSize(list));
+    assert((0 == model_size) == SkipListIsEmpty(list));
+    for (i = 0; i < model_size; ++i)
+    {
+        assert(model[i] == SkipListGetData(iter));
+        iter = SkipListNext(iter);
+    }
+    assert(SkipListIsIterSame(iter, SkipListEnd(list)));
+
+    for (i = model_size; 0 < i; --i)
+    {
+        iter = SkipListPrev(iter);
+        assert(model[i - 1] == SkipListGetData(iter));
+    }
+    assert(SkipListIsIterSame(iter, SkipListBegin(list)));
+}
+
+/* after every record with an equal or smaller key */
+static void ModelInsert(record_t *record)
+{
+    size_t idx = ModelLowerBound(record->key, 1);
+    size_t i = 0;
+
+    for (i = model_size; i > idx; --i)
+    {
+        model[i] = model[i - 1];
+    }
+    model[idx] = record;
+    ++model_size;
+}
+
+static void ModelRemove(size_t idx)
+{
+    for (--model_size; idx < model_size; ++idx)
+    {
+        model[idx] = model[idx + 1];
+    }
+}
+
+/* the first record not before key, or after it with is_upper */
+static size_t ModelLowerBound(int key, int is_upper)
+{
+    size_t low = 0;
+    size_t high = model_size;
+    size_t mid = 0;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        if (model[mid]->key < key || (is_upper && model[mid]->key == key))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static int Sum(void *data, void *param)
+{
+    *(size_t *)param += ((record_t *)data)->id;
+
+    return 0;
+}
+
+static int StopAt(void *data, void *param)
+{
+    return ((data == param) ? 7 : 0);
+}
+
+/* even keys stay in the list for the whole test. A writer keeps inserting
+   and removing the odd ones while readers walk the list inside read
+   sections, so removed nodes are retired both while a section is open
+   and while none is. A reader must always see the even keys in order and
+   never land on a freed node */
+static double TestConcurrentReads(size_t num_readers)
+{
+    pthread_t readers[MAX_READERS];
+    size_t seeds[MAX_READERS];
+    size_t writer_seed = 1;
+    pthread_t writer;
+    double ns = 0;
+    size_t i = 0;
+    int status = 0;
+
+    shared_list = SkipListCreate(CmpRecords, SKIPLIST_CONCURRENT_READS);
+    assert(NULL != shared_list);
+    atomic_init(&readers_done, 0);
+
+    for (i = 0; i < SHARED_KEYS; ++i)
+    {
+        shared[i].key = (int)i;
+        shared[i].id = i;
+        if (0 == i % 2)
+        {
+            SkipListInsert(shared_list, shared + i);
+        }
+    }
+
+    status = pthread_create(&writer, NULL, Write, &writer_seed);
+    assert(0 == status);
+    ns = NowNs();
+    for (i = 0; i < num_readers; ++i)
+    {
+        seeds[i] = i + 2;
+        status = pthread_create(&readers[i], NULL, Read, &seeds[i]);
+        assert(0 == status);
+    }
+    for (i = 0; i < num_readers; ++i)
+    {
+        pthread_join(readers[i], NULL);
+    }
+    ns = NowNs() - ns;
+    atomic_store(&readers_done, 1);
+    pthread_join(writer, NULL);
+
+    for (i = 0; i < SHARED_KEYS; i += 2)
+    {
+        assert(shared + i == SkipListGetData(SkipListFind(shared_list,
+                                                          shared + i)));
+    }
+    SkipListDestroy(shared_list);
+    (void)status;
+
+    return (num_readers * READ_ROUNDS / ns * 1e3);
+}
+
+static void *Read(void *arg)
+{
+    size_t *seed = (size_t *)arg;
+    skiplist_iter_t iter;
+    skiplist_iter_t end;
+    const record_t *record = NULL;
+    record_t key;
+    int last = 0;
+    int evens = 0;
+    size_t round = 0;
+    size_t step = 0;
+    skiplist_read_t section = 0;
+
+    for (round = 0; round < READ_ROUNDS; ++round)
+    {
+        key.key = (int)(NextRandom(seed) % (SHARED_KEYS - 2 * READ_WALK));
+        key.key -= key.key % 2;
+
+        section = SkipListReadBegin(shared_list);
+        iter = SkipListFind(shared_list, &key);
+        end = SkipListEnd(shared_list);
+        assert(!SkipListIsIterSame(iter, end));
+        last = key.key - 1;
+        evens = 0;
+        for (step = 0; step < READ_WALK; ++step)
+        {
+            record = SkipListGetData(iter);
+            assert(last < record->key);
+            evens += (0 == record->key % 2);
+            last = record->key;
+            iter = SkipListNext(iter);
+            assert(!SkipListIsIterSame(iter, end));
+        }
+        /* every even key from the start of the walk was there */
+        assert((last - key.key) / 2 + 1 == evens);
+        SkipListReadEnd(shared_list, section);
+
+        /* lets the writer find no section open now and then */
+        if (0 == round % 64)
+        {
+            sched_yield();
+        }
+    }
+    (void)evens;
+    (void)last;
+    (void)end;
+
+    return NULL;
+}
+
+static void *Write(void *arg)
+{
+    size_t *seed = (size_t *)arg;
+    skiplist_iter_t iter;
+    int in_list[SHARED_KEYS] = {0};
+    size_t idx = 0;
+
+    while (!atomic_load(&readers_done))
+    {
+        idx = NextRandom(seed) % (SHARED_KEYS / 2) * 2 + 1;
+        if (in_list[idx])
+        {
+            iter = SkipListFind(shared_list, shared + idx);
+            assert(shared + idx == SkipListGetData(iter));
+            SkipListRemove(iter);
+        }
+        else
+        {
+            SkipListInsert(shared_list, shared + idx);
+        }
+        in_list[idx] = !in_list[idx];
+    }
+    (void)iter;
+
+    return NULL;
+}
+
+/* every reader keeps a section open at all times, starting the next one
+   before it ends the last, while the writer removes and inserts the odd
+   keys again and again. Removed nodes must still be freed as the sections
+   that could see them end, so the footprint stays flat. ASan holds freed
+   memory back, so it only checks the readers there */
+static void TestReclaim(void)
+{
+    pthread_t readers[RECLAIM_READERS];
+    size_t seeds[RECLAIM_READERS];
+    size_t seed = 1;
+    skiplist_iter_t iter;
+    long rss = 0;
+    size_t idx = 0;
+    size_t i = 0;
+    int status = 0;
+
+    shared_list = SkipListCreate(CmpRecords, SKIPLIST_CONCURRENT_READS);
+    assert(NULL != shared_list);
+    atomic_init(&writer_done, 0);
+
+    for (i = 0; i < SHARED_KEYS; ++i)
+    {
+        shared[i].key = (int)i;
+        shared[i].id = i;
+        SkipListInsert(shared_list, shared + i);
+    }
+    for (i = 0; i < RECLAIM_READERS; ++i)
+    {
+        seeds[i] = i + 2;
+        status = pthread_create(&readers[i], NULL, ReadOverlapping, &seeds[i]);
+        assert(0 == status);
+    }
+
+    /* the first round settles the heap */
+    for (i = 0; i < 2 * RECLAIM_OPS; ++i)
+    {
+        if (RECLAIM_OPS == i)
+        {
+            rss = RssKB();
+        }
+        idx = NextRandom(&seed) % (SHARED_KEYS / 2) * 2 + 1;
+        iter = SkipListFind(shared_list, shared + idx);
+        assert(shared + idx == SkipListGetData(iter));
+        SkipListRemove(iter);
+        iter = SkipListInsert(shared_list, shared + idx);
+        assert(shared + idx == SkipListGetData(iter));
+    }
+#ifndef __SANITIZE_ADDRESS__
+    assert(RssKB() - rss < RECLAIM_SLACK_KB);
+#endif
+
+    atomic_store(&writer_done, 1);
+    for (i = 0; i < RECLAIM_READERS; ++i)
+    {
+        pthread_join(readers[i], NULL);
+    }
+    assert(SHARED_KEYS == SkipListSize(shared_list));
+    SkipListDestroy(shared_list);
+    (void)iter;
+    (void)rss;
+    (void)status;
+}
+
+static void *ReadOverlapping(void *arg)
+{
+    size_t *seed = (size_t *)arg;
+    skiplist_read_t sections[2];
+    skiplist_iter_t iter;
+    record_t key;
+    size_t open = 0;
+
+    sections[open] = SkipListReadBegin(shared_list);
+    while (!atomic_load(&writer_done))
+    {
+        sections[!open] = SkipListReadBegin(shared_list);
+        SkipListReadEnd(shared_list, sections[open]);
+        open = !open;
+
+        key.key = (int)(NextRandom(seed) % (SHARED_KEYS / 2) * 2);
+        iter = SkipListFind(shared_list, &key);
+        assert(shared + key.key == SkipListGetData(iter));
+        iter = SkipListNext(iter);
+        assert(SkipListIsIterSame(iter, SkipListEnd(shared_list)) ||
+               key.key < ((record_t *)SkipListGetData(iter))->key);
+    }
+    SkipListReadEnd(shared_list, sections[open]);
+    (void)iter;
+
+    return NULL;
+}
+
+/* rand is not meant to be shared between threads, each one has its own */
+static size_t NextRandom(size_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+
+    return (*seed / 65536 % 32768);
+}
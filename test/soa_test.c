@@ -0,0 +1,355 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 soa_test.c ../src/soa.c ../src/dvector.c -I../inc -o soa.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memset */
+#include <limits.h> /* LONG_MIN */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "soa.h" /* soa_t */
+#include "dvector.h" /* dvector_t */
+
+#define DEADLINE (0)
+#define ID (1)
+#define TAG (2)
+#define NUM_COLUMNS (3)
+#define TAG_SIZE (3)
+#define TEST_ROWS (1000)
+#define BENCH_ROWS (1000000)
+#define BENCH_ROUNDS (20)
+#define PAYLOAD_SIZE (48)
+
+/* the same fields as one row of the soa in the benchmark, 64 bytes */
+typedef struct row
+{
+    long deadline;
+    unsigned long id;
+    char payload[PAYLOAD_SIZE];
+} row_t;
+
+static double NowNs(void);
+static void TestAddRemove(void);
+static void TestResize(void);
+static void TestFilter(size_t rows);
+static soa_t *MakeRows(size_t capacity, size_t rows);
+static void PushRow(soa_t *soa, unsigned long id);
+static void CheckRow(const soa_t *soa, size_t idx, unsigned long id);
+static long DeadlineOf(unsigned long id);
+static void BenchFilter(void);
+
+int main(void)
+{
+    TestAddRemove();
+    TestResize();
+    TestFilter(0);
+    TestFilter(1);
+    TestFilter(63);
+    TestFilter(64);
+    TestFilter(65);
+    TestFilter(TEST_ROWS);
+
+    BenchFilter();
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+/* swap removes from the front, the middle and the back, mirrored on a
+   plain array of ids */
+static void TestAddRemove(void)
+{
+    soa_t *soa = MakeRows(4, TEST_ROWS);
+    unsigned long model[TEST_ROWS];
+    size_t size = TEST_ROWS;
+    size_t idx = 0;
+    size_t i = 0;
+
+    for (i = 0; i < TEST_ROWS; ++i)
+    {
+        model[i] = i;
+        CheckRow(soa, i, i);
+    }
+
+    while (0 < size)
+    {
+        if (3 == size % 4)
+        {
+            SoaPopBack(soa);
+        }
+        else
+        {
+            idx = (0 == size % 4) ? 0 :
+                  (1 == size % 4) ? size - 1 : (size_t)rand() % size;
+            SoaSwapRemove(soa, idx);
+            model[idx] = model[size - 1];
+        }
+        --size;
+
+        assert(size == SoaSize(soa));
+        for (i = 0; i < size; ++i)
+        {
+            CheckRow(soa, i, model[i]);
+        }
+    }
+
+    /* emptied rows are pushed over */
+    PushRow(soa, 7);
+    assert(1 == SoaSize(soa));
+    CheckRow(soa, 0, 7);
+
+    SoaDestroy(soa);
+}
+
+/* every column has to keep its rows when it moves, in both directions */
+static void TestResize(void)
+{
+    soa_t *soa = MakeRows(1, 0);
+    size_t capacity = 0;
+    size_t i = 0;
+    size_t j = 0;
+    int status = 0;
+
+    status = SoaReserve(soa, 0);
+    assert(0 == status);
+    assert(1 == SoaCapacity(soa));
+
+    for (i = 0; i < TEST_ROWS; ++i)
+    {
+        capacity = SoaCapacity(soa);
+        PushRow(soa, i);
+        if (capacity != SoaCapacity(soa))
+        {
+            assert(2 * capacity == SoaCapacity(soa));
+            for (j = 0; j <= i; ++j)
+            {
+                CheckRow(soa, j, j);
+            }
+        }
+    }
+
+    status = SoaReserve(soa, 4 * TEST_ROWS);
+    assert(0 == status);
+    assert(4 * TEST_ROWS == SoaCapacity(soa));
+
+    /* shrinking stops at the size */
+    status = SoaReserve(soa, 1);
+    assert(0 == status);
+    assert(TEST_ROWS == SoaCapacity(soa));
+    for (i = 0; i < TEST_ROWS; ++i)
+    {
+        CheckRow(soa, i, i);
+    }
+
+    PushRow(soa, TEST_ROWS);
+    assert(TEST_ROWS < SoaCapacity(soa));
+    CheckRow(soa, TEST_ROWS, TEST_ROWS);
+    assert(DeadlineOf(0) == *(long *)SoaGetColumn(soa, DEADLINE));
+
+    SoaDestroy(soa);
+    (void)status;
+}
+
+/* both results against a plain loop, for thresholds that match nothing,
+   everything and some of it. Random deadlines leave whole blocks of 64
+   without a match at the low thresholds */
+static void TestFilter(size_t rows)
+{
+    long thresholds[] = {LONG_MIN, -1, 0, 50, 1000, 500000, LONG_MAX};
+    soa_t *soa = MakeRows(1, 0);
+    size_t *indices = (size_t *)malloc((rows + 1) * sizeof(size_t));
+    long deadline = 0;
+    size_t found = 0;
+    size_t expected = 0;
+    size_t t = 0;
+    size_t i = 0;
+
+    assert(NULL != indices);
+    for (i = 0; i < rows; ++i)
+    {
+        PushRow(soa, (unsigned long)rand() % 1000000);
+    }
+    /* the extremes take part too */
+    if (2 < rows)
+    {
+        deadline = LONG_MIN;
+        *(long *)SoaGetField(soa, DEADLINE, 0) = deadline;
+        deadline = LONG_MAX;
+        *(long *)SoaGetField(soa, DEADLINE, rows - 1) = deadline;
+    }
+
+    for (t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); ++t)
+    {
+        found = SoaFilterLess(soa, DEADLINE, thresholds[t], indices);
+        assert(found == SoaCountLess(soa, DEADLINE, thresholds[t]));
+
+        expected = 0;
+        for (i = 0; i < rows; ++i)
+        {
+            deadline = *(long *)SoaGetField(soa, DEADLINE, i);
+            if (deadline < thresholds[t])
+            {
+                assert(expected < found && i == indices[expected]);
+                ++expected;
+            }
+        }
+        assert(expected == found);
+    }
+    (void)found;
+
+    free(indices);
+    SoaDestroy(soa);
+}
+
+static soa_t *MakeRows(size_t capacity, size_t rows)
+{
+    size_t sizes[NUM_COLUMNS] = {sizeof(long), sizeof(unsigned long),
+                                 TAG_SIZE};
+    soa_t *soa = SoaCreate(NUM_COLUMNS, sizes, capacity);
+    size_t i = 0;
+
+    assert(NULL != soa);
+    assert(0 == SoaSize(soa) && capacity == SoaCapacity(soa));
+    for (i = 0; i < rows; ++i)
+    {
+        PushRow(soa, i);
+    }
+
+    return soa;
+}
+
+static void PushRow(soa_t *soa, unsigned long id)
+{
+    long deadline = DeadlineOf(id);
+    unsigned char tag[TAG_SIZE];
+    const void *fields[NUM_COLUMNS];
+    int status = 0;
+
+    tag[0] = (unsigned char)id;
+    tag[1] = (unsigned char)(id >> 8);
+    tag[2] = (unsigned char)(id >> 16);
+    fields[DEADLINE] = &deadline;
+    fields[ID] = &id;
+    fields[TAG] = tag;
+
+    status = SoaPushBack(soa, fields);
+    assert(0 == status);
+    (void)status;
+}
+
+static void CheckRow(const soa_t *soa, size_t idx, unsigned long id)
+{
+    const unsigned char *tag = SoaGetField(soa, TAG, idx);
+
+    assert(DeadlineOf(id) == *(long *)SoaGetField(soa, DEADLINE, idx));
+    assert(id == *(unsigned long *)SoaGetField(soa, ID, idx));
+    assert((unsigned char)id == tag[0] &&
+           (unsigned char)(id >> 8) == tag[1] &&
+           (unsigned char)(id >> 16) == tag[2]);
+    (void)tag;
+    (void)id;
+}
+
+/* negative for small ids so thresholds around 0 split the rows */
+static long DeadlineOf(unsigned long id)
+{
+    return ((long)id - 100);
+}
+
+/* collecting the rows whose deadline passed, from a soa and from an array
+   of 64 byte rows in a dvector. The soa reads 8 of every 64 bytes the
+   dvector does */
+static void BenchFilter(void)
+{
+    size_t sizes[NUM_COLUMNS] = {sizeof(long), sizeof(unsigned long),
+                                 PAYLOAD_SIZE};
+    long percents[] = {0, 1, 10, 50, 100};
+    soa_t *soa = SoaCreate(NUM_COLUMNS, sizes, BENCH_ROWS);
+    dvector_t *dvector = DvectorCreate(BENCH_ROWS, sizeof(row_t));
+    size_t *indices = (size_t *)malloc(BENCH_ROWS * sizeof(size_t));
+    const void *fields[NUM_COLUMNS];
+    const row_t *rows = NULL;
+    row_t row;
+    long threshold = 0;
+    double soa_ns = 0;
+    double aos_ns = 0;
+    size_t soa_found = 0;
+    size_t aos_found = 0;
+    size_t round = 0;
+    size_t p = 0;
+    size_t i = 0;
+    int status = 0;
+
+    assert(NULL != soa && NULL != dvector && NULL != indices);
+    memset(&row, 0, sizeof(row));
+    fields[DEADLINE] = &row.deadline;
+    fields[ID] = &row.id;
+    fields[TAG] = row.payload;
+    for (i = 0; i < BENCH_ROWS; ++i)
+    {
+        row.deadline = rand() % 1000;
+        row.id = i;
+        status = SoaPushBack(soa, fields);
+        assert(0 == status);
+        status = DvectorPushBack(dvector, &row);
+        assert(0 == status);
+    }
+    rows = DvectorGetAccessToElement(dvector, 0);
+
+    printf("%d rows, ms per scan\n", BENCH_ROWS);
+    printf("%10s %10s %12s %12s\n", "matching", "rows", "soa filter",
+           "aos loop");
+    for (p = 0; p < sizeof(percents) / sizeof(percents[0]); ++p)
+    {
+        threshold = percents[p] * 10;
+
+        soa_ns = NowNs();
+        for (round = 0; round < BENCH_ROUNDS; ++round)
+        {
+            soa_found = SoaFilterLess(soa, DEADLINE, threshold, indices);
+        }
+        soa_ns = (NowNs() - soa_ns) / BENCH_ROUNDS;
+
+        aos_ns = NowNs();
+        for (round = 0; round < BENCH_ROUNDS; ++round)
+        {
+            aos_found = 0;
+            for (i = 0; i < BENCH_ROWS; ++i)
+            {
+                if (rows[i].deadline < threshold)
+                {
+                    indices[aos_found++] = i;
+                }
+            }
+        }
+        aos_ns = (NowNs() - aos_ns) / BENCH_ROUNDS;
+        assert(soa_found == aos_found);
+
+        printf("%9ld%% %10lu %12.2f %12.2f\n", percents[p],
+               (unsigned long)soa_found, soa_ns / 1e6, aos_ns / 1e6);
+    }
+
+    free(indices);
+    DvectorDestroy(dvector);
+    SoaDestroy(soa);
+    (void)status;
+}
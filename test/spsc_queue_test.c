@@ -0,0 +1,254 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 -pthread spsc_queue_test.c ../src/spsc_queue.c -I../inc -o spsc_queue.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <string.h> /* memset, memcmp */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+#include <sched.h> /* sched_yield */
+#include <pthread.h> /* pthread_create */
+
+#include "spsc_queue.h" /* spsc_queue_t */
+
+#define ODD_SIZE (3)
+#define WRAP_ROUNDS (1000)
+#define NUM_MESSAGES (2000000)
+
+typedef struct transfer
+{
+    spsc_queue_t *queue;
+    size_t count;
+} transfer_t;
+
+static double NowNs(void);
+static void TestCapacityOne(void);
+static void TestFullAndEmpty(void);
+static void TestWrapAround(void);
+static double TestThreads(size_t capacity);
+static void *Produce(void *arg);
+static void MakeElement(size_t seq, unsigned char element[ODD_SIZE]);
+
+int main(void)
+{
+    size_t capacities[] = {2, 64, 4096};
+    size_t i = 0;
+
+    TestCapacityOne();
+    TestFullAndEmpty();
+    TestWrapAround();
+
+    printf("%d messages, one producer thread and one consumer\n",
+           NUM_MESSAGES);
+    printf("%10s %12s\n", "capacity", "Mmsg/s");
+    for (i = 0; i < sizeof(capacities) / sizeof(capacities[0]); ++i)
+    {
+        printf("%10lu %12.2f\n", (unsigned long)capacities[i],
+               TestThreads(capacities[i]));
+    }
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+static void TestCapacityOne(void)
+{
+    spsc_queue_t *queue = SPSCQueueCreate(1, sizeof(size_t));
+    size_t value = 7;
+    int status = 0;
+
+    assert(NULL != queue);
+    assert(1 == SPSCQueueCapacity(queue));
+
+    status = SPSCQueueDequeue(queue, &value);
+    assert(-1 == status && 7 == value);
+    status = SPSCQueueEnqueue(queue, &value);
+    assert(0 == status && 1 == SPSCQueueSize(queue));
+    value = 8;
+    status = SPSCQueueEnqueue(queue, &value);
+    assert(-1 == status && 1 == SPSCQueueSize(queue));
+    status = SPSCQueueDequeue(queue, &value);
+    assert(0 == status && 7 == value);
+    status = SPSCQueueDequeue(queue, &value);
+    assert(-1 == status && 0 == SPSCQueueSize(queue));
+
+    SPSCQueueDestroy(queue);
+    (void)status;
+}
+
+/* a full queue refuses until the consumer frees a slot, and the producer
+   has to see that slot through its stale cached head */
+static void TestFullAndEmpty(void)
+{
+    spsc_queue_t *queue = SPSCQueueCreate(5, ODD_SIZE);
+    unsigned char element[ODD_SIZE];
+    unsigned char expected[ODD_SIZE];
+    size_t capacity = 0;
+    size_t i = 0;
+    int status = 0;
+
+    assert(NULL != queue);
+    capacity = SPSCQueueCapacity(queue);
+    assert(8 == capacity);
+
+    for (i = 0; i < capacity; ++i)
+    {
+        MakeElement(i, element);
+        status = SPSCQueueEnqueue(queue, element);
+        assert(0 == status);
+    }
+    MakeElement(capacity, element);
+    status = SPSCQueueEnqueue(queue, element);
+    assert(-1 == status && capacity == SPSCQueueSize(queue));
+
+    status = SPSCQueueDequeue(queue, element);
+    MakeElement(0, expected);
+    assert(0 == status && 0 == memcmp(expected, element, ODD_SIZE));
+    MakeElement(capacity, element);
+    status = SPSCQueueEnqueue(queue, element);
+    assert(0 == status);
+    status = SPSCQueueEnqueue(queue, element);
+    assert(-1 == status);
+
+    for (i = 1; i <= capacity; ++i)
+    {
+        status = SPSCQueueDequeue(queue, element);
+        MakeElement(i, expected);
+        assert(0 == status && 0 == memcmp(expected, element, ODD_SIZE));
+    }
+
+    /* a failed dequeue leaves the output alone */
+    memset(element, 0xAB, ODD_SIZE);
+    status = SPSCQueueDequeue(queue, element);
+    assert(-1 == status && 0xAB == element[0] && 0xAB == element[2]);
+    assert(0 == SPSCQueueSize(queue));
+
+    SPSCQueueDestroy(queue);
+    (void)status;
+}
+
+/* the indices run far past the capacity, at every fill level */
+static void TestWrapAround(void)
+{
+    spsc_queue_t *queue = SPSCQueueCreate(4, sizeof(size_t));
+    size_t next_in = 0;
+    size_t next_out = 0;
+    size_t value = 0;
+    size_t round = 0;
+    size_t i = 0;
+    int status = 0;
+
+    assert(NULL != queue);
+    for (round = 0; round < WRAP_ROUNDS; ++round)
+    {
+        for (i = 0; i <= round % 5; ++i)
+        {
+            status = SPSCQueueEnqueue(queue, &next_in);
+            if (4 == next_in - next_out)
+            {
+                assert(-1 == status);
+                break;
+            }
+            assert(0 == status);
+            ++next_in;
+        }
+        assert(next_in - next_out == SPSCQueueSize(queue));
+
+        for (i = 0; i <= (round * 7) % 5; ++i)
+        {
+            status = SPSCQueueDequeue(queue, &value);
+            if (next_out == next_in)
+            {
+                assert(-1 == status);
+                break;
+            }
+            assert(0 == status && next_out == value);
+            ++next_out;
+        }
+    }
+
+    SPSCQueueDestroy(queue);
+    (void)status;
+}
+
+/* every message arrives once and in order, through a queue that is
+   full or empty much of the time */
+static double TestThreads(size_t capacity)
+{
+    transfer_t transfer;
+    pthread_t producer;
+    size_t expected = 0;
+    size_t value = 0;
+    double ns = 0;
+    int status = 0;
+
+    transfer.queue = SPSCQueueCreate(capacity, sizeof(size_t));
+    transfer.count = NUM_MESSAGES;
+    assert(NULL != transfer.queue);
+
+    ns = NowNs();
+    status = pthread_create(&producer, NULL, Produce, &transfer);
+    assert(0 == status);
+    while (expected < NUM_MESSAGES)
+    {
+        if (0 != SPSCQueueDequeue(transfer.queue, &value))
+        {
+            sched_yield();
+            continue;
+        }
+        assert(expected == value);
+        ++expected;
+    }
+    pthread_join(producer, NULL);
+    ns = NowNs() - ns;
+
+    status = SPSCQueueDequeue(transfer.queue, &value);
+    assert(-1 == status);
+
+    SPSCQueueDestroy(transfer.queue);
+    (void)status;
+
+    return (NUM_MESSAGES / ns * 1e3);
+}
+
+static void *Produce(void *arg)
+{
+    transfer_t *transfer = (transfer_t *)arg;
+    size_t value = 0;
+
+    while (value < transfer->count)
+    {
+        if (0 != SPSCQueueEnqueue(transfer->queue, &value))
+        {
+            sched_yield();
+            continue;
+        }
+        ++value;
+    }
+
+    return NULL;
+}
+
+static void MakeElement(size_t seq, unsigned char element[ODD_SIZE])
+{
+    element[0] = (unsigned char)seq;
+    element[1] = (unsigned char)(seq * 31);
+    element[2] = (unsigned char)~seq;
+}
@@ -0,0 +1,213 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -O2 ulist_test.c ../src/ulist.c ../src/dlist.c -I../inc -o ulist.out
+*/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc */
+#include <assert.h> /* assert */
+#include <time.h> /* clock_gettime */
+
+#include "ulist.h" /* ulist_t */
+#include "dlist.h" /* dlist_t */
+
+#define MIN_ELEMENTS (1000)
+#define MAX_ELEMENTS (10000000)
+#define CHECK_ELEMENTS (5000)
+
+static double NowNs(void);
+static void TestEdits(void);
+static int Sum(void *data, void *param);
+static int IsEqual(const void *data, void *param);
+
+int main(void)
+{
+    size_t *values = NULL;
+    ulist_t *ulist = NULL;
+    dlist_t *dlist = NULL;
+    size_t elements = 0;
+    size_t missing = MAX_ELEMENTS;
+    size_t sum = 0;
+    size_t i = 0;
+    double start = 0;
+    double ulist_walk = 0;
+    double dlist_walk = 0;
+    double ulist_find = 0;
+    double dlist_find = 0;
+    ulist_iter_t ufound;
+    dlist_iter_t dfound;
+
+    TestEdits();
+
+    values = (size_t *)malloc(MAX_ELEMENTS * sizeof(size_t));
+    assert(NULL != values);
+    for (i = 0; i < MAX_ELEMENTS; ++i)
+    {
+        values[i] = i;
+    }
+
+    printf("%10s %14s %14s %14s %14s\n", "elements", "ulist walk ns",
+           "dlist walk ns", "ulist find ns", "dlist find ns");
+    for (elements = MIN_ELEMENTS; elements <= MAX_ELEMENTS; elements *= 10)
+    {
+        ulist = UListCreate();
+        dlist = DListCreate();
+        assert(NULL != ulist && NULL != dlist);
+        for (i = 0; i < elements; ++i)
+        {
+            UListPushBack(ulist, values + i);
+            DListPushBack(dlist, values + i);
+        }
+
+        sum = 0;
+        start = NowNs();
+        UListForEach(UListBegin(ulist), UListEnd(ulist), Sum, &sum);
+        ulist_walk = NowNs() - start;
+        assert(elements * (elements - 1) / 2 == sum);
+
+        sum = 0;
+        start = NowNs();
+        DListForEach(DListBegin(dlist), DListEnd(dlist), Sum, &sum);
+        dlist_walk = NowNs() - start;
+        assert(elements * (elements - 1) / 2 == sum);
+
+        /* a miss walks the whole list through the match callback */
+        start = NowNs();
+        ufound = UListFind(UListBegin(ulist), UListEnd(ulist), IsEqual,
+                           &missing);
+        ulist_find = NowNs() - start;
+        assert(UListIsIterSame(UListEnd(ulist), ufound));
+
+        start = NowNs();
+        dfound = DListFind(DListBegin(dlist), DListEnd(dlist), IsEqual,
+                           &missing);
+        dlist_find = NowNs() - start;
+        assert(DListIsIterSame(DListEnd(dlist), dfound));
+
+        printf("%10lu %14.0f %14.0f %14.0f %14.0f\n", (unsigned long)elements,
+               ulist_walk, dlist_walk, ulist_find, dlist_find);
+
+        UListDestroy(ulist);
+        DListDestroy(dlist);
+    }
+    free(values);
+    (void)ufound;
+    (void)dfound;
+
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec * 1e9 + now.tv_nsec);
+}
+
+/* mixed inserts and removes in the middle must keep the same order as a
+   dlist fed the same operations */
+static void TestEdits(void)
+{
+    static size_t values[CHECK_ELEMENTS];
+    ulist_t *ulist = UListCreate();
+    dlist_t *dlist = DListCreate();
+    ulist_iter_t uiter;
+    dlist_iter_t diter;
+    size_t steps = 0;
+    size_t i = 0;
+    void *upopped = NULL;
+    void *dpopped = NULL;
+
+    assert(NULL != ulist && NULL != dlist);
+
+    for (i = 0; i < CHECK_ELEMENTS; ++i)
+    {
+        values[i] = i;
+        steps = (i * 7919) % (UListCount(ulist) + 1);
+        uiter = UListBegin(ulist);
+        diter = DListBegin(dlist);
+        for (; 0 < steps; --steps)
+        {
+            uiter = UListNext(uiter);
+            diter = DListNext(diter);
+        }
+        uiter = UListInsert(uiter, values + i);
+        assert(values + i == UListGetData(uiter));
+        DListInsert(diter, values + i);
+
+        if (0 == i % 3)
+        {
+            steps = (i * 104729) % UListCount(ulist);
+            uiter = UListBegin(ulist);
+            diter = DListBegin(dlist);
+            for (; 0 < steps; --steps)
+            {
+                uiter = UListNext(uiter);
+                diter = DListNext(diter);
+            }
+            uiter = UListRemove(uiter);
+            diter = DListRemove(diter);
+            assert(UListIsIterSame(uiter, UListEnd(ulist)) ==
+                   DListIsIterSame(diter, DListEnd(dlist)));
+        }
+    }
+
+    assert(UListCount(ulist) == DListCount(dlist));
+    uiter = UListBegin(ulist);
+    for (diter = DListBegin(dlist); !DListIsIterSame(diter, DListEnd(dlist));
+         diter = DListNext(diter))
+    {
+        assert(UListGetData(uiter) == DListGetData(diter));
+        uiter = UListNext(uiter);
+    }
+    assert(UListIsIterSame(uiter, UListEnd(ulist)));
+
+    /* and backwards */
+    for (diter = DListEnd(dlist); !DListIsIterSame(diter, DListBegin(dlist));)
+    {
+        diter = DListPrev(diter);
+        uiter = UListPrev(uiter);
+        assert(UListGetData(uiter) == DListGetData(diter));
+    }
+
+    while (!UListIsEmpty(ulist))
+    {
+        upopped = UListPopFront(ulist);
+        dpopped = DListPopFront(dlist);
+        assert(upopped == dpopped);
+        if (!UListIsEmpty(ulist))
+        {
+            upopped = UListPopBack(ulist);
+            dpopped = DListPopBack(dlist);
+            assert(upopped == dpopped);
+        }
+    }
+    assert(DListIsEmpty(dlist));
+
+    UListDestroy(ulist);
+    DListDestroy(dlist);
+    (void)upopped;
+    (void)dpopped;
+}
+
+static int Sum(void *data, void *param)
+{
+    *(size_t *)param += *(size_t *)data;
+
+    return 0;
+}
+
+static int IsEqual(const void *data, void *param)
+{
+    return (*(const size_t *)data == *(size_t *)param);
+}
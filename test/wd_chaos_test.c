@@ -0,0 +1,731 @@
+/*//////////////////////////////////////
+Name: Alon Weinberg
+Reviewer:
+Last Date Updated: 19/10/26
+File Type: Test File
+//////////////////////////////////////*/
+/*
+compile with:
+gcc -pthread wd.c wd_client.c scheduler.c dvector.c heap.c pq_heap.c task.c
+    uid.c -I../inc -o wd.out
+gcc -pthread ../test/wd_chaos_test.c wd_client.c scheduler.c dvector.c heap.c
+    pq_heap.c task.c uid.c -I../inc -o wd_chaos.out
+run from the folder of wd.out as ./wd_chaos.out [rounds per stress mode]
+*/
+
+#define _GNU_SOURCE /* prctl, clock_gettime */
+
+#include <stdio.h> /* printf, fopen */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* strcmp, memcpy */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* fork, execl, pipe */
+#include <signal.h> /* kill, SIGSTOP */
+#include <fcntl.h> /* fcntl, open */
+#include <dirent.h> /* opendir */
+#include <semaphore.h> /* sem_unlink */
+#include <sys/wait.h> /* waitpid */
+#include <sys/prctl.h> /* PR_SET_CHILD_SUBREAPER */
+
+#include "wd_client.h" /* WDStart */
+
+#define DEFAULT_ROUNDS (4)
+#define POLL_NS (5e6)
+#define START_TIMEOUT_NS (10e9)
+#define DETECT_TIMEOUT_NS (30e9)
+#define REVIVE_TIMEOUT_NS (10e9)
+#define SHORT_HANG_MIN_MS (500)
+#define SHORT_HANG_MAX_MS (3500)
+#define QUIET_MIN_MS (1000)
+#define QUIET_MAX_MS (3000)
+#define SETTLE_NS (2e9)
+#define MEM_STRESS_MB (256)
+#define PAGE_SIZE (4096)
+#define NUM_BUCKETS (64)
+#define BUCKET_MS (250)
+#define MAX_KNOWN (4096)
+#define MAX_WORKERS (64)
+
+/* the semaphores of wd_client.c, left behind by a killed pair */
+#define USER_SEM_NAME ("USER_SEMA")
+#define WD_SEM_NAME ("WD_SEMA")
+
+/* a short hang is resumed before the peer's error limit and should not
+   be revived. A long hang is, like a kill */
+typedef enum fault
+{
+    KILL_CLIENT = 0,
+    KILL_WD,
+    HANG_CLIENT,
+    HANG_WD,
+    SHORT_HANG_CLIENT,
+    SHORT_HANG_WD,
+    NUM_FAULTS
+} fault_t;
+
+typedef enum stress
+{
+    STRESS_NONE = 0,
+    STRESS_CPU,
+    STRESS_MEMORY,
+    STRESS_BOTH,
+    NUM_STRESS
+} stress_t;
+
+/* BUCKET_MS wide, the last one takes everything above */
+typedef struct histogram
+{
+    size_t counts[NUM_BUCKETS];
+    size_t total;
+    double sum_ms;
+    double max_ms;
+} histogram_t;
+
+typedef struct chaos
+{
+    const char *self;
+    int up_fds[2];
+    pid_t client;
+    pid_t wd;
+    pid_t known[MAX_KNOWN];
+    size_t num_known;
+    pid_t workers[MAX_WORKERS];
+    size_t num_workers;
+    histogram_t detection;
+    histogram_t revival;
+    histogram_t false_hangs;
+    size_t faults[NUM_STRESS];
+    size_t missed[NUM_STRESS];
+    size_t false_quiet[NUM_STRESS];
+    size_t false_hang[NUM_STRESS];
+    double detection_ms[NUM_STRESS];
+    double revival_ms[NUM_STRESS];
+    size_t revived[NUM_STRESS];
+} chaos_t;
+
+static const char *stress_names[] = {"none", "cpu", "memory", "cpu+memory"};
+
+static int RunClient(char *argv[]);
+static int StartPair(chaos_t *chaos);
+static void StopPair(chaos_t *chaos, pid_t extra);
+static int Quiet(chaos_t *chaos, stress_t stress, double ns);
+static int Inject(chaos_t *chaos, stress_t stress, fault_t fault);
+static int ShortHang(chaos_t *chaos, stress_t stress, pid_t victim);
+static void StartStress(chaos_t *chaos, stress_t stress);
+static void StopStress(chaos_t *chaos);
+static pid_t NewChild(const chaos_t *chaos, pid_t parent);
+static int ReadStat(pid_t pid, char *comm, size_t comm_size, char *state,
+                    pid_t *ppid);
+static int IsWD(pid_t pid);
+static int WaitUp(chaos_t *chaos, pid_t pid, double deadline);
+static void AddKnown(chaos_t *chaos, pid_t pid);
+static void Reap(void);
+static void HistAdd(histogram_t *hist, double ms);
+static void HistPrint(const histogram_t *hist, const char *title);
+static void Report(const chaos_t *chaos, size_t rounds);
+static void SleepNs(double ns);
+static double NowNs(void);
+
+/* a guarded client and its wd.out get faults at random, each after a
+   quiet spell, once without stress and then under CPU, memory and both.
+   Detection is the peer forking the revived process, revival is that
+   process being up: a client reports its pid on a pipe after WDStart, a
+   wd is up once it runs wd.out. Any fork during a quiet spell or a short
+   hang is a false positive */
+int main(int argc, char *argv[])
+{
+    static chaos_t chaos;
+    size_t rounds = DEFAULT_ROUNDS;
+    size_t round = 0;
+    int stress = 0;
+
+    if (3 == argc && 0 == strcmp("client", argv[1]))
+    {
+        return RunClient(argv);
+    }
+    if (2 == argc)
+    {
+        rounds = (size_t)atoi(argv[1]);
+    }
+    if (0 != access("./wd.out", X_OK))
+    {
+        fprintf(stderr, "run from the folder of wd.out\n");
+        return 1;
+    }
+
+    chaos.self = argv[0];
+    srand((unsigned int)time(NULL));
+    unsetenv("WD_PID");
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+    if (0 != pipe(chaos.up_fds))
+    {
+        perror("pipe");
+        return 1;
+    }
+    fcntl(chaos.up_fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(chaos.up_fds[0], F_SETFD, FD_CLOEXEC);
+
+    for (stress = 0; NUM_STRESS > stress; ++stress)
+    {
+        StartStress(&chaos, (stress_t)stress);
+        if (!StartPair(&chaos))
+        {
+            fprintf(stderr, "the pair did not start\n");
+            StopStress(&chaos);
+            return 1;
+        }
+
+        for (round = 0; round < rounds; ++round)
+        {
+            if (!Quiet(&chaos, (stress_t)stress,
+                       (QUIET_MIN_MS + rand() % (QUIET_MAX_MS - QUIET_MIN_MS))
+                       * 1e6) ||
+                !Inject(&chaos, (stress_t)stress,
+                        (fault_t)(rand() % NUM_FAULTS)))
+            {
+                if (!StartPair(&chaos))
+                {
+                    fprintf(stderr, "the pair did not restart\n");
+                    break;
+                }
+            }
+        }
+
+        StopPair(&chaos, 0);
+        StopStress(&chaos);
+    }
+
+    Report(&chaos, rounds);
+
+    return 0;
+}
+
+/* the guarded side. Revived clients run this again with the same
+   arguments, the pipe came down to them through wd.out */
+static int RunClient(char *argv[])
+{
+    const char *cmd[3] = {0};
+    pid_t pid = getpid();
+    int up_fd = atoi(argv[2]);
+
+    cmd[0] = argv[0];
+    cmd[1] = (char *)argv;
+    cmd[2] = 0;
+
+    if (SUCCESS_WD != WDStart(cmd))
+    {
+        return 1;
+    }
+    if (sizeof(pid) != write(up_fd, &pid, sizeof(pid)))
+    {
+        return 1;
+    }
+
+    for (;;)
+    {
+        pause();
+    }
+
+    return 0;
+}
+
+/* kills whatever pair there is and starts a fresh one, with its output
+   going to /dev/null */
+static int StartPair(chaos_t *chaos)
+{
+    char fd_str[16];
+    double deadline = 0;
+    pid_t pid = 0;
+    int devnull = -1;
+
+    StopPair(chaos, 0);
+    sem_unlink(USER_SEM_NAME);
+    sem_unlink(WD_SEM_NAME);
+
+    pid = fork();
+    if (-1 == pid)
+    {
+        return 0;
+    }
+    if (0 == pid)
+    {
+        devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        sprintf(fd_str, "%d", chaos->up_fds[1]);
+        execl(chaos->self, chaos->self, "client", fd_str, (char *)NULL);
+        _exit(127);
+    }
+
+    chaos->client = pid;
+    AddKnown(chaos, pid);
+    deadline = NowNs() + START_TIMEOUT_NS;
+    if (!WaitUp(chaos, pid, deadline))
+    {
+        return 0;
+    }
+    while (0 == chaos->wd && NowNs() < deadline)
+    {
+        pid = NewChild(chaos, chaos->client);
+        if (0 != pid && IsWD(pid))
+        {
+            chaos->wd = pid;
+            AddKnown(chaos, pid);
+        }
+        SleepNs(POLL_NS);
+    }
+    SleepNs(SETTLE_NS);
+
+    return (0 != chaos->wd);
+}
+
+/* extra is a process of the pair that the harness no longer tracks,
+   0 if there is none */
+static void StopPair(chaos_t *chaos, pid_t extra)
+{
+    pid_t pid = 0;
+
+    if (0 != chaos->client)
+    {
+        while (0 != (pid = NewChild(chaos, chaos->client)))
+        {
+            kill(pid, SIGKILL);
+            AddKnown(chaos, pid);
+        }
+        kill(chaos->client, SIGKILL);
+    }
+    if (0 != chaos->wd)
+    {
+        while (0 != (pid = NewChild(chaos, chaos->wd)))
+        {
+            kill(pid, SIGKILL);
+            AddKnown(chaos, pid);
+        }
+        kill(chaos->wd, SIGKILL);
+    }
+    if (0 != extra)
+    {
+        kill(extra, SIGKILL);
+    }
+    chaos->client = 0;
+    chaos->wd = 0;
+    SleepNs(POLL_NS);
+    Reap();
+}
+
+static int Quiet(chaos_t *chaos, stress_t stress, double ns)
+{
+    double deadline = NowNs() + ns;
+
+    while (NowNs() < deadline)
+    {
+        if (0 != NewChild(chaos, chaos->client) ||
+            0 != NewChild(chaos, chaos->wd))
+        {
+            ++chaos->false_quiet[stress];
+            return 0;
+        }
+        Reap();
+        SleepNs(POLL_NS);
+    }
+
+    return 1;
+}
+
+static int Inject(chaos_t *chaos, stress_t stress, fault_t fault)
+{
+    int victim_is_client = (0 == fault % 2);
+    pid_t victim = victim_is_client ? chaos->client : chaos->wd;
+    pid_t survivor = victim_is_client ? chaos->wd : chaos->client;
+    pid_t revived = 0;
+    double start = 0;
+    double detected = 0;
+    double up = 0;
+    int is_up = 0;
+
+    ++chaos->faults[stress];
+    if (SHORT_HANG_CLIENT <= fault)
+    {
+        return ShortHang(chaos, stress, victim);
+    }
+
+    start = NowNs();
+    kill(victim, (KILL_CLIENT == fault || KILL_WD == fault) ? SIGKILL :
+                                                              SIGSTOP);
+    while (0 == revived && NowNs() < start + DETECT_TIMEOUT_NS)
+    {
+        SleepNs(POLL_NS);
+        revived = NewChild(chaos, survivor);
+    }
+    detected = NowNs();
+    if (0 == revived)
+    {
+        ++chaos->missed[stress];
+        StopPair(chaos, victim);
+        return 0;
+    }
+    AddKnown(chaos, revived);
+
+    if (victim_is_client)
+    {
+        is_up = WaitUp(chaos, revived, detected + REVIVE_TIMEOUT_NS);
+    }
+    while (!victim_is_client && !(is_up = IsWD(revived)) &&
+           NowNs() < detected + REVIVE_TIMEOUT_NS)
+    {
+        SleepNs(POLL_NS);
+    }
+    up = NowNs();
+    if (!is_up)
+    {
+        ++chaos->missed[stress];
+        StopPair(chaos, revived);
+        return 0;
+    }
+
+    if (HANG_CLIENT == fault || HANG_WD == fault)
+    {
+        kill(victim, SIGKILL);
+    }
+    if (victim_is_client)
+    {
+        chaos->client = revived;
+    }
+    else
+    {
+        chaos->wd = revived;
+    }
+
+    HistAdd(&chaos->detection, (detected - start) / 1e6);
+    HistAdd(&chaos->revival, (up - start) / 1e6);
+    chaos->detection_ms[stress] += (detected - start) / 1e6;
+    chaos->revival_ms[stress] += (up - start) / 1e6;
+    ++chaos->revived[stress];
+    SleepNs(SETTLE_NS);
+
+    return 1;
+}
+
+/* stopped for less than the error limit, then resumed and watched for a
+   while, as a late revive would come once the peer catches up */
+static int ShortHang(chaos_t *chaos, stress_t stress, pid_t victim)
+{
+    double hang_ms = SHORT_HANG_MIN_MS +
+                     rand() % (SHORT_HANG_MAX_MS - SHORT_HANG_MIN_MS);
+    double start = NowNs();
+    double deadline = start + hang_ms * 1e6;
+
+    kill(victim, SIGSTOP);
+    while (NowNs() < deadline + SETTLE_NS)
+    {
+        if (NowNs() >= deadline)
+        {
+            kill(victim, SIGCONT);
+        }
+        if (0 != NewChild(chaos, chaos->client) ||
+            0 != NewChild(chaos, chaos->wd))
+        {
+            kill(victim, SIGCONT);
+            ++chaos->false_hang[stress];
+            HistAdd(&chaos->false_hangs, hang_ms);
+            return 0;
+        }
+        SleepNs(POLL_NS);
+    }
+
+    return 1;
+}
+
+/* CPU stress is two spinning processes per CPU. Memory stress keeps
+   writing over MEM_STRESS_MB, a page at a time */
+static void StartStress(chaos_t *chaos, stress_t stress)
+{
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long num_spinners = 0;
+    volatile unsigned long spin = 0;
+    char *memory = NULL;
+    size_t i = 0;
+    pid_t pid = 0;
+
+    if (STRESS_CPU == stress || STRESS_BOTH == stress)
+    {
+        num_spinners = 2 * ((0 < num_cpus) ? num_cpus : 1);
+    }
+    if (MAX_WORKERS - 1 < num_spinners)
+    {
+        num_spinners = MAX_WORKERS - 1;
+    }
+
+    for (i = 0; (size_t)num_spinners > i; ++i)
+    {
+        pid = fork();
+        if (0 == pid)
+        {
+            for (;;)
+            {
+                ++spin;
+            }
+        }
+        if (0 < pid)
+        {
+            chaos->workers[chaos->num_workers++] = pid;
+        }
+    }
+
+    if (STRESS_MEMORY == stress || STRESS_BOTH == stress)
+    {
+        pid = fork();
+        if (0 == pid)
+        {
+            memory = (char *)malloc((size_t)MEM_STRESS_MB << 20);
+            for (i = 0; NULL != memory; i = (i + PAGE_SIZE) %
+                                            ((size_t)MEM_STRESS_MB << 20))
+            {
+                memory[i] = (char)i;
+            }
+            _exit(1);
+        }
+        if (0 < pid)
+        {
+            chaos->workers[chaos->num_workers++] = pid;
+        }
+    }
+}
+
+static void StopStress(chaos_t *chaos)
+{
+    size_t i = 0;
+
+    for (i = 0; chaos->num_workers > i; ++i)
+    {
+        kill(chaos->workers[i], SIGKILL);
+        waitpid(chaos->workers[i], NULL, 0);
+    }
+    chaos->num_workers = 0;
+}
+
+/* a live child of parent that is not part of the pair yet. /proc is
+   scanned for it, as not every kernel lists children per task */
+static pid_t NewChild(const chaos_t *chaos, pid_t parent)
+{
+    DIR *proc = opendir("/proc");
+    struct dirent *entry = NULL;
+    pid_t found = 0;
+    pid_t pid = 0;
+    pid_t ppid = 0;
+    char state = 0;
+    size_t i = 0;
+
+    if (NULL == proc || 0 == parent)
+    {
+        if (NULL != proc)
+        {
+            closedir(proc);
+        }
+        return 0;
+    }
+
+    while (0 == found && NULL != (entry = readdir(proc)))
+    {
+        pid = (pid_t)atoi(entry->d_name);
+        if (0 >= pid || !ReadStat(pid, NULL, 0, &state, &ppid) ||
+            parent != ppid || 'Z' == state)
+        {
+            continue;
+        }
+        for (i = 0; chaos->num_known > i && pid != chaos->known[i]; ++i)
+        {
+        }
+        if (i == chaos->num_known)
+        {
+            found = pid;
+        }
+    }
+    closedir(proc);
+
+    return found;
+}
+
+/* the command name sits in parentheses and may hold spaces of its own */
+static int ReadStat(pid_t pid, char *comm, size_t comm_size, char *state,
+                    pid_t *ppid)
+{
+    char path[64];
+    char line[512];
+    char *open_paren = NULL;
+    char *close_paren = NULL;
+    FILE *stat = NULL;
+    int pid_num = 0;
+    size_t len = 0;
+
+    sprintf(path, "/proc/%d/stat", (int)pid);
+    stat = fopen(path, "r");
+    if (NULL == stat)
+    {
+        return 0;
+    }
+    if (NULL == fgets(line, sizeof(line), stat))
+    {
+        fclose(stat);
+        return 0;
+    }
+    fclose(stat);
+
+    open_paren = strchr(line, '(');
+    close_paren = strrchr(line, ')');
+    if (NULL == open_paren || NULL == close_paren ||
+        2 != sscanf(close_paren + 1, " %c %d", state, &pid_num))
+    {
+        return 0;
+    }
+    *ppid = (pid_t)pid_num;
+
+    if (NULL != comm)
+    {
+        len = (size_t)(close_paren - open_paren - 1);
+        len = (len < comm_size) ? len : comm_size - 1;
+        memcpy(comm, open_paren + 1, len);
+        comm[len] = '\0';
+    }
+
+    return 1;
+}
+
+static int IsWD(pid_t pid)
+{
+    char comm[32];
+    char state = 0;
+    pid_t ppid = 0;
+
+    return (ReadStat(pid, comm, sizeof(comm), &state, &ppid) &&
+            0 == strcmp("wd.out", comm));
+}
+
+/* pids of other clients that come up meanwhile are dropped */
+static int WaitUp(chaos_t *chaos, pid_t pid, double deadline)
+{
+    pid_t up = 0;
+
+    while (NowNs() < deadline)
+    {
+        while (sizeof(up) == read(chaos->up_fds[0], &up, sizeof(up)))
+        {
+            if (pid == up)
+            {
+                return 1;
+            }
+        }
+        SleepNs(POLL_NS);
+    }
+
+    return 0;
+}
+
+static void AddKnown(chaos_t *chaos, pid_t pid)
+{
+    if (MAX_KNOWN > chaos->num_known)
+    {
+        chaos->known[chaos->num_known++] = pid;
+    }
+}
+
+/* killed processes whose parents are gone come to the harness, as a
+   subreaper */
+static void Reap(void)
+{
+    while (0 < waitpid(-1, NULL, WNOHANG))
+    {
+    }
+}
+
+static void HistAdd(histogram_t *hist, double ms)
+{
+    size_t bucket = (size_t)(ms / BUCKET_MS);
+
+    bucket = (NUM_BUCKETS - 1 < bucket) ? NUM_BUCKETS - 1 : bucket;
+    ++hist->counts[bucket];
+    ++hist->total;
+    hist->sum_ms += ms;
+    hist->max_ms = (ms > hist->max_ms) ? ms : hist->max_ms;
+}
+
+static void HistPrint(const histogram_t *hist, const char *title)
+{
+    size_t first = 0;
+    size_t last = NUM_BUCKETS;
+    size_t bucket = 0;
+    size_t i = 0;
+
+    printf("\n%s, ms: %lu", title, (unsigned long)hist->total);
+    if (0 == hist->total)
+    {
+        printf("\n");
+        return;
+    }
+    printf(", mean %.1f, max %.1f\n", hist->sum_ms / hist->total,
+           hist->max_ms);
+
+    while (0 == hist->counts[first])
+    {
+        ++first;
+    }
+    while (0 == hist->counts[last - 1])
+    {
+        --last;
+    }
+    for (bucket = first; bucket < last; ++bucket)
+    {
+        printf("%6lu - %6lu | %5lu ", (unsigned long)(bucket * BUCKET_MS),
+               (unsigned long)((bucket + 1) * BUCKET_MS),
+               (unsigned long)hist->counts[bucket]);
+        for (i = 0; i < hist->counts[bucket] * 40 / hist->total + 1 &&
+                    0 < hist->counts[bucket]; ++i)
+        {
+            printf("#");
+        }
+        printf("\n");
+    }
+}
+
+static void Report(const chaos_t *chaos, size_t rounds)
+{
+    int stress = 0;
+
+    printf("%lu faults per stress mode\n", (unsigned long)rounds);
+    printf("%-11s %7s %7s %8s %8s %12s %12s\n", "stress", "faults",
+           "missed", "fp quiet", "fp hang", "detect ms", "revive ms");
+    for (stress = 0; NUM_STRESS > stress; ++stress)
+    {
+        printf("%-11s %7lu %7lu %8lu %8lu %12.1f %12.1f\n",
+               stress_names[stress], (unsigned long)chaos->faults[stress],
+               (unsigned long)chaos->missed[stress],
+               (unsigned long)chaos->false_quiet[stress],
+               (unsigned long)chaos->false_hang[stress],
+               chaos->revived[stress] ?
+               chaos->detection_ms[stress] / chaos->revived[stress] : 0.0,
+               chaos->revived[stress] ?
+               chaos->revival_ms[stress] / chaos->revived[stress] : 0.0);
+    }
+
+    HistPrint(&chaos->detection, "detection latency");
+    HistPrint(&chaos->revival, "revive latency");
+    HistPrint(&chaos->false_hangs, "short hangs revived anyway, by hang");
+}
+
+static void SleepNs(double ns)
+{
+    struct timespec delay;
+
+    delay.tv_sec = (time_t)(ns / 1e9);
+    delay.tv_nsec = (long)(ns - (double)delay.tv_sec * 1e9);
+    nanosleep(&delay, NULL);
+}
+
+static double NowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((double)now.tv_sec * 1e9 + (double)now.tv_nsec);
+}